@@ -16,6 +16,11 @@
 # systemd ExecStart line.  If --module or --uds are not present among the
 # forwarded arguments the user is prompted interactively.
 #
+# With --hot-restart among the forwarded arguments the unit is generated as
+# Type=notify with an ExecReload that sends SIGUSR2, so
+# "systemctl --user reload" (and upgrade.sh) restart lswasm without
+# dropping connections.
+#
 # Example:
 #   ./install.sh --bin ./build/lswasm --install-dir /opt/lswasm \
 #                -- --module /etc/lswasm/filter.wasm --uds /run/lswasm.sock
@@ -172,7 +177,7 @@ for i in "${!LSWASM_ARGS[@]}"; do
         LSWASM_ARGS[$next_i]="$(realpath "${LSWASM_ARGS[$next_i]}")"
       fi
       ;;
-    --uds)
+    --uds|--hot-restart)
       next_i=$((i + 1))
       if [[ $next_i -lt ${#LSWASM_ARGS[@]} ]]; then
         LSWASM_ARGS[$next_i]="${LSWASM_ARGS[$next_i]/#\~/$HOME}"
@@ -213,6 +218,20 @@ for arg in "${LSWASM_ARGS[@]+"${LSWASM_ARGS[@]}"}"; do
   EXEC_START+=" $(printf '%q' "$arg")"
 done
 
+# ── Service type ─────────────────────────────────────────────────────────
+# With --hot-restart, lswasm reports readiness itself and a reload re-execs
+# it: the successor announces its own PID (MAINPID=) once it serves, which
+# NotifyAccess=all lets systemd accept from a process other than the
+# current main one.
+HOT_RESTART=false
+SERVICE_TYPE="Type=simple"
+if has_arg "--hot-restart" "${LSWASM_ARGS[@]+"${LSWASM_ARGS[@]}"}"; then
+  HOT_RESTART=true
+  SERVICE_TYPE="Type=notify
+NotifyAccess=all
+ExecReload=/bin/kill -USR2 \$MAINPID"
+fi
+
 # ── Generate systemd user unit ───────────────────────────────────────────
 UNIT_DIR="${HOME}/.config/systemd/user"
 UNIT_PATH="${UNIT_DIR}/${SERVICE_NAME}"
@@ -224,7 +243,7 @@ Description=lswasm — WASM HTTP Proxy Server
 After=network.target
 
 [Service]
-Type=simple
+${SERVICE_TYPE}
 ExecStart=${EXEC_START}
 Restart=on-failure
 RestartSec=5s
@@ -244,6 +263,7 @@ INSTALLED_BIN=${INSTALLED_BIN}
 INSTALL_DIR=${INSTALL_DIR}
 SERVICE_NAME=${SERVICE_NAME}
 UNIT_PATH=${UNIT_PATH}
+HOT_RESTART=${HOT_RESTART}
 EOF
 echo "State saved to $STATE_FILE"
 
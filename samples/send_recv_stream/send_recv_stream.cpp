@@ -226,6 +226,17 @@ FilterHeadersStatus SendRecvStreamContext::onRequestHeaders(
     return FilterHeadersStatus::StopIteration;
   }
 
+  // Echo the body as it arrives rather than in large batches: any
+  // buffered bytes wake the filter (min_chunk 1, host max_chunk, no
+  // latency).  Hosts without lswasm_set_body_delivery keep their default.
+  const uint32_t delivery[3] = {1, 0, 0};
+  char *result = nullptr;
+  size_t result_size = 0;
+  static constexpr std::string_view kSetBodyDelivery = "lswasm_set_body_delivery";
+  proxy_call_foreign_function(kSetBodyDelivery.data(), kSetBodyDelivery.size(),
+                              reinterpret_cast<const char *>(delivery), sizeof(delivery),
+                              &result, &result_size);
+
   // Tell the host to keep delivering body data to this filter.
   return FilterHeadersStatus::Continue;
 }
@@ -0,0 +1,93 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2026  LiteSpeed Technologies, Inc.                        *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+
+/**
+ * CoarseClock — process-wide cached wall-clock and monotonic time.
+ *
+ * Every running reactor refreshes the cache once per loop turn, and its
+ * timer tick (TIMER_TICK_MS) wakes an idle loop, so a cached reading is
+ * never more than one tick old and under load it is as fresh as the last
+ * event.  Hot readers — the WASM host's time calls, log timestamps,
+ * connection timestamps — load an atomic instead of calling
+ * clock_gettime().
+ *
+ * The cache is only trusted while at least one reactor drives it
+ * (attach() / detach()).  Otherwise — the LSAPI transport, startup,
+ * shutdown — reads fall through to clock_gettime().
+ *
+ * With several reactors the monotonic reading only ever moves forward;
+ * the wall clock is whatever the last refresh saw.
+ */
+class CoarseClock {
+public:
+    /// Nanoseconds since the Unix epoch (CLOCK_REALTIME).
+    static uint64_t realtimeNs() {
+        if (drivers_.load(std::memory_order_relaxed) == 0) return read(CLOCK_REALTIME);
+        return realtime_.load(std::memory_order_relaxed);
+    }
+
+    /// Nanoseconds on CLOCK_MONOTONIC (the clock behind steady_clock).
+    static uint64_t monotonicNs() {
+        if (drivers_.load(std::memory_order_relaxed) == 0) return read(CLOCK_MONOTONIC);
+        return monotonic_.load(std::memory_order_relaxed);
+    }
+
+    /// monotonicNs() as a steady_clock time point.
+    static std::chrono::steady_clock::time_point steadyNow() {
+        return std::chrono::steady_clock::time_point(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::nanoseconds(monotonicNs())));
+    }
+
+    /// Take fresh readings.  Returns the monotonic one.
+    static uint64_t refresh() {
+        uint64_t mono = read(CLOCK_MONOTONIC);
+        realtime_.store(read(CLOCK_REALTIME), std::memory_order_relaxed);
+        uint64_t cur = monotonic_.load(std::memory_order_relaxed);
+        while (mono > cur &&
+               !monotonic_.compare_exchange_weak(cur, mono, std::memory_order_relaxed)) {
+        }
+        return mono;
+    }
+
+    /// A reactor starts (stops) refreshing the cache.
+    static void attach() {
+        refresh();
+        drivers_.fetch_add(1, std::memory_order_relaxed);
+    }
+    static void detach() { drivers_.fetch_sub(1, std::memory_order_relaxed); }
+
+private:
+    static uint64_t read(clockid_t id) {
+        struct timespec ts;
+        clock_gettime(id, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull +
+               static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    static inline std::atomic<uint64_t> realtime_{0};
+    static inline std::atomic<uint64_t> monotonic_{0};
+    static inline std::atomic<int> drivers_{0};
+};
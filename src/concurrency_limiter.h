@@ -0,0 +1,166 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2026  LiteSpeed Technologies, Inc.                        *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "coarse_clock.h"
+#include "server_stats.h"
+
+inline constexpr size_t DEFAULT_CONCURRENCY_HEADROOM = 4;     // auto limit ceiling, x pool capacity
+inline constexpr uint64_t CONCURRENCY_WINDOW_NS = 100000000;  // 100 ms between limit updates
+inline constexpr uint32_t CONCURRENCY_WINDOW_SAMPLES = 10;    // fewest samples for an update
+inline constexpr double CONCURRENCY_TOLERANCE = 1.5;          // latency growth accepted before backing off
+inline constexpr double CONCURRENCY_SMOOTHING = 0.2;          // weight of a new estimate
+inline constexpr double CONCURRENCY_BASELINE_WINDOWS = 600;   // windows averaged into the baseline
+
+/**
+ * ConcurrencyLimiter — adaptive cap on the requests one worker pool has
+ * in flight, after Netflix's gradient limiter.
+ *
+ * The reactors call tryAcquire() before dispatching a request and answer
+ * it with 503 on the spot when the pool is at its limit; the worker calls
+ * release() with the request's latency once its response is complete
+ * (see ConnectionIO::admit()).  Once
+ * per window (100 ms with at least 10 samples) the mean latency of the
+ * window is compared with a slow moving average of past windows, the
+ * baseline:
+ *
+ *     gradient = clamp(1.5 × baseline / latency, 0.5, 1)
+ *     limit    = limit × gradient + √limit
+ *
+ * smoothed and kept within [min, max].  While latency stays within half
+ * as much again of the baseline the limit grows by √limit per window;
+ * once requests queue up and latency climbs, it shrinks towards what the
+ * workers complete at that latency.  The limit is not raised while the
+ * pool used less than half of it — idle capacity says nothing about
+ * overload.  When min == max the limit is fixed.
+ *
+ * tryAcquire() is a CAS on the in-flight count; release() takes a mutex
+ * to fold its sample into the window.
+ */
+class ConcurrencyLimiter {
+public:
+    ConcurrencyLimiter(size_t initial, size_t min_limit, size_t max_limit)
+        : min_(std::max<size_t>(min_limit, 1)), max_(std::max(max_limit, min_)),
+          estimate_(static_cast<double>(std::clamp(initial, min_, max_))),
+          limit_(std::clamp(initial, min_, max_)) {
+        server_stats().concurrency_limit.fetch_add(limit_.load(std::memory_order_relaxed),
+                                                   std::memory_order_relaxed);
+    }
+
+    ~ConcurrencyLimiter() {
+        server_stats().concurrency_limit.fetch_sub(limit_.load(std::memory_order_relaxed),
+                                                   std::memory_order_relaxed);
+    }
+
+    // Non-copyable, non-movable.
+    ConcurrencyLimiter(const ConcurrencyLimiter &) = delete;
+    ConcurrencyLimiter &operator=(const ConcurrencyLimiter &) = delete;
+
+    /// Admit one request, or count it as shed and return false if the
+    /// limit is reached.  Any thread.
+    bool tryAcquire() {
+        size_t cur = in_flight_.load(std::memory_order_relaxed);
+        do {
+            if (cur >= limit_.load(std::memory_order_relaxed)) {
+                server_stats().requests_shed.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        } while (!in_flight_.compare_exchange_weak(cur, cur + 1, std::memory_order_relaxed));
+        server_stats().requests_in_flight.fetch_add(1, std::memory_order_relaxed);
+        uint64_t peak = window_peak_.load(std::memory_order_relaxed);
+        while (cur + 1 > peak &&
+               !window_peak_.compare_exchange_weak(peak, cur + 1, std::memory_order_relaxed)) {
+        }
+        return true;
+    }
+
+    /// An admitted request finished after \p latency_ns.
+    void release(uint64_t latency_ns) {
+        cancel();
+        if (min_ == max_) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        window_sum_ns_ += latency_ns;
+        ++window_samples_;
+        uint64_t now = CoarseClock::monotonicNs();
+        if (window_start_ns_ == 0) window_start_ns_ = now;
+        if (now - window_start_ns_ < CONCURRENCY_WINDOW_NS ||
+            window_samples_ < CONCURRENCY_WINDOW_SAMPLES) {
+            return;
+        }
+        update(std::max(static_cast<double>(window_sum_ns_) / window_samples_, 1.0));
+        window_start_ns_ = now;
+        window_sum_ns_ = 0;
+        window_samples_ = 0;
+    }
+
+    /// An admitted request left without a latency sample (discarded).
+    void cancel() {
+        in_flight_.fetch_sub(1, std::memory_order_relaxed);
+        server_stats().requests_in_flight.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    size_t limit() const { return limit_.load(std::memory_order_relaxed); }
+    size_t inFlight() const { return in_flight_.load(std::memory_order_relaxed); }
+
+private:
+    // Fold one window's mean latency into the limit.  Called under mutex_.
+    void update(double latency) {
+        if (baseline_ == 0) baseline_ = latency;
+        baseline_ += (latency - baseline_) * (2 / (CONCURRENCY_BASELINE_WINDOWS + 1));
+        // Latency well below the baseline: the load that raised it is gone.
+        if (baseline_ > 2 * latency) baseline_ *= 0.95;
+
+        double gradient = std::clamp(CONCURRENCY_TOLERANCE * baseline_ / latency, 0.5, 1.0);
+        uint64_t peak = window_peak_.exchange(in_flight_.load(std::memory_order_relaxed),
+                                              std::memory_order_relaxed);
+        if (gradient >= 1.0 && static_cast<double>(peak) < estimate_ / 2) return;  // not using it
+
+        double target = estimate_ * gradient + std::sqrt(estimate_);
+        estimate_ = std::clamp(estimate_ * (1 - CONCURRENCY_SMOOTHING) + target * CONCURRENCY_SMOOTHING,
+                               static_cast<double>(min_), static_cast<double>(max_));
+        size_t next = static_cast<size_t>(estimate_);
+        size_t prev = limit_.exchange(next, std::memory_order_relaxed);
+        std::atomic<uint64_t> &gauge = server_stats().concurrency_limit;
+        if (next > prev) {
+            gauge.fetch_add(next - prev, std::memory_order_relaxed);
+        } else {
+            gauge.fetch_sub(prev - next, std::memory_order_relaxed);
+        }
+    }
+
+    const size_t min_;
+    const size_t max_;
+    std::atomic<size_t> in_flight_{0};
+    std::atomic<uint64_t> window_peak_{0};  // most requests in flight this window
+
+    std::mutex mutex_;
+    double estimate_;                       // unrounded limit
+    double baseline_ = 0;                   // long-term mean latency, ns
+    uint64_t window_start_ns_ = 0;
+    uint64_t window_sum_ns_ = 0;
+    uint32_t window_samples_ = 0;
+    std::atomic<size_t> limit_;
+};
@@ -18,14 +18,61 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <string>
 #include <string_view>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
 #include <cstring>
+#include <memory>
+#include <utility>
+#include <fcntl.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 
+#include "concurrency_limiter.h"
+#include "fair_queue.h"
+#include "file_cache.h"
+#include "http_parser.h"
 #include "log.h"
+#include "ready_queue.h"
+#include "server_stats.h"
+#include "spsc_ring.h"
+#include "thread_pool.h"
+
+// ConnectionIO buffer configuration
+inline constexpr size_t DEFAULT_BODY_HIGH_WATERMARK = 262144;  // 256 KB of body buffered before reads pause
+inline constexpr size_t DEFAULT_BODY_LOW_WATERMARK = 65536;    // reads resume once the worker drains to 64 KB
+inline constexpr size_t DEFAULT_BODY_PREBUFFER = 65536;        // bodies up to 64 KB are collected before dispatch
+inline constexpr size_t DEFAULT_BODY_DELIVERY_MIN = 65536;     // body bytes that wake a waiting worker
+inline constexpr size_t DEFAULT_BODY_DELIVERY_MAX = 524288;    // most body bytes handed over per read
+inline constexpr uint32_t DEFAULT_BODY_DELIVERY_LATENCY = 10;  // ms a smaller batch may wait
+inline constexpr size_t DEFAULT_EGRESS_DEPTH = 64;   // response segments queued in memory per request
+inline constexpr size_t DEFAULT_OUTPUT_BUDGET = 1048576;  // 1 MB of queued response bytes before spilling
+inline constexpr size_t EGRESS_TAKE_IOV = 16;    // segments looked at per takeResponse() round
+inline constexpr size_t FILE_COPY_CHUNK = 65536;  // bytes per pread() when a file range must be copied
+inline constexpr std::string_view HTTP_100_CONTINUE = "HTTP/1.1 100 Continue\r\n\r\n";
+
+/// Per-request buffer limits, fixed for the lifetime of a reactor.
+struct ConnectionLimits {
+    size_t body_high_watermark = DEFAULT_BODY_HIGH_WATERMARK;  // body ring fill that pauses reading
+    size_t body_low_watermark = DEFAULT_BODY_LOW_WATERMARK;    // fill at which reading resumes
+    size_t body_prebuffer = DEFAULT_BODY_PREBUFFER;  // body received before dispatch (0 = none)
+    size_t egress_depth = DEFAULT_EGRESS_DEPTH;    // response segments queued in memory
+    size_t output_budget = DEFAULT_OUTPUT_BUDGET;  // response bytes queued in memory before spilling
+};
+
+/// How readBodyChunk() batches request body bytes for the worker.
+struct BodyDelivery {
+    size_t min_chunk = DEFAULT_BODY_DELIVERY_MIN;  // buffered bytes that are delivered at once
+    size_t max_chunk = DEFAULT_BODY_DELIVERY_MAX;  // largest chunk returned by one read
+    uint32_t max_latency_ms = DEFAULT_BODY_DELIVERY_LATENCY;  // oldest byte's wait before a smaller chunk goes
+};
 
 /**
  * ConnectionIO — bridge between a worker thread and the epoll event loop.
@@ -34,14 +81,90 @@
  * in-memory buffers via this class.
  *
  * Thread safety:
- *   - Worker calls: headers(), bodyPrefix(), contentLength(),
- *     readBodyChunk(), writeData(), finish()
- *   - Epoll-loop calls: setHeaderData(), feedBody(), pendingWriteData(),
- *     advanceWrite(), isWritePending(), isFinished(), needsWriteEvent()
- *   - Shared state is protected by read_mutex_ / write_mutex_.
+ *   - Worker calls: request(), field(), headers(), bodyPrefix(),
+ *     contentLength(), lengthUnknown(), hasBody(), expectsContinue(), bodyReceived(),
+ *     secure(), readBodyChunk(), trailers(), writeData(), writeFile(),
+ *     finish(), keepAlive(), disableKeepAlive()
+ *   - Epoll-loop calls: setRequest(), setKeepAlive(), setStreamId(), setSecure(),
+ *     feedBody(), endBody(), pendingWriteSegments(), advanceWrite(),
+ *     pendingFile(), advanceFile(), takeResponse(), isFinished(), keepAlive()
+ *
+ * Both directions are single-producer / single-consumer rings, so the
+ * fast path takes no lock:
+ *   - Request body: the reactor writes received bytes into a byte ring
+ *     (SpscByteRing, allocated only for requests whose body streams in
+ *     after the headers); the worker reads them out.  Once the ring holds
+ *     body_high_watermark bytes, feedBody() takes no more and the reactor
+ *     stops reading from the socket; the worker notifies it when it has
+ *     drained the ring to body_low_watermark.  A chunked body is decoded
+ *     by the reactor and streams through the same ring; its length is
+ *     known only once the reactor has seen the last chunk (endBody()).
+ *     An HTTP/2 stream's DATA frames arrive the same way.
+ *   - Response: every writeData() call queues one segment (the string is
+ *     moved, not copied) on a segment ring of egress_depth entries.  The
+ *     reactor sends all queued segments with one gather write
+ *     (pendingWriteSegments() + sendmsg).  writeFile() queues a range of
+ *     an open file instead (a file segment): the reactor stops the gather
+ *     write in front of it and sends it with sendfile() (pendingFile() /
+ *     advanceFile()), so the bytes never enter user space.  A file segment
+ *     holds no buffer memory and does not count against the output budget.
+ *
+ * Response writes never wait for the client.  Once the queued bytes would
+ * exceed the output budget, or the segment ring is full, the response
+ * spills: a spill marker is queued, and this and every later write is
+ * appended to an anonymous memory file (memfd, or an unlinked tmpfile).
+ * After the in-memory segments ahead of the marker, the reactor sends the
+ * spill file with sendfile(), like a file segment.  A file range written
+ * after the spill began is copied into the spill file.  A worker
+ * therefore returns to the pool as soon as the filter chain is done, and
+ * slow readers cost memory-file pages rather than threads.  Only if no
+ * spill file can be created does the worker fall back to waiting for room.
+ *
+ * A mutex and condition variable per direction are used only to park a
+ * side that has to wait; the other side takes the lock only if it sees
+ * the waiting flag set.  A handler running on a pool fiber (--fibers)
+ * waits for body bytes by suspending the fiber rather than the thread.
+ *
+ * Buffered body bytes and unsent response bytes (queued segments and
+ * spill file) are counted in the ServerStats gauges body_bytes_buffered
+ * and response_bytes_buffered, which the reactors hold against the
+ * process-wide memory budget.
+ *
+ * Notification: whenever the worker produces output, finishes, fails or
+ * frees body-ring space the reactor is waiting for, the connection pushes
+ * itself onto its reactor's ReadyQueue.  The reactor only looks at
+ * connections that were pushed, never at idle ones.
+ *
+ * Inline mode: when a request runs to completion on the reactor thread
+ * itself (the body already fully received), writeData() queues segments
+ * without waiting and the connection is not queued — the reactor flushes
+ * the segments once the handler returns.
+ *
+ * Dispatch: the object is its own ThreadPool task.  submitTo() queues it
+ * with a reference to itself that the worker takes over, so handing a
+ * request to the pool allocates nothing and the reactor cannot recycle the
+ * object before the handler has run.  With --class, it is submitted to the
+ * pool's FairQueue instead, which holds it until its class's turn.  A
+ * request admitted by a ConcurrencyLimiter (see admit()) gives its slot
+ * back once its response is complete — before the reactor can start the
+ * connection's next request — reporting its latency without the time the
+ * handler spent waiting for the client to send body bytes or take
+ * response bytes.
+ *
+ * Expect: 100-continue: a client that sent the expectation holds its body
+ * back until it sees the interim response.  Nothing is promised when the
+ * request is dispatched; the first readBodyChunk() that has to wait for
+ * body bytes queues "100 Continue" ahead of any response.  A handler that
+ * answers without reading the body (a filter rejecting the upload in
+ * onRequestHeaders) therefore never solicits it, and once a final response
+ * has been queued no 100 is sent at all.
  */
-class ConnectionIO {
+class ConnectionIO : public ReadyQueue::Node,
+                     public FairQueue::Node,
+                     public std::enable_shared_from_this<ConnectionIO> {
 public:
+    using Handler = std::function<void(const std::shared_ptr<ConnectionIO> &)>;
+
     enum class BodyReadStatus {
         Data,
         Complete,
@@ -54,8 +177,12 @@ public:
         BodyReadStatus status = BodyReadStatus::Data;
     };
 
-    explicit ConnectionIO(int fd, int event_fd)
-        : fd_(fd), event_fd_(event_fd) {}
+    ConnectionIO(int fd, ReadyQueue *ready, uint32_t generation = 0,
+                 const ConnectionLimits &limits = ConnectionLimits())
+        : fd_(fd), generation_(generation), ready_(ready), limits_(limits),
+          egress_(limits.egress_depth) {}
+
+    ~ConnectionIO() override { releaseBuffers(); }
 
     // Non-copyable, non-movable
     ConnectionIO(const ConnectionIO &) = delete;
@@ -63,256 +190,890 @@ public:
 
     int fd() const { return fd_; }
 
+    /// Reactor slot generation this request belongs to (see HttpReactor).
+    uint32_t generation() const { return generation_; }
+
+    /// Recycle the object for a new request on \p fd.  Only the reactor may
+    /// call this, and only once it holds the sole reference: buffers keep
+    /// their capacity, everything else returns to the initial state.
+    void reset(int fd, uint32_t generation) {
+        releaseBuffers();
+        fd_ = fd;
+        generation_ = generation;
+        request_buf_.clear();
+        request_.clear();
+        prefix_len_ = 0;
+        content_length_ = 0;
+        length_unknown_ = false;
+        continue_pending_ = false;
+        stream_id_ = 0;
+        secure_ = false;
+        trailers_.clear();
+        keep_alive_.store(false, std::memory_order_relaxed);
+        inline_ = false;
+        body_bytes_fed_.store(0, std::memory_order_relaxed);
+        body_length_.store(0, std::memory_order_relaxed);
+        read_eof_.store(false, std::memory_order_relaxed);
+        read_error_.store(false, std::memory_order_relaxed);
+        feed_paused_.store(false, std::memory_order_relaxed);
+        write_cursor_ = 0;
+        spilling_ = false;
+        spill_written_.store(0, std::memory_order_relaxed);
+        spill_sent_ = 0;
+        finished_.store(false, std::memory_order_relaxed);
+        write_error_.store(false, std::memory_order_relaxed);
+    }
+
+    /// Drop any body and response bytes still queued (an aborted request)
+    /// and return them to the buffered-bytes gauges.  Same calling rules
+    /// as reset(); the reactor calls it when the object goes back to the
+    /// pool so an idle object holds no accounted memory.
+    void releaseBuffers() {
+        ServerStats &st = server_stats();
+        if (body_ring_) {
+            st.body_bytes_buffered.fetch_sub(body_ring_->readable(), std::memory_order_relaxed);
+            body_ring_->clear();
+        }
+        egress_.clear();
+        size_t unsent = egress_bytes_.exchange(0, std::memory_order_relaxed);
+        if (spill_fd_ >= 0) {
+            unsent += spill_written_.exchange(0, std::memory_order_relaxed) - spill_sent_;
+            spill_sent_ = 0;
+            close(spill_fd_);
+            spill_fd_ = -1;
+        }
+        st.response_bytes_buffered.fetch_sub(unsent, std::memory_order_relaxed);
+    }
+
     // ════════════════════════════════════════════════════════════════════
     //  Epoll-loop-side setup (called before dispatching to worker)
     // ════════════════════════════════════════════════════════════════════
 
-    /// Set the raw header data and any body prefix bytes that arrived
-    /// with the headers.  Also set the parsed Content-Length.
-    void setHeaderData(std::string header_data, std::string body_prefix,
-                       size_t content_length) {
-        header_data_ = std::move(header_data);
-        body_prefix_ = std::move(body_prefix);
-        content_length_ = content_length;
-        if (body_prefix_.size() > content_length_) {
-            body_prefix_.resize(content_length_);
+    /// Run \p handler on this request from a worker of \p pool.  The
+    /// handler must outlive the pool's workers.
+    void submitTo(ThreadPool &pool, const Handler &handler) {
+        dispatch_handler_ = &handler;
+        dispatch_ref_ = shared_from_this();
+        pool.submit(*this);
+    }
+
+    /// As above, through \p queue: the request waits there in the class
+    /// its Host (or :authority), target and body select.
+    void submitTo(FairQueue &queue, const Handler &handler) {
+        std::string_view host;
+        for (const HttpHeaderSpan &h : request_.headers) {
+            std::string_view name = field(h.name);
+            if ((name.size() == 4 && strncasecmp(name.data(), "host", 4) == 0) ||
+                name == ":authority") {
+                host = field(h.value);
+                break;
+            }
         }
-        body_bytes_fed_ = body_prefix_.size();
+        size_t cls = request_classes().classify(host, field(request_.target), hasBody());
+        dispatch_handler_ = &handler;
+        dispatch_ref_ = shared_from_this();
+        queue.submit(*this, cls);
+    }
+
+    /// Count this request against \p limiter (which has admitted it)
+    /// until it finishes.  Call before submitTo().
+    void admit(ConcurrencyLimiter &limiter) {
+        limiter_ = &limiter;
+        admitted_ns_ = steady_ns();
+        client_wait_ns_ = 0;
+    }
+
+    void run() override {
+        std::shared_ptr<ConnectionIO> self = std::move(dispatch_ref_);
+        (*dispatch_handler_)(self);
+        fairDone();
+        release_limiter();
+    }
+
+    void discard() override {
+        if (ConcurrencyLimiter *limiter = std::exchange(limiter_, nullptr)) limiter->cancel();
+        dispatch_ref_.reset();
     }
 
+    /// Take over a parsed request.  \p buf holds the request head that
+    /// \p req describes, any body bytes that arrived with it and possibly
+    /// the start of the next pipelined request.  Buffer and parse result
+    /// are swapped in, not copied: on return \p buf holds only the bytes
+    /// past this request's body prefix (in this object's previous buffer)
+    /// and \p req this object's previous, cleared, parse result.  A body of
+    /// unknown length has no prefix: all bytes past the head are returned
+    /// in \p buf for the reactor to decode.
+    void setRequest(std::string &buf, ParsedRequest &req) {
+        request_buf_.swap(buf);
+        std::swap(request_, req);
+        req.clear();
+        content_length_ = request_.content_length;
+        length_unknown_ = request_.length_unknown;
+        prefix_len_ = length_unknown_ ? 0 : std::min(request_buf_.size() - request_.header_end,
+                                                     content_length_);
+        size_t used = request_.header_end + prefix_len_;
+        buf.assign(request_buf_, used, std::string::npos);
+        request_buf_.resize(used);
+        body_bytes_fed_.store(prefix_len_, std::memory_order_relaxed);
+        body_length_.store(length_unknown_ ? UNKNOWN_LENGTH : content_length_,
+                           std::memory_order_relaxed);
+        // A body already on its way needs no invitation.
+        continue_pending_ = request_.expect_continue && prefix_len_ == 0 && hasBody();
+        // The rest of the body streams in through the ring.
+        if ((length_unknown_ || prefix_len_ < content_length_) && !body_ring_) {
+            body_ring_ = std::make_unique<SpscByteRing>(limits_.body_high_watermark);
+        }
+    }
+
+    /// Record whether the connection may be reused after this response.
+    /// Set by the epoll loop from the request's version / Connection header
+    /// and the server's keep-alive limits.
+    void setKeepAlive(bool keep_alive) {
+        keep_alive_.store(keep_alive, std::memory_order_relaxed);
+    }
+
+    /// Mark the request as running on the reactor thread (see class
+    /// comment).  Must be called before the handler starts.
+    void setInline(bool inline_mode) { inline_ = inline_mode; }
+
+    /// HTTP/2 stream this request arrived on (0 for HTTP/1.x).
+    void setStreamId(uint32_t id) { stream_id_ = id; }
+    uint32_t streamId() const { return stream_id_; }
+
+    /// The request arrived over TLS (":scheme" https).
+    void setSecure(bool secure) { secure_ = secure; }
+    bool secure() const { return secure_; }
+
     // ════════════════════════════════════════════════════════════════════
     //  Worker-side API (blocking)
     // ════════════════════════════════════════════════════════════════════
 
-    /// Return the raw header data (everything up to and including CRLFCRLF).
-    const std::string &headers() const { return header_data_; }
+    /// The parsed request head; resolve its spans with field().
+    const ParsedRequest &request() const { return request_; }
+
+    /// The bytes of one span of request().
+    std::string_view field(HttpSpan s) const { return ParsedRequest::view(request_buf_.data(), s); }
+
+    /// Return the raw header data (everything up to and including the
+    /// blank line).
+    std::string_view headers() const {
+        return std::string_view(request_buf_.data(), request_.header_end);
+    }
 
     /// Return any body bytes that arrived with the header data.
-    const std::string &bodyPrefix() const { return body_prefix_; }
+    std::string_view bodyPrefix() const {
+        return std::string_view(request_buf_.data() + request_.header_end, prefix_len_);
+    }
 
-    /// Return the Content-Length value (0 if none).
+    /// Return the Content-Length value (0 if none, or if lengthUnknown()).
     size_t contentLength() const { return content_length_; }
 
-    /// Read body data from the event loop. Blocks until at least max_chunk
-    /// bytes have accumulated or the request body reaches a terminal state.
-    /// The returned status distinguishes complete delivery from truncation
-    /// and read error.
-    BodyReadResult readBodyChunk(size_t max_chunk) {
-        std::unique_lock<std::mutex> lock(read_mutex_);
-        read_cv_.wait(lock, [this, max_chunk] {
-            return read_chunk_.size() >= max_chunk || bodyCompleteLocked() ||
-                   read_eof_ || read_error_;
-        });
+    /// True if the body length is known only once it has all arrived: a
+    /// chunked body, or the DATA frames of an HTTP/2 stream.  Such a body
+    /// is read until readBodyChunk() returns Complete.
+    bool lengthUnknown() const { return length_unknown_; }
 
-        if (read_chunk_.empty()) {
-            if (bodyCompleteLocked()) {
-                return BodyReadResult{{}, BodyReadStatus::Complete};
-            }
-            if (read_error_) {
-                return BodyReadResult{{}, BodyReadStatus::Error};
-            }
-            if (read_eof_) {
-                return BodyReadResult{{}, BodyReadStatus::Truncated};
-            }
-        }
+    /// True if the request has a body to read (possibly empty if
+    /// lengthUnknown()).
+    bool hasBody() const { return length_unknown_ || content_length_ > 0; }
 
-        std::string result;
-        if (read_chunk_.size() <= max_chunk) {
-            result = std::move(read_chunk_);
-            read_chunk_.clear();
-        } else {
-            result = read_chunk_.substr(0, max_chunk);
-            read_chunk_.erase(0, max_chunk);
-        }
+    /// Trailer fields of a chunked body or HTTP/2 stream.  Valid once
+    /// readBodyChunk() has returned Complete.
+    const HeaderPairs &trailers() const { return trailers_; }
+
+    /// True if the connection stays open after this response.  The worker
+    /// reflects this in the Connection response header; the epoll loop
+    /// reads it once the response is finished.
+    bool keepAlive() const { return keep_alive_.load(std::memory_order_relaxed); }
+
+    /// Force the connection to close after this response (e.g. the worker
+    /// answered without consuming the whole request body).  Must be called
+    /// before the response headers are written.
+    void disableKeepAlive() { keep_alive_.store(false, std::memory_order_relaxed); }
 
-        if (read_chunk_.empty()) {
-            read_data_ready_ = false;
+    /// True if the whole body has already arrived (the reactor pre-buffered
+    /// it), so readBodyChunk() will not wait.
+    bool bodyReceived() const { return bodyComplete(); }
+
+    /// True while the client waits for "100 Continue" before sending the
+    /// body (see the class comment).
+    bool expectsContinue() const { return continue_pending_; }
+
+    /// Read up to max_chunk bytes of body data (further capped by
+    /// \p delivery.max_chunk).  Blocks until delivery.min_chunk bytes (or
+    /// max_chunk, if smaller) are buffered, the reactor has paused on the
+    /// high watermark, the oldest buffered byte has waited
+    /// delivery.max_latency_ms, or the request body reaches a terminal
+    /// state.  A fast upload is thus handed over in large chunks while a
+    /// trickle still reaches the filters within the latency bound.  The
+    /// returned status distinguishes complete delivery from truncation and
+    /// read error.  The first call solicits the body of an Expect:
+    /// 100-continue request.
+    BodyReadResult readBodyChunk(size_t max_chunk, const BodyDelivery &delivery = BodyDelivery()) {
+        if (!body_ring_) {
+            // Everything arrived with the headers.
+            return BodyReadResult{{}, bodyComplete() ? BodyReadStatus::Complete
+                                                     : BodyReadStatus::Error};
+        }
+        if (continue_pending_) send_continue();
+        max_chunk = std::min(max_chunk, std::max<size_t>(delivery.max_chunk, 1));
+        size_t want = std::max<size_t>(
+            std::min({delivery.min_chunk, max_chunk, limits_.body_high_watermark}), 1);
+        auto ready = [this, want] {
+            size_t avail = body_ring_->readable();
+            return avail >= want || bodyComplete() ||
+                   (avail > 0 && feed_paused_.load(std::memory_order_acquire)) ||
+                   read_eof_.load(std::memory_order_acquire) ||
+                   read_error_.load(std::memory_order_acquire);
+        };
+        if (!ready()) {
+            ClientWait timing(*this);
+            std::unique_lock<std::mutex> lock(read_mutex_);
+            read_waiting_.store(true, std::memory_order_seq_cst);
+            while (!ready()) {
+                if (body_ring_->readable() == 0) {
+                    wait_reader(lock, nullptr);
+                    continue;
+                }
+                // Short of want: deliver once the oldest byte is due.
+                auto due = std::chrono::steady_clock::time_point(
+                               std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                   std::chrono::nanoseconds(body_pending_since_.load(
+                                       std::memory_order_acquire)))) +
+                           std::chrono::milliseconds(delivery.max_latency_ms);
+                if (!wait_reader(lock, &due)) break;
+            }
+            read_waiting_.store(false, std::memory_order_relaxed);
         }
 
-        BodyReadStatus status = BodyReadStatus::Data;
-        if (read_chunk_.empty()) {
-            if (bodyCompleteLocked()) {
-                status = BodyReadStatus::Complete;
-            } else if (read_error_) {
-                status = BodyReadStatus::Error;
-            } else if (read_eof_) {
-                status = BodyReadStatus::Truncated;
+        BodyReadResult result;
+        body_ring_->read(result.data, max_chunk);
+        if (!result.data.empty()) {
+            server_stats().body_bytes_buffered.fetch_sub(result.data.size(),
+                                                         std::memory_order_relaxed);
+            // Pairs with feedBody(): a reactor that paused at the high
+            // watermark either sees the space or we see its pause flag.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (body_ring_->readable() <= limits_.body_low_watermark &&
+                feed_paused_.exchange(false, std::memory_order_acq_rel)) {
+                notify_reactor();
             }
         }
 
-        return BodyReadResult{std::move(result), status};
+        if (body_ring_->readable() == 0) {
+            if (bodyComplete()) {
+                result.status = BodyReadStatus::Complete;
+            } else if (read_error_.load(std::memory_order_acquire)) {
+                result.status = BodyReadStatus::Error;
+            } else if (read_eof_.load(std::memory_order_acquire)) {
+                result.status = BodyReadStatus::Truncated;
+            }
+        }
+        return result;
     }
 
-    /// Enqueue response data for the event loop to write.
-    /// Blocks until the event loop has consumed all previously queued data.
+    /// Queue one response segment for the event loop to write.  Does not
+    /// wait for the client (see the class comment on spilling).
     void writeData(const std::string &data) {
         if (data.empty()) return;
-        std::unique_lock<std::mutex> lock(write_mutex_);
-        // Wait until any previous write buffer has been fully consumed.
-        write_cv_.wait(lock, [this] {
-            return write_buffer_.empty() || write_error_;
-        });
-        if (write_error_) return;
-        write_buffer_ = data;
-        write_cursor_ = 0;
-        write_pending_ = true;
-        // Signal the event loop via eventfd.
-        signal_eventfd();
+        writeData(std::string(data));
     }
 
-    /// Enqueue response data (move version).
+    /// Queue one response segment (move version, no copy).
     void writeData(std::string &&data) {
         if (data.empty()) return;
-        std::unique_lock<std::mutex> lock(write_mutex_);
-        write_cv_.wait(lock, [this] {
-            return write_buffer_.empty() || write_error_;
-        });
-        if (write_error_) return;
-        write_buffer_ = std::move(data);
-        write_cursor_ = 0;
-        write_pending_ = true;
-        signal_eventfd();
+        if (!push_segment(std::move(data))) return;
+        notify_reactor();
+    }
+
+    /// Queue two segments (typically headers and body) with a single
+    /// notification, so they leave in one gather write.
+    void writeData(std::string &&head, std::string &&body) {
+        if (!head.empty() && !push_segment(std::move(head))) return;
+        if (!body.empty() && !push_segment(std::move(body))) return;
+        notify_reactor();
+    }
+
+    /// Queue \p len bytes of \p file starting at \p offset as one response
+    /// segment (see the class comment on file segments).  The file stays
+    /// open until the range is sent or the request is dropped.
+    void writeFile(std::shared_ptr<const OpenFile> file, off_t offset, size_t len) {
+        if (!file || len == 0) return;
+        if (!push_file(std::move(file), offset, len)) return;
+        notify_reactor();
     }
 
     /// Signal that the worker is done producing data.
     void finish() {
-        std::lock_guard<std::mutex> lock(write_mutex_);
-        finished_ = true;
-        signal_eventfd();
+        if (continue_pending_) decline_continue();
+        release_limiter();
+        finished_.store(true, std::memory_order_release);
+        notify_reactor();
     }
 
     /// Called by the worker to indicate an error (e.g. parse failure).
     /// The event loop will close the fd.
     void setError() {
-        {
-            std::lock_guard<std::mutex> lock(write_mutex_);
-            write_error_ = true;
-            finished_ = true;
-        }
-        write_cv_.notify_all();
-        signal_eventfd();
+        release_limiter();
+        write_error_.store(true, std::memory_order_release);
+        finished_.store(true, std::memory_order_release);
+        notify_reactor();
     }
 
     // ════════════════════════════════════════════════════════════════════
     //  Epoll-loop-side API (non-blocking)
     // ════════════════════════════════════════════════════════════════════
 
-    /// Called when EPOLLIN fires and the connection is in the body-reading
-    /// state.  Appends body bytes and wakes the worker if blocked.
-    void feedBody(const char *data, size_t len, bool eof) {
-        std::lock_guard<std::mutex> lock(read_mutex_);
+    /// Called when body bytes arrive from the socket.  Copies as much as
+    /// fits below the high watermark and wakes the worker if it is
+    /// waiting.  Returns the number of bytes taken; \p eof is recorded only
+    /// if all of them were.  On a short count the caller must hold the rest
+    /// back and offer it again once the worker has notified the reactor
+    /// (when the ring has drained to the low watermark).
+    size_t feedBody(const char *data, size_t len, bool eof) {
+        size_t taken = 0;
         if (len > 0) {
-            read_chunk_.append(data, len);
-            body_bytes_fed_ += len;
-            read_data_ready_ = true;
+            // The latency bound of readBodyChunk() runs from the first byte
+            // to enter an empty ring.
+            if (body_ring_->readable() == 0) {
+                body_pending_since_.store(CoarseClock::monotonicNs(), std::memory_order_release);
+            }
+            taken = write_body(data, len);
+            if (taken < len) {
+                // At the high watermark: ask the worker to notify us once
+                // it drains, then retry in case it drained before seeing
+                // the flag.
+                feed_paused_.store(true, std::memory_order_seq_cst);
+                taken += write_body(data + taken, len - taken);
+                if (taken == len) feed_paused_.store(false, std::memory_order_relaxed);
+            }
+            body_bytes_fed_.fetch_add(taken, std::memory_order_release);
+            server_stats().body_bytes_buffered.fetch_add(taken, std::memory_order_relaxed);
         }
-        if (eof) {
-            read_eof_ = true;
+        if (eof && taken == len) {
+            read_eof_.store(true, std::memory_order_release);
         }
-        read_cv_.notify_one();
+        wake_reader();
+        return taken;
+    }
+
+    /// Ask the worker to notify the reactor once it has drained the body
+    /// ring to the low watermark (memory-budget throttling).  Returns false,
+    /// arming nothing, if the ring already is at or below it.  Only while
+    /// feedBody() has no bytes held back.
+    bool awaitBodyDrain() {
+        if (!body_ring_) return false;
+        // Same handshake as a short feedBody().
+        feed_paused_.store(true, std::memory_order_seq_cst);
+        if (body_ring_->readable() <= limits_.body_low_watermark) {
+            feed_paused_.store(false, std::memory_order_relaxed);
+            return false;
+        }
+        wake_reader();  // a worker waiting for a full chunk takes what is there
+        return true;
+    }
+
+    /// The reactor decoded the last chunk of a chunked body (or the end of
+    /// an HTTP/2 stream): the body is \p length bytes long, and \p trailers
+    /// (swapped out) are its trailer fields.  Must precede the final
+    /// feedBody() call of the body.
+    void endBody(size_t length, HeaderPairs &trailers) {
+        trailers_.swap(trailers);
+        body_length_.store(length, std::memory_order_release);
+        wake_reader();
     }
 
     /// Called when an error occurs on the socket during body reading.
     void feedError() {
-        std::lock_guard<std::mutex> lock(read_mutex_);
-        read_error_ = true;
-        read_cv_.notify_one();
+        read_error_.store(true, std::memory_order_release);
+        wake_reader();
     }
 
     /// Called when a write error occurs on the socket.
     void writeError() {
-        std::lock_guard<std::mutex> lock(write_mutex_);
-        write_error_ = true;
-        write_buffer_.clear();
-        write_cv_.notify_one();
+        write_error_.store(true, std::memory_order_release);
+        wake_writer();
     }
 
-    /// Returns a view into the pending write data.  Empty if nothing pending.
-    std::string_view pendingWriteData() {
-        std::lock_guard<std::mutex> lock(write_mutex_);
-        if (write_cursor_ >= write_buffer_.size()) return {};
-        return std::string_view(write_buffer_).substr(write_cursor_);
+    /// Fill \p iov with the queued in-memory response segments, the first
+    /// one starting at the write cursor, up to the first file segment or
+    /// the spill marker if any.
+    /// Returns the number of entries used (0 if none are pending).  The
+    /// memory stays valid until advanceWrite() consumes it.
+    size_t pendingWriteSegments(struct iovec *iov, size_t max_iov) {
+        size_t n = std::min(egress_.readable(), max_iov);
+        for (size_t i = 0; i < n; ++i) {
+            Segment &seg = egress_.peek(i);
+            if (seg.spill || seg.file) return i;
+            size_t skip = (i == 0) ? write_cursor_ : 0;
+            iov[i].iov_base = const_cast<char *>(seg.data.data()) + skip;
+            iov[i].iov_len = seg.data.size() - skip;
+        }
+        return n;
     }
 
-    /// Advance the write cursor by n bytes.  If the buffer is fully
-    /// consumed, clears it and wakes the worker so it can produce more.
+    /// Consume n bytes sent from the in-memory segments.  Fully sent
+    /// segments are released and a waiting worker is woken.
     void advanceWrite(size_t n) {
-        std::lock_guard<std::mutex> lock(write_mutex_);
-        write_cursor_ += n;
-        if (write_cursor_ >= write_buffer_.size()) {
-            write_buffer_.clear();
+        size_t done = 0;
+        size_t freed = 0;
+        size_t avail = egress_.readable();
+        while (n > 0 && done < avail) {
+            size_t size = egress_.peek(done).data.size();
+            size_t left = size - write_cursor_;
+            if (n < left) {
+                write_cursor_ += n;
+                break;
+            }
+            n -= left;
             write_cursor_ = 0;
-            write_pending_ = false;
-            write_cv_.notify_one();
+            freed += size;
+            ++done;
+        }
+        if (done > 0) {
+            egress_.pop(done);
+            egress_bytes_.fetch_sub(freed, std::memory_order_release);
+            server_stats().response_bytes_buffered.fetch_sub(freed, std::memory_order_relaxed);
+            wake_writer();
         }
     }
 
-    /// Check if the worker has new data to write (for eventfd handler).
-    bool isWritePending() {
-        std::lock_guard<std::mutex> lock(write_mutex_);
-        return write_pending_;
+    /// If the in-memory segments ahead of it are all sent and the next
+    /// bytes come from a file — a file segment or the spilled tail —
+    /// report the descriptor and the range still to send.  Returns false
+    /// if there is nothing to send from a file right now.
+    bool pendingFile(int &file_fd, off_t &offset, size_t &len) {
+        if (egress_.readable() == 0) return false;
+        Segment &seg = egress_.peek(0);
+        if (seg.file) {
+            file_fd = seg.file->fd;
+            offset = seg.file_offset + static_cast<off_t>(write_cursor_);
+            len = seg.file_len - write_cursor_;
+            return true;
+        }
+        if (!seg.spill) return false;
+        size_t written = spill_written_.load(std::memory_order_acquire);
+        if (spill_sent_ >= written) return false;
+        file_fd = spill_fd_;
+        offset = static_cast<off_t>(spill_sent_);
+        len = written - spill_sent_;
+        return true;
     }
 
+    /// Consume n bytes sent from the range pendingFile() reported.  A fully
+    /// sent file segment is released and a waiting worker is woken.
+    void advanceFile(size_t n) {
+        Segment &seg = egress_.peek(0);
+        if (!seg.file) {
+            spill_sent_ += n;
+            server_stats().response_bytes_buffered.fetch_sub(n, std::memory_order_relaxed);
+            return;
+        }
+        write_cursor_ += n;
+        if (write_cursor_ < seg.file_len) return;
+        write_cursor_ = 0;
+        egress_.pop();
+        wake_writer();
+    }
+
+    /// Move up to \p max queued response bytes, in queue order and reading
+    /// file segments and the spilled tail back, to the end of \p out.  Returns the number
+    /// of bytes moved.  An HTTP/2 session uses this instead of sending the
+    /// segments: it re-frames the response before it goes out.
+    size_t takeResponse(std::string &out, size_t max) {
+        size_t moved = 0;
+        struct iovec iov[EGRESS_TAKE_IOV];
+        int file_fd;
+        off_t offset;
+        size_t len;
+        while (moved < max) {
+            size_t cnt = pendingWriteSegments(iov, EGRESS_TAKE_IOV);
+            if (cnt > 0) {
+                size_t n = 0;
+                for (size_t i = 0; i < cnt && moved + n < max; ++i) {
+                    size_t take = std::min(iov[i].iov_len, max - moved - n);
+                    out.append(static_cast<const char *>(iov[i].iov_base), take);
+                    n += take;
+                }
+                advanceWrite(n);
+                moved += n;
+                continue;
+            }
+            if (!pendingFile(file_fd, offset, len)) break;
+            len = std::min(len, max - moved);
+            size_t at = out.size();
+            out.resize(at + len);
+            ssize_t n = pread(file_fd, &out[at], len, offset);
+            if (n <= 0) {
+                out.resize(at);
+                if (n < 0 && errno == EINTR) continue;
+                // 0: the file of a file segment was truncated under us.
+                LOG_ERROR("Response file read failed: " << strerror(n < 0 ? errno : EIO));
+                setError();
+                break;
+            }
+            out.resize(at + static_cast<size_t>(n));
+            advanceFile(static_cast<size_t>(n));
+            moved += static_cast<size_t>(n);
+        }
+        return moved;
+    }
+
+    /// Response bytes queued and not yet sent (or taken).
+    size_t pendingBytes() const {
+        size_t n = egress_bytes_.load(std::memory_order_acquire);
+        if (spill_fd_ >= 0) n += spill_written_.load(std::memory_order_acquire) - spill_sent_;
+        return n;
+    }
+
+    /// Body bytes waiting in the ring for the worker.
+    size_t bodyBuffered() const { return body_ring_ ? body_ring_->readable() : 0; }
+
     /// Check if the worker has finished AND all write data has been consumed.
     bool isFinished() {
-        std::lock_guard<std::mutex> lock(write_mutex_);
-        return finished_ && write_buffer_.empty();
+        if (!finished_.load(std::memory_order_acquire)) return false;
+        size_t queued = egress_.readable();
+        if (queued == 0) return true;
+        // Only the spill marker left: done once the file is sent.
+        return queued == 1 && egress_.peek(0).spill &&
+               spill_sent_ >= spill_written_.load(std::memory_order_acquire);
     }
 
     /// Check if the worker signalled an error.
-    bool hasError() {
-        std::lock_guard<std::mutex> lock(write_mutex_);
-        return write_error_;
+    bool hasError() const {
+        return write_error_.load(std::memory_order_acquire);
+    }
+
+    /// Total body bytes handed to the worker so far (prefix + fed).
+    size_t bodyBytesReceived() const {
+        return body_bytes_fed_.load(std::memory_order_acquire);
     }
 
-    /// Check if the connection still needs body data from the socket.
-    bool needsMoreBody() {
-        std::lock_guard<std::mutex> lock(read_mutex_);
-        return body_bytes_fed_ < content_length_ && !read_eof_ && !read_error_;
+private:
+    static constexpr size_t UNKNOWN_LENGTH = static_cast<size_t>(-1);
+
+    bool bodyComplete() const {
+        return body_bytes_fed_.load(std::memory_order_acquire) >=
+               body_length_.load(std::memory_order_acquire);
     }
 
-    /// Total body bytes received so far (prefix + fed).
-    size_t bodyBytesReceived() {
-        std::lock_guard<std::mutex> lock(read_mutex_);
-        return body_bytes_fed_;
+    // Copy into the body ring without passing the high watermark.
+    size_t write_body(const char *data, size_t len) {
+        size_t level = body_ring_->readable();
+        if (level >= limits_.body_high_watermark) return 0;
+        return body_ring_->write(data, std::min(len, limits_.body_high_watermark - level));
     }
 
-private:
-    bool bodyCompleteLocked() const {
-        return body_bytes_fed_ >= content_length_;
+    // Queue a segment in memory while it fits the output budget, and
+    // spill it otherwise.  Returns false if the connection failed.
+    bool push_segment(std::string &&data) {
+        if (write_error_.load(std::memory_order_acquire)) return false;
+        if (continue_pending_) decline_continue();
+        if (spilling_) return spill(data);
+
+        // One ring slot always stays free for the spill marker.
+        size_t queued = egress_bytes_.load(std::memory_order_acquire);
+        size_t size = data.size();
+        if (queued + size <= limits_.output_budget && egress_.writable() > 1) {
+            count_egress(size);
+            egress_.tryPush(Segment(std::move(data)));
+            return true;
+        }
+        if (start_spill()) return spill(data);
+
+        // No spill file: fall back to waiting for ring space.
+        count_egress(size);
+        if (egress_.tryPush(Segment(std::move(data)))) return true;
+        if (inline_) {
+            // Reactor thread: nobody drains the ring until we return, so
+            // grow the newest segment instead (never a file segment, see
+            // push_file()).
+            egress_.newest()->data.append(data);
+            return true;
+        }
+        if (wait_for_slots(1) && egress_.tryPush(Segment(std::move(data)))) return true;
+        egress_bytes_.fetch_sub(size, std::memory_order_relaxed);
+        server_stats().response_bytes_buffered.fetch_sub(size, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Queue a file range as a file segment, or copy it into the spill file
+    // if the response spilled.  A file segment takes a slot only while two
+    // more stay free — the spill marker's and one for a data segment — so
+    // the newest segment of a full ring is always one push_segment() can
+    // grow.  Returns false if the connection failed.
+    bool push_file(std::shared_ptr<const OpenFile> &&file, off_t offset, size_t len) {
+        if (write_error_.load(std::memory_order_acquire)) return false;
+        if (continue_pending_) decline_continue();
+        if (!spilling_ && egress_.writable() > 2) {
+            egress_.tryPush(Segment(std::move(file), offset, len));
+            return true;
+        }
+        if (spilling_ || start_spill()) return spill_file(*file, offset, len);
+
+        // No spill file: the reactor thread cannot wait, so it copies the
+        // range; a worker waits for ring space.
+        if (inline_) return copy_file(*file, offset, len, &ConnectionIO::push_segment);
+        if (!wait_for_slots(1)) return false;
+        egress_.tryPush(Segment(std::move(file), offset, len));
+        return true;
+    }
+
+    // Append a file range to the spill file.
+    bool spill_file(const OpenFile &file, off_t offset, size_t len) {
+        return copy_file(file, offset, len, [](ConnectionIO &io, std::string &&data) {
+            return io.spill(data);
+        });
+    }
+
+    // Read a file range in FILE_COPY_CHUNK pieces and hand each to \p sink.
+    template <typename Sink>
+    bool copy_file(const OpenFile &file, off_t offset, size_t len, Sink sink) {
+        while (len > 0) {
+            std::string chunk(std::min(len, FILE_COPY_CHUNK), '\0');
+            ssize_t n = pread(file.fd, &chunk[0], chunk.size(), offset);
+            if (n <= 0) {
+                if (n < 0 && errno == EINTR) continue;
+                LOG_ERROR("Response file read failed: " << strerror(n < 0 ? errno : EIO));
+                setError();
+                return false;
+            }
+            chunk.resize(static_cast<size_t>(n));
+            if (!std::invoke(sink, *this, std::move(chunk))) return false;
+            offset += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Park the worker until the reactor has freed \p n ring slots.
+    // Returns false if the connection failed meanwhile.
+    bool wait_for_slots(size_t n) {
+        notify_reactor();
+        ClientWait timing(*this);
+        std::unique_lock<std::mutex> lock(write_mutex_);
+        write_waiting_.store(true, std::memory_order_seq_cst);
+        write_cv_.wait(lock, [this, n] {
+            return egress_.writable() >= n || write_error_.load(std::memory_order_acquire);
+        });
+        write_waiting_.store(false, std::memory_order_relaxed);
+        return !write_error_.load(std::memory_order_acquire);
+    }
+
+    // Account \p n bytes queued in memory.  Called before the segment is
+    // pushed, so advanceWrite() never subtracts them first.
+    void count_egress(size_t n) {
+        egress_bytes_.fetch_add(n, std::memory_order_relaxed);
+        server_stats().response_bytes_buffered.fetch_add(n, std::memory_order_relaxed);
     }
 
-    void signal_eventfd() {
-        uint64_t val = 1;
-        // Best-effort write — if it fails (e.g. would-block), the event
-        // loop will pick up the pending state on the next iteration anyway.
-        ssize_t r = ::write(event_fd_, &val, sizeof(val));
-        (void)r;
+    // Open the spill file and queue the marker after the in-memory
+    // segments.  Returns false if no file could be created.
+    bool start_spill() {
+        if (spill_fd_ < 0) {
+            spill_fd_ = memfd_create("lswasm-spill", MFD_CLOEXEC);
+            if (spill_fd_ < 0) {
+                spill_fd_ = open("/tmp", O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+            }
+            if (spill_fd_ < 0) {
+                LOG_ERROR("Cannot create response spill file: " << strerror(errno));
+                return false;
+            }
+        }
+        // The marker publishes spill_fd_ to the reactor.
+        if (!egress_.tryPush(Segment::spillMarker())) return false;
+        spilling_ = true;
+        server_stats().responses_spilled.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Append \p data to the spill file.
+    bool spill(const std::string &data) {
+        size_t off = spill_written_.load(std::memory_order_relaxed);
+        size_t done = 0;
+        while (done < data.size()) {
+            ssize_t n = pwrite(spill_fd_, data.data() + done, data.size() - done,
+                               static_cast<off_t>(off + done));
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                LOG_ERROR("Response spill write failed: " << strerror(errno));
+                setError();
+                return false;
+            }
+            done += static_cast<size_t>(n);
+        }
+        ServerStats &st = server_stats();
+        st.response_bytes_buffered.fetch_add(done, std::memory_order_relaxed);
+        spill_written_.store(off + done, std::memory_order_release);
+        st.spill_bytes.fetch_add(done, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Request latency is read from the real clock: the cached one is as
+    // coarse as a whole fast request.
+    static uint64_t steady_ns() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count());
+    }
+
+    // Report the request's latency to the limiter that admitted it, once.
+    void release_limiter() {
+        if (ConcurrencyLimiter *limiter = std::exchange(limiter_, nullptr)) {
+            uint64_t elapsed = steady_ns() - admitted_ns_;
+            limiter->release(elapsed > client_wait_ns_ ? elapsed - client_wait_ns_ : 0);
+        }
+    }
+
+    // Adds the lifetime of the object to client_wait_ns_ (worker side).
+    struct ClientWait {
+        explicit ClientWait(ConnectionIO &io) : io_(io), start_(steady_ns()) {}
+        ~ClientWait() { io_.client_wait_ns_ += steady_ns() - start_; }
+        ConnectionIO &io_;
+        uint64_t start_;
+    };
+
+    // Wait in readBodyChunk() until wake_reader() or \p due (if given);
+    // false on timeout.  Called with read_mutex_ held.  A request running
+    // on a fiber suspends it, which frees the worker thread for other
+    // requests; otherwise the thread blocks on read_cv_.
+    bool wait_reader(std::unique_lock<std::mutex> &lock,
+                     const std::chrono::steady_clock::time_point *due) {
+        Fiber *fiber = Fiber::current();
+        if (!fiber) {
+            if (!due) {
+                read_cv_.wait(lock);
+                return true;
+            }
+            return read_cv_.wait_until(lock, *due) != std::cv_status::timeout;
+        }
+        read_fiber_ = fiber;
+        fiber->prepareWait();
+        lock.unlock();
+        if (due) {
+            Fiber::suspendUntil(*due);
+        } else {
+            Fiber::suspend();
+        }
+        lock.lock();
+        read_fiber_ = nullptr;
+        return !due || std::chrono::steady_clock::now() < *due;
+    }
+
+    // Wake a worker parked in readBodyChunk() (the lock is taken only if
+    // one is).
+    void wake_reader() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (read_waiting_.load(std::memory_order_seq_cst)) {
+            std::lock_guard<std::mutex> lock(read_mutex_);
+            if (read_fiber_) {
+                read_fiber_->wake();
+                read_fiber_ = nullptr;
+            } else {
+                read_cv_.notify_one();
+            }
+        }
+    }
+
+    // Wake a worker parked in push_segment().
+    void wake_writer() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (write_waiting_.load(std::memory_order_seq_cst)) {
+            std::lock_guard<std::mutex> lock(write_mutex_);
+            write_cv_.notify_one();
+        }
+    }
+
+    // Queue the interim "100 Continue" unless the body is already arriving
+    // (the client gave up waiting) or has ended.
+    void send_continue() {
+        continue_pending_ = false;
+        if (body_bytes_fed_.load(std::memory_order_acquire) > prefix_len_ ||
+            read_eof_.load(std::memory_order_acquire) || bodyComplete()) {
+            return;
+        }
+        writeData(std::string(HTTP_100_CONTINUE));
+        server_stats().continues_sent.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // A response is going out before the body was asked for: the client
+    // gets the final status instead of 100 Continue.
+    void decline_continue() {
+        continue_pending_ = false;
+        server_stats().continues_declined.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void notify_reactor() {
+        if (inline_) return;  // the reactor is the caller
+        ready_->push(shared_from_this());
     }
 
     int fd_;
-    int event_fd_;
+    uint32_t generation_;
+    ReadyQueue *ready_;
+    const ConnectionLimits limits_;
 
-    // ── Header data (immutable after setHeaderData) ──
-    std::string header_data_;
-    std::string body_prefix_;
+    // ── Pool dispatch (see submitTo()) ──
+    const Handler *dispatch_handler_ = nullptr;
+    std::shared_ptr<ConnectionIO> dispatch_ref_;  // the queued task's reference to this
+    ConcurrencyLimiter *limiter_ = nullptr;       // admitted by this limiter (see admit())
+    uint64_t admitted_ns_ = 0;
+    uint64_t client_wait_ns_ = 0;                  // worker: time spent waiting on the client
+
+    // ── Request head (immutable after setRequest) ──
+    std::string request_buf_;   // head + body prefix; keeps its capacity across reset()
+    ParsedRequest request_;     // spans into request_buf_
+    size_t prefix_len_ = 0;     // body bytes that arrived with the head
     size_t content_length_ = 0;
+    bool length_unknown_ = false;  // chunked or HTTP/2 body, ended by endBody()
+    bool continue_pending_ = false;  // worker: client awaits 100 Continue
+    uint32_t stream_id_ = 0;    // HTTP/2 stream, 0 for HTTP/1.x
+    bool secure_ = false;       // arrived over TLS
+    HeaderPairs trailers_;      // body trailers, set by endBody()
+    std::atomic<bool> keep_alive_{false};
+    bool inline_ = false;  // handler runs on the reactor thread
 
     // ── Read side (epoll feeds, worker consumes) ──
-    std::string read_chunk_;
-    size_t body_bytes_fed_ = 0;
-    bool read_data_ready_ = false;
-    bool read_eof_ = false;
-    bool read_error_ = false;
+    std::unique_ptr<SpscByteRing> body_ring_;  // allocated on first streaming body
+    std::atomic<size_t> body_bytes_fed_{0};
+    std::atomic<size_t> body_length_{0};   // content length, or UNKNOWN_LENGTH until endBody()
+    std::atomic<uint64_t> body_pending_since_{0};  // monotonic ns the ring last became non-empty
+    std::atomic<bool> read_eof_{false};
+    std::atomic<bool> read_error_{false};
+    std::atomic<bool> feed_paused_{false};    // reactor waits for ring space
+    std::atomic<bool> read_waiting_{false};   // worker parked on read_cv_
     std::mutex read_mutex_;
     std::condition_variable read_cv_;
+    Fiber *read_fiber_ = nullptr;             // suspended in readBodyChunk() (under read_mutex_)
 
     // ── Write side (worker produces, epoll drains) ──
-    std::string write_buffer_;
-    size_t write_cursor_ = 0;
-    bool write_pending_ = false;
-    bool finished_ = false;
-    bool write_error_ = false;
+    struct Segment {
+        Segment() = default;
+        explicit Segment(std::string &&bytes) : data(std::move(bytes)) {}
+        Segment(std::shared_ptr<const OpenFile> &&f, off_t offset, size_t len)
+            : file(std::move(f)), file_offset(offset), file_len(len) {}
+        static Segment spillMarker() {
+            Segment seg;
+            seg.spill = true;
+            return seg;
+        }
+
+        std::string data;
+        bool spill = false;  // marker: the rest of the response is in the spill file
+        std::shared_ptr<const OpenFile> file;  // set for a file segment (data unused)
+        off_t file_offset = 0;
+        size_t file_len = 0;
+    };
+    SpscRing<Segment> egress_;
+    std::atomic<size_t> egress_bytes_{0};    // bytes held by queued in-memory segments
+    size_t write_cursor_ = 0;                 // bytes of the oldest segment (or file range) already sent
+    int spill_fd_ = -1;                       // memfd/tmpfile holding the spilled tail
+    bool spilling_ = false;                   // worker: later writes go to the spill file
+    std::atomic<size_t> spill_written_{0};    // bytes appended to the spill file
+    size_t spill_sent_ = 0;                   // reactor: spill bytes already sent
+    std::atomic<bool> finished_{false};
+    std::atomic<bool> write_error_{false};
+    std::atomic<bool> write_waiting_{false};  // worker parked on write_cv_
     std::mutex write_mutex_;
     std::condition_variable write_cv_;
 };
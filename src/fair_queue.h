@@ -0,0 +1,311 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2026  LiteSpeed Technologies, Inc.                        *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <strings.h>
+#include <vector>
+
+#include "server_stats.h"
+#include "thread_pool.h"
+
+inline constexpr uint32_t DEFAULT_CLASS_WEIGHT = 1;  // dispatches per round for a --class
+
+/// One request class of the fair scheduler (--class).  A request belongs
+/// to the first class whose every set criterion matches it.
+struct RequestClass {
+    std::string name;
+    std::string host;         // Host / :authority, "*.example.com" for a suffix ("" = any)
+    std::string path_prefix;  // request-target prefix ("" = any)
+    int body = -1;            // 1 = requests with a body, 0 = without, -1 = either
+    uint32_t weight = DEFAULT_CLASS_WEIGHT;
+    size_t max_in_flight = 0; // requests of the class on the workers at once (0 = no cap)
+
+    bool matches(std::string_view req_host, std::string_view path, bool has_body) const {
+        if (body >= 0 && has_body != (body == 1)) return false;
+        if (!path_prefix.empty() && path.compare(0, path_prefix.size(), path_prefix) != 0) {
+            return false;
+        }
+        if (host.empty()) return true;
+        size_t colon = req_host.rfind(':');  // ignore a port
+        if (colon != std::string_view::npos && req_host.find(']', colon) == std::string_view::npos) {
+            req_host = req_host.substr(0, colon);
+        }
+        if (host.compare(0, 2, "*.") == 0) {
+            std::string_view suffix = std::string_view(host).substr(1);
+            return req_host.size() > suffix.size() &&
+                   strncasecmp(req_host.data() + req_host.size() - suffix.size(), suffix.data(),
+                               suffix.size()) == 0;
+        }
+        return req_host.size() == host.size() &&
+               strncasecmp(req_host.data(), host.data(), host.size()) == 0;
+    }
+};
+
+/**
+ * RequestClasses — the process-wide --class table and its per-class
+ * statistics.  Configured once at startup, before any FairQueue exists;
+ * the statistics are relaxed atomics shared by every pool's queue.
+ */
+class RequestClasses {
+public:
+    struct Stats {
+        std::atomic<uint64_t> queued{0};        // waiting for a worker now
+        std::atomic<uint64_t> in_flight{0};     // on the workers now
+        std::atomic<uint64_t> dispatched{0};    // handed to a worker, total
+        std::atomic<uint64_t> wait_ns{0};       // time spent queued, total
+        std::atomic<uint64_t> wait_max_ns{0};   // longest time queued
+    };
+
+    /// Install the classes.  A catch-all "default" class is appended.
+    void configure(std::vector<RequestClass> classes) {
+        classes_ = std::move(classes);
+        RequestClass fallback;
+        fallback.name = "default";
+        classes_.push_back(std::move(fallback));
+        stats_ = std::make_unique<Stats[]>(classes_.size());
+    }
+
+    /// True once --class was given.
+    bool enabled() const { return classes_.size() > 1; }
+
+    size_t size() const { return classes_.size(); }
+    const RequestClass &at(size_t i) const { return classes_[i]; }
+    Stats &stats(size_t i) { return stats_[i]; }
+
+    /// Index of the class a request falls in.
+    size_t classify(std::string_view host, std::string_view path, bool has_body) const {
+        for (size_t i = 0; i + 1 < classes_.size(); ++i) {
+            if (classes_[i].matches(host, path, has_body)) return i;
+        }
+        return classes_.size() - 1;
+    }
+
+    /// Render the per-class statistics as "  class NAME: ..." lines.
+    std::string format() const {
+        std::string out;
+        for (size_t i = 0; enabled() && i < classes_.size(); ++i) {
+            const Stats &st = stats_[i];
+            uint64_t dispatched = st.dispatched.load(std::memory_order_relaxed);
+            uint64_t wait_ns = st.wait_ns.load(std::memory_order_relaxed);
+            out += "  class " + classes_[i].name + ": queued=" +
+                   std::to_string(st.queued.load(std::memory_order_relaxed)) +
+                   " in_flight=" + std::to_string(st.in_flight.load(std::memory_order_relaxed)) +
+                   " dispatched=" + std::to_string(dispatched) +
+                   " wait_avg_us=" + std::to_string(dispatched ? wait_ns / dispatched / 1000 : 0) +
+                   " wait_max_us=" +
+                   std::to_string(st.wait_max_ns.load(std::memory_order_relaxed) / 1000) + "\n";
+        }
+        return out;
+    }
+
+private:
+    std::vector<RequestClass> classes_;
+    std::unique_ptr<Stats[]> stats_;
+};
+
+/// The process-wide instance.
+inline RequestClasses &request_classes() {
+    static RequestClasses classes;
+    return classes;
+}
+
+/**
+ * FairQueue — weighted fair queuing of requests in front of one worker
+ * pool.
+ *
+ * Each request class has a FIFO; the queue keeps at most as many requests
+ * on the pool as it has room for (workers × fibers per worker, at the
+ * most workers an elastic pool grows to, so that the pool still sees the
+ * queue wait that makes it grow), so waiting happens here rather than in
+ * the pool's FIFO injection queue, and picks
+ * the next request by deficit round robin: visiting a class in turn adds
+ * its weight to the class's deficit, and each request dispatched costs
+ * one.  A class at its max_in_flight is passed over until one of its
+ * requests finishes.  A burst in one class (one virtual host, or big
+ * uploads) therefore queues behind itself, while the other classes keep
+ * their share of the workers.
+ *
+ * Nodes are intrusive (the request's ConnectionIO), so queueing does not
+ * allocate; a mutex guards the queues, taken once per submit and finish.
+ */
+class FairQueue {
+public:
+    /// Intrusive hook: a pool task that can wait in a FairQueue.
+    class Node : public ThreadPool::Task {
+    protected:
+        /// Tell the queue this request has left the worker (call at the
+        /// end of run()).  No-op if it was not dispatched through one.
+        void fairDone() {
+            if (FairQueue *queue = fair_queue_) {
+                fair_queue_ = nullptr;
+                queue->finished(*this);
+            }
+        }
+
+    private:
+        friend class FairQueue;
+        FairQueue *fair_queue_ = nullptr;
+        Node *fair_next_ = nullptr;
+        uint32_t fair_class_ = 0;
+        uint64_t fair_enqueued_ns_ = 0;
+    };
+
+    explicit FairQueue(ThreadPool &pool)
+        : pool_(pool),
+          capacity_(pool.maxSize() * std::max<size_t>(pool.fibersPerWorker(), 1)),
+          classes_(request_classes().size()) {}
+
+    /// Requests still queued are discarded, as the pool does with its own.
+    ~FairQueue() {
+        for (ClassQueue &q : classes_) {
+            while (Node *node = q.head) {
+                q.head = node->fair_next_;
+                node->fair_queue_ = nullptr;
+                node->discard();
+            }
+        }
+    }
+
+    // Non-copyable, non-movable.
+    FairQueue(const FairQueue &) = delete;
+    FairQueue &operator=(const FairQueue &) = delete;
+
+    /// Wait until every queued request has been handed to the pool (call
+    /// once no more are submitted, before shutting the pool down).
+    void drain() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        drained_.wait(lock, [this] { return queued_ == 0; });
+    }
+
+    /// Queue \p node in class \p cls (see RequestClasses::classify()).
+    /// Safe from any thread.
+    void submit(Node &node, size_t cls) {
+        node.fair_queue_ = this;
+        node.fair_next_ = nullptr;
+        node.fair_class_ = static_cast<uint32_t>(cls);
+        node.fair_enqueued_ns_ = steady_ns();
+        request_classes().stats(cls).queued.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++queued_;
+        ClassQueue &q = classes_[cls];
+        if (q.tail) {
+            q.tail->fair_next_ = &node;
+        } else {
+            q.head = &node;
+            active_.push_back(static_cast<uint32_t>(cls));
+        }
+        q.tail = &node;
+        dispatch_locked();
+    }
+
+private:
+    struct ClassQueue {
+        Node *head = nullptr;
+        Node *tail = nullptr;
+        size_t in_flight = 0;
+        uint64_t deficit = 0;
+        bool visited = false;  // weight granted for the current visit
+    };
+
+    // Queue wait is read from the real clock: the cached one is a
+    // reactor tick coarse, longer than the waits worth reporting.
+    static uint64_t steady_ns() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count());
+    }
+
+    // \p node's handler returned: free its slot and dispatch the next.
+    void finished(Node &node) {
+        request_classes().stats(node.fair_class_).in_flight.fetch_sub(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex_);
+        --classes_[node.fair_class_].in_flight;
+        --in_flight_;
+        dispatch_locked();
+    }
+
+    // Deficit round robin over the classes with queued requests, while
+    // the pool has room.
+    void dispatch_locked() {
+        size_t blocked = 0;  // consecutive classes passed over at their cap
+        while (in_flight_ < capacity_ && !active_.empty() && blocked < active_.size()) {
+            if (next_ >= active_.size()) next_ = 0;
+            uint32_t cls = active_[next_];
+            ClassQueue &q = classes_[cls];
+            const RequestClass &def = request_classes().at(cls);
+            if (!q.head) {
+                // Drained: leave the round and forfeit the deficit.
+                q.deficit = 0;
+                q.visited = false;
+                active_.erase(active_.begin() + static_cast<std::ptrdiff_t>(next_));
+                continue;
+            }
+            if (def.max_in_flight > 0 && q.in_flight >= def.max_in_flight) {
+                ++blocked;
+                ++next_;
+                continue;
+            }
+            if (!q.visited) {
+                q.deficit += def.weight;
+                q.visited = true;
+            }
+            if (q.deficit == 0) {
+                q.visited = false;
+                ++next_;
+                continue;
+            }
+            --q.deficit;
+            blocked = 0;
+            Node *node = q.head;
+            q.head = node->fair_next_;
+            if (!q.head) q.tail = nullptr;
+            if (--queued_ == 0) drained_.notify_all();
+            ++q.in_flight;
+            ++in_flight_;
+
+            RequestClasses::Stats &st = request_classes().stats(cls);
+            uint64_t waited = steady_ns() - node->fair_enqueued_ns_;
+            st.queued.fetch_sub(1, std::memory_order_relaxed);
+            st.in_flight.fetch_add(1, std::memory_order_relaxed);
+            st.dispatched.fetch_add(1, std::memory_order_relaxed);
+            st.wait_ns.fetch_add(waited, std::memory_order_relaxed);
+            ServerStats::raise(st.wait_max_ns, waited);
+            pool_.submit(*node);
+        }
+    }
+
+    ThreadPool &pool_;
+    const size_t capacity_;
+    std::mutex mutex_;
+    std::condition_variable drained_;
+    std::vector<ClassQueue> classes_;
+    std::vector<uint32_t> active_;  // classes with queued requests, in round order
+    size_t next_ = 0;               // position in active_ of the class being visited
+    size_t queued_ = 0;
+    size_t in_flight_ = 0;
+};
@@ -0,0 +1,186 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2026  LiteSpeed Technologies, Inc.                        *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+inline constexpr size_t DEFAULT_FIBER_STACK = 1048576;  // bytes reserved per fiber stack
+
+class Fiber;
+
+/// Owner of a set of fibers: resumes the ones that are woken.
+class FiberScheduler {
+public:
+    /// \p fiber's wait is over; resume it on the owning thread.  Safe from
+    /// any thread.
+    virtual void schedule(Fiber &fiber) = 0;
+
+protected:
+    ~FiberScheduler() = default;
+};
+
+/**
+ * Fiber — a stackful coroutine that runs one job at a time on the thread
+ * of its scheduler.
+ *
+ * A fiber is created once with its own stack (mmap'd, lazily committed,
+ * with a guard page below it) and reused: start() hands it a job and
+ * resume() switches into it until the job returns or the fiber suspends.
+ * Code running on the fiber waits for an event with
+ *
+ *     fiber->prepareWait();        // before publishing the fiber to the waker
+ *     ... publish, release locks ...
+ *     Fiber::suspend();            // or suspendUntil(deadline)
+ *
+ * and the waker calls wake(), which hands the fiber back to its scheduler.
+ * A fiber is only ever resumed by its scheduler's thread, so thread-local
+ * state (the thread's WASM VM clone) stays valid across a suspension.
+ * wake() and the deadline race safely: whichever claims the fiber first
+ * resumes it, the other is a no-op.
+ *
+ * Context switches use swapcontext(); the job must not throw.
+ */
+class Fiber {
+public:
+    using Job = void (*)(void *arg);
+
+    Fiber(FiberScheduler &scheduler, size_t stack_size) : scheduler_(&scheduler) {
+        long page = sysconf(_SC_PAGESIZE);
+        stack_size_ = (stack_size + page - 1) / page * page + page;  // + guard page
+        stack_ = mmap(nullptr, stack_size_, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+        if (stack_ == MAP_FAILED) throw std::bad_alloc();
+        mprotect(stack_, page, PROT_NONE);
+        getcontext(&context_);
+        context_.uc_stack.ss_sp = stack_;
+        context_.uc_stack.ss_size = stack_size_;
+        context_.uc_link = nullptr;
+        uintptr_t self = reinterpret_cast<uintptr_t>(this);
+        makecontext(&context_, reinterpret_cast<void (*)()>(&Fiber::entry), 2,
+                    static_cast<uint32_t>(self), static_cast<uint32_t>(self >> 32));
+    }
+
+    ~Fiber() { munmap(stack_, stack_size_); }
+
+    // Non-copyable, non-movable.
+    Fiber(const Fiber &) = delete;
+    Fiber &operator=(const Fiber &) = delete;
+
+    /// The fiber running on this thread, or nullptr outside any fiber.
+    static Fiber *current() { return current_; }
+
+    /// Scheduler: give an idle fiber its next job.  Run it with resume().
+    void start(Job job, void *arg) {
+        job_ = job;
+        arg_ = arg;
+        done_ = false;
+    }
+
+    /// Scheduler: run the fiber until its job returns (true) or it
+    /// suspends (false).
+    bool resume() {
+        state_.store(RUNNING, std::memory_order_relaxed);
+        has_deadline_ = false;
+        Fiber *outer = current_;
+        current_ = this;
+        swapcontext(&caller_, &context_);
+        current_ = outer;
+        return done_;
+    }
+
+    /// On the fiber: begin a wait.  Call before the fiber becomes visible
+    /// to whoever will wake() it.
+    void prepareWait() {
+        wait_seq_.fetch_add(1, std::memory_order_relaxed);
+        state_.store(WAITING, std::memory_order_release);
+    }
+
+    /// On the fiber: switch back to the scheduler until woken.
+    static void suspend() {
+        Fiber *self = current_;
+        swapcontext(&self->context_, &self->caller_);
+    }
+
+    /// On the fiber: as suspend(), but the scheduler also resumes the
+    /// fiber at \p deadline if it has not been woken by then.
+    static void suspendUntil(std::chrono::steady_clock::time_point deadline) {
+        Fiber *self = current_;
+        self->deadline_ = deadline;
+        self->has_deadline_ = true;
+        swapcontext(&self->context_, &self->caller_);
+    }
+
+    /// End a wait: hand the fiber to its scheduler.  Any thread; no-op if
+    /// the fiber is not waiting (already woken, or timed out).
+    void wake() {
+        if (claim()) scheduler_->schedule(*this);
+    }
+
+    /// Scheduler: take a waiting fiber for resumption.  False if someone
+    /// else already did.
+    bool claim() {
+        uint32_t expected = WAITING;
+        return state_.compare_exchange_strong(expected, RUNNABLE, std::memory_order_acq_rel,
+                                              std::memory_order_relaxed);
+    }
+
+    /// Scheduler, after resume() returned false: the deadline the fiber
+    /// set with suspendUntil(), if any, and the wait it belongs to.
+    bool hasDeadline() const { return has_deadline_; }
+    std::chrono::steady_clock::time_point deadline() const { return deadline_; }
+    uint32_t waitSeq() const { return wait_seq_.load(std::memory_order_relaxed); }
+
+    /// Intrusive link for the scheduler's run queue.
+    Fiber *next = nullptr;
+
+private:
+    enum : uint32_t { RUNNING, WAITING, RUNNABLE };
+
+    static void entry(uint32_t lo, uint32_t hi) {
+        Fiber *self = reinterpret_cast<Fiber *>(static_cast<uintptr_t>(lo) |
+                                                (static_cast<uintptr_t>(hi) << 32));
+        for (;;) {
+            self->job_(self->arg_);
+            self->done_ = true;
+            swapcontext(&self->context_, &self->caller_);
+        }
+    }
+
+    static inline thread_local Fiber *current_ = nullptr;
+
+    FiberScheduler *scheduler_;
+    void *stack_ = nullptr;
+    size_t stack_size_ = 0;
+    ucontext_t context_;
+    ucontext_t caller_;
+    Job job_ = nullptr;
+    void *arg_ = nullptr;
+    bool done_ = true;
+    bool has_deadline_ = false;
+    std::chrono::steady_clock::time_point deadline_;
+    std::atomic<uint32_t> state_{RUNNING};
+    std::atomic<uint32_t> wait_seq_{0};
+};
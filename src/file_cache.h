@@ -0,0 +1,212 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2026  LiteSpeed Technologies, Inc.                        *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "coarse_clock.h"
+#include "server_stats.h"
+
+inline constexpr size_t DEFAULT_FILE_CACHE_ENTRIES = 256;  // open files kept for reuse
+inline constexpr int FILE_CACHE_VALID_SECS = 2;  // seconds before an entry's path is stat()ed again
+
+/**
+ * OpenFile — a regular file opened read-only for a file response.
+ *
+ * Shared between the FileCache entry and every queued response that sends
+ * from it; the descriptor is closed when the last of them lets go, so an
+ * evicted or replaced entry stays readable until its responses are sent.
+ */
+struct OpenFile {
+    int fd = -1;
+    uint64_t size = 0;
+    struct timespec mtime{};
+    dev_t dev = 0;
+    ino_t ino = 0;
+
+    OpenFile() = default;
+    OpenFile(const OpenFile &) = delete;
+    OpenFile &operator=(const OpenFile &) = delete;
+    ~OpenFile() {
+        if (fd >= 0) close(fd);
+    }
+
+    /// \p st still describes this file (same inode, size and mtime).
+    bool matches(const struct stat &st) const {
+        return st.st_dev == dev && st.st_ino == ino &&
+               static_cast<uint64_t>(st.st_size) == size &&
+               st.st_mtim.tv_sec == mtime.tv_sec && st.st_mtim.tv_nsec == mtime.tv_nsec;
+    }
+};
+
+/**
+ * FileCache — process-wide LRU of open files for lswasm_send_file.
+ *
+ * A hot file is opened once and its descriptor reused by every request that
+ * sends it.  Every hit costs one fstat() of the cached descriptor, so a
+ * file changed in place (new size or mtime) is reopened at once and the
+ * Content-Length always matches; whether the path still names the same
+ * file (it may have been replaced by a rename) is checked with stat() only
+ * once an entry is FILE_CACHE_VALID_SECS old.  A file modified while a
+ * response is being sent may still yield a mix of old and new bytes, or a
+ * short response, as with any sendfile() server.
+ *
+ * The lock is held only for the map and list updates, never across a
+ * system call.  A capacity of 0 disables caching: every open() is fresh.
+ */
+class FileCache {
+public:
+    explicit FileCache(size_t capacity = DEFAULT_FILE_CACHE_ENTRIES) : capacity_(capacity) {}
+
+    FileCache(const FileCache &) = delete;
+    FileCache &operator=(const FileCache &) = delete;
+
+    /// Set the number of open files kept.  Shrinking evicts the oldest.
+    void setCapacity(size_t capacity) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_ = capacity;
+        evict_locked();
+    }
+
+    /// Open the regular file at \p path, reusing a cached descriptor when
+    /// it is still valid.  Returns null with errno set on failure (EISDIR
+    /// or EINVAL for something that is not a regular file).
+    std::shared_ptr<const OpenFile> open(const std::string &path) {
+        ServerStats &st = server_stats();
+        auto now = CoarseClock::steadyNow();
+        std::shared_ptr<const OpenFile> cached;
+        bool fresh = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = entries_.find(path);
+            if (it != entries_.end()) {
+                lru_.splice(lru_.begin(), lru_, it->second.lru);
+                cached = it->second.file;
+                fresh = now - it->second.checked < std::chrono::seconds(FILE_CACHE_VALID_SECS);
+            }
+        }
+
+        if (cached) {
+            struct stat sb;
+            bool valid = fstat(cached->fd, &sb) == 0 && cached->matches(sb) &&
+                         (fresh || (::stat(path.c_str(), &sb) == 0 && cached->matches(sb)));
+            if (valid) {
+                if (!fresh) {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    auto it = entries_.find(path);
+                    if (it != entries_.end() && it->second.file == cached) it->second.checked = now;
+                }
+                st.file_cache_hits.fetch_add(1, std::memory_order_relaxed);
+                return cached;
+            }
+        }
+
+        st.file_cache_misses.fetch_add(1, std::memory_order_relaxed);
+        std::shared_ptr<const OpenFile> file = open_file(path);
+        if (!file) {
+            int saved = errno;
+            if (cached) erase(path, cached);
+            errno = saved;
+            return nullptr;
+        }
+        insert(path, file, now);
+        return file;
+    }
+
+private:
+    struct Entry {
+        std::shared_ptr<const OpenFile> file;
+        std::chrono::steady_clock::time_point checked;  // last open() or stat()
+        std::list<std::string>::iterator lru;
+    };
+
+    static std::shared_ptr<const OpenFile> open_file(const std::string &path) {
+        // O_NONBLOCK: opening a FIFO would otherwise wait for a writer.
+        // Regular files, the only kind kept, ignore it.
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK);
+        if (fd < 0) return nullptr;
+        std::shared_ptr<OpenFile> file = std::make_shared<OpenFile>();
+        file->fd = fd;
+        struct stat sb;
+        if (fstat(fd, &sb) != 0) return nullptr;
+        if (!S_ISREG(sb.st_mode)) {
+            errno = S_ISDIR(sb.st_mode) ? EISDIR : EINVAL;
+            return nullptr;
+        }
+        file->size = static_cast<uint64_t>(sb.st_size);
+        file->mtime = sb.st_mtim;
+        file->dev = sb.st_dev;
+        file->ino = sb.st_ino;
+        return file;
+    }
+
+    void insert(const std::string &path, const std::shared_ptr<const OpenFile> &file,
+                std::chrono::steady_clock::time_point now) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (capacity_ == 0) return;
+        auto it = entries_.find(path);
+        if (it != entries_.end()) {
+            it->second.file = file;
+            it->second.checked = now;
+            lru_.splice(lru_.begin(), lru_, it->second.lru);
+            return;
+        }
+        lru_.push_front(path);
+        entries_.emplace(path, Entry{file, now, lru_.begin()});
+        evict_locked();
+    }
+
+    // Drop the entry for \p path if it still holds \p file.
+    void erase(const std::string &path, const std::shared_ptr<const OpenFile> &file) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(path);
+        if (it == entries_.end() || it->second.file != file) return;
+        lru_.erase(it->second.lru);
+        entries_.erase(it);
+    }
+
+    void evict_locked() {
+        while (entries_.size() > capacity_) {
+            entries_.erase(lru_.back());
+            lru_.pop_back();
+        }
+    }
+
+    std::mutex mutex_;
+    size_t capacity_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::list<std::string> lru_;  // paths, most recently used first
+};
+
+/// The process-wide instance.
+inline FileCache &file_cache() {
+    static FileCache cache;
+    return cache;
+}
@@ -0,0 +1,1216 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2026  LiteSpeed Technologies, Inc.                        *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "connection_io.h"
+#include "hpack.h"
+#include "http_parser.h"
+#include "http_utils.h"
+#include "log.h"
+#include "server_stats.h"
+
+// HTTP/2 configuration
+inline constexpr uint32_t H2_MAX_CONCURRENT_STREAMS = 100;   // open streams per connection
+inline constexpr uint32_t H2_DEFAULT_FRAME_SIZE = 16384;     // largest frame we accept (never raised)
+inline constexpr uint32_t H2_DEFAULT_WINDOW = 65535;         // RFC 9113 initial flow-control window
+inline constexpr uint32_t H2_CONNECTION_WINDOW = 16u << 20;  // 16 MB connection receive window
+inline constexpr uint32_t H2_MAX_WINDOW = 0x7fffffff;
+inline constexpr size_t H2_OUTPUT_HIGH = 262144;      // 256 KB of frames queued before streams stop being pumped
+inline constexpr size_t H2_PULL_SIZE = 16384;         // response bytes taken from a stream per round
+inline constexpr size_t H2_MAX_HEADER_BLOCK = 65536;  // encoded HEADERS + CONTINUATION bytes
+inline constexpr size_t H2_MAX_HEADER_LIST = 65536;   // decoded request fields (SETTINGS_MAX_HEADER_LIST_SIZE)
+inline constexpr size_t H2_MAX_RESPONSE_HEAD = 65536; // worker response head translated to HEADERS
+inline constexpr char H2_PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+inline constexpr size_t H2_PREFACE_LEN = sizeof(H2_PREFACE) - 1;
+inline constexpr char H2C_SWITCHING_PROTOCOLS[] =
+    "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+
+/// The reactor side of an H2Session: stream bridges come from, and go
+/// back to, the reactor's ConnectionIO pool, and requests run on its
+/// handler.  All calls are made on the reactor thread.
+class H2StreamHost {
+public:
+    /// A ConnectionIO for a new stream on connection \p fd.
+    virtual std::shared_ptr<ConnectionIO> h2_open_stream(int fd) = 0;
+
+    /// Run the request on \p io; \p body_complete if no body bytes are
+    /// still to come.  Returns false if the request is shed instead (the
+    /// session answers it with 503).
+    virtual bool h2_dispatch(int fd, const std::shared_ptr<ConnectionIO> &io,
+                             bool body_complete) = 0;
+
+    /// The stream is closed: take \p io back.
+    virtual void h2_close_stream(int fd, std::shared_ptr<ConnectionIO> &io) = 0;
+
+protected:
+    ~H2StreamHost() = default;
+};
+
+/**
+ * H2Session — one cleartext HTTP/2 (h2c) connection (RFC 9113), with
+ * every stream mapped onto its own ConnectionIO bridge.
+ *
+ * The reactor hands every received byte to onData().  Frames are parsed
+ * in place (only a frame split across reads is buffered), header blocks
+ * are decoded with HPACK straight into a ParsedRequest and its buffer, and
+ * each new stream is dispatched to the worker pool (or run to completion
+ * on the reactor thread) exactly like an HTTP/1.1 request.  DATA frames go
+ * into the stream's body ring; the client's end of stream — with or
+ * without a trailing HEADERS frame — ends the body as for a chunked one
+ * (ConnectionIO::endBody()).  A stream whose body may fit
+ * limits.body_prebuffer is held back until the body has ended or reached
+ * that size, as the reactor does for HTTP/1.1 (see HttpReactor).
+ *
+ * Workers are unaware of the protocol: they still write an HTTP/1.1
+ * response.  pump() takes it out of the stream's bridge
+ * (ConnectionIO::takeResponse()), turns the head into a HEADERS frame
+ * (dropping connection-specific fields), undoes a chunked encoding, and
+ * sends the body as DATA frames within the peer's flow-control windows.
+ * Streams are served round robin, one frame each per round, so one large
+ * response cannot starve the others.  All frames leave through the
+ * connection's own ConnectionIO, the "pipe", which the reactor flushes
+ * like any response; pumping stops while the pipe holds H2_OUTPUT_HIGH
+ * bytes, so a client that does not read costs no more than that.
+ *
+ * Flow control replaces the HTTP/1.1 read throttling.  A stream's receive
+ * window is at least the body high watermark, and it is re-opened
+ * (WINDOW_UPDATE) only for bytes the worker has taken out of the ring:
+ * once the ring is above the low watermark, the worker notifies the
+ * reactor when it has drained it (onStreamReady()).  The connection
+ * window is large and re-opened as data arrives, so a stalled stream does
+ * not block the others.
+ *
+ * Limits: H2_MAX_CONCURRENT_STREAMS streams (further ones are refused),
+ * H2_MAX_HEADER_BLOCK encoded and H2_MAX_HEADER_LIST decoded header bytes,
+ * and no server push.  The encoder uses no dynamic table and no Huffman
+ * coding.  CONNECT is answered with 501.
+ *
+ * Errors follow RFC 9113 §5.4: a malformed request or misuse of a single
+ * stream resets that stream; a framing, HPACK or flow-control violation
+ * of the connection sends GOAWAY, after which closing() is true and the
+ * reactor closes the connection once the pipe has drained.
+ */
+class H2Session {
+public:
+    H2Session(int fd, H2StreamHost &host, ConnectionIO &pipe, const ConnectionLimits &limits)
+        : fd_(fd), host_(host), pipe_(pipe), limits_(limits),
+          recv_window_(static_cast<uint32_t>(
+              std::min<size_t>(std::max<size_t>(limits.body_high_watermark, H2_DEFAULT_WINDOW),
+                               H2_MAX_WINDOW))) {}
+
+    H2Session(const H2Session &) = delete;
+    H2Session &operator=(const H2Session &) = delete;
+
+    /// Prior knowledge: send our SETTINGS; the client preface is expected
+    /// next.
+    void start() {
+        send_settings();
+        commit();
+    }
+
+    /// Upgrade from HTTP/1.1: \p settings is the decoded HTTP2-Settings
+    /// payload and \p io the upgraded request, which becomes stream 1
+    /// (half-closed on the client side) and is dispatched here.  The
+    /// reactor has already queued the 101 response on the pipe.
+    void startUpgrade(std::string_view settings, std::shared_ptr<ConnectionIO> io) {
+        send_settings();
+        if (settings.size() % 6 != 0 || !apply_settings(settings)) {
+            connection_error(ERR_PROTOCOL);
+            commit();
+            host_.h2_close_stream(fd_, io);
+            return;
+        }
+        last_stream_id_ = 1;
+        io->setStreamId(1);
+        Stream &s = streams_[1];
+        s.io = io;
+        s.send_window = peer_initial_window_;
+        s.end_received = true;
+        s.head_only = io->field(io->request().method) == "HEAD";
+        commit();
+        dispatch_stream(s, true);
+        commit();
+    }
+
+    /// If \p buf / \p req is an HTTP/1.1 request asking to upgrade to h2c
+    /// (RFC 7540 §3.2), decode its HTTP2-Settings into \p settings and
+    /// return true.  Requests with a body are not upgraded.
+    static bool wantsUpgrade(std::string_view buf, const ParsedRequest &req,
+                             std::string &settings) {
+        if (req.length_unknown || req.content_length > 0) return false;
+        bool h2c = false;
+        bool upgrade = false;
+        int settings_fields = 0;
+        std::string_view encoded;
+        for (const HttpHeaderSpan &h : req.headers) {
+            std::string_view name = ParsedRequest::view(buf.data(), h.name);
+            std::string_view value = ParsedRequest::view(buf.data(), h.value);
+            if (header_name_eq(name, "Upgrade")) {
+                h2c = h2c || has_token(value, "h2c");
+            } else if (header_name_eq(name, "Connection")) {
+                upgrade = upgrade || has_token(value, "upgrade");
+            } else if (header_name_eq(name, "HTTP2-Settings")) {
+                ++settings_fields;
+                encoded = value;
+            }
+        }
+        if (!h2c || !upgrade || settings_fields != 1) return false;
+        return http_utils::base64url_decode(encoded, settings);
+    }
+
+    /// Bytes received from the client.
+    void onData(const char *buf, size_t n) {
+        if (dead_) return;
+        if (in_.empty()) {
+            size_t used = process(buf, n);
+            if (!dead_) in_.append(buf + used, n - used);
+        } else {
+            in_.append(buf, n);
+            size_t used = process(in_.data(), in_.size());
+            in_.erase(0, used);
+        }
+        if (dead_) in_.clear();
+        if (conn_recv_unacked_ >= H2_CONNECTION_WINDOW / 2 && !dead_) {
+            send_window_update(0, static_cast<uint32_t>(conn_recv_unacked_));
+            conn_recv_unacked_ = 0;
+        }
+        commit();
+    }
+
+    /// A stream's worker queued output, finished, failed or drained its
+    /// body ring.  Moves held-back body bytes along and re-opens the
+    /// stream's receive window; output is sent by the next pump().
+    void onStreamReady(ConnectionIO *io) {
+        auto it = streams_.find(io->streamId());
+        if (it == streams_.end() || it->second.io.get() != io) return;
+        Stream &s = it->second;
+        if (!s.backlog.empty()) {
+            size_t taken = s.io->feedBody(s.backlog.data(), s.backlog.size(), s.end_received);
+            s.backlog.erase(0, taken);
+            server_stats().body_bytes_buffered.fetch_sub(taken, std::memory_order_relaxed);
+        }
+        update_window(it->first, s);
+        commit();
+    }
+
+    /// Turn the streams' responses into frames while the pipe has room.
+    /// Returns true if frames were queued on the pipe.
+    bool pump() {
+        if (!dead_) {
+            bool progress = true;
+            while (progress && room()) {
+                progress = false;
+                // One frame per stream per round, resuming after the
+                // stream served last.
+                auto it = streams_.upper_bound(rr_cursor_);
+                for (size_t i = 0, count = streams_.size(); i < count && room(); ++i) {
+                    if (streams_.empty()) break;
+                    if (it == streams_.end()) it = streams_.begin();
+                    auto next = std::next(it);
+                    rr_cursor_ = it->first;
+                    if (pump_stream(it)) progress = true;  // may erase it
+                    it = next;
+                }
+            }
+        }
+        return commit();
+    }
+
+    /// True once the connection is finished with: it failed (GOAWAY sent)
+    /// or the client went away and no stream is left.  The reactor closes
+    /// it once the pipe has drained.
+    bool closing() const {
+        return dead_ || ((peer_goaway_ || going_away_) && streams_.empty());
+    }
+
+    /// Graceful shutdown (the server is draining): send GOAWAY with
+    /// NO_ERROR and refuse new streams; the open ones run to completion,
+    /// after which closing() is true.  The frame goes out with the next
+    /// pump().
+    void goAway() {
+        if (dead_ || going_away_) return;
+        frame_header(8, FRAME_GOAWAY, 0, 0);
+        put32(last_stream_id_);
+        put32(ERR_NO_ERROR);
+        going_away_ = true;
+    }
+
+    /// goAway() has been called.
+    bool goingAway() const { return going_away_; }
+
+    /// Open streams.
+    size_t streams() const { return streams_.size(); }
+
+    /// The connection is going away: fail every stream and give the
+    /// bridges back.
+    void abort() {
+        while (!streams_.empty()) drop_stream(streams_.begin());
+    }
+
+private:
+    // Frame types (RFC 9113 §6).
+    static constexpr uint8_t FRAME_DATA = 0x0;
+    static constexpr uint8_t FRAME_HEADERS = 0x1;
+    static constexpr uint8_t FRAME_PRIORITY = 0x2;
+    static constexpr uint8_t FRAME_RST_STREAM = 0x3;
+    static constexpr uint8_t FRAME_SETTINGS = 0x4;
+    static constexpr uint8_t FRAME_PUSH_PROMISE = 0x5;
+    static constexpr uint8_t FRAME_PING = 0x6;
+    static constexpr uint8_t FRAME_GOAWAY = 0x7;
+    static constexpr uint8_t FRAME_WINDOW_UPDATE = 0x8;
+    static constexpr uint8_t FRAME_CONTINUATION = 0x9;
+
+    // Frame flags.
+    static constexpr uint8_t FLAG_END_STREAM = 0x1;
+    static constexpr uint8_t FLAG_ACK = 0x1;
+    static constexpr uint8_t FLAG_END_HEADERS = 0x4;
+    static constexpr uint8_t FLAG_PADDED = 0x8;
+    static constexpr uint8_t FLAG_PRIORITY = 0x20;
+
+    // Error codes (RFC 9113 §7).
+    static constexpr uint32_t ERR_NO_ERROR = 0x0;
+    static constexpr uint32_t ERR_PROTOCOL = 0x1;
+    static constexpr uint32_t ERR_INTERNAL = 0x2;
+    static constexpr uint32_t ERR_FLOW_CONTROL = 0x3;
+    static constexpr uint32_t ERR_STREAM_CLOSED = 0x5;
+    static constexpr uint32_t ERR_FRAME_SIZE = 0x6;
+    static constexpr uint32_t ERR_REFUSED_STREAM = 0x7;
+    static constexpr uint32_t ERR_COMPRESSION = 0x9;
+    static constexpr uint32_t ERR_ENHANCE_YOUR_CALM = 0xb;
+
+    // Settings (RFC 9113 §6.5.2).
+    static constexpr uint16_t SETTINGS_ENABLE_PUSH = 0x2;
+    static constexpr uint16_t SETTINGS_MAX_CONCURRENT_STREAMS = 0x3;
+    static constexpr uint16_t SETTINGS_INITIAL_WINDOW_SIZE = 0x4;
+    static constexpr uint16_t SETTINGS_MAX_FRAME_SIZE = 0x5;
+    static constexpr uint16_t SETTINGS_MAX_HEADER_LIST_SIZE = 0x6;
+
+    // Progress of a stream's response.
+    enum class Out {
+        Head,  // waiting for the worker's response head
+        Body,  // HEADERS sent, body being framed
+        Sent,  // END_STREAM sent; waiting for the worker to finish
+    };
+
+    // How the worker's HTTP/1.1 response delimits its body.
+    enum class Framing { Length, Chunked, Close };
+
+    struct Stream {
+        std::shared_ptr<ConnectionIO> io;
+        int64_t send_window = 0;      // peer's window for our DATA
+        uint64_t body_received = 0;   // request DATA payload bytes
+        uint64_t pad_received = 0;    // padding bytes (flow-controlled, never buffered)
+        uint64_t credited = 0;        // flow-controlled bytes re-opened by WINDOW_UPDATE
+        uint64_t declared_length = 0; // content-length, if has_length
+        bool has_length = false;
+        bool end_received = false;    // client ended the stream
+        bool head_only = false;       // HEAD request: the response has no body
+        bool held = false;            // body being pre-buffered, not dispatched yet
+        std::string backlog;          // body bytes the ring had no room for
+
+        Out out = Out::Head;
+        Framing framing = Framing::Close;
+        uint64_t body_left = 0;       // Framing::Length bytes still to come
+        bool body_end = false;        // the worker's body is complete
+        ChunkedDecoder chunked;       // Framing::Chunked decoder
+        std::string raw;              // response bytes taken, not yet translated
+        std::string data;             // body bytes ready for DATA frames
+    };
+    using StreamMap = std::map<uint32_t, Stream>;
+
+    // ── Input ───────────────────────────────────────────────────────
+
+    // Parse the preface and every complete frame in [p, p + n).  Returns
+    // the bytes consumed.
+    size_t process(const char *p, size_t n) {
+        size_t off = 0;
+        if (!preface_seen_) {
+            size_t cmp = std::min(n, H2_PREFACE_LEN);
+            if (std::memcmp(p, H2_PREFACE, cmp) != 0) {
+                LOG_INFO("HTTP/2: bad connection preface: fd " << fd_);
+                connection_error(ERR_PROTOCOL);
+                return n;
+            }
+            if (n < H2_PREFACE_LEN) return 0;
+            off = H2_PREFACE_LEN;
+            preface_seen_ = true;
+        }
+        while (!dead_ && n - off >= 9) {
+            const uint8_t *h = reinterpret_cast<const uint8_t *>(p + off);
+            uint32_t len = (static_cast<uint32_t>(h[0]) << 16) | (h[1] << 8) | h[2];
+            if (len > H2_DEFAULT_FRAME_SIZE) {
+                connection_error(ERR_FRAME_SIZE);
+                return n;
+            }
+            if (n - off < 9 + len) break;
+            uint32_t id = get32(h + 5) & 0x7fffffff;
+            on_frame(h[3], h[4], id, h + 9, len);
+            off += 9 + len;
+        }
+        return dead_ ? n : off;
+    }
+
+    void on_frame(uint8_t type, uint8_t flags, uint32_t id, const uint8_t *p, uint32_t len) {
+        // A header block is one unit: nothing may come between its frames.
+        if (in_continuation_ && (type != FRAME_CONTINUATION || id != block_stream_)) {
+            connection_error(ERR_PROTOCOL);
+            return;
+        }
+        switch (type) {
+        case FRAME_DATA:
+            on_data_frame(flags, id, p, len);
+            break;
+        case FRAME_HEADERS:
+            on_headers_frame(flags, id, p, len);
+            break;
+        case FRAME_PRIORITY:
+            if (id == 0) connection_error(ERR_PROTOCOL);
+            else if (len != 5) reset_stream(id, ERR_FRAME_SIZE);
+            break;
+        case FRAME_RST_STREAM: {
+            if (id == 0) return connection_error(ERR_PROTOCOL);
+            if (len != 4) return connection_error(ERR_FRAME_SIZE);
+            if (id > last_stream_id_) return connection_error(ERR_PROTOCOL);  // idle stream
+            auto it = streams_.find(id);
+            if (it != streams_.end()) drop_stream(it);
+            break;
+        }
+        case FRAME_SETTINGS:
+            if (id != 0) return connection_error(ERR_PROTOCOL);
+            if (flags & FLAG_ACK) {
+                if (len != 0) connection_error(ERR_FRAME_SIZE);
+                return;
+            }
+            if (len % 6 != 0) return connection_error(ERR_FRAME_SIZE);
+            if (!apply_settings(std::string_view(reinterpret_cast<const char *>(p), len))) return;
+            frame_header(0, FRAME_SETTINGS, FLAG_ACK, 0);
+            break;
+        case FRAME_PUSH_PROMISE:
+            connection_error(ERR_PROTOCOL);  // clients do not push
+            break;
+        case FRAME_PING:
+            if (id != 0) return connection_error(ERR_PROTOCOL);
+            if (len != 8) return connection_error(ERR_FRAME_SIZE);
+            if (!(flags & FLAG_ACK)) {
+                frame_header(8, FRAME_PING, FLAG_ACK, 0);
+                frames_.append(reinterpret_cast<const char *>(p), 8);
+            }
+            break;
+        case FRAME_GOAWAY:
+            if (id != 0) return connection_error(ERR_PROTOCOL);
+            if (len < 8) return connection_error(ERR_FRAME_SIZE);
+            peer_goaway_ = true;
+            break;
+        case FRAME_WINDOW_UPDATE:
+            on_window_update(id, p, len);
+            break;
+        case FRAME_CONTINUATION:
+            if (!in_continuation_) return connection_error(ERR_PROTOCOL);
+            if (block_.size() + len > H2_MAX_HEADER_BLOCK) {
+                return connection_error(ERR_ENHANCE_YOUR_CALM);
+            }
+            block_.append(reinterpret_cast<const char *>(p), len);
+            if (flags & FLAG_END_HEADERS) end_header_block();
+            break;
+        default:
+            break;  // unknown frame types are ignored
+        }
+    }
+
+    void on_data_frame(uint8_t flags, uint32_t id, const uint8_t *p, uint32_t len) {
+        if (id == 0) return connection_error(ERR_PROTOCOL);
+        uint32_t pad = 0;
+        if (flags & FLAG_PADDED) {
+            if (len < 1 || p[0] >= len) return connection_error(ERR_PROTOCOL);
+            pad = p[0];
+            ++p;
+        }
+        uint32_t data_len = len - pad - ((flags & FLAG_PADDED) ? 1 : 0);
+
+        // The whole frame counts against the connection window, whatever
+        // becomes of the stream.
+        conn_recv_unacked_ += len;
+        if (conn_recv_unacked_ > H2_CONNECTION_WINDOW) return connection_error(ERR_FLOW_CONTROL);
+
+        auto it = streams_.find(id);
+        if (it == streams_.end()) {
+            // An idle stream is an error; a stream we closed may still
+            // have frames in flight.
+            if (id > last_stream_id_) connection_error(ERR_PROTOCOL);
+            return;
+        }
+        Stream &s = it->second;
+        if (s.end_received) return reset_stream(id, ERR_STREAM_CLOSED);
+        s.body_received += data_len;
+        s.pad_received += len - data_len;
+        if (s.body_received + s.pad_received - s.credited > recv_window_) {
+            return reset_stream(id, ERR_FLOW_CONTROL);
+        }
+        if (s.has_length && s.body_received > s.declared_length) {
+            return reset_stream(id, ERR_PROTOCOL);
+        }
+        feed_stream(s, reinterpret_cast<const char *>(p), data_len);
+        if (flags & FLAG_END_STREAM) {
+            if (s.has_length && s.body_received != s.declared_length) {
+                return reset_stream(id, ERR_PROTOCOL);
+            }
+            HeaderPairs none;
+            end_request_body(s, none);
+            return;
+        }
+        update_window(id, s);
+        release_held(s);
+    }
+
+    void on_headers_frame(uint8_t flags, uint32_t id, const uint8_t *p, uint32_t len) {
+        if (id == 0) return connection_error(ERR_PROTOCOL);
+        uint32_t pos = 0;
+        uint32_t pad = 0;
+        if (flags & FLAG_PADDED) {
+            if (len < 1) return connection_error(ERR_PROTOCOL);
+            pad = p[0];
+            pos = 1;
+        }
+        if (flags & FLAG_PRIORITY) {
+            if (len < pos + 5) return connection_error(ERR_FRAME_SIZE);
+            pos += 5;  // dependency and weight: priorities are not used
+        }
+        if (pos + pad > len) return connection_error(ERR_PROTOCOL);
+        block_.assign(reinterpret_cast<const char *>(p + pos), len - pos - pad);
+        block_stream_ = id;
+        block_end_stream_ = (flags & FLAG_END_STREAM) != 0;
+        if (flags & FLAG_END_HEADERS) {
+            end_header_block();
+        } else {
+            in_continuation_ = true;
+        }
+    }
+
+    void on_window_update(uint32_t id, const uint8_t *p, uint32_t len) {
+        if (len != 4) return connection_error(ERR_FRAME_SIZE);
+        uint32_t inc = get32(p) & 0x7fffffff;
+        if (id == 0) {
+            if (inc == 0) return connection_error(ERR_PROTOCOL);
+            conn_send_window_ += inc;
+            if (conn_send_window_ > H2_MAX_WINDOW) connection_error(ERR_FLOW_CONTROL);
+            return;
+        }
+        auto it = streams_.find(id);
+        if (it == streams_.end()) {
+            if (id > last_stream_id_) connection_error(ERR_PROTOCOL);
+            return;
+        }
+        if (inc == 0) return reset_stream(id, ERR_PROTOCOL);
+        it->second.send_window += inc;
+        if (it->second.send_window > H2_MAX_WINDOW) reset_stream(id, ERR_FLOW_CONTROL);
+    }
+
+    // Apply a SETTINGS payload (a multiple of 6 bytes).  Returns false
+    // after a connection error.
+    bool apply_settings(std::string_view payload) {
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(payload.data());
+        for (size_t i = 0; i + 6 <= payload.size(); i += 6) {
+            uint16_t key = static_cast<uint16_t>((p[i] << 8) | p[i + 1]);
+            uint32_t value = get32(p + i + 2);
+            switch (key) {
+            case SETTINGS_ENABLE_PUSH:
+                if (value > 1) {
+                    connection_error(ERR_PROTOCOL);
+                    return false;
+                }
+                break;
+            case SETTINGS_INITIAL_WINDOW_SIZE: {
+                if (value > H2_MAX_WINDOW) {
+                    connection_error(ERR_FLOW_CONTROL);
+                    return false;
+                }
+                int64_t delta = static_cast<int64_t>(value) - peer_initial_window_;
+                peer_initial_window_ = value;
+                for (auto &entry : streams_) {
+                    entry.second.send_window += delta;
+                    if (entry.second.send_window > H2_MAX_WINDOW) {
+                        connection_error(ERR_FLOW_CONTROL);
+                        return false;
+                    }
+                }
+                break;
+            }
+            case SETTINGS_MAX_FRAME_SIZE:
+                if (value < H2_DEFAULT_FRAME_SIZE || value > 0xffffff) {
+                    connection_error(ERR_PROTOCOL);
+                    return false;
+                }
+                peer_max_frame_ = value;
+                break;
+            default:
+                break;  // table size (we never index), stream limits, unknown
+            }
+        }
+        return true;
+    }
+
+    // ── Requests ────────────────────────────────────────────────────
+
+    // A complete header block for block_stream_ is in block_.
+    void end_header_block() {
+        in_continuation_ = false;
+        uint32_t id = block_stream_;
+        auto it = streams_.find(id);
+        if (it != streams_.end()) {
+            on_trailers(it);
+            return;
+        }
+        if (id <= last_stream_id_) {
+            // A stream we already closed: keep the HPACK state in step.
+            if (!hpack_.decode(block_, [](std::string_view, std::string_view) {})) {
+                connection_error(ERR_COMPRESSION);
+            }
+            return;
+        }
+        if (id % 2 == 0) return connection_error(ERR_PROTOCOL);
+        last_stream_id_ = id;
+        open_stream(id);
+    }
+
+    // HEADERS on an open stream: the request trailers, which end it.
+    void on_trailers(StreamMap::iterator it) {
+        uint32_t id = it->first;
+        HeaderPairs trailers;
+        bool malformed = false;
+        size_t list_size = 0;
+        bool ok = hpack_.decode(block_, [&](std::string_view name, std::string_view value) {
+            list_size += name.size() + value.size() + 32;
+            if (malformed) return;
+            if (!valid_field(name, value) || name[0] == ':' ||
+                trailers.size() >= MAX_REQUEST_HEADERS || list_size > H2_MAX_HEADER_LIST) {
+                malformed = true;
+                return;
+            }
+            trailers.emplace_back(std::string(name), std::string(value));
+        });
+        if (!ok) return connection_error(ERR_COMPRESSION);
+        Stream &s = it->second;
+        if (s.end_received) return reset_stream(id, ERR_STREAM_CLOSED);
+        if (!block_end_stream_ || malformed ||
+            (s.has_length && s.body_received != s.declared_length)) {
+            return reset_stream(id, ERR_PROTOCOL);
+        }
+        end_request_body(s, trailers);
+    }
+
+    // HEADERS opening stream \p id: decode the request, then dispatch it.
+    void open_stream(uint32_t id) {
+        req_.clear();
+        req_buf_.clear();
+        HttpSpan pseudo[4];  // :method, :scheme, :path, :authority
+        bool seen[4] = {false, false, false, false};
+        bool regular_seen = false;
+        bool malformed = false;
+        bool too_large = false;
+        bool has_length = false;
+        uint64_t declared = 0;
+        size_t list_size = 0;
+        std::string cookies;  // cookie crumbs, joined again (RFC 9113 §8.2.3)
+
+        bool ok = hpack_.decode(block_, [&](std::string_view name, std::string_view value) {
+            list_size += name.size() + value.size() + 32;
+            if (malformed || too_large) return;
+            if (list_size > H2_MAX_HEADER_LIST || req_.headers.size() >= MAX_REQUEST_HEADERS) {
+                too_large = true;
+                return;
+            }
+            if (!valid_field(name, value)) {
+                malformed = true;
+                return;
+            }
+            if (name[0] == ':') {
+                static constexpr const char *PSEUDO[4] = {":method", ":scheme", ":path",
+                                                          ":authority"};
+                int which = -1;
+                for (int i = 0; i < 4; ++i) {
+                    if (name == PSEUDO[i]) which = i;
+                }
+                if (which < 0 || seen[which] || regular_seen) {
+                    malformed = true;
+                    return;
+                }
+                seen[which] = true;
+                pseudo[which] = add_field(name, value).value;
+                return;
+            }
+            regular_seen = true;
+            if (name == "connection" || name == "keep-alive" || name == "proxy-connection" ||
+                name == "transfer-encoding" || name == "upgrade" ||
+                (name == "te" && value != "trailers")) {
+                malformed = true;
+                return;
+            }
+            if (name == "cookie") {
+                if (!cookies.empty()) cookies += "; ";
+                cookies.append(value.data(), value.size());
+                return;
+            }
+            if (name == "content-length") {
+                uint64_t n = 0;
+                if (value.empty() || value.size() > 19) malformed = true;
+                for (char c : value) {
+                    if (c < '0' || c > '9') malformed = true;
+                    n = n * 10 + static_cast<uint64_t>(c - '0');
+                }
+                if (has_length && n != declared) malformed = true;
+                has_length = true;
+                declared = n;
+            }
+            add_field(name, value);
+        });
+        if (!ok) return connection_error(ERR_COMPRESSION);
+
+        if (dead_ || peer_goaway_ || going_away_ ||
+            streams_.size() >= H2_MAX_CONCURRENT_STREAMS) {
+            return reset_stream(id, ERR_REFUSED_STREAM);
+        }
+        if (too_large) return respond_status(id, 431);
+        if (malformed) return reset_stream(id, ERR_PROTOCOL);
+        std::string_view method = ParsedRequest::view(req_buf_.data(), pseudo[0]);
+        if (seen[0] && method == "CONNECT") return respond_status(id, 501);
+        if (!seen[0] || !seen[1] || !seen[2] || pseudo[2].len == 0) {
+            return reset_stream(id, ERR_PROTOCOL);
+        }
+        if (!cookies.empty()) add_field("cookie", cookies);
+        if (has_length && declared > 0 && block_end_stream_) return reset_stream(id, ERR_PROTOCOL);
+
+        req_.method = pseudo[0];
+        req_.target = pseudo[2];
+        req_.version = append_span("HTTP/2.0");
+        req_.header_end = req_buf_.size();
+        req_.length_unknown = !block_end_stream_;
+        req_.keep_alive = true;
+
+        std::shared_ptr<ConnectionIO> io = host_.h2_open_stream(fd_);
+        io->setStreamId(id);
+        io->setKeepAlive(true);
+        io->setRequest(req_buf_, req_);
+        Stream &s = streams_[id];
+        s.io = io;
+        s.send_window = peer_initial_window_;
+        s.has_length = has_length;
+        s.declared_length = declared;
+        s.end_received = block_end_stream_;
+        s.head_only = method == "HEAD";
+        size_t prebuffer = prebuffer_limit();
+        if (!block_end_stream_ && prebuffer > 0 && (!has_length || declared <= prebuffer)) {
+            s.held = true;
+            server_stats().requests_prebuffered.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        dispatch_stream(s, block_end_stream_);
+    }
+
+    // Body bytes a stream collects before it is dispatched: at most what
+    // its ring holds (the receive window is at least that large).
+    size_t prebuffer_limit() const {
+        return std::min(limits_.body_prebuffer, limits_.body_high_watermark);
+    }
+
+    // Dispatch a held stream once its body has ended or reached the
+    // pre-buffering limit.
+    void release_held(Stream &s) {
+        if (!s.held) return;
+        if (!s.end_received && s.backlog.empty() && s.io->bodyBuffered() < prebuffer_limit()) {
+            return;
+        }
+        s.held = false;
+        dispatch_stream(s, s.end_received && s.backlog.empty());
+    }
+
+    // Hand stream \p s to the host.  A stream the host sheds is answered
+    // with 503 and dropped.
+    void dispatch_stream(Stream &s, bool body_complete) {
+        if (host_.h2_dispatch(fd_, s.io, body_complete)) return;
+        uint32_t id = s.io->streamId();
+        std::string block;
+        hpack::encode_status(block, 503);
+        hpack::encode_field(block, "retry-after", "1");
+        hpack::encode_field(block, "content-length", "0");
+        queue_headers(id, block, true);
+        if (!s.end_received) {
+            // The client may still be sending the request body.
+            frame_header(4, FRAME_RST_STREAM, 0, id);
+            put32(ERR_NO_ERROR);
+        }
+        drop_stream(streams_.find(id));
+    }
+
+    // RFC 9113 §8.2.1: lowercase field names, no CR / LF / NUL in values
+    // and no surrounding whitespace.
+    static bool valid_field(std::string_view name, std::string_view value) {
+        if (name.empty()) return false;
+        for (size_t i = (name[0] == ':') ? 1 : 0; i < name.size(); ++i) {
+            unsigned char c = static_cast<unsigned char>(name[i]);
+            if (!http_is_tchar(c) || (c >= 'A' && c <= 'Z')) return false;
+        }
+        for (char c : value) {
+            if (c == '\0' || c == '\r' || c == '\n') return false;
+        }
+        if (!value.empty() && (value.front() == ' ' || value.front() == '\t' ||
+                               value.back() == ' ' || value.back() == '\t')) {
+            return false;
+        }
+        return true;
+    }
+
+    HttpSpan append_span(std::string_view s) {
+        HttpSpan span{static_cast<uint32_t>(req_buf_.size()), static_cast<uint32_t>(s.size())};
+        req_buf_.append(s.data(), s.size());
+        return span;
+    }
+
+    const HttpHeaderSpan &add_field(std::string_view name, std::string_view value) {
+        HttpHeaderSpan h;
+        h.name = append_span(name);
+        h.value = append_span(value);
+        req_.headers.push_back(h);
+        return req_.headers.back();
+    }
+
+    // Hand received body bytes to the worker; whatever the ring cannot
+    // take waits in the stream's backlog (bounded by its window).
+    void feed_stream(Stream &s, const char *data, size_t n) {
+        if (n == 0) return;
+        if (s.backlog.empty()) {
+            size_t taken = s.io->feedBody(data, n, false);
+            data += taken;
+            n -= taken;
+            if (n == 0) return;
+        }
+        s.backlog.append(data, n);
+        server_stats().body_bytes_buffered.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    void end_request_body(Stream &s, HeaderPairs &trailers) {
+        s.end_received = true;
+        s.io->endBody(static_cast<size_t>(s.body_received), trailers);
+        if (s.backlog.empty()) s.io->feedBody(nullptr, 0, true);
+        release_held(s);
+    }
+
+    // Re-open the stream's receive window for the bytes the worker has
+    // consumed, once that is worth a frame, and have the worker report
+    // back once it drains a ring above the low watermark.
+    void update_window(uint32_t id, Stream &s) {
+        if (s.end_received) return;
+        uint64_t buffered = s.io->bodyBuffered() + s.backlog.size();
+        uint64_t due = s.body_received + s.pad_received - buffered - s.credited;
+        uint64_t outstanding = s.body_received + s.pad_received - s.credited;
+        if (due > 0 && (due >= recv_window_ / 4 || recv_window_ - outstanding < recv_window_ / 2)) {
+            send_window_update(id, static_cast<uint32_t>(due));
+            s.credited += due;
+        }
+        if (s.backlog.empty() && s.io->bodyBuffered() > limits_.body_low_watermark) {
+            s.io->awaitBodyDrain();
+        }
+    }
+
+    // ── Responses ───────────────────────────────────────────────────
+
+    bool room() const { return pipe_.pendingBytes() + frames_.size() < H2_OUTPUT_HIGH; }
+
+    // Advance one stream's response by at most one DATA frame.  Returns
+    // true if anything happened.
+    bool pump_stream(StreamMap::iterator it) {
+        uint32_t id = it->first;
+        Stream &s = it->second;
+        ConnectionIO &io = *s.io;
+        if (s.out == Out::Sent) {
+            // Anything written after the body is not part of the response.
+            while (io.takeResponse(discard_, H2_PULL_SIZE) > 0) discard_.clear();
+            if (!io.isFinished() && !io.hasError()) return false;
+            finish_stream(it);
+            return true;
+        }
+        if (io.hasError()) {
+            reset_stream(id, ERR_INTERNAL);
+            return true;
+        }
+        bool progress = false;
+        if (s.out == Out::Head && !translate_head(it, progress)) return true;
+        if (s.out != Out::Body) return progress;
+
+        // Translate raw response bytes into body bytes.
+        if (!s.body_end && s.data.size() < H2_PULL_SIZE) {
+            if (s.raw.empty()) io.takeResponse(s.raw, H2_PULL_SIZE);
+            switch (s.framing) {
+            case Framing::Length: {
+                size_t n = static_cast<size_t>(std::min<uint64_t>(s.raw.size(), s.body_left));
+                s.data.append(s.raw, 0, n);
+                s.raw.erase(0, n);
+                s.body_left -= n;
+                s.body_end = s.body_left == 0;
+                break;
+            }
+            case Framing::Chunked: {
+                size_t used = 0;
+                ChunkedDecoder::Status st = s.chunked.decode(
+                    s.raw.data(), s.raw.size(), used,
+                    [&s](const char *d, size_t n) { s.data.append(d, n); });
+                if (st == ChunkedDecoder::Status::Error) {
+                    LOG_ERROR("HTTP/2: malformed chunked response on stream " << id);
+                    reset_stream(id, ERR_INTERNAL);
+                    return true;
+                }
+                s.raw.erase(0, used);
+                s.body_end = st == ChunkedDecoder::Status::Complete;
+                break;
+            }
+            case Framing::Close:
+                s.data += s.raw;
+                s.raw.clear();
+                s.body_end = io.isFinished();
+                break;
+            }
+            if (!s.body_end && s.raw.empty() && s.data.empty() && io.isFinished()) {
+                LOG_ERROR("HTTP/2: truncated response on stream " << id);
+                reset_stream(id, ERR_INTERNAL);
+                return true;
+            }
+        }
+
+        // Send what the windows allow.
+        int64_t window = std::min(s.send_window, conn_send_window_);
+        size_t n = std::min<size_t>(s.data.size(), peer_max_frame_);
+        n = window > 0 ? std::min<size_t>(n, static_cast<size_t>(window)) : 0;
+        bool trailers = s.framing == Framing::Chunked && !s.chunked.trailers().empty();
+        bool last = s.body_end && n == s.data.size() && !trailers;
+        if (n > 0 || last) {
+            frame_header(n, FRAME_DATA, last ? FLAG_END_STREAM : 0, id);
+            frames_.append(s.data, 0, n);
+            s.data.erase(0, n);
+            s.send_window -= static_cast<int64_t>(n);
+            conn_send_window_ -= static_cast<int64_t>(n);
+            progress = true;
+        }
+        if (s.body_end && s.data.empty()) {
+            if (trailers) {
+                std::string block;
+                encode_fields(block, s.chunked.trailers());
+                queue_headers(id, block, true);
+            }
+            s.out = Out::Sent;
+            progress = true;
+        }
+        return progress;
+    }
+
+    // Turn the worker's response head into a HEADERS frame.  Interim (1xx)
+    // responses are forwarded and the next head is awaited.  Returns false
+    // if the stream was reset.
+    bool translate_head(StreamMap::iterator it, bool &progress) {
+        uint32_t id = it->first;
+        Stream &s = it->second;
+        if (s.raw.size() < H2_MAX_RESPONSE_HEAD) s.io->takeResponse(s.raw, H2_PULL_SIZE);
+        while (s.out == Out::Head) {
+            size_t end = s.raw.find("\r\n\r\n");
+            if (end == std::string::npos) {
+                if (s.raw.size() >= H2_MAX_RESPONSE_HEAD || s.io->isFinished()) {
+                    LOG_ERROR("HTTP/2: no valid response head on stream " << id);
+                    reset_stream(id, ERR_INTERNAL);
+                    return false;
+                }
+                return true;
+            }
+            std::string_view head(s.raw.data(), end);
+            uint32_t status = 0;
+            if (head.size() < 12 || head.compare(0, 5, "HTTP/") != 0 ||
+                !parse_status(head.substr(9, 3), status) || status == 101) {
+                LOG_ERROR("HTTP/2: bad response status line on stream " << id);
+                reset_stream(id, ERR_INTERNAL);
+                return false;
+            }
+
+            std::string block;
+            hpack::encode_status(block, status);
+            bool chunked = false;
+            bool has_length = false;
+            uint64_t length = 0;
+            size_t pos = head.find("\r\n");
+            while (pos != std::string_view::npos) {
+                size_t next = head.find("\r\n", pos + 2);
+                std::string_view line = head.substr(pos + 2, next == std::string_view::npos
+                                                                 ? std::string_view::npos
+                                                                 : next - pos - 2);
+                pos = next;
+                std::string_view name, value;
+                if (!http_split_field(line, name, value)) continue;
+                if (header_name_eq(name, "Transfer-Encoding")) {
+                    chunked = has_token(value, "chunked");
+                    continue;
+                }
+                if (header_name_eq(name, "Content-Length")) {
+                    has_length = parse_length(value, length);
+                    if (!has_length) continue;
+                }
+                append_field(block, name, value);
+            }
+            s.raw.erase(0, end + 4);
+            progress = true;
+
+            if (status < 200) {
+                queue_headers(id, block, false);
+                continue;
+            }
+            bool no_body = s.head_only || status == 204 || status == 304 ||
+                           (!chunked && has_length && length == 0);
+            queue_headers(id, block, no_body);
+            if (no_body) {
+                s.out = Out::Sent;
+                return true;
+            }
+            s.out = Out::Body;
+            if (chunked) {
+                s.framing = Framing::Chunked;
+                s.chunked.reset();
+            } else if (has_length) {
+                s.framing = Framing::Length;
+                s.body_left = length;
+            } else {
+                s.framing = Framing::Close;
+            }
+        }
+        return true;
+    }
+
+    static bool parse_status(std::string_view digits, uint32_t &status) {
+        status = 0;
+        for (char c : digits) {
+            if (c < '0' || c > '9') return false;
+            status = status * 10 + static_cast<uint32_t>(c - '0');
+        }
+        return status >= 100;
+    }
+
+    static bool parse_length(std::string_view value, uint64_t &length) {
+        if (value.empty() || value.size() > 19) return false;
+        length = 0;
+        for (char c : value) {
+            if (c < '0' || c > '9') return false;
+            length = length * 10 + static_cast<uint64_t>(c - '0');
+        }
+        return true;
+    }
+
+    // Append one response field, lowercased, unless it is
+    // connection-specific.
+    static void append_field(std::string &block, std::string_view name, std::string_view value) {
+        if (header_name_eq(name, "Connection") || header_name_eq(name, "Keep-Alive") ||
+            header_name_eq(name, "Proxy-Connection") || header_name_eq(name, "Upgrade") ||
+            header_name_eq(name, "Transfer-Encoding")) {
+            return;
+        }
+        std::string lower(name);
+        std::transform(lower.begin(), lower.end(), lower.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        hpack::encode_field(block, lower, value);
+    }
+
+    static void encode_fields(std::string &block, const HeaderPairs &fields) {
+        for (const std::pair<std::string, std::string> &f : fields) {
+            append_field(block, f.first, f.second);
+        }
+    }
+
+    // Answer a stream with a bodiless \p status and close it.
+    void respond_status(uint32_t id, uint32_t status) {
+        std::string block;
+        hpack::encode_status(block, status);
+        hpack::encode_field(block, "content-length", "0");
+        queue_headers(id, block, true);
+        if (!block_end_stream_) {
+            // The client may still be sending the request body.
+            frame_header(4, FRAME_RST_STREAM, 0, id);
+            put32(ERR_NO_ERROR);
+        }
+    }
+
+    // ── Stream teardown ─────────────────────────────────────────────
+
+    // The response is complete and the worker done: close the stream,
+    // telling a client that is still sending that it may stop.
+    void finish_stream(StreamMap::iterator it) {
+        if (!it->second.end_received) {
+            frame_header(4, FRAME_RST_STREAM, 0, it->first);
+            put32(ERR_NO_ERROR);
+        }
+        drop_stream(it);
+    }
+
+    // Stream error: send RST_STREAM and drop the stream if it is open.
+    void reset_stream(uint32_t id, uint32_t code) {
+        frame_header(4, FRAME_RST_STREAM, 0, id);
+        put32(code);
+        auto it = streams_.find(id);
+        if (it != streams_.end()) drop_stream(it);
+    }
+
+    // Close a stream: fail its bridge (waking a worker blocked on it) and
+    // give it back to the reactor.
+    void drop_stream(StreamMap::iterator it) {
+        Stream &s = it->second;
+        s.io->feedError();
+        s.io->writeError();
+        server_stats().body_bytes_buffered.fetch_sub(s.backlog.size(), std::memory_order_relaxed);
+        host_.h2_close_stream(fd_, s.io);
+        streams_.erase(it);
+    }
+
+    // Connection error: GOAWAY, then the connection closes.
+    void connection_error(uint32_t code) {
+        if (dead_) return;
+        LOG_INFO("HTTP/2 connection error " << code << ": fd " << fd_);
+        frame_header(8, FRAME_GOAWAY, 0, 0);
+        put32(last_stream_id_);
+        put32(code);
+        dead_ = true;
+        in_continuation_ = false;
+    }
+
+    // ── Output ──────────────────────────────────────────────────────
+
+    void send_settings() {
+        static constexpr std::pair<uint16_t, uint32_t> FIXED[] = {
+            {SETTINGS_MAX_CONCURRENT_STREAMS, H2_MAX_CONCURRENT_STREAMS},
+            {SETTINGS_MAX_HEADER_LIST_SIZE, static_cast<uint32_t>(H2_MAX_HEADER_LIST)},
+        };
+        frame_header(18, FRAME_SETTINGS, 0, 0);
+        for (const std::pair<uint16_t, uint32_t> &kv : FIXED) put_setting(kv.first, kv.second);
+        put_setting(SETTINGS_INITIAL_WINDOW_SIZE, recv_window_);
+        send_window_update(0, H2_CONNECTION_WINDOW - H2_DEFAULT_WINDOW);
+    }
+
+    void put_setting(uint16_t key, uint32_t value) {
+        frames_.push_back(static_cast<char>(key >> 8));
+        frames_.push_back(static_cast<char>(key));
+        put32(value);
+    }
+
+    void send_window_update(uint32_t id, uint32_t inc) {
+        frame_header(4, FRAME_WINDOW_UPDATE, 0, id);
+        put32(inc);
+    }
+
+    // HEADERS, plus CONTINUATION frames if the block exceeds the peer's
+    // frame size.
+    void queue_headers(uint32_t id, const std::string &block, bool end_stream) {
+        size_t off = 0;
+        uint8_t type = FRAME_HEADERS;
+        do {
+            size_t n = std::min<size_t>(block.size() - off, peer_max_frame_);
+            bool last = off + n == block.size();
+            uint8_t flags = last ? FLAG_END_HEADERS : 0;
+            if (type == FRAME_HEADERS && end_stream) flags |= FLAG_END_STREAM;
+            frame_header(n, type, flags, id);
+            frames_.append(block, off, n);
+            off += n;
+            type = FRAME_CONTINUATION;
+        } while (off < block.size());
+    }
+
+    void frame_header(size_t len, uint8_t type, uint8_t flags, uint32_t id) {
+        char h[9] = {static_cast<char>(len >> 16), static_cast<char>(len >> 8),
+                     static_cast<char>(len), static_cast<char>(type), static_cast<char>(flags),
+                     static_cast<char>(id >> 24), static_cast<char>(id >> 16),
+                     static_cast<char>(id >> 8), static_cast<char>(id)};
+        frames_.append(h, sizeof(h));
+    }
+
+    void put32(uint32_t v) {
+        char b[4] = {static_cast<char>(v >> 24), static_cast<char>(v >> 16),
+                     static_cast<char>(v >> 8), static_cast<char>(v)};
+        frames_.append(b, sizeof(b));
+    }
+
+    static uint32_t get32(const uint8_t *p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    // Queue the frames built so far on the pipe, in one segment.
+    bool commit() {
+        if (frames_.empty()) return false;
+        pipe_.writeData(std::move(frames_));
+        frames_.clear();
+        return true;
+    }
+
+    // True if the comma-separated list \p value contains \p token.
+    static bool has_token(std::string_view value, std::string_view token) {
+        while (!value.empty()) {
+            size_t comma = value.find(',');
+            std::string_view t = value.substr(0, comma);
+            while (!t.empty() && (t.front() == ' ' || t.front() == '\t')) t.remove_prefix(1);
+            while (!t.empty() && (t.back() == ' ' || t.back() == '\t')) t.remove_suffix(1);
+            if (header_name_eq(t, token)) return true;
+            if (comma == std::string_view::npos) break;
+            value.remove_prefix(comma + 1);
+        }
+        return false;
+    }
+
+    int fd_;
+    H2StreamHost &host_;
+    ConnectionIO &pipe_;       // the connection's own bridge; carries every frame
+    const ConnectionLimits limits_;
+    const uint32_t recv_window_;  // our SETTINGS_INITIAL_WINDOW_SIZE
+
+    StreamMap streams_;
+    uint32_t last_stream_id_ = 0;   // highest stream the client opened
+    uint32_t rr_cursor_ = 0;        // stream pump() served last
+    int64_t conn_send_window_ = H2_DEFAULT_WINDOW;
+    int64_t peer_initial_window_ = H2_DEFAULT_WINDOW;
+    uint32_t peer_max_frame_ = H2_DEFAULT_FRAME_SIZE;
+    uint64_t conn_recv_unacked_ = 0;  // received bytes not yet re-opened on the connection
+    bool preface_seen_ = false;
+    bool peer_goaway_ = false;
+    bool dead_ = false;             // GOAWAY sent
+    bool going_away_ = false;       // graceful GOAWAY sent (draining)
+
+    HpackDecoder hpack_;
+    std::string block_;             // header block being assembled
+    uint32_t block_stream_ = 0;
+    bool block_end_stream_ = false;
+    bool in_continuation_ = false;
+
+    std::string in_;        // a frame split across reads
+    std::string frames_;    // frames not yet committed to the pipe
+    std::string req_buf_;   // decoded request fields, swapped into the stream's bridge
+    ParsedRequest req_;
+    std::string discard_;
+};
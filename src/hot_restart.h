@@ -0,0 +1,474 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2026  LiteSpeed Technologies, Inc.                        *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "log.h"
+
+inline constexpr size_t HOT_RESTART_MAX_FDS = 64;     // listening sockets per listener in one message
+inline constexpr int HOT_RESTART_RECV_TIMEOUT = 10;   // seconds the successor waits for each message
+inline constexpr int HOT_RESTART_POLL_MS = 200;       // control thread wake-up interval
+
+/**
+ * HotRestart — hands the listening sockets from a running lswasm to its
+ * successor, so that a new binary (or configuration) takes over without
+ * dropping a connection.
+ *
+ * Both processes are started with the same --hot-restart PATH, a Unix
+ * SOCK_SEQPACKET control socket served by the running process:
+ *
+ *   1. The successor connects (takeOver()) and receives one message per
+ *      listener: the listener's describe() string, with its sockets
+ *      attached as SCM_RIGHTS.  The control socket itself follows under
+ *      "control", then "end".  Both processes now share the same kernel
+ *      sockets, so the accept queues are never closed.
+ *   2. The successor adopts the sockets of the listeners it is configured
+ *      with (claim()), loads and warms its modules and starts its reactors;
+ *      until then the old process keeps serving alone.
+ *   3. activate(): the successor tells systemd it is the new main process
+ *      (MAINPID=, if NOTIFY_SOCKET is set), sends "ready" and starts
+ *      serving the control socket for its own successor.
+ *   4. On "ready" the old process runs its handoff callback, which lets
+ *      the reactors drain: they stop accepting, finish their open
+ *      connections and exit, after which the thread pools shut down.
+ *
+ * If the successor exits or disconnects before "ready", the old process
+ * carries on as if nothing had happened.
+ *
+ * SIGUSR2 (requestRestart()) makes the running process start the
+ * successor itself: it re-executes its own binary path with its original
+ * arguments, so replacing the binary file and sending SIGUSR2 upgrades in
+ * place — this is what the systemd unit's ExecReload does.
+ */
+class HotRestart {
+public:
+    /// Listener describe() string → its listening sockets.
+    using Sockets = std::map<std::string, std::vector<int>>;
+
+    enum class TakeOver { None, Done, Failed };
+
+    /// \p argv is the command line to re-execute on SIGUSR2.
+    HotRestart(std::string path, std::vector<std::string> argv)
+        : path_(std::move(path)), argv_(std::move(argv)) {
+        char exe[4096];
+        ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+        if (n > 0) exe_.assign(exe, static_cast<size_t>(n));
+    }
+
+    ~HotRestart() {
+        stop();
+        closeUnclaimed();
+        if (pred_fd_ >= 0) close(pred_fd_);
+    }
+
+    HotRestart(const HotRestart &) = delete;
+    HotRestart &operator=(const HotRestart &) = delete;
+
+    const std::string &path() const { return path_; }
+
+    /// Ask the process serving the control socket for its listeners.
+    /// None: nothing is running there (start fresh).  Failed: a process
+    /// answered but the transfer broke; \p error says why.
+    TakeOver takeOver(std::string &error) {
+        sockaddr_un addr{};
+        if (!make_address(addr, error)) return TakeOver::Failed;
+        int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            error = std::string("socket: ") + strerror(errno);
+            return TakeOver::Failed;
+        }
+        if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+            int err = errno;
+            close(fd);
+            if (err == ENOENT || err == ECONNREFUSED) return TakeOver::None;
+            error = "connect " + path_ + ": " + strerror(err);
+            return TakeOver::Failed;
+        }
+        struct timeval tv{};
+        tv.tv_sec = HOT_RESTART_RECV_TIMEOUT;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        for (;;) {
+            std::string key;
+            std::vector<int> fds;
+            if (!recv_sockets(fd, key, fds, error)) {
+                close(fd);
+                for (auto &entry : inherited_) {
+                    for (int sfd : entry.second) close(sfd);
+                }
+                inherited_.clear();
+                if (control_fd_ >= 0) close(control_fd_);
+                control_fd_ = -1;
+                return TakeOver::Failed;
+            }
+            if (key == "end") break;
+            if (key == "control" && fds.size() == 1 && control_fd_ < 0) {
+                control_fd_ = fds[0];
+                remember_path();
+                continue;
+            }
+            std::vector<int> &slot = inherited_[key];
+            slot.insert(slot.end(), fds.begin(), fds.end());
+        }
+        pred_fd_ = fd;
+        return TakeOver::Done;
+    }
+
+    /// Take over the inherited sockets of listener \p key (empty if the
+    /// predecessor had no such listener).
+    std::vector<int> claim(const std::string &key) {
+        auto it = inherited_.find(key);
+        if (it == inherited_.end()) return {};
+        std::vector<int> fds = std::move(it->second);
+        inherited_.erase(it);
+        return fds;
+    }
+
+    /// Close the inherited sockets of listeners this process does not
+    /// have.  Connections queued on them are lost once the predecessor
+    /// lets go as well.
+    void closeUnclaimed() {
+        for (auto &[key, fds] : inherited_) {
+            LOG_INFO("Hot restart: listener " << key << " is not configured, closing it");
+            for (int fd : fds) close(fd);
+        }
+        inherited_.clear();
+    }
+
+    /// Traffic is being served: tell systemd and the predecessor, then
+    /// serve the control socket so that \p sockets can be handed to a
+    /// successor.  \p on_handoff runs (on the control thread) once one
+    /// has taken over.  Returns false if the control socket cannot be set
+    /// up; the server keeps running, without hot restart.
+    bool activate(Sockets sockets, std::function<void()> on_handoff, std::string &error) {
+        bool took_over = pred_fd_ >= 0;
+        notify_systemd(took_over ? "MAINPID=" + std::to_string(getpid()) + "\nREADY=1"
+                                 : std::string("READY=1"));
+        if (took_over) {
+            static const char READY[] = "ready";
+            if (send(pred_fd_, READY, sizeof(READY) - 1, MSG_NOSIGNAL) < 0) {
+                LOG_ERROR("Hot restart: cannot signal the predecessor: " << strerror(errno));
+            }
+            close(pred_fd_);
+            pred_fd_ = -1;
+        }
+
+        if (control_fd_ < 0 && !bind_control(error)) return false;
+        owns_path_ = true;  // an inherited control socket is ours from here on
+        int pipe_fds[2];
+        if (pipe2(pipe_fds, O_CLOEXEC | O_NONBLOCK) < 0) {
+            error = std::string("pipe: ") + strerror(errno);
+            return false;
+        }
+        wake_rd_ = pipe_fds[0];
+        wake_fd().store(pipe_fds[1], std::memory_order_release);
+
+        sockets_ = std::move(sockets);
+        on_handoff_ = std::move(on_handoff);
+        thread_ = std::thread([this]() { control_loop(); });
+        return true;
+    }
+
+    /// Stop serving the control socket (shutdown).  The socket file is
+    /// removed unless a successor has taken it over, or this process never
+    /// activated (its predecessor is still serving it).
+    void stop() {
+        stop_.store(true, std::memory_order_relaxed);
+        if (thread_.joinable()) thread_.join();
+        int wfd = wake_fd().exchange(-1, std::memory_order_acq_rel);
+        if (wfd >= 0) close(wfd);
+        if (wake_rd_ >= 0) close(wake_rd_);
+        wake_rd_ = -1;
+        if (control_fd_ >= 0) {
+            close(control_fd_);
+            control_fd_ = -1;
+            // Leave the file alone if it is not ours yet, if a successor
+            // has it, or if it has since been replaced by another instance.
+            struct stat st;
+            if (owns_path_ && !handed_off_ && ::stat(path_.c_str(), &st) == 0 &&
+                st.st_dev == path_dev_ && st.st_ino == path_ino_) {
+                ::unlink(path_.c_str());
+            }
+        }
+    }
+
+    /// Start a successor (SIGUSR2).  Async-signal-safe.
+    static void requestRestart() {
+        int fd = wake_fd().load(std::memory_order_acquire);
+        if (fd >= 0) {
+            char c = 1;
+            ssize_t rc = write(fd, &c, 1);
+            (void)rc;
+        }
+    }
+
+private:
+    static std::atomic<int> &wake_fd() {
+        static std::atomic<int> fd{-1};
+        return fd;
+    }
+
+    bool make_address(sockaddr_un &addr, std::string &error) const {
+        addr.sun_family = AF_UNIX;
+        if (path_.size() >= sizeof(addr.sun_path)) {
+            error = "control socket path too long: " + path_;
+            return false;
+        }
+        std::strncpy(addr.sun_path, path_.c_str(), sizeof(addr.sun_path) - 1);
+        return true;
+    }
+
+    bool bind_control(std::string &error) {
+        sockaddr_un addr{};
+        if (!make_address(addr, error)) return false;
+        int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            error = std::string("socket: ") + strerror(errno);
+            return false;
+        }
+        ::unlink(path_.c_str());  // takeOver() found nobody serving it
+        mode_t old_mask = umask(077);
+        int rc = bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+        umask(old_mask);
+        if (rc < 0 || listen(fd, 4) < 0) {
+            error = "bind " + path_ + ": " + strerror(errno);
+            close(fd);
+            return false;
+        }
+        control_fd_ = fd;
+        remember_path();
+        return true;
+    }
+
+    // Note which file the control socket is, for stop().
+    void remember_path() {
+        struct stat st;
+        if (::stat(path_.c_str(), &st) == 0) {
+            path_dev_ = st.st_dev;
+            path_ino_ = st.st_ino;
+        }
+    }
+
+    // Send \p key with \p fds attached, as one message.
+    static bool send_sockets(int fd, const std::string &key, const std::vector<int> &fds) {
+        struct iovec iov{const_cast<char *>(key.data()), key.size()};
+        struct msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        std::vector<char> control;
+        if (!fds.empty()) {
+            control.assign(CMSG_SPACE(fds.size() * sizeof(int)), 0);
+            msg.msg_control = control.data();
+            msg.msg_controllen = control.size();
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(fds.size() * sizeof(int));
+            std::memcpy(CMSG_DATA(cmsg), fds.data(), fds.size() * sizeof(int));
+        }
+        return sendmsg(fd, &msg, MSG_NOSIGNAL) == static_cast<ssize_t>(key.size());
+    }
+
+    // Receive one message: its key and the sockets attached to it.
+    static bool recv_sockets(int fd, std::string &key, std::vector<int> &fds, std::string &error) {
+        char data[512];
+        char control[CMSG_SPACE(HOT_RESTART_MAX_FDS * sizeof(int))];
+        struct iovec iov{data, sizeof(data)};
+        struct msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        ssize_t n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+        if (n <= 0) {
+            error = n == 0 ? "predecessor closed the control connection"
+                           : std::string("recvmsg: ") + strerror(errno);
+            return false;
+        }
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+            size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const unsigned char *p = CMSG_DATA(cmsg);
+            for (size_t i = 0; i < count; ++i) {
+                int sfd;
+                std::memcpy(&sfd, p + i * sizeof(int), sizeof(int));
+                fds.push_back(sfd);
+            }
+        }
+        if (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) {
+            for (int sfd : fds) close(sfd);
+            error = "control message truncated";
+            return false;
+        }
+        key.assign(data, static_cast<size_t>(n));
+        return true;
+    }
+
+    // Control thread: wait for a successor to connect (or for SIGUSR2 to
+    // start one) until a handoff succeeds or stop() is called.
+    void control_loop() {
+        while (!stop_.load(std::memory_order_relaxed)) {
+            reap_child();
+            struct pollfd pfds[2] = {{control_fd_, POLLIN, 0}, {wake_rd_, POLLIN, 0}};
+            int n = poll(pfds, 2, HOT_RESTART_POLL_MS);
+            if (n <= 0) continue;
+            if (pfds[1].revents & POLLIN) {
+                char buf[64];
+                while (read(wake_rd_, buf, sizeof(buf)) > 0) {}
+                spawn_successor();
+            }
+            if (!(pfds[0].revents & POLLIN)) continue;
+            int fd = accept4(control_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) continue;
+            bool handed_off = serve_successor(fd);
+            close(fd);
+            if (handed_off) {
+                handed_off_ = true;
+                on_handoff_();
+                return;
+            }
+        }
+    }
+
+    // Send our sockets to a connected successor and wait for its "ready".
+    bool serve_successor(int fd) {
+        LOG_INFO("Hot restart: successor connected, handing over listeners");
+        for (const auto &[key, fds] : sockets_) {
+            if (fds.size() > HOT_RESTART_MAX_FDS) {
+                LOG_ERROR("Hot restart: " << key << " has too many sockets to hand over");
+                return false;
+            }
+            if (!send_sockets(fd, key, fds)) {
+                LOG_ERROR("Hot restart: sending " << key << " failed: " << strerror(errno));
+                return false;
+            }
+        }
+        if (!send_sockets(fd, "control", {control_fd_}) || !send_sockets(fd, "end", {})) {
+            LOG_ERROR("Hot restart: sending the control socket failed: " << strerror(errno));
+            return false;
+        }
+
+        // The successor loads its modules and starts its reactors first;
+        // keep serving meanwhile.
+        while (!stop_.load(std::memory_order_relaxed)) {
+            reap_child();
+            struct pollfd pfd = {fd, POLLIN, 0};
+            if (poll(&pfd, 1, HOT_RESTART_POLL_MS) <= 0) continue;
+            char buf[16];
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n == 5 && std::memcmp(buf, "ready", 5) == 0) {
+                LOG_INFO("Hot restart: successor is serving, draining");
+                return true;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            LOG_ERROR("Hot restart: successor went away before taking over");
+            return false;
+        }
+        return false;
+    }
+
+    // Re-execute our own binary with the original arguments.
+    void spawn_successor() {
+        if (child_ > 0) {
+            LOG_INFO("Hot restart: a successor (pid " << child_ << ") is already starting");
+            return;
+        }
+        if (exe_.empty()) {
+            LOG_ERROR("Hot restart: cannot determine the executable path");
+            return;
+        }
+        std::vector<char *> args;
+        for (std::string &a : argv_) args.push_back(a.data());
+        args.push_back(nullptr);
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            execv(exe_.c_str(), args.data());
+            _exit(127);
+        }
+        if (pid < 0) {
+            LOG_ERROR("Hot restart: fork failed: " << strerror(errno));
+            return;
+        }
+        child_ = pid;
+        LOG_INFO("Hot restart: started successor " << exe_ << " (pid " << pid << ")");
+    }
+
+    // Collect a successor that exited without taking over.
+    void reap_child() {
+        if (child_ <= 0) return;
+        int status = 0;
+        if (waitpid(child_, &status, WNOHANG) != child_) return;
+        LOG_ERROR("Hot restart: successor (pid " << child_ << ") exited with status "
+                  << (WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status)));
+        child_ = -1;
+    }
+
+    static void notify_systemd(const std::string &state) {
+        const char *path = getenv("NOTIFY_SOCKET");
+        if (!path || (path[0] != '/' && path[0] != '@')) return;
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        size_t len = strlen(path);
+        if (len >= sizeof(addr.sun_path)) return;
+        std::memcpy(addr.sun_path, path, len);
+        if (path[0] == '@') addr.sun_path[0] = '\0';  // abstract namespace
+        int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return;
+        if (sendto(fd, state.data(), state.size(), MSG_NOSIGNAL,
+                   reinterpret_cast<sockaddr *>(&addr),
+                   static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + len)) < 0) {
+            LOG_ERROR("sd_notify failed: " << strerror(errno));
+        }
+        close(fd);
+    }
+
+    std::string path_;
+    std::vector<std::string> argv_;
+    std::string exe_;                 // /proc/self/exe at startup
+    Sockets inherited_;               // received, not yet claimed
+    Sockets sockets_;                 // ours, for the next successor
+    std::function<void()> on_handoff_;
+    int pred_fd_ = -1;                // connection to the predecessor until activate()
+    int control_fd_ = -1;             // listening control socket
+    int wake_rd_ = -1;                // read end of the SIGUSR2 pipe
+    dev_t path_dev_ = 0;              // the control socket file, as found at startup
+    ino_t path_ino_ = 0;
+    pid_t child_ = -1;                // successor started by spawn_successor()
+    bool owns_path_ = false;          // bound or activated the control socket ourselves
+    bool handed_off_ = false;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
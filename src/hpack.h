@@ -0,0 +1,385 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2026  LiteSpeed Technologies, Inc.                        *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// HPACK configuration
+inline constexpr size_t HPACK_DEFAULT_TABLE_SIZE = 4096;  // dynamic table size until SETTINGS change it
+inline constexpr size_t HPACK_ENTRY_OVERHEAD = 32;        // per-entry size overhead (RFC 7541 §4.1)
+
+namespace hpack {
+
+struct StaticEntry {
+    const char *name;
+    const char *value;
+};
+
+// RFC 7541 Appendix A.  Index 1 is STATIC_TABLE[0].
+inline constexpr StaticEntry STATIC_TABLE[] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+inline constexpr size_t STATIC_TABLE_SIZE = sizeof(STATIC_TABLE) / sizeof(STATIC_TABLE[0]);
+
+// Code length of every symbol (256 = EOS) in the HPACK Huffman code
+// (RFC 7541 Appendix B).  The code is canonical, so the lengths alone
+// determine it.
+inline constexpr uint8_t HUFFMAN_CODE_LENGTHS[257] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+     6, 10, 10, 12, 13,  6,  8, 11, 10, 10,  8, 11,  8,  6,  6,  6,
+     5,  5,  5,  6,  6,  6,  6,  6,  6,  6,  7,  8, 15,  6, 12, 10,
+    13,  6,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,
+     7,  7,  7,  7,  7,  7,  7,  7,  8,  7,  8, 13, 19, 13, 14,  6,
+    15,  5,  6,  5,  6,  5,  6,  6,  6,  5,  7,  7,  6,  6,  6,  5,
+     6,  7,  6,  5,  5,  6,  7,  7,  7,  7,  7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30,
+};
+
+inline constexpr uint32_t HUFFMAN_EOS = 256;
+inline constexpr unsigned HUFFMAN_MAX_BITS = 30;
+
+/// Canonical-code decoding tables: for every code length, the first code
+/// of that length and where its symbols start in the length-sorted list.
+struct HuffmanTable {
+    uint32_t first[HUFFMAN_MAX_BITS + 1] = {};
+    uint16_t count[HUFFMAN_MAX_BITS + 1] = {};
+    uint16_t offset[HUFFMAN_MAX_BITS + 1] = {};
+    uint16_t symbols[257] = {};
+};
+
+inline const HuffmanTable &huffman_table() {
+    static const HuffmanTable table = [] {
+        HuffmanTable t;
+        for (uint32_t s = 0; s < 257; ++s) ++t.count[HUFFMAN_CODE_LENGTHS[s]];
+        uint32_t code = 0;
+        uint16_t offset = 0;
+        for (unsigned len = 1; len <= HUFFMAN_MAX_BITS; ++len) {
+            code = (code + t.count[len - 1]) << 1;
+            t.first[len] = code;
+            t.offset[len] = offset;
+            offset = static_cast<uint16_t>(offset + t.count[len]);
+        }
+        uint16_t next[HUFFMAN_MAX_BITS + 1] = {};
+        for (uint32_t s = 0; s < 257; ++s) {
+            unsigned len = HUFFMAN_CODE_LENGTHS[s];
+            t.symbols[t.offset[len] + next[len]++] = static_cast<uint16_t>(s);
+        }
+        return t;
+    }();
+    return table;
+}
+
+/// Decode a Huffman-coded string literal, appending to \p out.  Returns
+/// false on an invalid code, an explicit EOS, or padding that is longer
+/// than 7 bits or not all ones.
+inline bool huffman_decode(std::string_view in, std::string &out) {
+    const HuffmanTable &t = huffman_table();
+    uint32_t code = 0;
+    unsigned len = 0;
+    for (unsigned char byte : in) {
+        for (int bit = 7; bit >= 0; --bit) {
+            code = (code << 1) | ((byte >> bit) & 1u);
+            ++len;
+            if (len > HUFFMAN_MAX_BITS) return false;
+            if (code - t.first[len] < t.count[len]) {
+                uint16_t sym = t.symbols[t.offset[len] + (code - t.first[len])];
+                if (sym == HUFFMAN_EOS) return false;
+                out.push_back(static_cast<char>(sym));
+                code = 0;
+                len = 0;
+            }
+        }
+    }
+    // Leftover bits must be a prefix of EOS (all ones), at most 7 of them.
+    return len < 8 && code == (1u << len) - 1;
+}
+
+/// Append \p value as an HPACK integer with an N-bit prefix; \p flags
+/// holds the bits above the prefix in the first byte.
+inline void encode_int(std::string &out, uint64_t value, unsigned prefix_bits, uint8_t flags) {
+    uint64_t max_prefix = (1u << prefix_bits) - 1;
+    if (value < max_prefix) {
+        out.push_back(static_cast<char>(flags | value));
+        return;
+    }
+    out.push_back(static_cast<char>(flags | max_prefix));
+    value -= max_prefix;
+    while (value >= 128) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+/// Append a raw (not Huffman-coded) string literal.
+inline void encode_string(std::string &out, std::string_view s) {
+    encode_int(out, s.size(), 7, 0x00);
+    out.append(s.data(), s.size());
+}
+
+/// Static-table index of the first entry named \p name, or 0.
+inline size_t static_name_index(std::string_view name) {
+    for (size_t i = 0; i < STATIC_TABLE_SIZE; ++i) {
+        if (name == STATIC_TABLE[i].name) return i + 1;
+    }
+    return 0;
+}
+
+/// Append ":status" — an indexed field for the statuses in the static
+/// table, a literal with an indexed name otherwise.
+inline void encode_status(std::string &out, uint32_t status) {
+    for (size_t i = 7; i < 14; ++i) {  // ":status" entries 8..14
+        if (std::to_string(status) == STATIC_TABLE[i].value) {
+            encode_int(out, i + 1, 7, 0x80);
+            return;
+        }
+    }
+    encode_int(out, 8, 4, 0x00);
+    encode_string(out, std::to_string(status));
+}
+
+/// Append a literal field without indexing.  \p name must be lowercase.
+/// The encoder keeps no dynamic table, so it needs no state and never
+/// has to follow the peer's table size.
+inline void encode_field(std::string &out, std::string_view name, std::string_view value) {
+    size_t index = static_name_index(name);
+    if (index) {
+        encode_int(out, index, 4, 0x00);
+    } else {
+        out.push_back(0x00);
+        encode_string(out, name);
+    }
+    encode_string(out, value);
+}
+
+} // namespace hpack
+
+/**
+ * HpackDecoder — decoder side of one HTTP/2 connection's header
+ * compression context (RFC 7541).
+ *
+ * decode() walks a complete header block and hands every field to a
+ * callback as (name, value) views; the views are valid only during the
+ * call, so the caller copies the bytes straight into its own buffer.
+ * Huffman-coded literals are decoded into a scratch string that keeps its
+ * capacity.  The dynamic table is a deque of owned entries, newest first,
+ * bounded by the table size the peer selects (never more than the limit
+ * we advertised, HPACK_DEFAULT_TABLE_SIZE).
+ *
+ * Any decoding error is a connection error (COMPRESSION_ERROR): the
+ * table may be out of step with the peer's afterwards.
+ */
+class HpackDecoder {
+public:
+    /// Decode \p block, calling emit(std::string_view name,
+    /// std::string_view value) for each field.  Returns false if the block
+    /// is malformed.
+    template <typename Emit>
+    bool decode(std::string_view block, Emit &&emit) {
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(block.data());
+        const uint8_t *end = p + block.size();
+        bool fields_seen = false;
+        while (p < end) {
+            uint8_t b = *p;
+            uint64_t index;
+            if (b & 0x80) {
+                // Indexed field.
+                if (!decode_int(p, end, 7, index)) return false;
+                std::string_view name, value;
+                if (!lookup(index, name, value)) return false;
+                emit(name, value);
+                fields_seen = true;
+            } else if ((b & 0xe0) == 0x20) {
+                // Dynamic table size update: only before the first field.
+                if (fields_seen || !decode_int(p, end, 5, index)) return false;
+                if (index > max_size_) return false;
+                size_limit_ = static_cast<size_t>(index);
+                evict(0);
+            } else {
+                // Literal: with incremental indexing (01), without (0000) or
+                // never indexed (0001).
+                bool indexing = (b & 0xc0) == 0x40;
+                if (!decode_int(p, end, indexing ? 6 : 4, index)) return false;
+                std::string_view name;
+                std::string_view value;
+                if (index) {
+                    std::string_view unused;
+                    if (!lookup(index, name, unused)) return false;
+                    name_buf_.assign(name.data(), name.size());
+                } else {
+                    if (!decode_string(p, end, name_buf_)) return false;
+                }
+                if (!decode_string(p, end, value_buf_)) return false;
+                name = name_buf_;
+                value = value_buf_;
+                emit(name, value);
+                if (indexing) insert(name, value);
+                fields_seen = true;
+            }
+        }
+        return true;
+    }
+
+private:
+    // RFC 7541 §5.1.  Rejects values that do not fit in 32 bits.
+    static bool decode_int(const uint8_t *&p, const uint8_t *end, unsigned prefix_bits,
+                           uint64_t &value) {
+        uint64_t max_prefix = (1u << prefix_bits) - 1;
+        value = *p++ & max_prefix;
+        if (value < max_prefix) return true;
+        unsigned shift = 0;
+        while (p < end) {
+            uint8_t b = *p++;
+            value += static_cast<uint64_t>(b & 0x7f) << shift;
+            if (value > UINT32_MAX) return false;
+            if (!(b & 0x80)) return true;
+            shift += 7;
+        }
+        return false;
+    }
+
+    // RFC 7541 §5.2, into \p out (replacing its contents).
+    static bool decode_string(const uint8_t *&p, const uint8_t *end, std::string &out) {
+        if (p >= end) return false;
+        bool huffman = (*p & 0x80) != 0;
+        uint64_t len;
+        if (!decode_int(p, end, 7, len)) return false;
+        if (len > static_cast<uint64_t>(end - p)) return false;
+        std::string_view raw(reinterpret_cast<const char *>(p), static_cast<size_t>(len));
+        p += len;
+        out.clear();
+        if (!huffman) {
+            out.assign(raw.data(), raw.size());
+            return true;
+        }
+        return hpack::huffman_decode(raw, out);
+    }
+
+    bool lookup(uint64_t index, std::string_view &name, std::string_view &value) const {
+        if (index == 0) return false;
+        if (index <= hpack::STATIC_TABLE_SIZE) {
+            name = hpack::STATIC_TABLE[index - 1].name;
+            value = hpack::STATIC_TABLE[index - 1].value;
+            return true;
+        }
+        size_t i = static_cast<size_t>(index - hpack::STATIC_TABLE_SIZE - 1);
+        if (i >= table_.size()) return false;
+        name = table_[i].first;
+        value = table_[i].second;
+        return true;
+    }
+
+    void insert(std::string_view name, std::string_view value) {
+        size_t size = name.size() + value.size() + HPACK_ENTRY_OVERHEAD;
+        evict(size);
+        if (size > size_limit_) return;  // too big: the table is just emptied
+        table_.emplace_front(std::string(name), std::string(value));
+        size_ += size;
+    }
+
+    // Drop the oldest entries until \p room more bytes fit.
+    void evict(size_t room) {
+        while (!table_.empty() && size_ + room > size_limit_) {
+            const std::pair<std::string, std::string> &e = table_.back();
+            size_ -= e.first.size() + e.second.size() + HPACK_ENTRY_OVERHEAD;
+            table_.pop_back();
+        }
+    }
+
+    std::deque<std::pair<std::string, std::string>> table_;  // newest first
+    size_t size_ = 0;                                  // RFC 7541 §4.1 size of table_
+    size_t size_limit_ = HPACK_DEFAULT_TABLE_SIZE;     // current size chosen by the peer
+    size_t max_size_ = HPACK_DEFAULT_TABLE_SIZE;       // our SETTINGS_HEADER_TABLE_SIZE
+    std::string name_buf_;
+    std::string value_buf_;
+};
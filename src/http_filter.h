@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <map>
@@ -38,7 +39,9 @@ struct HttpData {
   std::string method;
   std::string path;
   std::string version;
+  std::string scheme = "http";   // "https" for requests that arrived over TLS
   HeaderPairs request_headers;
+  HeaderPairs request_trailers;  // chunked request bodies only
   HeaderPairs response_headers;
   std::string request_body;
   std::string response_body;
@@ -92,6 +95,24 @@ public:
     return false;
   }
 
+  /// The request body batching the filter chain asked for: of the modules
+  /// that set one, the smallest chunk sizes and the shortest latency win,
+  /// so every filter sees its body at least as promptly as it asked.
+  BodyDeliveryHint bodyDelivery() const {
+    BodyDeliveryHint merged;
+    for (const auto &[name, scope] : scopes_) {
+      if (!scope.context() || !scope.context()->bodyDelivery().set) continue;
+      const BodyDeliveryHint &hint = scope.context()->bodyDelivery();
+      auto smaller = [](uint32_t a, uint32_t b) { return a == 0 ? b : b == 0 ? a : std::min(a, b); };
+      merged.min_chunk = smaller(merged.min_chunk, hint.min_chunk);
+      merged.max_chunk = smaller(merged.max_chunk, hint.max_chunk);
+      merged.max_latency_ms = merged.set ? std::min(merged.max_latency_ms, hint.max_latency_ms)
+                                         : hint.max_latency_ms;
+      merged.set = true;
+    }
+    return merged;
+  }
+
   // note: global module manager is declared externally (see below)
 
   ~HttpFilterContext() {
@@ -183,7 +204,12 @@ public:
       if (http_data_->has_local_response) break;
       auto it = scopes_.find(m);
       if (it == scopes_.end() || !it->second.valid()) continue;
-      it->second.context()->onRequestTrailers(0);
+      auto *ctx = it->second.context();
+      ctx->setHeaderMap(
+          proxy_wasm::WasmHeaderMapType::RequestTrailers, http_data_->request_trailers);
+      ctx->onRequestTrailers(http_data_->request_trailers.size());
+      http_data_->request_trailers = ctx->getHeaderMapOwned(
+          proxy_wasm::WasmHeaderMapType::RequestTrailers);
       checkLocalResponse(it->second, m);
     }
   }
@@ -286,8 +312,8 @@ public:
 
 private:
   // Synthesize HTTP/2-style pseudo-headers that proxy-wasm filters expect.
-  // These are derived from the HTTP/1.1 request line (method, path, version)
-  // and the Host header.  They are prepended to the request header list so
+  // These are derived from the HTTP/1.1 request line (method, path, version),
+  // the transport (scheme) and the Host header.  They are prepended to the request header list so
   // the filter sees them via proxy_get_http_request_header(":method") etc.
   void synthesizePseudoHeaders() {
     HeaderPairs &hdrs = http_data_->request_headers;
@@ -310,8 +336,7 @@ private:
       pseudo.emplace_back(":path", http_data_->path);
     }
     if (!has(":scheme")) {
-      // lswasm always serves plain HTTP (no TLS termination).
-      pseudo.emplace_back(":scheme", "http");
+      pseudo.emplace_back(":scheme", http_data_->scheme);
     }
     if (!has(":authority")) {
       // Derive :authority from the Host header, falling back to "localhost".
@@ -0,0 +1,549 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2026  LiteSpeed Technologies, Inc.                        *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "http_utils.h"
+
+// Request parser limits
+inline constexpr size_t MAX_REQUEST_HEADERS = 128;  // header fields per request
+inline constexpr size_t MAX_CHUNK_LINE = 4096;       // chunk-size line, extensions included
+inline constexpr size_t MAX_REQUEST_TRAILER_SIZE = 16384;  // trailer section of a chunked body
+
+// RFC 9110 tchar.
+inline bool http_is_tchar(unsigned char c) {
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+        return true;
+    }
+    return c != 0 && std::strchr("!#$%&'*+-.^_`|~", c) != nullptr;
+}
+
+inline bool http_is_token(std::string_view s) {
+    if (s.empty()) return false;
+    for (char c : s) {
+        if (!http_is_tchar(static_cast<unsigned char>(c))) return false;
+    }
+    return true;
+}
+
+// Split "name: value" (no line ending) into the name and the OWS-trimmed
+// value.  Returns false if the line is not a valid field line: obs-fold,
+// missing colon, or a name that is not a token (e.g. space before ':').
+inline bool http_split_field(std::string_view line, std::string_view &name,
+                             std::string_view &value) {
+    if (line.empty() || line.front() == ' ' || line.front() == '\t') return false;
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos) return false;
+    name = line.substr(0, colon);
+    if (!http_is_token(name)) return false;
+    size_t vstart = colon + 1;
+    size_t vend = line.size();
+    while (vstart < vend && (line[vstart] == ' ' || line[vstart] == '\t')) ++vstart;
+    while (vend > vstart && (line[vend - 1] == ' ' || line[vend - 1] == '\t')) --vend;
+    value = line.substr(vstart, vend - vstart);
+    return true;
+}
+
+/// A byte range of the request buffer.
+struct HttpSpan {
+    uint32_t off = 0;
+    uint32_t len = 0;
+};
+
+/// One header field: name and value (OWS trimmed) as spans.
+struct HttpHeaderSpan {
+    HttpSpan name;
+    HttpSpan value;
+};
+
+/**
+ * ParsedRequest — a request head as offsets into the buffer it was parsed
+ * from.  Nothing is copied; resolve a span with view(buffer, span).  The
+ * reactor hands the buffer and this structure to the worker together
+ * (ConnectionIO::setRequest()).
+ */
+struct ParsedRequest {
+    HttpSpan method;
+    HttpSpan target;
+    HttpSpan version;                     // "HTTP/1.x" (or "HTTP/2.0", see H2Session)
+    std::vector<HttpHeaderSpan> headers;  // in arrival order
+    size_t header_end = 0;                // bytes up to and including the blank line
+    size_t content_length = 0;
+    bool chunked = false;                 // Transfer-Encoding: chunked body
+    bool length_unknown = false;          // body length known only at its end (chunked, HTTP/2)
+    bool keep_alive = false;              // version default, overridden by Connection
+    bool expect_continue = false;         // HTTP/1.1 "Expect: 100-continue"
+
+    void clear() {
+        method = target = version = HttpSpan{};
+        headers.clear();
+        header_end = 0;
+        content_length = 0;
+        chunked = false;
+        length_unknown = false;
+        keep_alive = false;
+        expect_continue = false;
+    }
+
+    static std::string_view view(const char *base, HttpSpan s) {
+        return std::string_view(base + s.off, s.len);
+    }
+};
+
+/**
+ * RequestParser — single-pass, incremental HTTP/1.x request-head parser.
+ *
+ * parse() is called with the connection's whole receive buffer each time
+ * bytes are appended.  It resumes at the first byte it has not scanned
+ * yet, so a head that arrives in many segments is still looked at once:
+ * line ends are located with a vectorised LF search (AVX2 or SSE2 when the
+ * build targets them, memchr otherwise), and every line is split and
+ * validated as soon as it is complete.  The result is recorded as spans
+ * in a ParsedRequest; the body framing and keep-alive decisions are made
+ * in the same pass.
+ *
+ * Framing is checked strictly (RFC 9112), since a lenient parser in front
+ * of another one is the root of request smuggling:
+ *   - obs-fold continuation lines, whitespace before the colon, a missing
+ *     colon or a non-token field name → 400;
+ *   - a Content-Length that is not a plain decimal number, or repeated
+ *     with a different value → 400;
+ *   - Transfer-Encoding together with Content-Length, or with a coding
+ *     after "chunked" → 400; any coding other than "chunked" → 501;
+ *   - more than MAX_REQUEST_HEADERS fields → 431.
+ * Bare LF line endings are accepted; empty lines before the request line
+ * are skipped.
+ *
+ * Offsets are relative to the start of the buffer, so they stay valid when
+ * the buffer reallocates as it grows.  Call reset() before parsing the
+ * next request.
+ */
+class RequestParser {
+public:
+    enum class Status { NeedMore, Complete, Error };
+
+    /// Continue parsing \p buf (the same buffer, possibly extended, as in
+    /// earlier calls).
+    Status parse(std::string_view buf) {
+        while (true) {
+            size_t lf = find_lf(buf.data() + scan_, buf.data() + buf.size());
+            if (lf == NOT_FOUND) {
+                scan_ = buf.size();
+                return Status::NeedMore;
+            }
+            size_t line_end = scan_ + lf;  // index of the LF
+            scan_ = line_end + 1;
+            size_t len = line_end - line_start_;
+            if (len > 0 && buf[line_end - 1] == '\r') --len;
+            std::string_view line(buf.data() + line_start_, len);
+
+            Status st = on_line(line, line_start_);
+            line_start_ = scan_;
+            if (st != Status::NeedMore) {
+                if (st == Status::Complete) req_.header_end = scan_;
+                return st;
+            }
+        }
+    }
+
+    /// The parsed request (complete once parse() returned Complete).
+    const ParsedRequest &request() const { return req_; }
+    ParsedRequest &request() { return req_; }
+
+    /// HTTP status for the error reply once parse() returned Error.
+    uint32_t errorStatus() const { return error_status_; }
+
+    /// Bytes examined so far (the head length once Complete).
+    size_t scanned() const { return scan_; }
+
+    /// Forget everything and start on a new request.
+    void reset() {
+        req_.clear();
+        scan_ = line_start_ = 0;
+        seen_request_line_ = false;
+        seen_content_length_ = false;
+        seen_transfer_encoding_ = false;
+        other_coding_ = false;
+        close_seen_ = false;
+        http_1_0_ = false;
+        error_status_ = 0;
+    }
+
+private:
+    static constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+    // Offset of the first LF in [p, end), or NOT_FOUND.
+    static size_t find_lf(const char *p, const char *end) {
+        const char *start = p;
+#if defined(__AVX2__)
+        const __m256i lf32 = _mm256_set1_epi8('\n');
+        for (; end - p >= 32; p += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            uint32_t m = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, lf32)));
+            if (m) return static_cast<size_t>(p - start) + __builtin_ctz(m);
+        }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__)
+        const __m128i lf16 = _mm_set1_epi8('\n');
+        for (; end - p >= 16; p += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            uint32_t m = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, lf16)));
+            if (m) return static_cast<size_t>(p - start) + __builtin_ctz(m);
+        }
+#endif
+        if (p >= end) return NOT_FOUND;
+        const void *hit = std::memchr(p, '\n', static_cast<size_t>(end - p));
+        if (!hit) return NOT_FOUND;
+        return static_cast<size_t>(static_cast<const char *>(hit) - start);
+    }
+
+    static HttpSpan span(size_t off, size_t len) {
+        return HttpSpan{static_cast<uint32_t>(off), static_cast<uint32_t>(len)};
+    }
+
+    Status fail(uint32_t status) {
+        error_status_ = status;
+        return Status::Error;
+    }
+
+    // One complete line (without its line ending) starting at \p off.
+    Status on_line(std::string_view line, size_t off) {
+        if (!seen_request_line_) {
+            if (line.empty()) return Status::NeedMore;  // stray CRLF between requests
+            return on_request_line(line, off);
+        }
+        if (line.empty()) return on_head_end();
+        return on_header_line(line, off);
+    }
+
+    // method SP request-target SP HTTP-version
+    Status on_request_line(std::string_view line, size_t off) {
+        size_t sp1 = line.find(' ');
+        if (sp1 == std::string_view::npos) return fail(400);
+        size_t sp2 = line.find(' ', sp1 + 1);
+        if (sp2 == std::string_view::npos || sp2 == sp1 + 1) return fail(400);
+        std::string_view method = line.substr(0, sp1);
+        std::string_view target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+        std::string_view version = line.substr(sp2 + 1);
+        if (!http_is_token(method)) return fail(400);
+        for (char c : target) {
+            if (static_cast<unsigned char>(c) <= 0x20 || c == 0x7f) return fail(400);
+        }
+        if (version.size() != 8 || version.compare(0, 7, "HTTP/1.") != 0 ||
+            version[7] < '0' || version[7] > '9') {
+            return fail(400);
+        }
+        req_.method = span(off, sp1);
+        req_.target = span(off + sp1 + 1, target.size());
+        req_.version = span(off + sp2 + 1, version.size());
+        req_.keep_alive = (version[7] != '0');
+        http_1_0_ = (version[7] == '0');
+        seen_request_line_ = true;
+        return Status::NeedMore;
+    }
+
+    // field-name ":" OWS field-value OWS
+    Status on_header_line(std::string_view line, size_t off) {
+        if (req_.headers.size() >= MAX_REQUEST_HEADERS) return fail(431);
+        std::string_view name, value;
+        if (!http_split_field(line, name, value)) return fail(400);
+        req_.headers.push_back(HttpHeaderSpan{
+            span(off, name.size()), span(off + (value.data() - line.data()), value.size())});
+
+        if (header_name_eq(name, "Content-Length")) return on_content_length(value);
+        if (header_name_eq(name, "Transfer-Encoding")) return on_transfer_encoding(value);
+        if (header_name_eq(name, "Connection")) on_connection(value);
+        // An HTTP/1.0 client cannot wait for 100 Continue (RFC 9110 §10.1.1).
+        if (header_name_eq(name, "Expect") && header_name_eq(value, "100-continue") &&
+            !http_1_0_) {
+            req_.expect_continue = true;
+        }
+        return Status::NeedMore;
+    }
+
+    // The blank line: settle the body framing.
+    Status on_head_end() {
+        if (!seen_transfer_encoding_) return Status::Complete;
+        // A message with both is a smuggling attempt (RFC 9112 §6.3).
+        if (seen_content_length_) return fail(400);
+        if (!req_.chunked) return fail(501);  // a coding we cannot decode
+        req_.length_unknown = true;
+        return Status::Complete;
+    }
+
+    Status on_content_length(std::string_view value) {
+        if (value.empty() || value.size() > 19) return fail(400);
+        size_t n = 0;
+        for (char c : value) {
+            if (c < '0' || c > '9') return fail(400);
+            n = n * 10 + static_cast<size_t>(c - '0');
+        }
+        if (seen_content_length_ && n != req_.content_length) return fail(400);
+        seen_content_length_ = true;
+        req_.content_length = n;
+        return Status::NeedMore;
+    }
+
+    // Transfer codings, possibly spread over several fields.  Only
+    // "chunked" alone is supported; chunked must be the final coding.
+    Status on_transfer_encoding(std::string_view value) {
+        seen_transfer_encoding_ = true;
+        while (true) {
+            size_t comma = value.find(',');
+            std::string_view coding = value.substr(0, comma);
+            while (!coding.empty() && (coding.front() == ' ' || coding.front() == '\t'))
+                coding.remove_prefix(1);
+            while (!coding.empty() && (coding.back() == ' ' || coding.back() == '\t'))
+                coding.remove_suffix(1);
+            if (!coding.empty()) {
+                if (req_.chunked) return fail(400);  // a coding after chunked
+                if (header_name_eq(coding, "chunked")) {
+                    req_.chunked = true;
+                } else {
+                    other_coding_ = true;
+                }
+            }
+            if (comma == std::string_view::npos) break;
+            value.remove_prefix(comma + 1);
+        }
+        if (other_coding_) req_.chunked = false;
+        return Status::NeedMore;
+    }
+
+    // Comma-separated connection options: "close" / "keep-alive".
+    void on_connection(std::string_view value) {
+        while (!value.empty()) {
+            size_t comma = value.find(',');
+            std::string_view token = value.substr(0, comma);
+            while (!token.empty() && (token.front() == ' ' || token.front() == '\t'))
+                token.remove_prefix(1);
+            while (!token.empty() && (token.back() == ' ' || token.back() == '\t'))
+                token.remove_suffix(1);
+            if (header_name_eq(token, "close")) {
+                req_.keep_alive = false;
+                close_seen_ = true;
+            } else if (header_name_eq(token, "keep-alive") && !close_seen_) {
+                req_.keep_alive = true;
+            }
+            if (comma == std::string_view::npos) break;
+            value.remove_prefix(comma + 1);
+        }
+    }
+
+    ParsedRequest req_;
+    size_t scan_ = 0;        // first byte not yet searched for LF
+    size_t line_start_ = 0;  // start of the line being assembled
+    bool seen_request_line_ = false;
+    bool seen_content_length_ = false;
+    bool seen_transfer_encoding_ = false;
+    bool other_coding_ = false;  // a transfer coding other than chunked
+    bool close_seen_ = false;
+    bool http_1_0_ = false;
+    uint32_t error_status_ = 0;
+};
+
+/**
+ * ChunkedDecoder — incremental decoder for a Transfer-Encoding: chunked
+ * request body (RFC 9112 §7.1).
+ *
+ * decode() is fed the raw bytes as they come off the socket, in pieces of
+ * any size.  Chunk data is passed to the sink as runs of the input buffer
+ * (never copied or accumulated); only the short chunk-size lines are
+ * looked at byte by byte, and only the trailer section is buffered, up to
+ * MAX_REQUEST_TRAILER_SIZE.  Memory use is therefore constant whatever the
+ * body length.  Decoding stops right after the terminating blank line, so
+ * the bytes of a pipelined request that follow are left to the caller.
+ *
+ * Rejected as malformed: a chunk size that is not hex or overflows 64
+ * bits, a chunk-size line longer than MAX_CHUNK_LINE, control characters
+ * in chunk extensions, chunk data not followed by a line ending, and
+ * trailer fields that would fail the header checks.  Chunk extensions are
+ * ignored; bare LF line endings are accepted as in the head.
+ */
+class ChunkedDecoder {
+public:
+    enum class Status { NeedMore, Complete, Error };
+
+    /// Decode from \p data, calling sink(const char *, size_t) for each
+    /// run of chunk data.  \p consumed is set to the bytes used; short of
+    /// \p len only once the body is Complete (or on Error).
+    template <typename Sink>
+    Status decode(const char *data, size_t len, size_t &consumed, Sink &&sink) {
+        size_t i = 0;
+        while (i < len) {
+            if (state_ == State::Data) {
+                size_t n = static_cast<size_t>(
+                    std::min<uint64_t>(remaining_, static_cast<uint64_t>(len - i)));
+                sink(data + i, n);
+                i += n;
+                remaining_ -= n;
+                decoded_ += n;
+                if (remaining_ == 0) state_ = State::DataCR;
+                continue;
+            }
+            if (state_ == State::Trailer) {
+                const char *lf = static_cast<const char *>(std::memchr(data + i, '\n', len - i));
+                size_t end = lf ? static_cast<size_t>(lf - data) : len;
+                trailer_bytes_ += end - i + (lf ? 1 : 0);
+                if (trailer_bytes_ > MAX_REQUEST_TRAILER_SIZE) return fail(consumed, i);
+                trailer_buf_.append(data + i, end - i);
+                i = end;
+                if (!lf) break;
+                ++i;
+                if (!on_trailer_line()) return fail(consumed, i);
+                if (state_ == State::Done) {
+                    consumed = i;
+                    return Status::Complete;
+                }
+                continue;
+            }
+            if (!on_control_byte(data[i++])) return fail(consumed, i);
+        }
+        consumed = i;
+        return state_ == State::Done ? Status::Complete : Status::NeedMore;
+    }
+
+    /// Chunk data bytes decoded so far (the body length once Complete).
+    uint64_t decoded() const { return decoded_; }
+
+    /// Trailer fields, valid once decode() returned Complete.
+    HeaderPairs &trailers() { return trailers_; }
+
+    /// Start on a new body.
+    void reset() {
+        state_ = State::Size;
+        size_ = 0;
+        digits_ = 0;
+        line_len_ = 0;
+        remaining_ = 0;
+        decoded_ = 0;
+        trailer_bytes_ = 0;
+        trailer_buf_.clear();
+        trailers_.clear();
+    }
+
+private:
+    enum class State { Size, Ext, SizeLF, Data, DataCR, DataLF, Trailer, Done };
+
+    Status fail(size_t &consumed, size_t at) {
+        consumed = at;
+        state_ = State::Done;
+        return Status::Error;
+    }
+
+    static int hex_value(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    // One byte of a chunk-size line or of the line ending after chunk data.
+    bool on_control_byte(char c) {
+        switch (state_) {
+        case State::Size: {
+            if (++line_len_ > MAX_CHUNK_LINE) return false;
+            int v = hex_value(c);
+            if (v >= 0) {
+                if (size_ >> 60) return false;  // next digit would overflow
+                size_ = (size_ << 4) | static_cast<uint64_t>(v);
+                ++digits_;
+                return true;
+            }
+            if (digits_ == 0) return false;
+            if (c == '\r') { state_ = State::SizeLF; return true; }
+            if (c == '\n') return end_size_line();
+            if (c == ';' || c == ' ' || c == '\t') { state_ = State::Ext; return true; }
+            return false;
+        }
+        case State::Ext:
+            if (++line_len_ > MAX_CHUNK_LINE) return false;
+            if (c == '\r') { state_ = State::SizeLF; return true; }
+            if (c == '\n') return end_size_line();
+            return c == '\t' || (static_cast<unsigned char>(c) >= 0x20 && c != 0x7f);
+        case State::SizeLF:
+            return c == '\n' && end_size_line();
+        case State::DataCR:
+            if (c == '\r') { state_ = State::DataLF; return true; }
+            if (c == '\n') { start_size_line(); return true; }
+            return false;
+        case State::DataLF:
+            if (c != '\n') return false;
+            start_size_line();
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool end_size_line() {
+        if (size_ == 0) {
+            state_ = State::Trailer;
+        } else {
+            remaining_ = size_;
+            state_ = State::Data;
+        }
+        return true;
+    }
+
+    void start_size_line() {
+        state_ = State::Size;
+        size_ = 0;
+        digits_ = 0;
+        line_len_ = 0;
+    }
+
+    // A complete trailer line is in trailer_buf_ (its LF already dropped).
+    bool on_trailer_line() {
+        std::string_view line(trailer_buf_);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) {
+            state_ = State::Done;
+            return true;
+        }
+        std::string_view name, value;
+        if (trailers_.size() >= MAX_REQUEST_HEADERS || !http_split_field(line, name, value)) {
+            return false;
+        }
+        trailers_.emplace_back(std::string(name), std::string(value));
+        trailer_buf_.clear();
+        return true;
+    }
+
+    State state_ = State::Size;
+    uint64_t size_ = 0;       // chunk size being parsed
+    uint32_t digits_ = 0;     // hex digits seen on this size line
+    size_t line_len_ = 0;     // bytes of this size line so far
+    uint64_t remaining_ = 0;  // chunk data bytes still to come
+    uint64_t decoded_ = 0;
+    size_t trailer_bytes_ = 0;  // trailer section bytes so far
+    std::string trailer_buf_;   // the trailer line being assembled
+    HeaderPairs trailers_;
+};
@@ -0,0 +1,1655 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2026  LiteSpeed Technologies, Inc.                        *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/sendfile.h>
+#include <sys/timerfd.h>
+
+#include "coarse_clock.h"
+#include "connection_io.h"
+#include "h2_session.h"
+#include "http_parser.h"
+#include "http_utils.h"
+#include "log.h"
+#include "ready_queue.h"
+#include "server_stats.h"
+#include "thread_pool.h"
+#include "timer_wheel.h"
+#include "tls_context.h"
+
+// Reactor configuration
+inline constexpr int BUFFER_SIZE = 65536;          // 64 KB per recv() syscall
+inline constexpr int MAX_EPOLL_EVENTS = 64;
+inline constexpr size_t MAX_HEADER_SIZE = 65536;   // 64 KB limit for request headers
+inline constexpr int DEFAULT_KEEPALIVE_TIMEOUT = 75;             // seconds an idle persistent connection is kept
+inline constexpr uint32_t DEFAULT_MAX_KEEPALIVE_REQUESTS = 1000; // requests per connection (0 = unlimited)
+inline constexpr size_t CONN_SLAB_PREALLOC = 4096;  // connection slots allocated up front (grows by fd)
+inline constexpr size_t CONN_IO_POOL_MAX = 1024;    // idle ConnectionIO objects kept per reactor
+inline constexpr size_t HEADER_BUF_RETAIN = 2 * BUFFER_SIZE;  // larger header buffers are released on close
+inline constexpr size_t EGRESS_IOV_MAX = 64;        // response segments per gather write
+inline constexpr size_t DEFAULT_MEMORY_BUDGET = 512ull << 20;  // 512 MB of buffered bytes, all reactors (0 = unlimited)
+inline constexpr size_t MEMORY_RESUME_PERCENT = 75;  // throttled body reads resume below this share of the budget
+inline constexpr size_t TLS_WRITE_MAX = 65536;      // plaintext bytes per SSL_write() (four full records)
+inline constexpr size_t TLS_COALESCE_BELOW = 16384; // smaller segments are gathered into one SSL_write()
+inline constexpr int TLS_HANDSHAKE_TIMEOUT = 10;    // seconds allowed to complete a TLS handshake
+inline constexpr int DEFAULT_DRAIN_TIMEOUT = 30;    // seconds a draining reactor waits for open connections
+inline constexpr int DRAIN_IDLE_GRACE = 1;         // seconds an idle connection may still send a request while draining
+inline constexpr int LINGER_TIMEOUT = 2;           // seconds unread request body is discarded before a close
+inline constexpr int DEFAULT_HEADER_TIMEOUT = 30;  // seconds to receive a complete request head
+inline constexpr int DEFAULT_BODY_TIMEOUT = 60;    // seconds a request body may go without a byte arriving
+inline constexpr int DEFAULT_SEND_TIMEOUT = 60;    // seconds a response may wait on a client that reads nothing
+inline constexpr int TIMER_TICK_MS = 100;          // timer wheel resolution and coarse clock refresh interval
+inline constexpr int TIMER_RECHECK = 1;            // seconds between looks at a connection without a deadline
+
+/**
+ * HttpReactor — one event loop and the connections it owns.
+ *
+ * The reactor owns ALL socket I/O for its connections.  Worker threads
+ * interact only with in-memory buffers via ConnectionIO.  Neither request
+ * nor response is fully buffered — data flows in chunks.
+ *
+ * This class holds the HTTP/1.1 connection logic shared by every I/O
+ * backend; subclasses provide the event loop and the socket primitives
+ * (EpollReactor below, UringReactor in uring_reactor.h).
+ *
+ * Each reactor has its own listener registration, event loop, eventfd and
+ * connection table; nothing is shared between reactors except the worker
+ * ThreadPool.  Several reactors may run side by side (one per core), each
+ * on its own SO_REUSEPORT TCP socket, or all on one shared UDS listener.
+ *
+ * Per-connection state machine:
+ *   ReadingHeaders → Active → ReadingHeaders (keep-alive) … → (closed)
+ *                           ↘ Lingering → (closed)
+ *
+ * Connections are persistent (HTTP/1.1 keep-alive).  Once a response has
+ * been fully sent, the connection returns to ReadingHeaders with any bytes
+ * that arrived past the request body already buffered.  Pipelined requests
+ * are handled strictly one at a time: while a request is Active and its
+ * body is complete, read interest is dropped so the next request waits in
+ * the socket buffer.  Responses therefore always leave in request order.
+ * Idle keep-alive connections are closed after keepalive_timeout seconds.
+ *
+ * A response sent before the request body was read (typically a filter
+ * rejecting an upload, whose Expect: 100-continue is then never answered)
+ * closes the connection.  Closing a socket with unread input makes the
+ * kernel reset it, and the reset can destroy the response before the
+ * client has read it; so such a connection lingers instead: the write side
+ * is shut down and whatever the client still sends is discarded until it
+ * closes, or for at most LINGER_TIMEOUT seconds.
+ *
+ * Load shedding: with a ConcurrencyLimiter (Options::limiter), a request
+ * that would take the worker pool past its limit never reaches a worker
+ * or a VM.  The reactor answers it with a fixed 503 and lingers; an
+ * HTTP/2 stream is answered with 503 and closed, the connection stays.
+ *
+ * In the Active state, the connection can want:
+ *   WANT_READ  — body bytes still arriving from the client
+ *   WANT_WRITE — response bytes waiting for socket space
+ *   (both)     — simultaneous body reading and response writing
+ *   (none)     — worker processing, no I/O pending
+ *
+ * Dispatch: with run_to_completion set, a request whose body is already
+ * complete when its headers are parsed runs the filter chain directly on
+ * the reactor thread (using that thread's WASM VM clone) and its response
+ * is flushed without any cross-thread handoff.  Requests that would block
+ * on body bytes still in flight go to the worker ThreadPool.
+ *
+ * Pre-buffering: a request whose body is no larger than
+ * limits.body_prebuffer (capped at the high watermark) is not dispatched
+ * when its head is parsed.  The reactor collects the body in the ring
+ * first, so the handler finds it all there — the filters get it in one
+ * onRequestBody() call, and with run_to_completion it runs inline — and
+ * no worker waits on a slow client.  A chunked body is collected until it
+ * ends or passes the limit; a larger body, a request with Expect:
+ * 100-continue, or one the memory governor throttles is dispatched at
+ * once and streams as below.  HTTP/2 streams are held back the same way
+ * by H2Session.
+ *
+ * Body bytes reach the worker through ConnectionIO's body ring.  A
+ * Transfer-Encoding: chunked body is decoded here, in the slot's
+ * ChunkedDecoder, as it arrives; only the decoded data enters the ring,
+ * and the trailers follow with the end of the body.  When it
+ * reaches the high watermark, the bytes that did not fit wait in the
+ * slot's body_backlog and read interest is dropped, so the client is
+ * throttled by TCP flow control; once the worker has drained the ring to
+ * the low watermark it notifies the reactor, which refeeds the backlog
+ * and resumes reading.  Response segments queued by the worker are sent
+ * with one gather write per flush.
+ *
+ * Memory governor: every buffered body and response byte is counted in
+ * the process-wide ServerStats gauges.  While the total is above
+ * memory_budget, a reactor answers new connections with 503 and stops
+ * reading ahead of the workers: a connection whose body ring is above the
+ * low watermark is throttled until its worker drains it there (or the
+ * pressure ends), so only bodies a worker is actually waiting for keep
+ * flowing.  Throttled connections are released together once the total
+ * drops to MEMORY_RESUME_PERCENT of the budget.
+ *
+ * Connections live in an fd-indexed slab: slot lookup is an array index,
+ * and slots, their header buffers and ConnectionIO objects are recycled, so
+ * accepting and closing connections does not allocate once the slab and
+ * the ConnectionIO pool are warm.  Every slot carries a generation counter
+ * bumped on close; a ConnectionIO remembers the generation it was issued
+ * for, so stale notifications for a reused fd are ignored.
+ *
+ * HTTP/2 (h2c): with Options::h2c set, a connection that opens with the
+ * HTTP/2 preface (prior knowledge), or whose request asks to upgrade
+ * (Upgrade: h2c with HTTP2-Settings, no body), is handed to an H2Session
+ * and stays Active for good.  Received bytes go to the session, every
+ * stream gets its own ConnectionIO from the pool and is dispatched like a
+ * request, and the session's frames leave through the slot's conn_io,
+ * which then serves as the connection's output pipe.  Notifications from
+ * a stream's worker reach the session (onStreamReady()); each time the
+ * pipe has drained, the session is pumped for more frames.  An HTTP/2
+ * connection without streams is closed after keepalive_timeout.
+ *
+ * Draining (hot restart): once the draining flag is raised, the reactor
+ * stops accepting — the listener now belongs to the process that took it
+ * over — and finishes what it has.  Every response from then on carries
+ * Connection: close and the connection closes once it is sent; a
+ * connection that sends no request for DRAIN_IDLE_GRACE seconds is closed
+ * as idle (a client in the middle of a keep-alive exchange gets its answer
+ * instead of a reset), and HTTP/2 connections get a GOAWAY and close when
+ * their last stream is done.  run() returns once no connection is left,
+ * or after drain_timeout seconds.
+ *
+ * TLS: with Options::tls set (epoll backend only), every accepted
+ * connection first completes a TLS handshake, driven by readiness events
+ * on the reactor thread; a connection that has not finished it within
+ * TLS_HANDSHAKE_TIMEOUT seconds is closed.  Then it proceeds as above, with ALPN "h2"
+ * taking the place of the cleartext preface check.  If kTLS took over a
+ * direction, that direction uses the plain socket calls; otherwise bytes
+ * pass through SSL_read() and SSL_write().
+ *
+ * Timeouts: every connection has one entry in the reactor's TimerWheel
+ * (keyed by fd), set to the deadline of the phase it is in:
+ *   ReadingHeaders, new or with part of a head — header_timeout from
+ *     accept or from the first byte of a keep-alive request (slowloris);
+ *   ReadingHeaders, idle between requests — keepalive_timeout;
+ *   Active, reading the body — body_timeout since the last byte arrived;
+ *   Active, waiting to send — send_timeout since the client last took data;
+ *   TLS handshake, Lingering — TLS_HANDSHAKE_TIMEOUT, LINGER_TIMEOUT.
+ * Reads and sends only record the current tick; the deadline is checked
+ * when the entry fires and pushed back if there was progress, so a busy
+ * connection costs no timer operations.  A phase with no deadline (the
+ * worker is producing the response, or reading is paused by the
+ * reactor's own backpressure) is looked at again every TIMER_RECHECK
+ * seconds.  A stalled body or send closes the connection, which fails the
+ * worker's readBodyChunk()/writes; a stalled head gets 408.  The wheel is
+ * driven by a periodic timerfd (TIMER_TICK_MS) that also wakes an idle
+ * loop to notice the shutdown and draining flags, and each loop turn
+ * refreshes the process-wide CoarseClock.
+ *
+ * Worker→reactor notification goes through a lock-free ReadyQueue.  When
+ * a worker enqueues response data, finishes or fails, its ConnectionIO is
+ * pushed onto the queue (the eventfd is written only when the queue was
+ * empty).  On wakeup the reactor drains the queue and services just those
+ * connections — a wakeup costs O(ready), not O(connections).  Response
+ * bytes are sent right away; write interest is taken only if the socket
+ * fills.
+ */
+class HttpReactor : protected H2StreamHost {
+public:
+    /// Runs the filter chain for one request.  Must not throw.
+    using RequestHandler = ConnectionIO::Handler;
+
+    struct Options {
+        int keepalive_timeout = DEFAULT_KEEPALIVE_TIMEOUT;
+        uint32_t max_keepalive_requests = DEFAULT_MAX_KEEPALIVE_REQUESTS;
+        bool run_to_completion = false;  // run complete requests on the reactor thread
+        bool shared_listener = false;    // listener is shared with other reactors
+        int cpu = -1;                    // pin the reactor thread to this CPU (-1 = no pinning)
+        ConnectionLimits limits;         // per-request body and response buffering
+        size_t memory_budget = DEFAULT_MEMORY_BUDGET;  // buffered bytes, all reactors (0 = unlimited)
+        bool h2c = true;                 // accept cleartext HTTP/2 (prior knowledge and Upgrade)
+        std::shared_ptr<TlsContext> tls; // terminate TLS on accepted connections (epoll only)
+        int drain_timeout = DEFAULT_DRAIN_TIMEOUT;  // seconds to finish open connections when draining
+        int header_timeout = DEFAULT_HEADER_TIMEOUT;  // seconds (0 = none), see the class comment
+        int body_timeout = DEFAULT_BODY_TIMEOUT;
+        int send_timeout = DEFAULT_SEND_TIMEOUT;
+        FairQueue *fair_queue = nullptr; // dispatch through this pool's --class queue, if any
+        ConcurrencyLimiter *limiter = nullptr;  // shed requests beyond this pool's limit, if any
+    };
+
+    HttpReactor(int listen_fd, const Options &opts, RequestHandler handler,
+                ThreadPool &pool, const std::atomic<bool> &shutdown,
+                const std::atomic<bool> &draining)
+        : listen_fd_(listen_fd), opts_(opts), handler_(std::move(handler)),
+          pool_(pool), shutdown_(shutdown), draining_(draining) {}
+
+    virtual ~HttpReactor() {
+        server_stats().conn_io_owned.fetch_sub(io_pool_.size() + io_retiring_.size(),
+                                               std::memory_order_relaxed);
+        if (event_fd_ >= 0) close(event_fd_);
+        if (timer_fd_ >= 0) close(timer_fd_);
+    }
+
+    // Non-copyable, non-movable.
+    HttpReactor(const HttpReactor &) = delete;
+    HttpReactor &operator=(const HttpReactor &) = delete;
+
+    /// Set up the backend and register the listener.  Returns false if the
+    /// backend is unavailable; the reactor must then not be run.
+    virtual bool init() = 0;
+
+    /// Run the event loop until the shutdown flag is raised, or until
+    /// the draining flag is raised and the open connections are done.
+    virtual void run() = 0;
+
+    /// Backend name for log messages.
+    virtual const char *backendName() const = 0;
+
+    // ── Helper: set a socket to non-blocking mode ───────────────────────
+
+    static void set_nonblocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        if (flags < 0) flags = 0;
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    }
+
+protected:
+    // Interest bits (same values as the epoll flags).
+    static constexpr uint32_t WANT_READ = EPOLLIN;
+    static constexpr uint32_t WANT_WRITE = EPOLLOUT;
+
+    // ── Per-connection state ────────────────────────────────────────
+
+    enum class ConnState { ReadingHeaders, Active, Lingering };
+
+    struct ConnCtx {
+        bool in_use = false;                       // slot holds an open connection
+        uint32_t generation = 0;                   // bumped every time the slot is freed
+        ConnState state = ConnState::ReadingHeaders;
+        std::string header_buf;                    // header bytes (plus any pipelined bytes)
+        RequestParser parser;                      // progress through header_buf
+        ChunkedDecoder chunked;                    // progress through a chunked body
+        std::string body_backlog;                  // body bytes the body ring had no room for
+        std::shared_ptr<ConnectionIO> conn_io;     // bridge to worker thread (HTTP/2: the output pipe)
+        std::unique_ptr<H2Session> h2;             // set once the connection speaks HTTP/2
+        std::unique_ptr<TlsConnection> tls;        // set on TLS listeners
+        bool h2_pumping = false;                   // after_flush_h2() is running
+        bool h2_repump = false;                    // the pipe drained again meanwhile
+        bool body_complete = false;                // all body bytes received
+        bool dispatch_pending = false;             // body being pre-buffered, handler not started
+        bool peer_closed = false;                  // client shut down its write side
+        bool throttled = false;                    // body reads paused by the memory budget
+        bool throttle_listed = false;              // slot is on the reactor's throttled_ list
+        uint32_t interest = WANT_READ;             // current WANT_READ / WANT_WRITE
+        uint32_t requests_served = 0;              // completed requests on this connection
+        uint64_t idle_since = 0;                   // tick the current phase began (see phase_deadline())
+        uint64_t last_io = 0;                      // tick of the last body byte read or response byte sent
+    };
+
+    // ── Backend hooks ───────────────────────────────────────────────
+
+    /// Change the connection's read/write interest.
+    virtual void set_interest(int fd, ConnCtx &ctx, uint32_t interest) = 0;
+
+    /// Push pending response bytes to the socket.  Must end in
+    /// after_flush() once nothing is left to send (possibly later, from a
+    /// completion).  Returns false if the connection was closed.
+    virtual bool flush(int fd, ConnCtx &ctx) = 0;
+
+    /// Release the backend's hold on the socket and close it.
+    virtual void close_socket(int fd, ConnCtx &ctx) = 0;
+
+    /// Stop taking connections from the listener (draining).
+    virtual void stop_accepting() = 0;
+
+    /// An accept may still complete after stop_accepting().
+    virtual bool accept_pending() const { return false; }
+
+    // ── Shared setup ────────────────────────────────────────────────
+
+    /// Create the eventfd and the connection slab.
+    bool init_common() {
+        // Create eventfd for worker→reactor notification.
+        event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (event_fd_ < 0) {
+            LOG_ERROR("Failed to create eventfd: " << strerror(errno));
+            return false;
+        }
+        ready_.setEventFd(event_fd_);
+
+        // Periodic tick for the timer wheel and the coarse clock.
+        timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timer_fd_ < 0) {
+            LOG_ERROR("Failed to create timerfd: " << strerror(errno));
+            return false;
+        }
+        struct itimerspec its{};
+        its.it_interval.tv_nsec = TIMER_TICK_MS * 1000000L;
+        its.it_value = its.it_interval;
+        timerfd_settime(timer_fd_, 0, &its, nullptr);
+        refresh_clock();
+        timers_ = TimerWheel(tick_);
+
+        // Preallocate the connection slab up to the fd limit (capped); it
+        // grows on demand for higher fds.
+        size_t prealloc = CONN_SLAB_PREALLOC;
+        struct rlimit rl{};
+        if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY) {
+            prealloc = std::min(prealloc, static_cast<size_t>(rl.rlim_cur));
+        }
+        slots_.resize(prealloc);
+        io_pool_.reserve(CONN_IO_POOL_MAX);
+        io_retiring_.reserve(CONN_IO_POOL_MAX);
+
+        // Make the listening socket non-blocking so accept() won't block.
+        set_nonblocking(listen_fd_);
+        return true;
+    }
+
+    /// Pin the calling thread to the configured CPU, if any.
+    void pin_thread() {
+        if (opts_.cpu < 0) return;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(opts_.cpu, &set);
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (rc != 0) {
+            LOG_ERROR("Failed to pin reactor to CPU " << opts_.cpu << ": " << strerror(rc));
+        }
+    }
+
+    // ── Connection slab ─────────────────────────────────────────────
+
+    // Slot of an open connection, or nullptr.
+    ConnCtx *slot(int fd) {
+        if (fd < 0 || static_cast<size_t>(fd) >= slots_.size()) return nullptr;
+        ConnCtx &ctx = slots_[fd];
+        return ctx.in_use ? &ctx : nullptr;
+    }
+
+    // Slot of an open connection that is still the given generation.
+    ConnCtx *slot(int fd, uint32_t generation) {
+        ConnCtx *ctx = slot(fd);
+        return (ctx && ctx->generation == generation) ? ctx : nullptr;
+    }
+
+    // Take the slot for a newly accepted fd.  Only allocates when fd is
+    // beyond the current slab.
+    ConnCtx &claim_slot(int fd) {
+        if (static_cast<size_t>(fd) >= slots_.size()) {
+            slots_.resize(std::max(static_cast<size_t>(fd) + 1, slots_.size() * 2));
+        }
+        ConnCtx &ctx = slots_[fd];
+        ctx.in_use = true;
+        ctx.state = ConnState::ReadingHeaders;
+        ctx.header_buf.clear();
+        ctx.parser.reset();
+        ctx.body_complete = false;
+        ctx.peer_closed = false;
+        ctx.dispatch_pending = false;
+        ctx.throttled = false;
+        ctx.throttle_listed = false;
+        ctx.interest = WANT_READ;
+        ctx.requests_served = 0;
+        ctx.h2_pumping = false;
+        ctx.h2_repump = false;
+        ctx.idle_since = ctx.last_io = tick_;
+        arm_timer(fd, ctx);
+        ++open_conns_;
+
+        ServerStats &st = server_stats();
+        st.connections_accepted.fetch_add(1, std::memory_order_relaxed);
+        uint64_t active = st.connections_active.fetch_add(1, std::memory_order_relaxed) + 1;
+        ServerStats::raise(st.connections_high_water, active);
+        return ctx;
+    }
+
+    // Get a ConnectionIO for a new request, from the pool if possible.
+    std::shared_ptr<ConnectionIO> acquire_io(int fd, uint32_t generation) {
+        ServerStats &st = server_stats();
+        if (io_pool_.empty()) reclaim_retiring();
+        if (!io_pool_.empty()) {
+            std::shared_ptr<ConnectionIO> io = std::move(io_pool_.back());
+            io_pool_.pop_back();
+            io->reset(fd, generation);
+            st.conn_io_reused.fetch_add(1, std::memory_order_relaxed);
+            return io;
+        }
+        st.conn_io_created.fetch_add(1, std::memory_order_relaxed);
+        uint64_t owned = st.conn_io_owned.fetch_add(1, std::memory_order_relaxed) + 1;
+        ServerStats::raise(st.conn_io_pool_high_water, owned);
+        return std::make_shared<ConnectionIO>(fd, &ready_, generation, opts_.limits);
+    }
+
+    // Return a finished request's ConnectionIO to the pool.  If a worker
+    // (or the ready queue) still holds a reference — typically the worker
+    // is still unwinding out of the handler — the object waits on the
+    // retiring list until it is the reactor's alone.
+    void release_io(std::shared_ptr<ConnectionIO> &io) {
+        if (!io) return;
+        if (io.use_count() == 1 && io_pool_.size() < CONN_IO_POOL_MAX) {
+            // Pairs with the release decrement of the last other owner, so
+            // everything it wrote is visible before reset().
+            std::atomic_thread_fence(std::memory_order_acquire);
+            io->releaseBuffers();
+            io_pool_.push_back(std::move(io));
+        } else if (io_pool_.size() + io_retiring_.size() < CONN_IO_POOL_MAX) {
+            io_retiring_.push_back(std::move(io));
+        } else {
+            server_stats().conn_io_owned.fetch_sub(1, std::memory_order_relaxed);
+        }
+        io.reset();
+    }
+
+    // Move retiring ConnectionIO objects that nobody else references any
+    // more into the pool.
+    void reclaim_retiring() {
+        for (size_t i = 0; i < io_retiring_.size();) {
+            if (io_retiring_[i].use_count() == 1) {
+                std::atomic_thread_fence(std::memory_order_acquire);
+                io_retiring_[i]->releaseBuffers();
+                io_pool_.push_back(std::move(io_retiring_[i]));
+                io_retiring_[i] = std::move(io_retiring_.back());
+                io_retiring_.pop_back();
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    // Tear down a connection (signal errors to worker, close fd) and
+    // free its slot.  The ctx must not be used afterwards.
+    void close_conn(int fd, ConnCtx &ctx) {
+        timers_.cancel(static_cast<uint32_t>(fd));
+        if (ctx.tls) ctx.tls->shutdown();
+        close_socket(fd, ctx);
+        ctx.tls.reset();
+        if (ctx.h2) {
+            ctx.h2->abort();  // fail and release every stream
+            ctx.h2.reset();
+        }
+        if (ctx.conn_io) {
+            ctx.conn_io->feedError();   // wake worker blocked in readBodyChunk()
+            ctx.conn_io->writeError();  // wake worker blocked in writeData()
+            release_io(ctx.conn_io);
+        }
+
+        ctx.in_use = false;
+        ++ctx.generation;
+        ctx.header_buf.clear();
+        if (ctx.header_buf.capacity() > HEADER_BUF_RETAIN) {
+            std::string().swap(ctx.header_buf);
+        }
+        drop_backlog(ctx);
+        std::string().swap(ctx.body_backlog);
+        --open_conns_;
+        server_stats().connections_active.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Close every open connection (reactor shutdown).
+    void close_all() {
+        for (size_t fd = 0; fd < slots_.size(); ++fd) {
+            if (slots_[fd].in_use) close_conn(static_cast<int>(fd), slots_[fd]);
+        }
+    }
+
+    // ── Shared connection logic ─────────────────────────────────────
+
+    // Workers queued connections that have response data, have finished or
+    // have failed.  Service exactly those.  The caller consumes the eventfd
+    // counter first, so a push racing with the drain produces a fresh
+    // wakeup rather than a lost one.
+    void drain_ready() {
+        ready_.drain([this](std::shared_ptr<ReadyQueue::Node> &&node) {
+            ConnectionIO *conn = static_cast<ConnectionIO *>(node.get());
+            // The connection may have been closed (and its fd reused)
+            // since the worker queued it.
+            int fd = conn->fd();
+            ConnCtx *ctx = slot(fd, conn->generation());
+            if (ctx && ctx->h2) {
+                // One of the connection's HTTP/2 streams.
+                ctx->h2->onStreamReady(conn);
+                node.reset();
+                flush(fd, *ctx);
+                return;
+            }
+            if (!ctx || ctx->conn_io.get() != conn) return;
+            node.reset();  // drop the queue's reference so the object can be pooled
+            service(fd, *ctx);
+        });
+    }
+
+    // Requests that ran to completion on this thread: flush their
+    // responses and move on to any pipelined request.  Servicing one may
+    // run the next, so this loops until nothing is left.
+    void drain_completed_inline() {
+        while (!completed_inline_.empty()) {
+            std::pair<int, uint32_t> done = completed_inline_.back();
+            completed_inline_.pop_back();
+            ConnCtx *ctx = slot(done.first, done.second);
+            if (ctx && ctx->conn_io) service(done.first, *ctx);
+        }
+    }
+
+    // Bytes received from the client.  Returns false if the connection was
+    // closed.
+    bool on_data(int fd, ConnCtx &ctx, const char *buf, size_t n) {
+        if (ctx.h2) {
+            ctx.h2->onData(buf, n);
+            return flush(fd, ctx);
+        }
+        if (ctx.state == ConnState::ReadingHeaders) {
+            if (ctx.header_buf.empty() && ctx.requests_served > 0) {
+                // The next request begins: the header timeout replaces keep-alive.
+                ctx.idle_since = tick_;
+                arm_timer(fd, ctx);
+            }
+            ctx.header_buf.append(buf, n);
+            return start_request(fd, ctx);
+        }
+        if (ctx.state == ConnState::Lingering) return true;  // discarded
+        ctx.last_io = tick_;
+        if (!ctx.body_complete) {
+            if (ctx.conn_io->request().chunked) {
+                if (!decode_chunked(ctx, buf, n)) {
+                    LOG_INFO("Malformed chunked request body: fd " << fd);
+                    close_conn(fd, ctx);
+                    return false;
+                }
+            } else {
+                // Feed body bytes to ConnectionIO.
+                size_t received = ctx.conn_io->bodyBytesReceived() + ctx.body_backlog.size();
+                size_t cl = ctx.conn_io->contentLength();
+                size_t remaining = (cl > received) ? (cl - received) : 0;
+                size_t to_feed = std::min(n, remaining);
+                bool eof = (to_feed >= remaining);
+                feed_body(ctx, buf, to_feed, eof);
+
+                // Bytes past the body belong to the next pipelined request.
+                if (n > to_feed) {
+                    ctx.header_buf.append(buf + to_feed, n - to_feed);
+                }
+                if (eof) ctx.body_complete = true;
+            }
+            if (!ctx.body_complete && over_budget()) throttle(fd, ctx);
+            // Stop reading once the body is in, while the ring is full or
+            // while the memory budget is exhausted.
+            if (!wants_body(ctx)) set_interest(fd, ctx, ctx.interest & ~WANT_READ);
+            if (ctx.dispatch_pending && prebuffered(ctx)) dispatch(fd, ctx);
+            return true;
+        }
+        // The next pipelined request; it is parsed once this one completes.
+        ctx.header_buf.append(buf, n);
+        return true;
+    }
+
+    // The peer closed its write direction.  Returns false if the
+    // connection was closed.
+    bool on_peer_eof(int fd, ConnCtx &ctx) {
+        // A body cut short before its handler started: nobody to answer.
+        if (ctx.state != ConnState::Active || ctx.h2 || ctx.dispatch_pending) {
+            close_conn(fd, ctx);
+            return false;
+        }
+        // Active state: signal EOF to body reader (after any backlog).
+        // The connection is closed once the response is sent.
+        if (!ctx.body_complete && ctx.conn_io && ctx.body_backlog.empty()) {
+            ctx.conn_io->feedBody(nullptr, 0, true);
+        }
+        ctx.body_complete = true;
+        ctx.peer_closed = true;
+        set_interest(fd, ctx, ctx.interest & ~WANT_READ);
+        return true;
+    }
+
+    // Everything pending has been sent: complete the request if the
+    // handler has finished, otherwise wait for more output.  Returns false
+    // if the connection was closed.
+    bool after_flush(int fd, ConnCtx &ctx) {
+        if (ctx.h2) return after_flush_h2(fd, ctx);
+        if (ctx.conn_io->isFinished()) return complete_request(fd, ctx);
+        set_interest(fd, ctx, wants_body(ctx) ? WANT_READ : 0u);
+        return true;
+    }
+
+    // HTTP/2: the pipe has drained, so pump the streams for more frames
+    // and send them.  A flush that drains the pipe again at once calls
+    // back in here; that is turned into another round of this loop rather
+    // than recursion.  Returns false if the connection was closed.
+    bool after_flush_h2(int fd, ConnCtx &ctx) {
+        if (ctx.h2_pumping) {
+            ctx.h2_repump = true;
+            return true;
+        }
+        ctx.h2_pumping = true;
+        do {
+            ctx.h2_repump = false;
+            if (!ctx.h2->pump()) break;
+            if (!flush(fd, ctx)) return false;
+            if (!ctx.h2_repump) {
+                // Frames still pending: the next completion comes back here.
+                ctx.h2_pumping = false;
+                return true;
+            }
+        } while (true);
+        ctx.h2_pumping = false;
+        if (ctx.h2->closing()) {
+            close_conn(fd, ctx);
+            return false;
+        }
+        set_interest(fd, ctx, WANT_READ);
+        return true;
+    }
+
+    // ── HTTP/2 stream host (see H2StreamHost) ───────────────────────
+
+    std::shared_ptr<ConnectionIO> h2_open_stream(int fd) override {
+        server_stats().h2_streams.fetch_add(1, std::memory_order_relaxed);
+        std::shared_ptr<ConnectionIO> io = acquire_io(fd, slots_[fd].generation);
+        io->setSecure(slots_[fd].tls != nullptr);
+        return io;
+    }
+
+    bool h2_dispatch(int fd, const std::shared_ptr<ConnectionIO> &io, bool body_complete) override {
+        if (opts_.run_to_completion && body_complete) {
+            // The response is picked up by the pump that follows.
+            io->setInline(true);
+            handler_(io);
+            return true;
+        }
+        return submit(*io);
+    }
+
+    void h2_close_stream(int fd, std::shared_ptr<ConnectionIO> &io) override {
+        release_io(io);
+        slots_[fd].idle_since = tick_;
+    }
+
+    // Switch the connection to HTTP/2.  \p upgraded is the HTTP/1.1
+    // request that asked for it, with its decoded HTTP2-Settings in
+    // \p settings, or null for prior knowledge.  Any bytes left in
+    // header_buf are the client's first frames.  Returns false if the
+    // connection was closed.
+    bool start_h2(int fd, ConnCtx &ctx, std::shared_ptr<ConnectionIO> upgraded,
+                  const std::string &settings) {
+        ServerStats &st = server_stats();
+        st.h2_connections.fetch_add(1, std::memory_order_relaxed);
+        std::shared_ptr<ConnectionIO> pipe = acquire_io(fd, ctx.generation);
+        pipe->setInline(true);  // written by the reactor itself
+        ctx.conn_io = pipe;
+        ctx.state = ConnState::Active;
+        ctx.body_complete = false;  // keep reading: frames arrive at any time
+        ctx.parser.reset();
+        H2StreamHost &host = *this;
+        ctx.h2 = std::make_unique<H2Session>(fd, host, *pipe, opts_.limits);
+        ctx.idle_since = ctx.last_io = tick_;
+        arm_timer(fd, ctx);
+        LOG_INFO("HTTP/2 connection ("
+                 << (upgraded ? "upgrade" : ctx.tls ? "ALPN" : "prior knowledge")
+                 << "): fd " << fd);
+        if (upgraded) {
+            st.h2_streams.fetch_add(1, std::memory_order_relaxed);
+            upgraded->setKeepAlive(true);
+            pipe->writeData(std::string(H2C_SWITCHING_PROTOCOLS));
+            ctx.h2->startUpgrade(settings, std::move(upgraded));
+        } else {
+            ctx.h2->start();
+        }
+        set_interest(fd, ctx, WANT_READ);
+        if (!ctx.header_buf.empty()) {
+            chunk_scratch_.swap(ctx.header_buf);
+            ctx.header_buf.clear();
+            ctx.h2->onData(chunk_scratch_.data(), chunk_scratch_.size());
+            chunk_scratch_.clear();
+        }
+        return flush(fd, ctx);
+    }
+
+    // True if more body bytes should be read from the socket now.
+    static bool wants_body(const ConnCtx &ctx) {
+        return !ctx.body_complete && ctx.body_backlog.empty() && !ctx.throttled;
+    }
+
+    // Body bytes collected before a request is dispatched (see the class
+    // comment): at most what the body ring holds.
+    size_t prebuffer_limit() const {
+        return std::min(opts_.limits.body_prebuffer, opts_.limits.body_high_watermark);
+    }
+
+    // True once a pre-buffered request should go to its handler: the body
+    // is complete, reading has paused, or a chunked body outgrew the limit.
+    bool prebuffered(const ConnCtx &ctx) const {
+        return !wants_body(ctx) || ctx.conn_io->bodyBuffered() >= prebuffer_limit();
+    }
+
+    // Hand body bytes to the worker; whatever the body ring cannot take
+    // waits in body_backlog.  \p eof marks the end of the body.
+    void feed_body(ConnCtx &ctx, const char *buf, size_t n, bool eof) {
+        if (ctx.body_backlog.empty()) {
+            size_t taken = ctx.conn_io->feedBody(buf, n, eof);
+            buf += taken;
+            n -= taken;
+            if (n == 0) return;
+        }
+        ctx.body_backlog.append(buf, n);
+        server_stats().body_bytes_buffered.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    // Run received bytes of a chunked body through the slot's decoder and
+    // hand the decoded data to the worker.  After the last chunk the body
+    // length and trailers go to ConnectionIO, and any further bytes are
+    // the next pipelined request.  Returns false if the encoding is
+    // malformed.
+    bool decode_chunked(ConnCtx &ctx, const char *buf, size_t n) {
+        size_t used = 0;
+        ChunkedDecoder::Status st = ctx.chunked.decode(
+            buf, n, used, [this, &ctx](const char *data, size_t len) {
+                feed_body(ctx, data, len, false);
+            });
+        if (st == ChunkedDecoder::Status::Error) return false;
+        if (st == ChunkedDecoder::Status::Complete) {
+            ctx.conn_io->endBody(static_cast<size_t>(ctx.chunked.decoded()),
+                                 ctx.chunked.trailers());
+            feed_body(ctx, nullptr, 0, true);
+            ctx.body_complete = true;
+            if (n > used) ctx.header_buf.append(buf + used, n - used);
+        }
+        return true;
+    }
+
+    // The worker drained the body ring to its low watermark: refeed the
+    // backlog and resume reading once it is gone.
+    void refeed_body(int fd, ConnCtx &ctx) {
+        size_t taken = ctx.conn_io->feedBody(ctx.body_backlog.data(), ctx.body_backlog.size(),
+                                             ctx.body_complete);
+        ctx.body_backlog.erase(0, taken);
+        server_stats().body_bytes_buffered.fetch_sub(taken, std::memory_order_relaxed);
+        if (wants_body(ctx)) set_interest(fd, ctx, ctx.interest | WANT_READ);
+    }
+
+    // Discard the body backlog (request over or connection closed).
+    void drop_backlog(ConnCtx &ctx) {
+        server_stats().body_bytes_buffered.fetch_sub(ctx.body_backlog.size(),
+                                                     std::memory_order_relaxed);
+        ctx.body_backlog.clear();
+    }
+
+    // ── Memory governor ─────────────────────────────────────────────
+
+    // True while the process buffers more than the memory budget.  Also
+    // keeps the buffered_high_water gauge current.
+    bool over_budget() {
+        ServerStats &st = server_stats();
+        uint64_t buffered = st.bufferedBytes();
+        ServerStats::raise(st.buffered_high_water, buffered);
+        return opts_.memory_budget > 0 && buffered > opts_.memory_budget;
+    }
+
+    // Pause the connection's body reads until its worker has drained the
+    // body ring to the low watermark.  No-op if it already has.  With a
+    // backlog, the refeed notification is already pending.
+    void throttle(int fd, ConnCtx &ctx) {
+        if (ctx.throttled) return;
+        if (ctx.body_backlog.empty() && !ctx.conn_io->awaitBodyDrain()) return;
+        ctx.throttled = true;
+        if (!ctx.throttle_listed) {
+            ctx.throttle_listed = true;
+            throttled_.emplace_back(fd, ctx.generation);
+        }
+        server_stats().reads_throttled.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Let a throttled connection read its body again.
+    void unthrottle(int fd, ConnCtx &ctx) {
+        ctx.throttled = false;
+        if (wants_body(ctx)) set_interest(fd, ctx, ctx.interest | WANT_READ);
+    }
+
+    // Once buffered bytes have fallen to MEMORY_RESUME_PERCENT of the
+    // budget, release every throttled connection.
+    void resume_throttled() {
+        if (throttled_.empty()) return;
+        uint64_t resume_at = opts_.memory_budget / 100 * MEMORY_RESUME_PERCENT;
+        if (server_stats().bufferedBytes() > resume_at) return;
+        for (const std::pair<int, uint32_t> &t : throttled_) {
+            ConnCtx *ctx = slot(t.first, t.second);
+            if (!ctx) continue;
+            ctx->throttle_listed = false;
+            if (ctx->throttled && ctx->conn_io) unthrottle(t.first, *ctx);
+        }
+        throttled_.clear();
+    }
+
+    // Refuse a freshly accepted connection with 503 while over the memory
+    // budget.  Returns true if the connection was shed (and closed).
+    bool shed_accept(int fd) {
+        if (!over_budget()) return false;
+        const char *resp =
+            "HTTP/1.1 503 Service Unavailable\r\n"
+            "Connection: close\r\nRetry-After: 1\r\nContent-Length: 0\r\n\r\n";
+        // A TLS client cannot read a plaintext answer; it just sees the close.
+        if (!opts_.tls) ::send(fd, resp, strlen(resp), MSG_NOSIGNAL | MSG_DONTWAIT);
+        close(fd);
+        server_stats().accepts_shed.fetch_add(1, std::memory_order_relaxed);
+        LOG_INFO("Memory budget exceeded, shedding connection: fd " << fd);
+        return true;
+    }
+
+    // A request has output, finished, failed or drained its body ring:
+    // close on error, otherwise move body bytes along and send what is
+    // pending.
+    bool service(int fd, ConnCtx &ctx) {
+        if (ctx.conn_io->hasError()) {
+            close_conn(fd, ctx);
+            return false;
+        }
+        if (!ctx.body_backlog.empty()) refeed_body(fd, ctx);
+        // A throttled connection resumes once its worker has caught up;
+        // otherwise wait for the next drain notification.
+        if (ctx.throttled && ctx.body_backlog.empty() && !ctx.conn_io->awaitBodyDrain()) {
+            unthrottle(fd, ctx);
+        }
+        return flush(fd, ctx);
+    }
+
+    // Answer a request head that cannot be served with \p status and
+    // close the connection.
+    void reject_request(int fd, ConnCtx &ctx, uint32_t status) {
+        std::string resp = "HTTP/1.1 " + std::to_string(status) + " " +
+                           http_utils::reason_phrase(status) +
+                           "\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+        if (ctx.tls) {
+            ctx.tls->send(fd, resp.data(), resp.size());
+        } else {
+            ::send(fd, resp.data(), resp.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        }
+        close_conn(fd, ctx);
+    }
+
+    // Advance the request parser over header_buf; once the head is
+    // complete, hand it to a ConnectionIO bridge and dispatch the request.
+    // Returns false if the connection had to be closed.
+    bool start_request(int fd, ConnCtx &ctx) {
+        // HTTP/2 with prior knowledge (or negotiated through ALPN): the
+        // connection opens with the preface.
+        if ((ctx.tls ? ctx.tls->alpnH2() : opts_.h2c) && ctx.requests_served == 0) {
+            size_t n = std::min(ctx.header_buf.size(), H2_PREFACE_LEN);
+            if (std::memcmp(ctx.header_buf.data(), H2_PREFACE, n) == 0) {
+                if (n < H2_PREFACE_LEN) return true;  // need more bytes
+                return start_h2(fd, ctx, nullptr, std::string());
+            }
+        }
+
+        RequestParser::Status st = ctx.parser.parse(ctx.header_buf);
+        if (st == RequestParser::Status::Error) {
+            LOG_INFO("Malformed request head: fd " << fd << ", status " << ctx.parser.errorStatus());
+            reject_request(fd, ctx, ctx.parser.errorStatus());
+            return false;
+        }
+        if ((st == RequestParser::Status::NeedMore && ctx.header_buf.size() > MAX_HEADER_SIZE) ||
+            (st == RequestParser::Status::Complete &&
+             ctx.parser.request().header_end > MAX_HEADER_SIZE)) {
+            reject_request(fd, ctx, 431);
+            return false;
+        }
+        if (st == RequestParser::Status::NeedMore) return true;  // need more bytes
+
+        // The last request allowed on this connection is answered with
+        // Connection: close.
+        size_t content_length = ctx.parser.request().content_length;
+        bool chunked = ctx.parser.request().chunked;
+        bool keep_alive = opts_.keepalive_timeout > 0 && ctx.parser.request().keep_alive &&
+                          !drain_started_ &&
+                          (opts_.max_keepalive_requests == 0 ||
+                           ctx.requests_served + 1 < opts_.max_keepalive_requests);
+
+        LOG_INFO("Received request: fd " << fd << ", content-length " << content_length
+                 << ", chunked " << chunked << ", keep-alive " << keep_alive);
+
+        std::string h2_settings;
+        bool upgrade = opts_.h2c && !ctx.tls &&
+                       H2Session::wantsUpgrade(ctx.header_buf, ctx.parser.request(), h2_settings);
+
+        // Set up the ConnectionIO bridge (pooled).  The head and the body
+        // bytes that arrived with it move over with the buffer; anything
+        // past the body is the start of the next pipelined request and
+        // stays in header_buf until this request completes.
+        std::shared_ptr<ConnectionIO> conn_io = acquire_io(fd, ctx.generation);
+        conn_io->setRequest(ctx.header_buf, ctx.parser.request());
+        ctx.parser.reset();
+        conn_io->setKeepAlive(keep_alive);
+        conn_io->setSecure(ctx.tls != nullptr);
+        if (upgrade) return start_h2(fd, ctx, std::move(conn_io), h2_settings);
+        ctx.conn_io = conn_io;
+        ctx.state = ConnState::Active;
+        ctx.last_io = tick_;
+
+        // Determine if the body is already complete.  Once it is, stop
+        // reading: a pipelined request stays in the socket buffer until
+        // this response has been sent.
+        if (chunked) {
+            // Everything after the head is encoded body (and perhaps the
+            // next request): decode it now.
+            ctx.body_complete = false;
+            ctx.chunked.reset();
+            chunk_scratch_.swap(ctx.header_buf);
+            ctx.header_buf.clear();
+            bool ok = decode_chunked(ctx, chunk_scratch_.data(), chunk_scratch_.size());
+            chunk_scratch_.clear();
+            if (!ok) {
+                LOG_INFO("Malformed chunked request body: fd " << fd);
+                reject_request(fd, ctx, 400);
+                return false;
+            }
+            set_interest(fd, ctx, wants_body(ctx) ? WANT_READ : 0u);
+        } else if (content_length == 0 ||
+                   conn_io->bodyBytesReceived() >= content_length) {
+            ctx.body_complete = true;
+            set_interest(fd, ctx, 0);  // idle until the response is produced
+        } else {
+            ctx.body_complete = false;
+            set_interest(fd, ctx, WANT_READ);  // keep reading the body
+        }
+
+        arm_timer(fd, ctx);
+
+        // A small body is collected before the handler runs.
+        if (!ctx.body_complete && prebuffer_limit() > 0 && !conn_io->expectsContinue() &&
+            (chunked || content_length <= prebuffer_limit())) {
+            ctx.dispatch_pending = true;
+            server_stats().requests_prebuffered.fetch_add(1, std::memory_order_relaxed);
+            if (!prebuffered(ctx)) return true;
+        }
+        dispatch(fd, ctx);
+        return true;
+    }
+
+    // Start the request's handler: inline if nothing is left to wait for
+    // and run_to_completion is set, otherwise on the worker pool.  A
+    // request the concurrency limiter sheds is answered with 503 and the
+    // connection lingers (see linger()).
+    void dispatch(int fd, ConnCtx &ctx) {
+        ctx.dispatch_pending = false;
+        if (opts_.run_to_completion && ctx.body_complete && ctx.body_backlog.empty()) {
+            // Run the filter chain here, on this reactor's thread and VM
+            // clone.  The response is flushed from the main loop once the
+            // handler returns.
+            ctx.conn_io->setInline(true);
+            handler_(ctx.conn_io);
+            completed_inline_.emplace_back(fd, ctx.generation);
+            return;
+        }
+        if (submit(*ctx.conn_io)) return;
+        static const char SHED_RESPONSE[] =
+            "HTTP/1.1 503 Service Unavailable\r\n"
+            "Connection: close\r\nRetry-After: 1\r\nContent-Length: 0\r\n\r\n";
+        if (ctx.tls) {
+            ctx.tls->send(fd, SHED_RESPONSE, sizeof(SHED_RESPONSE) - 1);
+        } else {
+            ::send(fd, SHED_RESPONSE, sizeof(SHED_RESPONSE) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+        }
+        linger(fd, ctx);
+    }
+
+    // Hand a request to the workers, through the fair queue if configured.
+    // Returns false, without dispatching, if the concurrency limiter sheds
+    // it.
+    bool submit(ConnectionIO &io) {
+        if (opts_.limiter) {
+            if (!opts_.limiter->tryAcquire()) return false;
+            io.admit(*opts_.limiter);
+        }
+        if (opts_.fair_queue) {
+            io.submitTo(*opts_.fair_queue, handler_);
+        } else {
+            io.submitTo(pool_, handler_);
+        }
+        return true;
+    }
+
+    // The handler has finished and every response byte has been sent.
+    // Recycle the connection for the next request if keep-alive was
+    // negotiated, otherwise close it.  Returns false if closed.
+    bool complete_request(int fd, ConnCtx &ctx) {
+        bool reuse = ctx.conn_io->keepAlive() && !ctx.conn_io->hasError() &&
+                     ctx.body_complete && !ctx.peer_closed &&
+                     !shutdown_.load(std::memory_order_relaxed);
+        if (!reuse) {
+            // The client may still be sending a body nobody read.
+            if (!ctx.body_complete && !ctx.peer_closed && !ctx.conn_io->hasError() &&
+                !shutdown_.load(std::memory_order_relaxed)) {
+                linger(fd, ctx);
+                return true;
+            }
+            close_conn(fd, ctx);
+            return false;
+        }
+        release_io(ctx.conn_io);
+        drop_backlog(ctx);
+        ctx.throttled = false;
+        ctx.state = ConnState::ReadingHeaders;
+        ctx.body_complete = false;
+        ++ctx.requests_served;
+        ctx.idle_since = tick_;
+        arm_timer(fd, ctx);
+        set_interest(fd, ctx, WANT_READ);
+        // A pipelined request may already be buffered.
+        return start_request(fd, ctx);
+    }
+
+    // Close the connection after a response that left the request body
+    // unread, without resetting it (see the class comment): send our FIN,
+    // then read and discard until the client's arrives.
+    void linger(int fd, ConnCtx &ctx) {
+        LOG_INFO("Lingering close: fd " << fd);
+        server_stats().lingering_closes.fetch_add(1, std::memory_order_relaxed);
+        if (ctx.tls) ctx.tls->shutdown();
+        ::shutdown(fd, SHUT_WR);
+        release_io(ctx.conn_io);
+        drop_backlog(ctx);
+        ctx.header_buf.clear();
+        ctx.throttled = false;
+        ctx.state = ConnState::Lingering;
+        ctx.idle_since = tick_;
+        arm_timer(fd, ctx);
+        set_interest(fd, ctx, WANT_READ);
+    }
+
+    // ── Timers ──────────────────────────────────────────────────────
+
+    enum class Phase { None, Header, KeepAlive, Body, Send, TlsHandshake, Linger };
+
+    static uint64_t ticks(int seconds) {
+        return static_cast<uint64_t>(seconds) * 1000 / TIMER_TICK_MS;
+    }
+
+    // Refresh the coarse clock and the reactor's current tick.  Called at
+    // the top of every loop turn.
+    void refresh_clock() {
+        tick_ = CoarseClock::refresh() / (TIMER_TICK_MS * 1000000ull);
+    }
+
+    // The timed phase the connection is in and its deadline (a tick); see
+    // the class comment.
+    Phase phase_deadline(const ConnCtx &ctx, uint64_t &deadline) const {
+        if (ctx.state == ConnState::Lingering) {
+            deadline = ctx.idle_since + ticks(LINGER_TIMEOUT);
+            return Phase::Linger;
+        }
+        if (ctx.tls && !ctx.tls->established()) {
+            deadline = ctx.idle_since + ticks(TLS_HANDSHAKE_TIMEOUT);
+            return Phase::TlsHandshake;
+        }
+        if ((ctx.state == ConnState::Active || ctx.h2) && (ctx.interest & WANT_WRITE) &&
+            opts_.send_timeout > 0) {
+            deadline = ctx.last_io + ticks(opts_.send_timeout);
+            return Phase::Send;
+        }
+        if (ctx.h2) {
+            if (ctx.h2->streams() > 0) return Phase::None;
+            deadline = ctx.idle_since + ticks(opts_.keepalive_timeout);
+            return Phase::KeepAlive;
+        }
+        if (ctx.state == ConnState::ReadingHeaders) {
+            if (ctx.header_buf.empty() && ctx.requests_served > 0) {
+                deadline = ctx.idle_since + ticks(opts_.keepalive_timeout);
+                return Phase::KeepAlive;
+            }
+            if (opts_.header_timeout == 0) return Phase::None;
+            deadline = ctx.idle_since + ticks(opts_.header_timeout);
+            return Phase::Header;
+        }
+        if (wants_body(ctx) && opts_.body_timeout > 0) {
+            deadline = ctx.last_io + ticks(opts_.body_timeout);
+            return Phase::Body;
+        }
+        return Phase::None;
+    }
+
+    // Point the connection's timer at the deadline of its current phase.
+    void arm_timer(int fd, const ConnCtx &ctx) {
+        uint64_t deadline = 0;
+        uint64_t now = timers_.now();
+        if (phase_deadline(ctx, deadline) == Phase::None) deadline = now + ticks(TIMER_RECHECK);
+        timers_.schedule(static_cast<uint32_t>(fd), deadline > now ? deadline - now : 0);
+    }
+
+    // A connection's timer fired: close it if its phase has overrun,
+    // otherwise wait for the (possibly moved) deadline.
+    void on_conn_timer(int fd) {
+        ConnCtx *ctx = slot(fd);
+        if (!ctx) return;
+        uint64_t deadline = 0;
+        Phase phase = phase_deadline(*ctx, deadline);
+        if (phase == Phase::None) {
+            // Nothing is timed now; a phase that starts later counts from here.
+            ctx->last_io = tick_;
+            arm_timer(fd, *ctx);
+            return;
+        }
+        if (deadline > tick_) {
+            arm_timer(fd, *ctx);
+            return;
+        }
+        ServerStats &st = server_stats();
+        switch (phase) {
+        case Phase::Header:
+            st.timeouts_header.fetch_add(1, std::memory_order_relaxed);
+            LOG_INFO("Request head timed out: fd " << fd);
+            if (ctx->header_buf.empty()) break;
+            reject_request(fd, *ctx, 408);
+            return;
+        case Phase::KeepAlive:
+            LOG_INFO("Closing idle " << (ctx->h2 ? "HTTP/2" : "keep-alive")
+                     << " connection: fd " << fd);
+            break;
+        case Phase::Body:
+            st.timeouts_body.fetch_add(1, std::memory_order_relaxed);
+            LOG_INFO("Request body timed out: fd " << fd);
+            break;
+        case Phase::Send:
+            st.timeouts_send.fetch_add(1, std::memory_order_relaxed);
+            LOG_INFO("Response send timed out: fd " << fd);
+            break;
+        case Phase::TlsHandshake:
+            LOG_INFO("Closing connection stuck in the TLS handshake: fd " << fd);
+            break;
+        case Phase::Linger:
+        case Phase::None:
+            break;
+        }
+        close_conn(fd, *ctx);
+    }
+
+    // Run the connection timers that are due and, once a second, pool
+    // retired ConnectionIO objects (returning whatever an aborted response
+    // still held to the gauges).  Called at the end of every loop turn.
+    void run_timers() {
+        if (tick_ >= timers_.now()) {
+            timers_.advance(tick_, [this](uint32_t fd) { on_conn_timer(static_cast<int>(fd)); });
+        }
+        if (tick_ - last_reclaim_ >= ticks(1)) {
+            last_reclaim_ = tick_;
+            reclaim_retiring();
+        }
+    }
+
+    // Consume the timerfd's expiration count (the tick itself is read
+    // from the clock).
+    void read_timer_fd() {
+        uint64_t expirations;
+        ssize_t rr = ::read(timer_fd_, &expirations, sizeof(expirations));
+        (void)rr;
+    }
+
+    // Called every loop turn while the draining flag is up.  The first
+    // call stops accepting; requests started from then on answer with
+    // Connection: close, while those already in progress keep whatever
+    // their headers promised (the worker may have sent them already).  Idle
+    // connections are closed at most once per tick.  Returns true
+    // once the loop may exit: nothing is left open, or the drain timeout
+    // has passed (the caller's close_all() then ends whatever remains).
+    bool drain_step() {
+        if (!drain_started_) {
+            drain_started_ = true;
+            drain_deadline_ = tick_ + ticks(opts_.drain_timeout);
+            stop_accepting();
+            LOG_INFO("Reactor draining: " << open_conns_ << " open connections");
+        } else if (tick_ == last_drain_scan_ && (open_conns_ > 0 || accept_pending())) {
+            return false;
+        }
+        last_drain_scan_ = tick_;
+
+        for (size_t fd = 0; fd < slots_.size() && open_conns_ > 0; ++fd) {
+            ConnCtx &cctx = slots_[fd];
+            if (!cctx.in_use) continue;
+            if (cctx.h2) {
+                if (!cctx.h2->goingAway()) {
+                    cctx.h2->goAway();
+                    flush(static_cast<int>(fd), cctx);
+                }
+            } else if (cctx.state == ConnState::ReadingHeaders && cctx.header_buf.empty() &&
+                       (!cctx.tls || cctx.tls->established()) &&
+                       tick_ - cctx.idle_since >= ticks(DRAIN_IDLE_GRACE)) {
+                close_conn(static_cast<int>(fd), cctx);
+            }
+        }
+        if (open_conns_ == 0 && !accept_pending()) {
+            LOG_INFO("Reactor drained");
+            return true;
+        }
+        if (tick_ >= drain_deadline_) {
+            LOG_INFO("Drain timeout: closing " << open_conns_ << " connections");
+            return true;
+        }
+        return false;
+    }
+
+    int listen_fd_;
+    int event_fd_ = -1;
+    Options opts_;
+    RequestHandler handler_;
+    ThreadPool &pool_;
+    const std::atomic<bool> &shutdown_;
+    const std::atomic<bool> &draining_;
+    size_t open_conns_ = 0;        // slots in use
+    bool drain_started_ = false;   // drain_step() has stopped accepting
+    uint64_t drain_deadline_ = 0;  // tick
+    uint64_t last_drain_scan_ = 0;  // tick
+
+    std::vector<ConnCtx> slots_;                        // connection slab, indexed by fd
+    std::vector<std::shared_ptr<ConnectionIO>> io_pool_;  // idle ConnectionIO objects
+    std::vector<std::shared_ptr<ConnectionIO>> io_retiring_;  // awaiting last worker release
+    ReadyQueue ready_;  // connections pushed by workers
+    // (fd, generation) of requests that ran inline and await their response flush.
+    std::vector<std::pair<int, uint32_t>> completed_inline_;
+    // (fd, generation) of connections whose body reads the memory budget paused.
+    std::vector<std::pair<int, uint32_t>> throttled_;
+    std::string chunk_scratch_;  // encoded body bytes that arrived with a chunked head
+    int timer_fd_ = -1;       // periodic TIMER_TICK_MS tick
+    TimerWheel timers_;       // one entry per connection, keyed by fd
+    uint64_t tick_ = 0;       // current tick (coarse monotonic clock / TIMER_TICK_MS)
+    uint64_t last_reclaim_ = 0;
+};
+
+/**
+ * EpollReactor — the default backend: an edge-triggered epoll loop.
+ *
+ * Client sockets are edge-triggered: reads drain the socket until EAGAIN
+ * (or until the connection stops wanting input) and writes flush until the
+ * buffer is empty or the socket is full, at which point EPOLLOUT is armed.
+ * A listener shared by several reactors is registered with EPOLLEXCLUSIVE
+ * so each new connection wakes only one of them.
+ *
+ * This is the backend for TLS listeners: the handshake waits for whichever
+ * direction OpenSSL asks for, and without kTLS the response segments are
+ * encrypted with SSL_write() (small ones gathered first, file segments
+ * and a spilled tail read back in TLS_WRITE_MAX pieces) instead of
+ * sendmsg()/sendfile().
+ */
+class EpollReactor final : public HttpReactor {
+public:
+    using HttpReactor::HttpReactor;
+
+    ~EpollReactor() override {
+        if (epoll_fd_ >= 0) close(epoll_fd_);
+    }
+
+    /// Create the epoll set and eventfd and register the listener.
+    bool init() override {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            LOG_ERROR("Failed to create epoll fd: " << strerror(errno));
+            return false;
+        }
+        if (!init_common()) return false;
+
+        // Register the listening socket.
+        {
+            struct epoll_event ev{};
+            ev.events = EPOLLIN;
+            if (opts_.shared_listener) ev.events |= EPOLLEXCLUSIVE;
+            ev.data.fd = listen_fd_;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev) < 0) {
+                LOG_ERROR("Failed to add server socket to epoll: " << strerror(errno));
+                return false;
+            }
+        }
+
+        // Register eventfd with epoll.
+        {
+            struct epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = event_fd_;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &ev) < 0) {
+                LOG_ERROR("Failed to add eventfd to epoll: " << strerror(errno));
+                return false;
+            }
+        }
+
+        // Register the timer tick with epoll.
+        {
+            struct epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = timer_fd_;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, timer_fd_, &ev) < 0) {
+                LOG_ERROR("Failed to add timerfd to epoll: " << strerror(errno));
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void run() override {
+        pin_thread();
+        CoarseClock::attach();
+
+        // No wait timeout: the timer tick wakes the loop.
+        struct epoll_event events[MAX_EPOLL_EVENTS];
+        while (!shutdown_.load(std::memory_order_relaxed)) {
+            int nfds = epoll_wait(epoll_fd_, events, MAX_EPOLL_EVENTS, -1);
+            if (nfds < 0) {
+                if (errno == EINTR) continue;
+                if (shutdown_.load(std::memory_order_relaxed)) break;
+                LOG_ERROR("epoll_wait error: " << strerror(errno));
+                break;
+            }
+            refresh_clock();
+
+            for (int i = 0; i < nfds; ++i) {
+                int fd = events[i].data.fd;
+                uint32_t ev = events[i].events;
+
+                if (fd == listen_fd_) {
+                    if (!drain_started_) accept_new();
+                    continue;
+                }
+                if (fd == event_fd_) {
+                    uint64_t val;
+                    ssize_t rr = ::read(event_fd_, &val, sizeof(val));
+                    (void)rr;
+                    drain_ready();
+                    continue;
+                }
+                if (fd == timer_fd_) {
+                    read_timer_fd();
+                    continue;
+                }
+
+                // ── Client fd ─────────────────────────────────────────
+                ConnCtx *ctx = slot(fd);
+                if (!ctx) continue;
+
+                if (ev & (EPOLLERR | EPOLLHUP)) {
+                    close_conn(fd, *ctx);
+                    continue;
+                }
+                if ((ev & EPOLLIN) && !on_readable(fd, *ctx)) continue;
+                if (!(ev & EPOLLOUT)) continue;
+                if (ctx->tls && !ctx->tls->established()) {
+                    tls_handshake(fd, *ctx);
+                } else if (ctx->conn_io) {
+                    flush(fd, *ctx);
+                }
+            }
+
+            drain_completed_inline();
+            resume_throttled();
+            run_timers();
+            if (draining_.load(std::memory_order_relaxed) && drain_step()) break;
+        }
+
+        // Clean up remaining client connections.
+        close_all();
+        CoarseClock::detach();
+    }
+
+    const char *backendName() const override { return "epoll"; }
+
+protected:
+    // Update epoll registration for a client fd.  Client sockets are
+    // always registered edge-triggered.
+    void set_interest(int fd, ConnCtx &ctx, uint32_t interest) override {
+        if (interest == ctx.interest) return;
+        if (interest == 0) {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        } else {
+            struct epoll_event ev2{};
+            ev2.events = interest | EPOLLET;
+            ev2.data.fd = fd;
+            epoll_ctl(epoll_fd_, ctx.interest == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD,
+                      fd, &ev2);
+        }
+        ctx.interest = interest;
+    }
+
+    // Send queued response segments, gathered into one sendmsg() per
+    // round, and file segments and any spilled tail with sendfile(), until
+    // nothing is left or the socket is full.  Returns false if the
+    // connection was closed.
+    bool flush(int fd, ConnCtx &ctx) override {
+        if (ctx.tls && !ctx.tls->ktlsSend()) return flush_tls(fd, ctx);
+        struct iovec iov[EGRESS_IOV_MAX];
+        for (;;) {
+            size_t cnt = ctx.conn_io->pendingWriteSegments(iov, EGRESS_IOV_MAX);
+            int file_fd = -1;
+            off_t file_off = 0;
+            size_t file_len = 0;
+            if (cnt == 0 && !ctx.conn_io->pendingFile(file_fd, file_off, file_len)) break;
+
+            ssize_t sent;
+            if (cnt > 0) {
+                struct msghdr msg{};
+                msg.msg_iov = iov;
+                msg.msg_iovlen = cnt;
+                sent = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+            } else {
+                sent = ::sendfile(fd, file_fd, &file_off, file_len);
+                if (sent == 0) {
+                    // The file shrank below the range the headers promised.
+                    LOG_ERROR("Response file truncated while sending (fd " << fd << ")");
+                    sent = -1;
+                    errno = EIO;
+                }
+            }
+            if (sent < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    uint32_t wanted = WANT_WRITE;
+                    if (wants_body(ctx)) wanted |= WANT_READ;
+                    set_interest(fd, ctx, wanted);
+                    return true;
+                }
+                ctx.conn_io->writeError();
+                close_conn(fd, ctx);
+                return false;
+            }
+            ctx.last_io = tick_;
+            if (cnt > 0) {
+                ctx.conn_io->advanceWrite(static_cast<size_t>(sent));
+            } else {
+                ctx.conn_io->advanceFile(static_cast<size_t>(sent));
+            }
+        }
+        return after_flush(fd, ctx);
+    }
+
+    // flush() for TLS without kernel offload: one SSL_write() of up to
+    // TLS_WRITE_MAX bytes per round.  A large leading segment is written
+    // in place; smaller ones are gathered into tls_scratch_ first, and
+    // file segments and a spilled tail are read back into it.  After
+    // EAGAIN the next round rebuilds the same leading bytes, as
+    // SSL_write() requires.
+    bool flush_tls(int fd, ConnCtx &ctx) {
+        struct iovec iov[EGRESS_IOV_MAX];
+        for (;;) {
+            size_t cnt = ctx.conn_io->pendingWriteSegments(iov, EGRESS_IOV_MAX);
+            int file_fd = -1;
+            off_t file_off = 0;
+            size_t file_len = 0;
+            const char *data;
+            size_t len;
+            if (cnt == 1 || (cnt > 1 && iov[0].iov_len >= TLS_COALESCE_BELOW)) {
+                data = static_cast<const char *>(iov[0].iov_base);
+                len = std::min(iov[0].iov_len, TLS_WRITE_MAX);
+            } else if (cnt > 1) {
+                tls_scratch_.clear();
+                for (size_t i = 0; i < cnt && tls_scratch_.size() < TLS_WRITE_MAX; ++i) {
+                    size_t take = std::min(iov[i].iov_len, TLS_WRITE_MAX - tls_scratch_.size());
+                    tls_scratch_.append(static_cast<const char *>(iov[i].iov_base), take);
+                }
+                data = tls_scratch_.data();
+                len = tls_scratch_.size();
+            } else if (ctx.conn_io->pendingFile(file_fd, file_off, file_len)) {
+                tls_scratch_.resize(std::min(file_len, TLS_WRITE_MAX));
+                ssize_t got = ::pread(file_fd, &tls_scratch_[0], tls_scratch_.size(), file_off);
+                if (got <= 0) {
+                    LOG_ERROR("Failed to read response file: " << strerror(got < 0 ? errno : EIO));
+                    ctx.conn_io->writeError();
+                    close_conn(fd, ctx);
+                    return false;
+                }
+                data = tls_scratch_.data();
+                len = static_cast<size_t>(got);
+            } else {
+                break;
+            }
+
+            ssize_t sent = ctx.tls->send(fd, data, len);
+            if (sent < 0) {
+                if (errno == EAGAIN) {
+                    uint32_t wanted = WANT_WRITE;
+                    if (wants_body(ctx)) wanted |= WANT_READ;
+                    set_interest(fd, ctx, wanted);
+                    return true;
+                }
+                ctx.conn_io->writeError();
+                close_conn(fd, ctx);
+                return false;
+            }
+            ctx.last_io = tick_;
+            if (cnt > 0) {
+                ctx.conn_io->advanceWrite(static_cast<size_t>(sent));
+            } else {
+                ctx.conn_io->advanceFile(static_cast<size_t>(sent));
+            }
+        }
+        return after_flush(fd, ctx);
+    }
+
+    void close_socket(int fd, ConnCtx &ctx) override {
+        if (ctx.interest) {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+            ctx.interest = 0;
+        }
+        close(fd);
+    }
+
+    void stop_accepting() override {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, listen_fd_, nullptr);
+    }
+
+private:
+    // Accept every pending connection on the listener.
+    void accept_new() {
+        while (true) {
+            sockaddr_storage client_addr{};
+            socklen_t client_addrlen = sizeof(client_addr);
+            int client_fd = accept4(listen_fd_,
+                                    reinterpret_cast<sockaddr *>(&client_addr),
+                                    &client_addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (client_fd < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (shutdown_.load(std::memory_order_relaxed)) break;
+                LOG_ERROR("Accept error: " << strerror(errno));
+                break;
+            }
+            LOG_INFO("Accepted new connection: fd " << client_fd);
+            if (shed_accept(client_fd)) continue;
+
+            struct epoll_event client_ev{};
+            client_ev.events = EPOLLIN | EPOLLET;
+            client_ev.data.fd = client_fd;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, client_fd, &client_ev) < 0) {
+                LOG_ERROR("Failed to add client socket to epoll: " << strerror(errno));
+                close(client_fd);
+                continue;
+            }
+
+            ConnCtx &ctx = claim_slot(client_fd);
+            if (opts_.tls) {
+                ctx.tls = TlsConnection::accept(*opts_.tls, client_fd);
+                if (!ctx.tls) {
+                    LOG_ERROR("Failed to set up TLS: " << TlsContext::last_error());
+                    close_conn(client_fd, ctx);
+                    continue;
+                }
+                arm_timer(client_fd, ctx);  // the handshake deadline
+            }
+        }
+    }
+
+    // Advance the TLS handshake of a new connection.  Once it is done the
+    // connection reads like any other; bytes that came with the client's
+    // last handshake flight are picked up at once.  Returns false if the
+    // connection was closed.
+    bool tls_handshake(int fd, ConnCtx &ctx) {
+        switch (ctx.tls->handshake()) {
+        case TlsConnection::Status::WantRead:
+            set_interest(fd, ctx, WANT_READ);
+            return true;
+        case TlsConnection::Status::WantWrite:
+            set_interest(fd, ctx, WANT_WRITE);
+            return true;
+        case TlsConnection::Status::Error:
+            LOG_INFO("TLS handshake failed: fd " << fd);
+            close_conn(fd, ctx);
+            return false;
+        case TlsConnection::Status::Done:
+            break;
+        }
+        LOG_INFO("TLS established: fd " << fd << ", " << ctx.tls->version() << " "
+                 << ctx.tls->cipher() << (ctx.tls->alpnH2() ? ", h2" : "")
+                 << (ctx.tls->ktlsSend() ? ", kTLS tx" : "")
+                 << (ctx.tls->ktlsRecv() ? ", kTLS rx" : ""));
+        ctx.idle_since = tick_;
+        arm_timer(fd, ctx);
+        set_interest(fd, ctx, WANT_READ);
+        return on_readable(fd, ctx);
+    }
+
+    // EPOLLIN: drain the socket until EAGAIN, or until the connection stops
+    // wanting input (body complete).  Returns false if the connection was
+    // closed.
+    bool on_readable(int fd, ConnCtx &ctx) {
+        if (ctx.tls && !ctx.tls->established()) return tls_handshake(fd, ctx);
+        char buf[BUFFER_SIZE];
+        while (ctx.interest & WANT_READ) {
+            ssize_t n = ctx.tls ? ctx.tls->recv(fd, buf, sizeof(buf))
+                                : recv(fd, buf, sizeof(buf), 0);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+                close_conn(fd, ctx);
+                return false;
+            }
+            if (n == 0) return on_peer_eof(fd, ctx);
+            if (!on_data(fd, ctx, buf, static_cast<size_t>(n))) return false;
+        }
+        return true;
+    }
+
+    int epoll_fd_ = -1;
+    std::string tls_scratch_;  // gathered, file or spilled response bytes for SSL_write()
+};
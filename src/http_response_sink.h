@@ -18,8 +18,13 @@
 
 #pragma once
 
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
 #include "response_sink.h"
 #include "connection_io.h"
+#include "response_compressor.h"
 
 /**
  * HttpResponseSink — ResponseSink backed by a ConnectionIO bridge.
@@ -31,13 +36,27 @@
  * For the non-streaming path, headers are written with Content-Length and
  * the body is written as a flat byte stream.  For the streaming path,
  * headers are written with Transfer-Encoding: chunked and each writeBody()
- * call wraps the data in a chunked-encoding frame.
+ * or sendFile() call wraps the data in a chunked-encoding frame.  Both
+ * paths own the Connection header, which reflects
+ * ConnectionIO::keepAlive().  sendFile() queues a file segment, which the
+ * reactor sends with sendfile().
+ *
+ * A streaming response is compressed on the way out when the request's
+ * Accept-Encoding allows a coding and the response qualifies (see
+ * ResponseCompression): every writeBody() is compressed and flushed as
+ * one chunk, so the client still sees each write as it happens, and a
+ * sendFile() is read back through the compressor.  Non-streaming
+ * responses (lswasm_send_file) keep their Content-Length and are sent
+ * as they are.
  */
 class HttpResponseSink : public ResponseSink {
 public:
-    /// Construct with a non-owning pointer to the ConnectionIO bridge.
-    /// The caller must ensure the ConnectionIO outlives this sink.
-    explicit HttpResponseSink(ConnectionIO *conn) : conn_(conn) {}
+    /// Construct with a non-owning pointer to the ConnectionIO bridge and,
+    /// for compression, to the request headers (read when the response
+    /// starts, so a filter may remove Accept-Encoding first).  The caller
+    /// must ensure both outlive this sink.
+    explicit HttpResponseSink(ConnectionIO *conn, const HeaderPairs *request_headers = nullptr)
+        : conn_(conn), request_headers_(request_headers) {}
 
     bool sendHeaders(uint32_t status_code, const HeaderPairs &headers,
                      bool streaming) override {
@@ -48,47 +67,68 @@ public:
         }
         streaming_ = streaming;
 
-        if (streaming) {
-            // For streaming responses: strip Content-Length, ensure
-            // Transfer-Encoding: chunked is present.
-            HeaderPairs normalized;
-            normalized.reserve(headers.size() + 1);
-            bool saw_chunked = false;
-            for (const auto &hdr : headers) {
-                if (header_name_eq(hdr.first, "Content-Length")) {
-                    continue;  // Remove Content-Length for chunked streaming.
+        // For streaming responses: strip Content-Length, ensure
+        // Transfer-Encoding: chunked is present.  Non-streaming headers
+        // are written as-is (the caller manages Content-Length).
+        HeaderPairs normalized;
+        normalized.reserve(headers.size() + 2);
+        bool saw_chunked = false;
+        for (const auto &hdr : headers) {
+            if (streaming && header_name_eq(hdr.first, "Content-Length")) {
+                continue;  // Remove Content-Length for chunked streaming.
+            }
+            if (streaming && header_name_eq(hdr.first, "Transfer-Encoding")) {
+                std::string val_lower(hdr.second);
+                std::transform(val_lower.begin(), val_lower.end(),
+                               val_lower.begin(),
+                               [](unsigned char c) { return std::tolower(c); });
+                if (val_lower == "chunked") {
+                    saw_chunked = true;
+                    normalized.emplace_back(hdr.first, hdr.second);
+                } else {
+                    LOG_ERROR("[HttpResponseSink] refusing conflicting "
+                              "Transfer-Encoding on chunked streaming response");
+                    error_ = true;
+                    return false;
                 }
-                if (header_name_eq(hdr.first, "Transfer-Encoding")) {
-                    std::string val_lower(hdr.second);
-                    std::transform(val_lower.begin(), val_lower.end(),
-                                   val_lower.begin(),
-                                   [](unsigned char c) { return std::tolower(c); });
-                    if (val_lower == "chunked") {
-                        saw_chunked = true;
-                        normalized.emplace_back(hdr.first, hdr.second);
-                    } else {
-                        LOG_ERROR("[HttpResponseSink] refusing conflicting "
-                                  "Transfer-Encoding on chunked streaming response");
-                        error_ = true;
-                        return false;
-                    }
-                    continue;
+                continue;
+            }
+            if (header_name_eq(hdr.first, "Connection")) {
+                // Connection is hop-by-hop and owned by the host; a
+                // filter may only ask for the connection to be closed.
+                std::string val_lower(hdr.second);
+                std::transform(val_lower.begin(), val_lower.end(),
+                               val_lower.begin(),
+                               [](unsigned char c) { return std::tolower(c); });
+                if (val_lower.find("close") != std::string::npos) {
+                    conn_->disableKeepAlive();
                 }
-                normalized.emplace_back(hdr.first, hdr.second);
+                continue;
             }
-            if (!saw_chunked) {
-                normalized.emplace_back("Transfer-Encoding", "chunked");
+            normalized.emplace_back(hdr.first, hdr.second);
+        }
+        if (streaming && !saw_chunked) {
+            normalized.emplace_back("Transfer-Encoding", "chunked");
+        }
+        ResponseCompression &compression = response_compression();
+        if (streaming && compression.enabled() &&
+            ResponseCompression::compressible(status_code, headers)) {
+            ContentCoding coding = ContentCoding::Identity;
+            if (request_headers_) {
+                coding = compression.negotiate(
+                    http_utils::header_value(*request_headers_, "Accept-Encoding"));
+            }
+            if (compressor_.start(coding, compression.level())) {
+                ResponseCompression::markEncoded(normalized, coding);
+            } else {
+                ResponseCompression::addVary(normalized);
             }
-            std::string hdr_str = http_utils::serialize_headers(status_code,
-                                                                 normalized);
-            conn_->writeData(std::move(hdr_str));
-        } else {
-            // Non-streaming: headers are written as-is (caller manages
-            // Content-Length).
-            std::string hdr_str = http_utils::serialize_headers(status_code,
-                                                                 headers);
-            conn_->writeData(std::move(hdr_str));
         }
+        normalized.emplace_back("Connection",
+                                conn_->keepAlive() ? "keep-alive" : "close");
+        std::string hdr_str = http_utils::serialize_headers(status_code,
+                                                             normalized);
+        conn_->writeData(std::move(hdr_str));
         return true;
     }
 
@@ -96,18 +136,12 @@ public:
         if (!conn_ || error_) return false;
         if (data.empty()) return true;
 
-        if (streaming_) {
-            // Wrap data in HTTP/1.1 chunked transfer encoding:
-            //   <hex-size>\r\n<data>\r\n
-            char size_buf[24];
-            int n = std::snprintf(size_buf, sizeof(size_buf), "%zx\r\n",
-                                  data.size());
-            std::string chunk;
-            chunk.reserve(static_cast<size_t>(n) + data.size() + 2);
-            chunk.append(size_buf, static_cast<size_t>(n));
-            chunk.append(data.data(), data.size());
-            chunk.append("\r\n");
-            conn_->writeData(std::move(chunk));
+        if (compressor_.active()) {
+            std::string out;
+            if (!compressor_.write(data, out)) return compression_failed();
+            write_chunk(out);
+        } else if (streaming_) {
+            write_chunk(data);
         } else {
             // Non-streaming: write raw body bytes.
             conn_->writeData(std::string(data));
@@ -115,8 +149,57 @@ public:
         return true;
     }
 
+    bool sendFile(const std::shared_ptr<const OpenFile> &file, off_t offset,
+                  size_t len) override {
+        if (!conn_ || error_) return false;
+        if (len == 0) return true;
+
+        if (compressor_.active()) {
+            // The bytes must pass through the compressor: read them back.
+            std::string block(std::min(len, COMPRESSION_BLOCK), '\0');
+            std::string out;
+            while (len > 0) {
+                ssize_t n = pread(file->fd, &block[0], std::min(len, block.size()), offset);
+                if (n <= 0) {
+                    LOG_ERROR("[HttpResponseSink] reading file for compression failed: "
+                              << (n < 0 ? std::strerror(errno) : "unexpected end of file"));
+                    error_ = true;
+                    return false;
+                }
+                if (!compressor_.write(std::string_view(block.data(), static_cast<size_t>(n)),
+                                       out, /*flush=*/false)) {
+                    return compression_failed();
+                }
+                offset += n;
+                len -= static_cast<size_t>(n);
+                if (out.size() >= COMPRESSION_BLOCK) {
+                    write_chunk(out);
+                    out.clear();
+                }
+            }
+            if (!compressor_.write({}, out)) return compression_failed();
+            write_chunk(out);
+        } else if (streaming_) {
+            // Same chunk framing as writeBody(), around the file segment.
+            char size_buf[24];
+            int n = std::snprintf(size_buf, sizeof(size_buf), "%zx\r\n", len);
+            conn_->writeData(std::string(size_buf, static_cast<size_t>(n)));
+            conn_->writeFile(file, offset, len);
+            conn_->writeData(std::string("\r\n"));
+        } else {
+            conn_->writeFile(file, offset, len);
+        }
+        return true;
+    }
+
     bool finishBody() override {
         if (!conn_ || error_) return false;
+        if (compressor_.active()) {
+            std::string out;
+            if (!compressor_.finish(out)) return compression_failed();
+            write_chunk(out);
+            ResponseCompression::record(compressor_);
+        }
         if (streaming_) {
             // Send the chunked transfer encoding terminator: zero-length chunk.
             conn_->writeData(std::string("0\r\n\r\n"));
@@ -128,7 +211,29 @@ public:
     bool hasError() const override { return error_; }
 
 private:
+    // Wrap data in HTTP/1.1 chunked transfer encoding:
+    //   <hex-size>\r\n<data>\r\n
+    void write_chunk(std::string_view data) {
+        if (data.empty()) return;  // a zero-size chunk would end the body
+        char size_buf[24];
+        int n = std::snprintf(size_buf, sizeof(size_buf), "%zx\r\n", data.size());
+        std::string chunk;
+        chunk.reserve(static_cast<size_t>(n) + data.size() + 2);
+        chunk.append(size_buf, static_cast<size_t>(n));
+        chunk.append(data.data(), data.size());
+        chunk.append("\r\n");
+        conn_->writeData(std::move(chunk));
+    }
+
+    bool compression_failed() {
+        LOG_ERROR("[HttpResponseSink] response compression failed");
+        error_ = true;
+        return false;
+    }
+
     ConnectionIO *conn_ = nullptr;
+    const HeaderPairs *request_headers_ = nullptr;
+    Compressor compressor_;
     bool streaming_ = false;
     bool error_ = false;
 };
@@ -22,6 +22,7 @@
 #include <cctype>
 #include <cstdint>
 #include <cstring>
+#include <ctime>
 #include <sstream>
 #include <string>
 #include <string_view>
@@ -50,6 +51,7 @@ inline const char *reason_phrase(uint32_t status_code) {
         case 200: return "OK";
         case 201: return "Created";
         case 204: return "No Content";
+        case 206: return "Partial Content";
         case 301: return "Moved Permanently";
         case 302: return "Found";
         case 304: return "Not Modified";
@@ -58,8 +60,11 @@ inline const char *reason_phrase(uint32_t status_code) {
         case 403: return "Forbidden";
         case 404: return "Not Found";
         case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
+        case 416: return "Range Not Satisfiable";
         case 431: return "Request Header Fields Too Large";
         case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
         case 502: return "Bad Gateway";
         case 503: return "Service Unavailable";
         default:  return "";
@@ -80,6 +85,111 @@ inline std::string serialize_headers(uint32_t status_code,
     return response.str();
 }
 
+// The value of the first \p name field in \p headers, or empty.
+inline std::string_view header_value(const HeaderPairs &headers, std::string_view name) {
+    for (const auto &[key, value] : headers) {
+        if (header_name_eq(key, name)) return value;
+    }
+    return {};
+}
+
+// Format \p t as an HTTP-date (IMF-fixdate, RFC 9110 §5.6.7).
+inline std::string http_date(time_t t) {
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    char buf[32];
+    size_t n = std::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return std::string(buf, n);
+}
+
+// How a Range request header applies to a representation.
+enum class ByteRange {
+    Full,           // no usable range: send the whole representation (200)
+    Partial,        // send [first, last] (206)
+    Unsatisfiable,  // no byte of the range exists (416)
+};
+
+// Evaluate a Range header \p value (RFC 9110 §14.2) against a
+// representation of \p size bytes.  A single "bytes=" range yields Partial
+// with the inclusive bounds in \p first and \p last, clipped to the size.
+// Several ranges, another unit or a malformed value yield Full: the server
+// may ignore the header, and multipart/byteranges is not produced.
+inline ByteRange parse_byte_range(std::string_view value, uint64_t size,
+                                  uint64_t &first, uint64_t &last) {
+    auto trim = [](std::string_view v) {
+        while (!v.empty() && (v.front() == ' ' || v.front() == '\t')) v.remove_prefix(1);
+        while (!v.empty() && (v.back() == ' ' || v.back() == '\t')) v.remove_suffix(1);
+        return v;
+    };
+    // Digits only, no overflow; an empty string is "absent".
+    auto number = [](std::string_view v, uint64_t &out) {
+        out = 0;
+        for (char c : v) {
+            if (c < '0' || c > '9') return false;
+            uint64_t d = static_cast<uint64_t>(c - '0');
+            if (out > (UINT64_MAX - d) / 10) return false;
+            out = out * 10 + d;
+        }
+        return true;
+    };
+
+    value = trim(value);
+    size_t eq = value.find('=');
+    if (eq == std::string_view::npos || !header_name_eq(trim(value.substr(0, eq)), "bytes")) {
+        return ByteRange::Full;
+    }
+    std::string_view spec = trim(value.substr(eq + 1));
+    size_t dash = spec.find('-');
+    if (spec.find(',') != std::string_view::npos || dash == std::string_view::npos) {
+        return ByteRange::Full;
+    }
+    std::string_view from = trim(spec.substr(0, dash));
+    std::string_view to = trim(spec.substr(dash + 1));
+    uint64_t a, b;
+    if (!number(from, a) || !number(to, b) || (from.empty() && to.empty())) {
+        return ByteRange::Full;
+    }
+
+    if (from.empty()) {  // suffix range: the last b bytes
+        if (b == 0 || size == 0) return ByteRange::Unsatisfiable;
+        first = size - std::min(b, size);
+        last = size - 1;
+        return ByteRange::Partial;
+    }
+    if (!to.empty() && b < a) return ByteRange::Full;  // invalid: ignored
+    if (a >= size) return ByteRange::Unsatisfiable;
+    first = a;
+    last = to.empty() ? size - 1 : std::min(b, size - 1);
+    return ByteRange::Partial;
+}
+
+// Decode base64url (RFC 4648 §5), with or without padding, into \p out.
+// Returns false on any character outside the alphabet or a bad length.
+inline bool base64url_decode(std::string_view in, std::string &out) {
+    out.clear();
+    while (!in.empty() && in.back() == '=') in.remove_suffix(1);
+    if (in.size() % 4 == 1) return false;
+    out.reserve(in.size() * 3 / 4);
+    uint32_t acc = 0;
+    int bits = 0;
+    for (char c : in) {
+        int v;
+        if (c >= 'A' && c <= 'Z') v = c - 'A';
+        else if (c >= 'a' && c <= 'z') v = c - 'a' + 26;
+        else if (c >= '0' && c <= '9') v = c - '0' + 52;
+        else if (c == '-') v = 62;
+        else if (c == '_') v = 63;
+        else return false;
+        acc = (acc << 6) | static_cast<uint32_t>(v);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<char>((acc >> bits) & 0xff));
+        }
+    }
+    return true;
+}
+
 // Deserialize proxy-wasm pairs format into HeaderPairs.
 //
 // Wire format (same as proxy_wasm_api.h marshalPairs):
@@ -30,6 +30,8 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include "coarse_clock.h"
+
 namespace lswasm_log {
 
 // Sentinel file: logging is only active if this file exists at startup.
@@ -77,13 +79,12 @@ inline void log_init(bool debug = false) {
 
 /**
  * Return a timestamp string in the form "YYYY-MM-DD HH:MM:SS.MMMMMM".
+ * Reads the reactors' cached clock (see CoarseClock).
  */
 inline std::string timestamp() {
-  std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
-  std::time_t time_t_now = std::chrono::system_clock::to_time_t(now);
-  std::chrono::microseconds us = std::chrono::duration_cast<std::chrono::microseconds>(
-                                     now.time_since_epoch()) %
-                                 std::chrono::seconds(1);
+  uint64_t now_ns = CoarseClock::realtimeNs();
+  std::time_t time_t_now = static_cast<std::time_t>(now_ns / 1000000000ull);
+  std::chrono::microseconds us((now_ns % 1000000000ull) / 1000);
   std::tm tm_buf{};
   ::localtime_r(&time_t_now, &tm_buf);
   std::ostringstream oss;
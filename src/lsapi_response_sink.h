@@ -25,6 +25,8 @@ extern "C" {
 #include "lsapilib.h"
 }
 
+inline constexpr size_t LSAPI_SENDFILE_MAX = 16777216;  // 16 MB of file per LSAPI stream packet
+
 /**
  * LsapiResponseSink — ResponseSink backed by an LSAPI_Request.
  *
@@ -32,7 +34,9 @@ extern "C" {
  * calls.  Unlike the HTTP sink, LSAPI handles its own protocol framing —
  * there is no chunked transfer encoding.  Headers and body bytes are
  * passed through via LSAPI_SetRespStatus_r(), LSAPI_AppendRespHeader2_r(),
- * LSAPI_FinalizeRespHeaders_r(), and LSAPI_Write_r().
+ * LSAPI_FinalizeRespHeaders_r(), and LSAPI_Write_r(); sendFile() uses
+ * LSAPI_sendfile_r(), which flushes the buffered response and sends the
+ * file range in one stream packet straight from the file.
  */
 class LsapiResponseSink : public ResponseSink {
 public:
@@ -91,6 +95,27 @@ public:
         return true;
     }
 
+    bool sendFile(const std::shared_ptr<const OpenFile> &file, off_t offset,
+                  size_t len) override {
+        if (!req_ || error_) return false;
+        // One LSAPI packet per call: its header announces the full size,
+        // so a short sendfile() cannot be resumed in the same packet.
+        while (len > 0) {
+            size_t part = std::min(len, LSAPI_SENDFILE_MAX);
+            off_t off = offset;
+            ssize_t sent = LSAPI_sendfile_r(req_, file->fd, &off, part);
+            if (sent != static_cast<ssize_t>(part)) {
+                LOG_ERROR("[LsapiResponseSink] LSAPI_sendfile_r failed ("
+                          << sent << " of " << part << " bytes)");
+                error_ = true;
+                return false;
+            }
+            offset += static_cast<off_t>(part);
+            len -= part;
+        }
+        return true;
+    }
+
     bool finishBody() override {
         if (!req_ || error_) return false;
         // Flush any buffered data.
@@ -16,6 +16,7 @@
 *    along with this program. If not, see http://www.gnu.org/licenses/.      *
 *****************************************************************************/
 
+#include <algorithm>
 #include <iostream>
 #include <filesystem>
 #include <memory>
@@ -24,8 +25,13 @@
 #include <map>
 #include <unordered_map>
 #include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
 #include <stdexcept>
-#include <sstream>
+#include <climits>
 #include <cstring>
 #include <unistd.h>
 #include <sys/socket.h>
@@ -43,9 +49,17 @@
 #include "v8-initialization.h"
 #endif
 
+#include "concurrency_limiter.h"
 #include "connection_io.h"
+#include "fair_queue.h"
+#include "file_cache.h"
+#include "hot_restart.h"
 #include "http_filter.h"
+#include "http_reactor.h"
+#include "uring_reactor.h"
 #include "http_response_sink.h"
+#include "response_compressor.h"
+#include "server_stats.h"
 #include "thread_pool.h"
 #include "wasm_module_manager.h"
 #include "proxy-wasm/exports.h"   // RegisterForeignFunction, current_context_
@@ -64,17 +78,15 @@ extern "C" {
 const int DEFAULT_PORT = 8080;
 const char *DEFAULT_UDS_PATH = "/tmp/lswasm.sock";
 const int BACKLOG = 128;
-const int BUFFER_SIZE = 65536;          // 64 KB per recv() syscall
-const int MAX_EPOLL_EVENTS = 64;
-const size_t MAX_HEADER_SIZE = 65536;   // 64 KB limit for request headers
-const size_t BODY_CHUNK_SIZE = 524288;  // 512 KB streaming chunk size
+const size_t BODY_CHUNK_SIZE = 524288;  // 512 KB LSAPI body chunk size
+// BUFFER_SIZE, MAX_HEADER_SIZE and the keep-alive defaults live in http_reactor.h.
 
 // Global state
 static std::atomic<bool> g_shutdown{false};
-static int g_server_socket = -1;  // For signal handler to unblock accept()
-static std::string g_uds_path;    // For cleanup on shutdown
+static std::atomic<bool> g_draining{false};     // Hot restart: a successor has the listeners
 static std::atomic<uint32_t> g_next_context_id{1};
 static bool g_body_pacifier = false;  // When true, include diagnostic body in responses.
+static BodyDelivery g_body_delivery;   // Request body batching unless a filter asks otherwise.
 std::unique_ptr<WasmModuleManager> g_module_manager;
 
 // ── Streaming response foreign functions ──────────────────────────────
@@ -149,47 +161,86 @@ static proxy_wasm::RegisterForeignFunction register_finish_response(
       return ctx->streamingFinish();
     });
 
-// Extract Content-Length value from raw HTTP header data (case-insensitive).
-// Returns 0 if the header is absent or on parse error.
-static size_t extract_content_length(const std::string &headers) {
-    // Scan for lines beginning with "Content-Length:" (case-insensitive).
-    size_t pos = 0;
-    while (pos < headers.size()) {
-        // Find start of the next line.
-        size_t line_end = headers.find('\n', pos);
-        if (line_end == std::string::npos) line_end = headers.size();
-        std::string_view line(headers.data() + pos, line_end - pos);
-        // Strip trailing \r
-        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
-
-        if (line.size() > 15 && line[14] == ':') {
-            if (header_name_eq(line.substr(0, 14), "Content-Length")) {
-                size_t j = 15;
-                while (j < line.size() && (line[j] == ' ' || line[j] == '\t')) ++j;
-                size_t start = j;
-                while (j < line.size() && line[j] >= '0' && line[j] <= '9') ++j;
-                if (j > start) {
-                    try {
-                        return std::stoull(std::string(line.substr(start, j - start)));
-                    } catch (...) {
-                        return 0;
-                    }
-                }
-            }
-        }
-        pos = line_end + 1;
-    }
-    return 0;
-}
+// ── lswasm_send_file ──
+// Sends a whole response from a file (see LsWasmContext::streamingSendFile).
+// Argument format:
+//   8 bytes  uint64_t  offset of the first byte to send
+//   8 bytes  uint64_t  length (UINT64_MAX = to the end of the file)
+//   4 bytes  uint32_t  path_len
+//   path_len bytes     file path
+//   remainder          proxy-wasm pairs (marshalled headers), may be empty
+static proxy_wasm::RegisterForeignFunction register_send_file(
+    "lswasm_send_file",
+    [](proxy_wasm::WasmBase & /*wasm*/, std::string_view argument,
+       std::function<void *(size_t)> /*alloc_result*/) -> proxy_wasm::WasmResult {
+      auto *ctx = streaming_context();
+      if (!ctx) return proxy_wasm::WasmResult::InternalFailure;
+
+      if (argument.size() == 0) {
+        LOG_INFO("[Streaming] send_file: isSupported() probe");
+        return proxy_wasm::WasmResult::BadArgument;
+      }
+      uint32_t path_len = 0;
+      if (argument.size() >= 20) std::memcpy(&path_len, argument.data() + 16, 4);
+      if (argument.size() < 20 || path_len == 0 || argument.size() - 20 < path_len) {
+        LOG_ERROR("[Streaming] send_file: malformed argument ("
+                  << argument.size() << " bytes)");
+        return proxy_wasm::WasmResult::BadArgument;
+      }
+      uint64_t offset, length;
+      std::memcpy(&offset, argument.data(), 8);
+      std::memcpy(&length, argument.data() + 8, 8);
+      std::string path(argument.substr(20, path_len));
+
+      HeaderPairs headers;
+      http_utils::deserialize_header_pairs(argument.substr(20 + path_len), headers);
+
+      return ctx->streamingSendFile(path, offset, length, headers);
+    });
+
+// ── lswasm_set_body_delivery ──
+// Sets how this request's body is batched into onRequestBody() calls
+// (see LsWasmContext::setBodyDelivery); call it from onRequestHeaders.
+// Argument format:
+//   4 bytes  uint32_t  min_chunk       (0 = host default)
+//   4 bytes  uint32_t  max_chunk       (0 = host default)
+//   4 bytes  uint32_t  max_latency_ms
+static proxy_wasm::RegisterForeignFunction register_set_body_delivery(
+    "lswasm_set_body_delivery",
+    [](proxy_wasm::WasmBase & /*wasm*/, std::string_view argument,
+       std::function<void *(size_t)> /*alloc_result*/) -> proxy_wasm::WasmResult {
+      auto *ctx = streaming_context();
+      if (!ctx) return proxy_wasm::WasmResult::InternalFailure;
 
-// HTTP server supporting both TCP and Unix Domain Socket listeners.
+      if (argument.size() == 0) {
+        LOG_INFO("[Streaming] set_body_delivery: isSupported() probe");
+        return proxy_wasm::WasmResult::BadArgument;
+      }
+      if (argument.size() != 12) {
+        LOG_ERROR("[Streaming] set_body_delivery: malformed argument ("
+                  << argument.size() << " bytes), expected 12");
+        return proxy_wasm::WasmResult::BadArgument;
+      }
+      uint32_t min_chunk, max_chunk, max_latency_ms;
+      std::memcpy(&min_chunk, argument.data(), 4);
+      std::memcpy(&max_chunk, argument.data() + 4, 4);
+      std::memcpy(&max_latency_ms, argument.data() + 8, 4);
+      ctx->setBodyDelivery(min_chunk, max_chunk, max_latency_ms);
+      return proxy_wasm::WasmResult::Ok;
+    });
+
+// One HTTP listener — a TCP port or a Unix Domain Socket — together with
+// the reactors that serve it.  main() runs one HttpServer per --listen
+// entry, each with its own reactor set and, optionally, its own pool.
 class HttpServer {
 public:
-    // Construct a TCP listener on the given port.
-    static HttpServer tcp(int port) {
+    // Construct a TCP listener on the given port.  An empty address binds
+    // every interface.
+    static HttpServer tcp(int port, const std::string &address = std::string()) {
         HttpServer s;
         s.mode_ = Mode::TCP;
         s.port_ = port;
+        s.bind_address_ = address;
         return s;
     }
 
@@ -203,385 +254,211 @@ public:
     }
 
     ~HttpServer() {
-        if (server_socket_ >= 0) {
-            close(server_socket_);
+        for (int fd : listen_sockets_) {
+            close(fd);
         }
-        cleanup_uds();
-    }
-
-    bool start() {
-        switch (mode_) {
-        case Mode::TCP:
-            return start_tcp();
-        case Mode::UDS:
-            return start_uds();
+        // Only an instance that listened owns the socket file (the
+        // factories' temporaries never did), an inherited one only once
+        // this process took over, and after a hot restart it belongs to
+        // the successor.
+        if (!listen_sockets_.empty() && owns_socket_file_ &&
+            !g_draining.load(std::memory_order_relaxed)) {
+            cleanup_uds();
         }
-        return false;
     }
 
-    // ════════════════════════════════════════════════════════════════════
-    //  Streaming I/O event loop
-    //
-    //  The epoll loop owns ALL socket I/O.  Worker threads interact only
-    //  with in-memory buffers via ConnectionIO.  Neither request nor
-    //  response is fully buffered — data flows in BODY_CHUNK_SIZE chunks.
-    //
-    //  Per-connection state machine:
-    //    ReadingHeaders → Active → (closed)
-    //
-    //  In the Active state, the fd can have:
-    //    EPOLLIN  — body bytes still arriving from the client
-    //    EPOLLOUT — response bytes ready to send to the client
-    //    (both)   — simultaneous body reading and response writing
-    //    (none)   — worker processing, no I/O pending
-    //
-    //  A global eventfd is used for worker→epoll notification.  When a
-    //  worker enqueues response data or finishes, it writes to the
-    //  eventfd.  The epoll loop consumes the counter and scans active
-    //  connections for pending writes or finished workers.
-    // ════════════════════════════════════════════════════════════════════
+    // Configure persistent connections.  A timeout of 0 disables keep-alive
+    // (every response carries Connection: close); max_requests of 0 means
+    // no per-connection request limit.
+    void setKeepAlive(int timeout_secs, uint32_t max_requests) {
+        keepalive_timeout_ = timeout_secs;
+        max_keepalive_requests_ = max_requests;
+    }
 
-    void accept_connections(ThreadPool &pool) {
-        int epoll_fd = epoll_create1(0);
-        if (epoll_fd < 0) {
-            LOG_ERROR("Failed to create epoll fd: " << strerror(errno));
-            return;
-        }
+    // Per-phase connection timeouts in seconds (0 = none): finishing the
+    // request head, each stall while reading a request body, and each
+    // stall while the client is not reading the response.
+    void setTimeouts(int header_secs, int body_secs, int send_secs) {
+        header_timeout_ = header_secs;
+        body_timeout_ = body_secs;
+        send_timeout_ = send_secs;
+    }
 
-        // Create eventfd for worker→epoll notification.
-        int event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
-        if (event_fd < 0) {
-            LOG_ERROR("Failed to create eventfd: " << strerror(errno));
-            close(epoll_fd);
-            return;
-        }
+    // Run n event-loop reactors, one per core (see accept_connections()).
+    // 0 keeps the classic layout: one reactor, every request on the pool.
+    // Must be called before start().
+    void setReactors(size_t n) { num_reactors_ = n; }
 
-        // Make the server socket non-blocking so accept() won't block.
-        set_nonblocking(server_socket_);
-
-        // Register the server (listening) socket with epoll.
-        {
-            struct epoll_event ev{};
-            ev.events = EPOLLIN;
-            ev.data.fd = server_socket_;
-            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_socket_, &ev) < 0) {
-                LOG_ERROR("Failed to add server socket to epoll: " << strerror(errno));
-                close(event_fd);
-                close(epoll_fd);
-                return;
-            }
-        }
+    // Socket I/O backend used by the reactors.  Uring falls back to epoll
+    // if the kernel does not support it.  Must be called before start().
+    enum class IoBackend { Epoll, Uring };
+    void setIoBackend(IoBackend backend) { io_backend_ = backend; }
 
-        // Register eventfd with epoll.
-        {
-            struct epoll_event ev{};
-            ev.events = EPOLLIN;
-            ev.data.fd = event_fd;
-            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_fd, &ev) < 0) {
-                LOG_ERROR("Failed to add eventfd to epoll: " << strerror(errno));
-                close(event_fd);
-                close(epoll_fd);
-                return;
-            }
-        }
+    // Per-request body watermarks and response buffering limits.
+    void setConnectionLimits(const ConnectionLimits &limits) { limits_ = limits; }
 
-        // ── Per-connection state ────────────────────────────────────────
+    // Buffered body and response bytes, across all reactors, above which
+    // body reads are throttled and new connections shed (0 = unlimited).
+    void setMemoryBudget(size_t bytes) { memory_budget_ = bytes; }
 
-        enum class ConnState { ReadingHeaders, Active };
+    // Accept cleartext HTTP/2 (prior knowledge and Upgrade: h2c).
+    void setH2c(bool enabled) { h2c_ = enabled; }
 
-        struct ConnCtx {
-            ConnState state = ConnState::ReadingHeaders;
-            std::string header_buf;                    // accumulates header bytes
-            std::shared_ptr<ConnectionIO> conn_io;     // bridge to worker thread
-            bool body_complete = false;                // all body bytes received
-            uint32_t epoll_events = EPOLLIN;           // currently registered events
-        };
+    // Terminate TLS on this (TCP) listener.  TLS listeners always run on
+    // the epoll backend.  Must be called before start().
+    void setTls(std::shared_ptr<TlsContext> tls) { tls_ = std::move(tls); }
 
-        std::unordered_map<int, ConnCtx> connections;
-
-        // Helper: update epoll registration for a client fd.
-        auto update_epoll = [&](int fd, ConnCtx &ctx, uint32_t new_events) {
-            if (new_events == ctx.epoll_events) return;
-            if (new_events == 0) {
-                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
-            } else if (ctx.epoll_events == 0) {
-                struct epoll_event ev2{};
-                ev2.events = new_events;
-                ev2.data.fd = fd;
-                epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev2);
-            } else {
-                struct epoll_event ev2{};
-                ev2.events = new_events;
-                ev2.data.fd = fd;
-                epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev2);
-            }
-            ctx.epoll_events = new_events;
-        };
+    // Index into the allowed CPU list at which reactor pinning starts, so
+    // that the reactors of several listeners land on different cores.
+    void setFirstCpu(size_t index) { first_cpu_ = index; }
 
-        // Helper: tear down a connection (signal errors to worker, close fd).
-        auto close_conn = [&](int fd, ConnCtx &ctx) {
-            if (ctx.epoll_events) {
-                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
-                ctx.epoll_events = 0;
-            }
-            if (ctx.conn_io) {
-                ctx.conn_io->feedError();   // wake worker blocked in readBodyChunk()
-                ctx.conn_io->writeError();  // wake worker blocked in writeData()
-            }
-            close(fd);
-        };
+    // Seconds the reactors wait for open connections once draining.
+    void setDrainTimeout(int secs) { drain_timeout_ = secs; }
 
-        struct epoll_event events[MAX_EPOLL_EVENTS];
+    // Dispatch requests through \p queue (--class), which must feed the
+    // pool passed to accept_connections().
+    void setFairQueue(FairQueue *queue) { fair_queue_ = queue; }
 
-        while (!g_shutdown.load(std::memory_order_relaxed)) {
-            int nfds = epoll_wait(epoll_fd, events, MAX_EPOLL_EVENTS, 200 /*ms*/);
-            if (nfds < 0) {
-                if (errno == EINTR) continue;
-                if (g_shutdown.load(std::memory_order_relaxed)) break;
-                LOG_ERROR("epoll_wait error: " << strerror(errno));
-                break;
-            }
+    // Answer requests beyond \p limiter's limit with 503 on the reactor
+    // (--concurrency-limit).  One limiter per worker pool.
+    void setConcurrencyLimiter(ConcurrencyLimiter *limiter) { limiter_ = limiter; }
 
-            for (int i = 0; i < nfds; ++i) {
-                int fd = events[i].data.fd;
-                uint32_t ev = events[i].events;
-
-                // ── Server socket: accept new connections ──────────────
-                if (fd == server_socket_) {
-                    while (true) {
-                        sockaddr_storage client_addr{};
-                        socklen_t client_addrlen = sizeof(client_addr);
-                        int client_fd = accept(server_socket_,
-                                               reinterpret_cast<sockaddr *>(&client_addr),
-                                               &client_addrlen);
-                        if (client_fd < 0) {
-                            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
-                            if (g_shutdown.load(std::memory_order_relaxed)) break;
-                            LOG_ERROR("Accept error: " << strerror(errno));
-                            break;
-                        }
-                        LOG_INFO("Accepted new connection: fd " << client_fd);
-
-                        set_nonblocking(client_fd);
-
-                        struct epoll_event client_ev{};
-                        client_ev.events = EPOLLIN;
-                        client_ev.data.fd = client_fd;
-                        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &client_ev) < 0) {
-                            LOG_ERROR("Failed to add client socket to epoll: "
-                                      << strerror(errno));
-                            close(client_fd);
-                            continue;
-                        }
-
-                        connections[client_fd] = ConnCtx{};
-                    }
-                    continue;
-                }
+    // Hot restart: serve these listening sockets, received from the
+    // previous process, instead of binding new ones.  Must be called
+    // before start().
+    void adoptSockets(std::vector<int> fds) { adopted_ = std::move(fds); }
 
-                // ── Eventfd: worker signalled ──────────────────────────
-                if (fd == event_fd) {
-                    // Consume the counter.
-                    uint64_t val;
-                    ssize_t rr = ::read(event_fd, &val, sizeof(val));
-                    (void)rr;
-
-                    // Scan active connections for pending writes or finished workers.
-                    std::vector<int> to_close;
-                    for (auto &[cfd, cctx] : connections) {
-                        if (cctx.state != ConnState::Active) continue;
-                        if (!cctx.conn_io) continue;
-                        if (cctx.conn_io->hasError()) {
-                            to_close.push_back(cfd);
-                            continue;
-                        }
-                        if (cctx.conn_io->isFinished() && !cctx.conn_io->isWritePending()) {
-                            to_close.push_back(cfd);
-                            continue;
-                        }
-                        if (cctx.conn_io->isWritePending()) {
-                            uint32_t wanted = EPOLLOUT;
-                            if (!cctx.body_complete) wanted |= EPOLLIN;
-                            update_epoll(cfd, cctx, wanted);
-                        }
-                    }
-                    for (int cfd : to_close) {
-                        auto cit = connections.find(cfd);
-                        if (cit != connections.end()) {
-                            close_conn(cfd, cit->second);
-                            connections.erase(cit);
-                        }
-                    }
-                    continue;
-                }
+    // The listening sockets (for handing over to a successor).
+    const std::vector<int> &listenSockets() const { return listen_sockets_; }
 
-                // ── Client fd ─────────────────────────────────────────
-                auto it = connections.find(fd);
-                if (it == connections.end()) continue;
-                ConnCtx &ctx = it->second;
+    // Hot restart: the predecessor has let go of the adopted sockets, so
+    // their socket file is ours to remove at shutdown.
+    void claimSocketFile() { owns_socket_file_ = true; }
 
-                if (ev & (EPOLLERR | EPOLLHUP)) {
-                    close_conn(fd, ctx);
-                    connections.erase(it);
-                    continue;
-                }
+    // One reactor per listening socket, and at least as many as asked for.
+    size_t reactorCount() const {
+        return std::max(std::max<size_t>(num_reactors_, 1), listen_sockets_.size());
+    }
 
-                // ── EPOLLIN ───────────────────────────────────────────
-                if (ev & EPOLLIN) {
-                    char buf[BUFFER_SIZE];
-                    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    // "tcp:[ADDR:]PORT" or "unix:PATH", for log messages.
+    std::string describe() const {
+        if (mode_ == Mode::UDS) return "unix:" + uds_path_;
+        std::string name = "tcp:";
+        if (!bind_address_.empty()) name += bind_address_ + ":";
+        name += std::to_string(port_);
+        if (tls_) name += " (TLS)";
+        return name;
+    }
 
-                    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
-                        close_conn(fd, ctx);
-                        connections.erase(it);
-                        continue;
-                    }
+    bool start() {
+        switch (mode_) {
+        case Mode::TCP:
+            return start_tcp();
+        case Mode::UDS:
+            return start_uds();
+        }
+        return false;
+    }
 
-                    if (n == 0) {
-                        // Peer closed their write direction.
-                        if (ctx.state == ConnState::ReadingHeaders) {
-                            close_conn(fd, ctx);
-                            connections.erase(it);
-                            continue;
-                        }
-                        // Active state: signal EOF to body reader.
-                        if (!ctx.body_complete && ctx.conn_io) {
-                            ctx.conn_io->feedBody(nullptr, 0, true);
-                        }
-                        ctx.body_complete = true;
-                        uint32_t wanted = ctx.epoll_events & ~(uint32_t)EPOLLIN;
-                        update_epoll(fd, ctx, wanted);
-                    }
+    // ════════════════════════════════════════════════════════════════════
+    //  Streaming I/O event loops
+    //
+    //  Socket I/O is owned by one or more HttpReactor instances (see
+    //  http_reactor.h).  With the default of a single reactor, every
+    //  request is handed to a worker from the thread pool.  With
+    //  --reactors N, N reactors run side by side, one per core: TCP gets
+    //  one SO_REUSEPORT socket per reactor so the kernel spreads accepts,
+    //  while a Unix socket is shared by all reactors through
+    //  EPOLLEXCLUSIVE.  Each reactor then runs requests whose body has
+    //  already arrived directly on its own thread (and its own WASM VM
+    //  clone), using the pool only for requests that stream a body.
+    //
+    //  Each reactor drives its sockets with epoll, or with io_uring when
+    //  --io-backend=uring is given and the kernel supports it.
+    //
+    //  Before its event loop starts, every reactor that runs requests
+    //  inline creates its thread's VM clones, then calls on_running.
+    //
+    //  Reactor 0 runs on the calling thread; the call returns once every
+    //  reactor has observed the shutdown flag, or has drained.  Returns
+    //  false if the reactors could not be set up.
+    // ════════════════════════════════════════════════════════════════════
 
-                    if (n > 0) {
-                        if (ctx.state == ConnState::ReadingHeaders) {
-                            ctx.header_buf.append(buf, static_cast<size_t>(n));
-
-                            // Guard against oversized headers.
-                            if (ctx.header_buf.size() > MAX_HEADER_SIZE) {
-                                const char *resp =
-                                    "HTTP/1.1 431 Request Header Fields Too Large\r\n"
-                                    "Connection: close\r\nContent-Length: 0\r\n\r\n";
-                                ::send(fd, resp, strlen(resp), MSG_NOSIGNAL);
-                                close_conn(fd, ctx);
-                                connections.erase(it);
-                                continue;
-                            }
-
-                            // Check whether full headers have arrived.
-                            size_t hdr_end = ctx.header_buf.find("\r\n\r\n");
-                            if (hdr_end != std::string::npos) {
-                                hdr_end += 4;  // include the \r\n\r\n
-                                std::string header_data = ctx.header_buf.substr(0, hdr_end);
-                                std::string body_prefix = ctx.header_buf.substr(hdr_end);
-                                ctx.header_buf.clear();
-                                ctx.header_buf.shrink_to_fit();
-
-                                size_t content_length = extract_content_length(header_data);
-
-                                LOG_INFO("Received request: fd " << fd << ", content-length " << content_length);
-
-                                // Create the ConnectionIO bridge.
-                                auto conn_io = std::make_shared<ConnectionIO>(fd, event_fd);
-                                conn_io->setHeaderData(std::move(header_data),
-                                                       std::move(body_prefix),
-                                                       content_length);
-                                ctx.conn_io = conn_io;
-                                ctx.state = ConnState::Active;
-
-                                // Determine if the body is already complete.
-                                if (content_length == 0 ||
-                                    conn_io->bodyBytesReceived() >= content_length) {
-                                    ctx.body_complete = true;
-                                    update_epoll(fd, ctx, 0);  // idle until worker produces data
-                                } else {
-                                    ctx.body_complete = false;
-                                    // Keep EPOLLIN for body reading.
-                                }
-
-                                // Dispatch to worker thread pool.
-                                pool.submit([this, conn = std::move(conn_io)]() {
-                                    try {
-                                        handle_request(conn);
-                                    } catch (const std::exception &e) {
-                                        LOG_ERROR("Worker exception: " << e.what());
-                                        conn->setError();
-                                    } catch (...) {
-                                        LOG_ERROR("Worker unknown exception");
-                                        conn->setError();
-                                    }
-                                });
-                            }
-
-                        } else if (ctx.state == ConnState::Active && !ctx.body_complete) {
-                            // Feed body bytes to ConnectionIO.
-                            size_t received = ctx.conn_io->bodyBytesReceived();
-                            size_t cl = ctx.conn_io->contentLength();
-                            size_t remaining = (cl > received) ? (cl - received) : 0;
-                            size_t to_feed = std::min(static_cast<size_t>(n), remaining);
-                            bool eof = (to_feed >= remaining);
-                            ctx.conn_io->feedBody(buf, to_feed, eof);
-
-                            if (eof) {
-                                ctx.body_complete = true;
-                                uint32_t wanted = ctx.epoll_events & ~(uint32_t)EPOLLIN;
-                                update_epoll(fd, ctx, wanted);
-                            }
-                        }
-                    }
+    bool accept_connections(ThreadPool &pool, const std::function<void()> &on_running) {
+        HttpReactor::RequestHandler handler =
+            [this](const std::shared_ptr<ConnectionIO> &conn) {
+                try {
+                    handle_request(conn);
+                } catch (const std::exception &e) {
+                    LOG_ERROR("Worker exception: " << e.what());
+                    conn->setError();
+                } catch (...) {
+                    LOG_ERROR("Worker unknown exception");
+                    conn->setError();
                 }
+            };
 
-                // ── EPOLLOUT ──────────────────────────────────────────
-                if (ev & EPOLLOUT) {
-                    auto it2 = connections.find(fd);
-                    if (it2 == connections.end()) continue;
-                    ConnCtx &ctx2 = it2->second;
-                    if (!ctx2.conn_io) continue;
-
-                    std::string_view pending = ctx2.conn_io->pendingWriteData();
-                    if (pending.empty()) {
-                        if (ctx2.conn_io->isFinished()) {
-                            close_conn(fd, ctx2);
-                            connections.erase(it2);
-                        } else {
-                            uint32_t wanted = ctx2.body_complete ? 0 : EPOLLIN;
-                            update_epoll(fd, ctx2, wanted);
-                        }
-                        continue;
-                    }
-
-                    ssize_t sent = ::send(fd, pending.data(), pending.size(), MSG_NOSIGNAL);
-                    if (sent < 0) {
-                        if (errno != EAGAIN && errno != EWOULDBLOCK) {
-                            ctx2.conn_io->writeError();
-                            close_conn(fd, ctx2);
-                            connections.erase(it2);
-                        }
-                        continue;
-                    }
-
-                    ctx2.conn_io->advanceWrite(static_cast<size_t>(sent));
-
-                    if (!ctx2.conn_io->isWritePending()) {
-                        if (ctx2.conn_io->isFinished()) {
-                            close_conn(fd, ctx2);
-                            connections.erase(it2);
-                        } else {
-                            uint32_t wanted = ctx2.body_complete ? 0 : EPOLLIN;
-                            update_epoll(fd, ctx2, wanted);
-                        }
-                    }
+        size_t count = reactorCount();
+        std::vector<int> cpus = allowed_cpus();
+        if (tls_ && io_backend_ == IoBackend::Uring) {
+            LOG_INFO(describe() << ": TLS listeners use the epoll backend");
+            io_backend_ = IoBackend::Epoll;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            HttpReactor::Options opts;
+            opts.keepalive_timeout = keepalive_timeout_;
+            opts.max_keepalive_requests = max_keepalive_requests_;
+            opts.limits = limits_;
+            opts.memory_budget = memory_budget_;
+            opts.h2c = h2c_;
+            opts.tls = tls_;
+            opts.run_to_completion = (num_reactors_ > 0);
+            opts.shared_listener = (count > listen_sockets_.size());
+            opts.drain_timeout = drain_timeout_;
+            opts.header_timeout = header_timeout_;
+            opts.body_timeout = body_timeout_;
+            opts.send_timeout = send_timeout_;
+            opts.fair_queue = fair_queue_;
+            opts.limiter = limiter_;
+            if (num_reactors_ > 0 && !cpus.empty()) {
+                opts.cpu = cpus[(first_cpu_ + i) % cpus.size()];
+            }
+            int listen_fd = listen_sockets_[i % listen_sockets_.size()];
+            if (io_backend_ == IoBackend::Uring) {
+                auto reactor = std::make_shared<UringReactor>(listen_fd, opts, handler,
+                                                              pool, g_shutdown, g_draining);
+                if (reactor->init()) {
+                    reactors_.push_back(std::move(reactor));
+                    continue;
                 }
+                if (i > 0) return false;  // reactors must not mix backends
+                LOG_ERROR("io_uring backend unavailable, falling back to epoll");
+                io_backend_ = IoBackend::Epoll;
             }
+            reactors_.push_back(std::make_shared<EpollReactor>(listen_fd, opts, handler,
+                                                              pool, g_shutdown, g_draining));
+            if (!reactors_.back()->init()) return false;
+        }
+        LOG_INFO(describe() << ": I/O backend " << reactors_[0]->backendName());
+        if (num_reactors_ > 0) {
+            LOG_INFO(describe() << ": running " << count << " reactors"
+                     << (listen_sockets_.size() > 1 ? " (SO_REUSEPORT)" : " (shared listener)"));
         }
 
-        // Clean up remaining client connections.
-        for (auto &[fd, ctx] : connections) {
-            close_conn(fd, ctx);
+        bool inline_requests = num_reactors_ > 0;
+        auto run = [inline_requests, &on_running](HttpReactor *r) {
+            if (inline_requests) g_module_manager->warmThread();
+            on_running();
+            r->run();
+            if (inline_requests) WasmModuleManager::releaseThread();
+        };
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < count; ++i) {
+            threads.emplace_back(run, reactors_[i].get());
         }
-        connections.clear();
-        close(event_fd);
-        close(epoll_fd);
+        run(reactors_[0].get());
+        for (auto &t : threads) t.join();
+        return true;
     }
 
 private:
@@ -589,57 +466,77 @@ private:
 
     HttpServer() : mode_(Mode::TCP), port_(DEFAULT_PORT), sock_perm_(0666), server_socket_(-1) {}
 
-    // ── Helper: set a socket to non-blocking mode ───────────────────────
+    // ── Helper: CPUs this process may run on (for reactor pinning) ──────
 
-    static void set_nonblocking(int fd) {
-        int flags = fcntl(fd, F_GETFL, 0);
-        if (flags < 0) flags = 0;
-        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    static std::vector<int> allowed_cpus() {
+        std::vector<int> cpus;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int c = 0; c < CPU_SETSIZE; ++c) {
+                if (CPU_ISSET(c, &set)) cpus.push_back(c);
+            }
+        }
+        return cpus;
     }
 
     // ── TCP listener ────────────────────────────────────────────────────
 
+    // With more than one reactor, one SO_REUSEPORT socket is bound per
+    // reactor so the kernel load-balances new connections between them.
     bool start_tcp() {
-        server_socket_ = socket(AF_INET, SOCK_STREAM, 0);
-        if (server_socket_ < 0) {
-            LOG_ERROR("Failed to create TCP socket");
-            return false;
-        }
+        if (!adopted_.empty()) return adopt();
+        size_t count = std::max<size_t>(num_reactors_, 1);
+        for (size_t i = 0; i < count; ++i) {
+            int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd < 0) {
+                LOG_ERROR("Failed to create TCP socket");
+                return false;
+            }
+            listen_sockets_.push_back(fd);
 
-        int opt = 1;
-        if (setsockopt(server_socket_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-            LOG_ERROR("Failed to set socket options");
-            close(server_socket_);
-            return false;
-        }
+            int opt = 1;
+            if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0 ||
+                (count > 1 &&
+                 setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)) {
+                LOG_ERROR("Failed to set socket options");
+                return false;
+            }
 
-        sockaddr_in server_addr{};
-        server_addr.sin_family = AF_INET;
-        server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-        server_addr.sin_port = htons(port_);
+            sockaddr_in server_addr{};
+            server_addr.sin_family = AF_INET;
+            server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+            server_addr.sin_port = htons(port_);
+            if (!bind_address_.empty() &&
+                inet_pton(AF_INET, bind_address_.c_str(), &server_addr.sin_addr) != 1) {
+                LOG_ERROR("Invalid IPv4 listen address: " << bind_address_);
+                return false;
+            }
 
-        if (bind(server_socket_, reinterpret_cast<sockaddr *>(&server_addr),
-                 sizeof(server_addr)) < 0) {
-            LOG_ERROR("Failed to bind TCP socket to port " << port_);
-            close(server_socket_);
-            return false;
-        }
+            if (bind(fd, reinterpret_cast<sockaddr *>(&server_addr),
+                     sizeof(server_addr)) < 0) {
+                LOG_ERROR("Failed to bind TCP socket to " << describe()
+                          << ": " << strerror(errno));
+                return false;
+            }
 
-        if (listen(server_socket_, BACKLOG) < 0) {
-            LOG_ERROR("Failed to listen on TCP socket");
-            close(server_socket_);
-            return false;
+            if (listen(fd, BACKLOG) < 0) {
+                LOG_ERROR("Failed to listen on TCP socket");
+                return false;
+            }
         }
 
-        g_server_socket = server_socket_;
-        LOG_INFO("HTTP Server listening on TCP port " << port_);
+        server_socket_ = listen_sockets_.front();
+        LOG_INFO("HTTP Server listening on TCP " << (bind_address_.empty() ? "port " : bind_address_ + " port ")
+                 << port_);
         return true;
     }
 
     // ── Unix Domain Socket listener ─────────────────────────────────────
 
     bool start_uds() {
-        server_socket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (!adopted_.empty()) return adopt();
+        server_socket_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
         if (server_socket_ < 0) {
             LOG_ERROR("Failed to create Unix domain socket");
             return false;
@@ -698,12 +595,31 @@ private:
             return false;
         }
 
-        g_server_socket = server_socket_;
-        g_uds_path = uds_path_;
+        listen_sockets_.push_back(server_socket_);
         LOG_INFO("HTTP Server listening on Unix socket " << uds_path_);
         return true;
     }
 
+    // ── Listener inherited from the previous process (hot restart) ─────
+
+    // The sockets are already bound and listening; the socket file, if
+    // any, stays as it is.  With SO_REUSEPORT sockets, reactorCount()
+    // follows their number, so no accept queue is left unserved.
+    bool adopt() {
+        listen_sockets_ = std::move(adopted_);
+        adopted_.clear();
+        owns_socket_file_ = false;  // the predecessor still serves it
+        server_socket_ = listen_sockets_.front();
+        LOG_INFO("HTTP Server listening on " << describe() << " (" << listen_sockets_.size()
+                 << (listen_sockets_.size() == 1 ? " socket" : " sockets")
+                 << " taken over)");
+        if (listen_sockets_.size() > 1 && listen_sockets_.size() != std::max<size_t>(num_reactors_, 1)) {
+            LOG_INFO(describe() << ": running " << reactorCount()
+                     << " reactors to serve every inherited socket");
+        }
+        return true;
+    }
+
     void cleanup_uds() {
         if (!uds_path_.empty()) {
             ::unlink(uds_path_.c_str());
@@ -723,13 +639,10 @@ private:
     void handle_request(std::shared_ptr<ConnectionIO> conn) {
         HttpData http_data;
 
-        if (!parse_request(conn->headers(), http_data)) {
-            conn->setError();
-            return;
-        }
+        load_request(*conn, http_data);
 
         // Create a response sink for HTTP transport.
-        HttpResponseSink sink(conn.get());
+        HttpResponseSink sink(conn.get(), &http_data.request_headers);
 
         // Create a filter context for this request.
         uint32_t ctx_id = g_next_context_id.fetch_add(1);
@@ -740,35 +653,64 @@ private:
         // Execute request header phase via filter chain.
         // end_of_stream is false when the request has a body, so that
         // WASM filters know to expect onRequestBody() calls.
-        bool has_body = (conn->contentLength() > 0);
+        bool has_body = conn->hasBody();
         LOG_INFO("\n[HTTP] Processing request in filter chain...");
         filter_ctx.onRequestHeaders(/*end_of_stream=*/!has_body);
 
+        // Write the filter's local response.  A connection whose request
+        // body was not fully consumed cannot be reused for another request.
+        size_t content_length = conn->contentLength();
+        size_t body_consumed = 0;
+        bool body_done = !has_body;
+        auto send_local_response = [&]() {
+            if (!body_done) conn->disableKeepAlive();
+            std::string head = build_local_response_head(http_data, conn->keepAlive());
+            std::string body;
+            if (http_data.method != "HEAD") body = std::move(http_data.local_response_body);
+            conn->writeData(std::move(head), std::move(body));
+            conn->finish();
+        };
+
         // If the WASM filter sent a local response, write it and return.
         if (http_data.has_local_response) {
             LOG_INFO("[HTTP] WASM filter sent local response, using it.");
-            std::string response = build_local_response(http_data);
-            write_chunked(conn, response);
-            conn->finish();
+            send_local_response();
             return;
         }
 
         // ── Stream request body in chunks via ConnectionIO ────────
-        size_t content_length = conn->contentLength();
-        LOG_INFO("Request has Content-Length: " << content_length);
-        if (content_length > 0) {
-            const std::string &prefix = conn->bodyPrefix();
-            size_t body_consumed = prefix.size();
+        // A chunked body or HTTP/2 stream has no length up front: it is read
+        // until the reactor reports its end, and its trailers come after it.
+        // Chunks are as large as the client's pace allows, between the
+        // delivery bounds, and never held back longer than their latency.
+        BodyDelivery delivery = g_body_delivery;
+        BodyDeliveryHint hint = filter_ctx.bodyDelivery();
+        if (hint.set) {
+            if (hint.min_chunk > 0) delivery.min_chunk = hint.min_chunk;
+            if (hint.max_chunk > 0) delivery.max_chunk = hint.max_chunk;
+            delivery.max_latency_ms = hint.max_latency_ms;
+        }
+        LOG_INFO("Request has Content-Length: " << content_length
+                 << (conn->lengthUnknown() ? " (length unknown)" : ""));
+        if (has_body) {
+            std::string_view prefix = conn->bodyPrefix();
+            body_consumed = prefix.size();
             LOG_INFO("Prefix size: " << body_consumed);
+            // A body the reactor pre-buffered reaches the filters in one
+            // call: the prefix is held and joined with the rest.
+            bool hold_prefix = false;
             if (!prefix.empty()) {
-                http_data.request_body = prefix;
-                filter_ctx.onRequestBody(body_consumed >= content_length);
+                body_done = !conn->lengthUnknown() && body_consumed >= content_length;
+                http_data.request_body.assign(prefix.data(), prefix.size());
+                hold_prefix = !body_done && conn->bodyReceived();
+                if (!hold_prefix) filter_ctx.onRequestBody(body_done);
             }
 
             LOG_INFO("Read: " << body_consumed << " / " << content_length);
-            while (body_consumed < content_length && !http_data.has_local_response) {
-                size_t want = std::min(content_length - body_consumed, BODY_CHUNK_SIZE);
-                ConnectionIO::BodyReadResult read_result = conn->readBodyChunk(want);
+            while (!body_done && !http_data.has_local_response) {
+                size_t want = delivery.max_chunk;
+                if (!conn->lengthUnknown()) want = std::min(content_length - body_consumed, want);
+                ConnectionIO::BodyReadResult read_result = conn->readBodyChunk(want, delivery);
                 if (read_result.status == ConnectionIO::BodyReadStatus::Error) {
                     LOG_ERROR("[HTTP] Request body read error after " << body_consumed
                               << " / " << content_length << " bytes");
@@ -781,17 +723,26 @@ private:
                     conn->setError();
                     return;
                 }
-                if (read_result.data.empty()) {
+                body_done = conn->lengthUnknown()
+                                ? read_result.status == ConnectionIO::BodyReadStatus::Complete
+                                : body_consumed + read_result.data.size() >= content_length;
+                if (read_result.data.empty() && !body_done) {
                     LOG_ERROR("[HTTP] Request body read returned no data before completion");
                     conn->setError();
                     return;
                 }
                 body_consumed += read_result.data.size();
-                http_data.request_body = std::move(read_result.data);
+                if (hold_prefix) {
+                    http_data.request_body += read_result.data;
+                    hold_prefix = false;
+                } else {
+                    http_data.request_body = std::move(read_result.data);
+                }
                 LOG_INFO("Read: " << body_consumed << " / " << content_length);
-                filter_ctx.onRequestBody(body_consumed >= content_length);
+                filter_ctx.onRequestBody(body_done);
             }
         }
+        if (body_done) http_data.request_trailers = conn->trailers();
 
         if (!http_data.has_local_response) {
             filter_ctx.onRequestTrailers();
@@ -799,9 +750,7 @@ private:
 
         // Check again after body processing.
         if (http_data.has_local_response) {
-            std::string response = build_local_response(http_data);
-            write_chunked(conn, response);
-            conn->finish();
+            send_local_response();
             return;
         }
 
@@ -828,7 +777,8 @@ private:
         // Populate default response headers.
         http_data.response_headers.clear();
         http_data.response_headers.emplace_back("Content-Type", "text/plain");
-        http_data.response_headers.emplace_back("Connection", "close");
+        http_data.response_headers.emplace_back("Connection",
+                                                conn->keepAlive() ? "keep-alive" : "close");
 
         // Execute response phases — WASM modules can modify response headers,
         // response body bytes, or replace the response entirely.
@@ -844,9 +794,7 @@ private:
                 return;
             }
             filter_ctx.onDone();
-            std::string response = build_local_response(http_data);
-            write_chunked(conn, response);
-            conn->finish();
+            send_local_response();
             return;
         }
 
@@ -864,66 +812,53 @@ private:
 
         filter_ctx.onDone();
 
-        // Ensure Content-Length is correct after filter chain.
+        // Compress the body if the client accepts it (the filters may have
+        // removed Accept-Encoding), then make Content-Length match.
         HeaderPairs &hdrs = http_data.response_headers;
+        ResponseCompression &compression = response_compression();
+        compression.compressBody(
+            compression.negotiate(http_utils::header_value(http_data.request_headers,
+                                                           "Accept-Encoding")),
+            200, hdrs, http_data.response_body);
         hdrs.erase(std::remove_if(hdrs.begin(), hdrs.end(),
             [](const std::pair<std::string, std::string> &p) {
                 return header_name_eq(p.first, "Content-Length");
             }), hdrs.end());
         hdrs.emplace_back("Content-Length", std::to_string(http_data.response_body.length()));
 
-        // Write response headers.
+        // Queue headers and body as two segments; the reactor sends them
+        // in one gather write.  A HEAD response carries the Content-Length
+        // but no body, or it would corrupt the next response on a
+        // persistent connection.
         std::string hdr_str = http_utils::serialize_headers(200, hdrs);
-        conn->writeData(hdr_str);
-
-        // Write response body in chunks.
-        write_chunked(conn, http_data.response_body);
+        std::string body;
+        if (http_data.method != "HEAD") body = std::move(http_data.response_body);
+        conn->writeData(std::move(hdr_str), std::move(body));
 
         conn->finish();
     }
 
-    bool parse_request(const std::string &request, HttpData &http_data) {
-        std::istringstream iss(request);
-        iss >> http_data.method >> http_data.path >> http_data.version;
-
-        if (http_data.method.empty() || http_data.path.empty()) {
-            return false;
-        }
-
-        // Parse headers (simplified).
-        std::string line;
-        // Consume the remainder of the request line.
-        std::getline(iss, line);
-        while (std::getline(iss, line) && !line.empty() && line != "\r") {
-            size_t colon = line.find(':');
-            if (colon != std::string::npos) {
-                std::string header_name = line.substr(0, colon);
-                std::string header_value = line.substr(colon + 1);
-                // Trim leading whitespace (OWS per RFC 7230)
-                size_t start = header_value.find_first_not_of(" \t");
-                if (start != std::string::npos) {
-                    header_value = header_value.substr(start);
-                } else {
-                    header_value.clear();
-                }
-                // Remove trailing \r if present
-                if (!header_value.empty() && header_value.back() == '\r') {
-                    header_value.pop_back();
-                }
-                http_data.request_headers.emplace_back(std::move(header_name),
-                                                       std::move(header_value));
-            }
+    // Copy the request head the reactor parsed into the filter's HttpData.
+    static void load_request(const ConnectionIO &conn, HttpData &http_data) {
+        const ParsedRequest &req = conn.request();
+        http_data.method = conn.field(req.method);
+        http_data.path = conn.field(req.target);
+        http_data.version = conn.field(req.version);
+        if (conn.secure()) http_data.scheme = "https";
+        http_data.request_headers.reserve(req.headers.size());
+        for (const HttpHeaderSpan &h : req.headers) {
+            http_data.request_headers.emplace_back(std::string(conn.field(h.name)),
+                                                   std::string(conn.field(h.value)));
         }
-
-        return true;
     }
 
-    // Build an HTTP response from the WASM filter's local response.
-    std::string build_local_response(const HttpData &http_data) {
+    // Build the status line and headers for the WASM filter's local
+    // response (the body is http_data.local_response_body).
+    std::string build_local_response_head(const HttpData &http_data, bool keep_alive) {
         HeaderPairs headers;
         headers.emplace_back("Content-Type", "text/plain");
         headers.emplace_back("X-Powered-By", "lswasm/proxy-wasm");
-        headers.emplace_back("Connection", "close");
+        headers.emplace_back("Connection", keep_alive ? "keep-alive" : "close");
         // Merge additional headers from sendLocalResponse.
         for (const std::pair<std::string, std::string> &h :
              http_data.local_response_additional_headers) {
@@ -937,8 +872,7 @@ private:
         headers.emplace_back("Content-Length",
                              std::to_string(http_data.local_response_body.length()));
 
-        std::string hdr_str = http_utils::serialize_headers(http_data.local_response_code, headers);
-        return hdr_str + http_data.local_response_body;
+        return http_utils::serialize_headers(http_data.local_response_code, headers);
     }
 
     // Build the diagnostic response body.
@@ -988,35 +922,51 @@ private:
         body += "  • proxy-wasm-cpp-sdk\n";
         body += "  • proxy-wasm-spec\n";
 
-        return body;
-    }
+        body += "\nServer Statistics:\n";
+        body += server_stats().format();
+        body += request_classes().format();
 
-    // Write a string through ConnectionIO in BODY_CHUNK_SIZE chunks.
-    static void write_chunked(std::shared_ptr<ConnectionIO> &conn,
-                              const std::string &data) {
-        size_t offset = 0;
-        while (offset < data.size()) {
-            size_t chunk = std::min(data.size() - offset, BODY_CHUNK_SIZE);
-            conn->writeData(data.substr(offset, chunk));
-            offset += chunk;
-        }
+        return body;
     }
 
     Mode mode_;
     int port_;
+    std::string bind_address_;          // TCP only; empty = INADDR_ANY
     std::string uds_path_;
     mode_t sock_perm_;
     int server_socket_;
+    std::vector<int> listen_sockets_;   // server_socket_ plus SO_REUSEPORT siblings
+    std::vector<int> adopted_;          // hot restart: sockets to serve instead of binding
+    bool owns_socket_file_ = true;      // false for adopted sockets until claimSocketFile()
+    int drain_timeout_ = DEFAULT_DRAIN_TIMEOUT;
+    FairQueue *fair_queue_ = nullptr;
+    ConcurrencyLimiter *limiter_ = nullptr;
+    size_t num_reactors_ = 0;
+    size_t first_cpu_ = 0;
+    IoBackend io_backend_ = IoBackend::Epoll;
+    ConnectionLimits limits_;
+    size_t memory_budget_ = DEFAULT_MEMORY_BUDGET;
+    bool h2c_ = true;
+    std::shared_ptr<TlsContext> tls_;
+    // Kept until the server is destroyed: workers still draining after
+    // shutdown may notify their reactor.
+    std::vector<std::shared_ptr<HttpReactor>> reactors_;
+    int keepalive_timeout_ = DEFAULT_KEEPALIVE_TIMEOUT;
+    uint32_t max_keepalive_requests_ = DEFAULT_MAX_KEEPALIVE_REQUESTS;
+    int header_timeout_ = DEFAULT_HEADER_TIMEOUT;
+    int body_timeout_ = DEFAULT_BODY_TIMEOUT;
+    int send_timeout_ = DEFAULT_SEND_TIMEOUT;
 };
 
 // Signal handler (only async-signal-safe operations)
 void signal_handler(int sig) {
     if (sig == SIGINT || sig == SIGTERM) {
+        // The reactors' timer tick notices the flag.  Never shutdown() a
+        // listening socket here: a hot restart shares it with another
+        // process.
         g_shutdown.store(true, std::memory_order_relaxed);
-        // Shutdown the listening socket to unblock accept()
-        if (g_server_socket >= 0) {
-            shutdown(g_server_socket, SHUT_RDWR);
-        }
+    } else if (sig == SIGUSR2) {
+        HotRestart::requestRestart();
     }
 }
 
@@ -1297,29 +1247,244 @@ int run_lsapi_loop(const std::string &wasm_module_path,
 
 } // anonymous namespace
 
+// ═══════════════════════════════════════════════════════════════════════
+//  Listener specifications (--listen)
+//
+//  SPEC is "tcp:[ADDR:]PORT" or "unix:PATH", optionally followed by
+//  comma-separated settings:
+//    workers=N          dedicated worker pool of N threads (default: the
+//                       shared --workers pool)
+//    reactors=N|auto    reactor count for this listener (default: --reactors)
+//    perm=MODE          UDS file permissions in octal (default: --sock-perm)
+//    prebuffer=BYTES    request body collected before dispatch (default:
+//                       --body-prebuffer)
+//    tls                terminate TLS (tcp only; --tls-cert / --tls-key)
+//  --port and --uds are shorthands for "tcp:PORT" and "unix:PATH".
+// ═══════════════════════════════════════════════════════════════════════
+
+namespace {
+
+struct ListenerSpec {
+    bool uds = false;
+    std::string path;         // unix
+    std::string address;      // tcp; empty = all interfaces
+    int port = 0;             // tcp
+    bool perm_set = false;
+    mode_t perm = 0666;
+    size_t workers = 0;       // 0 = shared pool
+    bool reactors_set = false;
+    size_t reactors = 0;
+    bool tls = false;
+    bool prebuffer_set = false;
+    size_t prebuffer = 0;
+};
+
+bool parse_unsigned(const std::string &text, int base, unsigned long max, unsigned long &out) {
+    if (text.empty()) return false;
+    char *end = nullptr;
+    errno = 0;
+    out = std::strtoul(text.c_str(), &end, base);
+    return errno == 0 && *end == '\0' && text[0] != '-' && out <= max;
+}
+
+// Parse one --listen SPEC.  On failure returns false and sets \p error.
+bool parse_listener_spec(const std::string &spec, ListenerSpec &out, std::string &error) {
+    size_t comma = spec.find(',');
+    std::string endpoint = spec.substr(0, comma);
+    unsigned long n = 0;
+
+    if (endpoint.rfind("unix:", 0) == 0) {
+        out.uds = true;
+        out.path = endpoint.substr(5);
+        if (out.path.empty()) {
+            error = "missing socket path";
+            return false;
+        }
+    } else if (endpoint.rfind("tcp:", 0) == 0) {
+        std::string rest = endpoint.substr(4);
+        size_t colon = rest.rfind(':');
+        if (colon != std::string::npos) {
+            out.address = rest.substr(0, colon);
+            rest = rest.substr(colon + 1);
+            in_addr probe{};
+            if (inet_pton(AF_INET, out.address.c_str(), &probe) != 1) {
+                error = "invalid IPv4 address '" + out.address + "'";
+                return false;
+            }
+        }
+        if (!parse_unsigned(rest, 10, 65535, n) || n == 0) {
+            error = "invalid port '" + rest + "'";
+            return false;
+        }
+        out.port = static_cast<int>(n);
+    } else {
+        error = "expected tcp:[ADDR:]PORT or unix:PATH";
+        return false;
+    }
+
+    while (comma != std::string::npos) {
+        size_t next = spec.find(',', comma + 1);
+        std::string option = spec.substr(comma + 1, next == std::string::npos
+                                                        ? std::string::npos
+                                                        : next - comma - 1);
+        comma = next;
+        size_t eq = option.find('=');
+        std::string key = option.substr(0, eq);
+        std::string value = (eq == std::string::npos) ? std::string() : option.substr(eq + 1);
+        if (key == "workers" && parse_unsigned(value, 10, 4096, n)) {
+            out.workers = n;
+        } else if (key == "reactors" && value == "auto") {
+            out.reactors_set = true;
+            out.reactors = std::max(1u, std::thread::hardware_concurrency());
+        } else if (key == "reactors" && parse_unsigned(value, 10, 4096, n)) {
+            out.reactors_set = true;
+            out.reactors = n;
+        } else if (key == "prebuffer" && parse_unsigned(value, 10, ULONG_MAX, n)) {
+            out.prebuffer_set = true;
+            out.prebuffer = n;
+        } else if (key == "tls" && !out.uds && eq == std::string::npos) {
+            out.tls = true;
+        } else if (key == "perm" && out.uds && parse_unsigned(value, 8, 0777, n)) {
+            out.perm_set = true;
+            out.perm = static_cast<mode_t>(n);
+        } else {
+            error = "invalid setting '" + option + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+// ═══════════════════════════════════════════════════════════════════════
+//  Request classes (--class)
+//
+//  SPEC is "NAME:" followed by comma-separated settings:
+//    host=HOST          Host / :authority, "*.example.com" for a suffix
+//    path=PREFIX        request-target prefix
+//    body=yes|no        requests with / without a body
+//    weight=N           share of the workers relative to other classes
+//                       (default: 1)
+//    max=N              requests of the class on the workers at once
+//  A request takes the first class it matches, otherwise "default".
+// ═══════════════════════════════════════════════════════════════════════
+
+// Parse one --class SPEC.  On failure returns false and sets \p error.
+bool parse_class_spec(const std::string &spec, RequestClass &out, std::string &error) {
+    size_t colon = spec.find(':');
+    out.name = spec.substr(0, colon);
+    if (out.name.empty() || out.name == "default") {
+        error = "expected NAME:SETTINGS (NAME other than 'default')";
+        return false;
+    }
+    unsigned long n = 0;
+    size_t comma = colon;
+    while (comma != std::string::npos && comma + 1 < spec.size()) {
+        size_t next = spec.find(',', comma + 1);
+        std::string option = spec.substr(comma + 1, next == std::string::npos
+                                                        ? std::string::npos
+                                                        : next - comma - 1);
+        comma = next;
+        size_t eq = option.find('=');
+        std::string key = option.substr(0, eq);
+        std::string value = (eq == std::string::npos) ? std::string() : option.substr(eq + 1);
+        if (key == "host" && !value.empty()) {
+            out.host = value;
+        } else if (key == "path" && !value.empty()) {
+            out.path_prefix = value;
+        } else if (key == "body" && (value == "yes" || value == "no")) {
+            out.body = value == "yes" ? 1 : 0;
+        } else if (key == "weight" && parse_unsigned(value, 10, 1000, n) && n > 0) {
+            out.weight = static_cast<uint32_t>(n);
+        } else if (key == "max" && parse_unsigned(value, 10, 1000000, n)) {
+            out.max_in_flight = n;
+        } else {
+            error = "invalid setting '" + option + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // anonymous namespace
+
 // ═══════════════════════════════════════════════════════════════════════
 //  main()
 // ═══════════════════════════════════════════════════════════════════════
 
 int main(int argc, char *argv[]) {
-    int port = DEFAULT_PORT;
     std::string wasm_module_path;
-    std::string uds_path = DEFAULT_UDS_PATH;
+    std::vector<ListenerSpec> listeners;
     mode_t sock_perm = 0666;
     std::unordered_map<std::string, std::string> wasm_envs;
     bool debug = false;
-    bool port_specified = false;
     bool lsapi_mode = false;
     size_t num_workers = 0;  // 0 = auto (hardware_concurrency)
+    size_t fibers = 0;       // requests in flight per worker on fibers (0 = none)
+    size_t fiber_stack = DEFAULT_FIBER_STACK;
+    ThreadPool::Scaling scaling;  // --max-workers: elastic shared pool
+    size_t num_reactors = 0; // 0 = single reactor, all requests on the pool
+    bool io_uring = false;   // --io-backend=uring
+    ConnectionLimits limits;
+    size_t memory_budget = DEFAULT_MEMORY_BUDGET;
+    int keepalive_timeout = DEFAULT_KEEPALIVE_TIMEOUT;
+    uint32_t max_keepalive_requests = DEFAULT_MAX_KEEPALIVE_REQUESTS;
+    int header_timeout = DEFAULT_HEADER_TIMEOUT;
+    int body_timeout = DEFAULT_BODY_TIMEOUT;
+    int send_timeout = DEFAULT_SEND_TIMEOUT;
+    bool h2c = true;
+    std::string tls_cert;
+    std::string tls_key;
+    bool ktls = true;
+    std::string hot_restart_path;
+    int drain_timeout = DEFAULT_DRAIN_TIMEOUT;
+    std::vector<RequestClass> classes;
+    bool limit_auto = false;
+    size_t limit_fixed = 0;  // --concurrency-limit N (0 = no limit)
+    size_t limit_max = 0;    // 0 = DEFAULT_CONCURRENCY_HEADROOM x pool capacity
 
     // Parse command line arguments
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
-        if (arg == "--port" && i + 1 < argc) {
-            port = std::stoi(argv[++i]);
-            port_specified = true;
-        } else if (arg == "--uds" && i + 1 < argc) {
-            uds_path = argv[++i];
+        if ((arg == "--port" || arg == "--uds" || arg == "--listen") && i + 1 < argc) {
+            std::string spec = argv[++i];
+            if (arg == "--port") spec = "tcp:" + spec;
+            if (arg == "--uds") spec = "unix:" + spec;
+            ListenerSpec listener;
+            std::string error;
+            if (!parse_listener_spec(spec, listener, error)) {
+                LOG_ERROR("Invalid " << arg << " value '" << argv[i] << "': " << error);
+                return 1;
+            }
+            listeners.push_back(std::move(listener));
+        } else if (arg == "--class" && i + 1 < argc) {
+            RequestClass cls;
+            std::string error;
+            if (!parse_class_spec(argv[++i], cls, error)) {
+                LOG_ERROR("Invalid --class value '" << argv[i] << "': " << error);
+                return 1;
+            }
+            classes.push_back(std::move(cls));
+        } else if (arg == "--concurrency-limit" && i + 1 < argc) {
+            std::string val = argv[++i];
+            unsigned long n = 0;
+            limit_auto = val == "auto";
+            if (val == "off") {
+                limit_fixed = 0;
+            } else if (!limit_auto) {
+                if (!parse_unsigned(val, 10, 1000000, n) || n == 0) {
+                    LOG_ERROR("Invalid --concurrency-limit value (expected auto, off or N > 0): "
+                              << val);
+                    return 1;
+                }
+                limit_fixed = n;
+            }
+        } else if (arg == "--concurrency-max" && i + 1 < argc) {
+            unsigned long n = 0;
+            if (!parse_unsigned(argv[++i], 10, 1000000, n) || n == 0) {
+                LOG_ERROR("Invalid --concurrency-max value (expected N > 0): " << argv[i]);
+                return 1;
+            }
+            limit_max = n;
         } else if (arg == "--sock-perm" && i + 1 < argc) {
             const char *val = argv[++i];
             char *endptr = nullptr;
@@ -1344,6 +1509,130 @@ int main(int argc, char *argv[]) {
             }
         } else if (arg == "--workers" && i + 1 < argc) {
             num_workers = static_cast<size_t>(std::stoi(argv[++i]));
+        } else if (arg == "--max-workers" && i + 1 < argc) {
+            unsigned long n = 0;
+            if (!parse_unsigned(argv[++i], 10, 4096, n)) {
+                LOG_ERROR("Invalid --max-workers value (expected 0-4096): " << argv[i]);
+                return 1;
+            }
+            scaling.max_threads = n;
+        } else if (arg == "--worker-queue-target" && i + 1 < argc) {
+            unsigned long n = 0;
+            if (!parse_unsigned(argv[++i], 10, 60000, n) || n == 0) {
+                LOG_ERROR("Invalid --worker-queue-target value (expected 1-60000 ms): " << argv[i]);
+                return 1;
+            }
+            scaling.queue_target_ms = static_cast<uint32_t>(n);
+        } else if (arg == "--worker-idle-timeout" && i + 1 < argc) {
+            unsigned long n = 0;
+            if (!parse_unsigned(argv[++i], 10, 86400, n) || n == 0) {
+                LOG_ERROR("Invalid --worker-idle-timeout value (expected 1-86400 s): " << argv[i]);
+                return 1;
+            }
+            scaling.idle_timeout_s = static_cast<uint32_t>(n);
+        } else if (arg == "--fibers" && i + 1 < argc) {
+            unsigned long n = 0;
+            if (!parse_unsigned(argv[++i], 10, 65536, n)) {
+                LOG_ERROR("Invalid --fibers value (expected 0-65536): " << argv[i]);
+                return 1;
+            }
+            fibers = n;
+        } else if (arg == "--fiber-stack" && i + 1 < argc) {
+            unsigned long n = 0;
+            if (!parse_unsigned(argv[++i], 10, 268435456, n) || n < 65536) {
+                LOG_ERROR("Invalid --fiber-stack value (expected 65536-268435456): " << argv[i]);
+                return 1;
+            }
+            fiber_stack = n;
+        } else if (arg == "--reactors" && i + 1 < argc) {
+            std::string val = argv[++i];
+            if (val == "auto") {
+                num_reactors = std::max(1u, std::thread::hardware_concurrency());
+            } else {
+                num_reactors = static_cast<size_t>(std::stoul(val));
+            }
+        } else if (arg == "--io-backend" && i + 1 < argc) {
+            std::string val = argv[++i];
+            if (val != "epoll" && val != "uring") {
+                LOG_ERROR("Invalid --io-backend value (expected epoll or uring): " << val);
+                return 1;
+            }
+            io_uring = (val == "uring");
+        } else if (arg == "--egress-depth" && i + 1 < argc) {
+            limits.egress_depth = static_cast<size_t>(std::stoul(argv[++i]));
+            if (limits.egress_depth == 0) {
+                LOG_ERROR("Invalid --egress-depth value (expected >= 1): " << argv[i]);
+                return 1;
+            }
+        } else if (arg == "--output-budget" && i + 1 < argc) {
+            limits.output_budget = static_cast<size_t>(std::stoul(argv[++i]));
+        } else if (arg == "--body-high-watermark" && i + 1 < argc) {
+            limits.body_high_watermark = static_cast<size_t>(std::stoul(argv[++i]));
+            if (limits.body_high_watermark == 0) {
+                LOG_ERROR("Invalid --body-high-watermark value (expected >= 1): " << argv[i]);
+                return 1;
+            }
+        } else if (arg == "--body-prebuffer" && i + 1 < argc) {
+            limits.body_prebuffer = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--body-low-watermark" && i + 1 < argc) {
+            limits.body_low_watermark = static_cast<size_t>(std::stoul(argv[++i]));
+        } else if ((arg == "--body-delivery-min" || arg == "--body-delivery-max") && i + 1 < argc) {
+            size_t &bytes = arg == "--body-delivery-min" ? g_body_delivery.min_chunk
+                                                          : g_body_delivery.max_chunk;
+            bytes = static_cast<size_t>(std::stoull(argv[++i]));
+            if (bytes == 0) {
+                LOG_ERROR("Invalid " << arg << " value (expected >= 1): " << argv[i]);
+                return 1;
+            }
+        } else if (arg == "--body-delivery-latency" && i + 1 < argc) {
+            g_body_delivery.max_latency_ms = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--memory-budget" && i + 1 < argc) {
+            memory_budget = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--keepalive-timeout" && i + 1 < argc) {
+            keepalive_timeout = std::stoi(argv[++i]);
+            if (keepalive_timeout < 0) {
+                LOG_ERROR("Invalid --keepalive-timeout value (expected >= 0): " << argv[i]);
+                return 1;
+            }
+        } else if (arg == "--max-keepalive-requests" && i + 1 < argc) {
+            max_keepalive_requests = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if ((arg == "--header-timeout" || arg == "--body-timeout" ||
+                    arg == "--send-timeout") && i + 1 < argc) {
+            int &secs = arg == "--header-timeout" ? header_timeout
+                      : arg == "--body-timeout"   ? body_timeout
+                                                  : send_timeout;
+            secs = std::stoi(argv[++i]);
+            if (secs < 0) {
+                LOG_ERROR("Invalid " << arg << " value (expected >= 0): " << argv[i]);
+                return 1;
+            }
+        } else if (arg == "--no-h2c") {
+            h2c = false;
+        } else if (arg == "--tls-cert" && i + 1 < argc) {
+            tls_cert = argv[++i];
+        } else if (arg == "--tls-key" && i + 1 < argc) {
+            tls_key = argv[++i];
+        } else if (arg == "--no-ktls") {
+            ktls = false;
+        } else if (arg == "--file-cache" && i + 1 < argc) {
+            file_cache().setCapacity(static_cast<size_t>(std::stoul(argv[++i])));
+        } else if (arg == "--no-compression") {
+            response_compression().setEnabled(false);
+        } else if (arg == "--compression-level" && i + 1 < argc) {
+            int level = std::stoi(argv[++i]);
+            if (level < 1 || level > 9) {
+                LOG_ERROR("Invalid --compression-level value (expected 1-9): " << argv[i]);
+                return 1;
+            }
+            response_compression().setLevel(level);
+        } else if (arg == "--hot-restart" && i + 1 < argc) {
+            hot_restart_path = argv[++i];
+        } else if (arg == "--drain-timeout" && i + 1 < argc) {
+            drain_timeout = std::stoi(argv[++i]);
+            if (drain_timeout < 0) {
+                LOG_ERROR("Invalid --drain-timeout value (expected >= 0): " << argv[i]);
+                return 1;
+            }
         } else if (arg == "--lsapi") {
             lsapi_mode = true;
         } else if (arg == "--body-pacifier") {
@@ -1358,30 +1647,126 @@ int main(int argc, char *argv[]) {
                       << " — WASM HTTP Proxy Server with Proxy-WASM Support\n";
             std::cout << "Usage: " << argv[0] << " --module <path> [options]\n";
             std::cout << "Options:\n";
-            std::cout << "  --port PORT      : Listen on TCP port (instead of UDS)\n";
-            std::cout << "  --uds PATH       : Listen on Unix domain socket (default: "
-                      << DEFAULT_UDS_PATH << ")\n";
+            std::cout << "  --port PORT      : Listen on TCP port (same as --listen tcp:PORT)\n";
+            std::cout << "  --uds PATH       : Listen on Unix domain socket (same as --listen unix:PATH)\n";
+            std::cout << "  --listen SPEC    : Add a listener (repeatable).  SPEC is tcp:[ADDR:]PORT or\n"
+                      << "                     unix:PATH, optionally followed by ,workers=N (dedicated\n"
+                      << "                     worker pool), ,reactors=N|auto, ,prebuffer=BYTES, for\n"
+                      << "                     unix ,perm=MODE and, for tcp, ,tls (needs --tls-cert\n"
+                      << "                     and --tls-key)\n";
             std::cout << "  --sock-perm MODE : Set UDS file permissions in octal (default: 0666)\n";
             std::cout << "  --module PATH    : Load WASM filter module (required)\n";
             std::cout << "  --env KEY=VALUE  : Set environment variable for WASM module (repeatable)\n";
             std::cout << "  --workers N      : Number of worker threads (default: hardware_concurrency)\n";
+            std::cout << "  --max-workers N  : Let the --workers pool grow to N threads while requests\n"
+                      << "                     wait for a worker (default: 0 = fixed size)\n";
+            std::cout << "  --worker-queue-target MS : Queue wait that adds a worker (default: "
+                      << DEFAULT_WORKER_QUEUE_TARGET << ")\n";
+            std::cout << "  --worker-idle-timeout SECS : Idle time after which an added worker exits\n"
+                      << "                     (default: " << DEFAULT_WORKER_IDLE_TIMEOUT << ")\n";
+            std::cout << "  --fibers N       : Run up to N requests per worker on fibers, so requests\n"
+                      << "                     waiting for body data do not hold a thread (default: 0 =\n"
+                      << "                     one request per worker thread)\n";
+            std::cout << "  --fiber-stack BYTES : Stack reserved per fiber (default: " << DEFAULT_FIBER_STACK
+                      << ")\n";
+            std::cout << "  --class NAME:SPEC : Schedule matching requests as class NAME (repeatable).\n"
+                      << "                     SPEC is comma-separated host=HOST|*.DOMAIN,\n"
+                      << "                     path=PREFIX, body=yes|no, weight=N (default: "
+                      << DEFAULT_CLASS_WEIGHT << ") and max=N\n"
+                      << "                     (concurrent requests); classes share the workers by\n"
+                      << "                     weight, unmatched requests form class 'default'\n";
+            std::cout << "  --concurrency-limit auto|N|off : Answer requests beyond a limit on the\n"
+                      << "                     requests in flight per worker pool with 503 from the\n"
+                      << "                     reactor; auto adapts the limit to measured latency\n"
+                      << "                     (default: off)\n";
+            std::cout << "  --concurrency-max N : Ceiling of the auto limit (default: "
+                      << DEFAULT_CONCURRENCY_HEADROOM << " x workers x fibers)\n";
+            std::cout << "  --reactors N|auto : Run N per-core event loops that execute requests inline\n"
+                      << "                     (default: 0 = one event loop, all requests on workers)\n";
+            std::cout << "  --io-backend epoll|uring : Socket I/O backend (default: epoll; uring falls\n"
+                      << "                     back to epoll if the kernel lacks support)\n";
+            std::cout << "  --egress-depth N : Response segments queued in memory per request before\n"
+                      << "                     the response spills (default: " << DEFAULT_EGRESS_DEPTH << ")\n";
+            std::cout << "  --output-budget BYTES : Response bytes queued in memory per request before\n"
+                      << "                     the rest spills to a memory file (default: "
+                      << DEFAULT_OUTPUT_BUDGET << ")\n";
+            std::cout << "  --body-high-watermark BYTES : Request body bytes buffered per request before\n"
+                      << "                     reading pauses (default: " << DEFAULT_BODY_HIGH_WATERMARK << ")\n";
+            std::cout << "  --body-low-watermark BYTES : Buffered body level at which reading resumes\n"
+                      << "                     (default: " << DEFAULT_BODY_LOW_WATERMARK << ")\n";
+            std::cout << "  --body-prebuffer BYTES : Collect request bodies up to BYTES before running the\n"
+                      << "                     filters, so they arrive in one piece (default: "
+                      << DEFAULT_BODY_PREBUFFER << ", 0 = stream every body)\n";
+            std::cout << "  --body-delivery-min BYTES : Buffered body bytes that are passed to the filters\n"
+                      << "                     at once (default: " << DEFAULT_BODY_DELIVERY_MIN << ")\n";
+            std::cout << "  --body-delivery-max BYTES : Largest body chunk per onRequestBody (default: "
+                      << DEFAULT_BODY_DELIVERY_MAX << ")\n";
+            std::cout << "  --body-delivery-latency MS : Longest a smaller body chunk waits for more data\n"
+                      << "                     (default: " << DEFAULT_BODY_DELIVERY_LATENCY
+                      << ", 0 = pass on whatever has arrived)\n";
+            std::cout << "  --memory-budget BYTES : Buffered body and response bytes, all connections,\n"
+                      << "                     above which body reads are throttled and new connections\n"
+                      << "                     get 503 (default: " << DEFAULT_MEMORY_BUDGET
+                      << ", 0 = unlimited)\n";
+            std::cout << "  --keepalive-timeout SECS : Close idle persistent connections after SECS (default: "
+                      << DEFAULT_KEEPALIVE_TIMEOUT << ", 0 disables keep-alive)\n";
+            std::cout << "  --max-keepalive-requests N : Requests served per connection (default: "
+                      << DEFAULT_MAX_KEEPALIVE_REQUESTS << ", 0 = unlimited)\n";
+            std::cout << "  --header-timeout SECS : Close a connection (408) that has not sent a complete\n"
+                      << "                     request head after SECS (default: " << DEFAULT_HEADER_TIMEOUT
+                      << ", 0 = none)\n";
+            std::cout << "  --body-timeout SECS : Close a connection whose request body stalls for SECS\n"
+                      << "                     (default: " << DEFAULT_BODY_TIMEOUT << ", 0 = none)\n";
+            std::cout << "  --send-timeout SECS : Close a connection that reads none of its response for\n"
+                      << "                     SECS (default: " << DEFAULT_SEND_TIMEOUT << ", 0 = none)\n";
+            std::cout << "  --no-h2c         : Do not accept cleartext HTTP/2 (prior knowledge or\n"
+                      << "                     Upgrade: h2c)\n";
+            std::cout << "  --tls-cert FILE  : PEM certificate chain for TLS listeners\n";
+            std::cout << "  --tls-key FILE   : PEM private key for TLS listeners\n";
+            std::cout << "  --no-ktls        : Keep TLS record processing in user space (no kernel TLS)\n";
+            std::cout << "  --file-cache N   : Open files kept for lswasm_send_file responses (default: "
+                      << DEFAULT_FILE_CACHE_ENTRIES << ", 0 disables the cache)\n";
+            std::cout << "  --no-compression : Send response bodies as the filters produce them, never\n"
+                      << "                     gzip/deflate"
+#ifdef LSWASM_HAVE_ZSTD
+                      << "/zstd"
+#endif
+                      << "-encoded by the host\n";
+            std::cout << "  --compression-level N : gzip/deflate level, 1 (fastest) to 9 (smallest)\n"
+                      << "                     (default: " << DEFAULT_COMPRESSION_LEVEL << ")\n";
+            std::cout << "  --hot-restart PATH : Control socket for zero-downtime restarts: a process\n"
+                      << "                     started with the same PATH takes over the listeners of\n"
+                      << "                     the one running; SIGUSR2 re-executes the binary to do so\n";
+            std::cout << "  --drain-timeout SECS : Seconds a replaced process lets its open connections\n"
+                      << "                     finish (default: " << DEFAULT_DRAIN_TIMEOUT << ")\n";
             std::cout << "  --lsapi          : Use LSAPI transport (instead of HTTP)\n";
             std::cout << "  --body-pacifier  : Include diagnostic body in HTTP responses\n";
             std::cout << "  --debug          : Enable debug logging to "
                       << lswasm_log::LOG_PATH << "\n";
             std::cout << "  --version        : Show version number\n";
             std::cout << "  --help           : Show this help message\n";
-            std::cout << "\nBy default, listens on UDS at " << DEFAULT_UDS_PATH << ".\n";
-            std::cout << "Use --port to listen on TCP instead. "
-                      << "When both --port and --uds are given, only --uds is used.\n";
+            std::cout << "\nWithout --port, --uds or --listen, listens on UDS at "
+                      << DEFAULT_UDS_PATH << ".\n";
+            std::cout << "Listeners without their own workers= setting share the --workers pool.\n";
             std::cout << "Use --lsapi for LSAPI transport mode (used by LiteSpeed web server).\n";
             return 0;
         }
     }
 
     // Validate --lsapi mutual exclusion with HTTP-only options.
-    if (lsapi_mode && port_specified) {
-        std::cerr << "Error: --lsapi and --port are mutually exclusive.\n";
+    if (lsapi_mode && std::any_of(listeners.begin(), listeners.end(),
+                                  [](const ListenerSpec &l) { return !l.uds; })) {
+        std::cerr << "Error: --lsapi and TCP listeners (--port, --listen tcp:) are mutually exclusive.\n";
+        return 1;
+    }
+    if (lsapi_mode && !hot_restart_path.empty()) {
+        std::cerr << "Error: --hot-restart applies to the HTTP transport only.\n";
+        return 1;
+    }
+
+    // Reads resume below the low watermark, so it must sit under the high one.
+    if (limits.body_low_watermark >= limits.body_high_watermark) {
+        std::cerr << "Error: --body-low-watermark must be below --body-high-watermark.\n";
         return 1;
     }
 
@@ -1423,6 +1808,10 @@ int main(int argc, char *argv[]) {
         sa.sa_flags = 0;  // No SA_RESTART – we want epoll_wait/accept to return EINTR.
         sigaction(SIGINT, &sa, nullptr);
         sigaction(SIGTERM, &sa, nullptr);
+        if (!hot_restart_path.empty()) sigaction(SIGUSR2, &sa, nullptr);
+        // OpenSSL writes TLS records with write(), which has no
+        // MSG_NOSIGNAL; a vanished client must not kill the process.
+        signal(SIGPIPE, SIG_IGN);
     }
 
     // ── Branch on transport mode ──────────────────────────────────────────
@@ -1459,51 +1848,245 @@ int main(int argc, char *argv[]) {
     }
 
     // ── HTTP transport mode (default) ────────────────────────────────────
-    // Create thread pool for worker threads.
-    ThreadPool pool(num_workers);
-    LOG_INFO("Thread pool started with " << pool.size() << " workers");
+    if (listeners.empty()) {
+        ListenerSpec listener;
+        listener.uds = true;
+        listener.path = DEFAULT_UDS_PATH;
+        listeners.push_back(std::move(listener));
+    }
 
-    try {
-        // Create server: default to UDS; use TCP only if --port was explicitly
-        // given without a custom --uds override.
-        std::unique_ptr<HttpServer> server;
-        bool explicit_uds = (uds_path != DEFAULT_UDS_PATH);
-        if (explicit_uds || !port_specified) {
-            server = std::make_unique<HttpServer>(HttpServer::uds(uds_path, sock_perm));
-        } else {
-            server = std::make_unique<HttpServer>(HttpServer::tcp(port));
+    // One TLS context for every TLS listener, so sessions resume on any
+    // listener and any reactor.
+    std::shared_ptr<TlsContext> tls_context;
+    if (std::any_of(listeners.begin(), listeners.end(),
+                    [](const ListenerSpec &l) { return l.tls; })) {
+        if (tls_cert.empty() || tls_key.empty()) {
+            std::cerr << "Error: TLS listeners need --tls-cert and --tls-key.\n";
+            return 1;
+        }
+        std::string error;
+        tls_context = TlsContext::create(tls_cert, tls_key, ktls, h2c, error);
+        if (!tls_context) {
+            LOG_ERROR("TLS setup failed: " << error);
+            std::cerr << "Error: TLS setup failed: " << error << "\n";
+            return 1;
         }
+        LOG_INFO("TLS certificate " << tls_cert << (ktls ? ", kTLS enabled" : ", kTLS disabled"));
+    }
 
-        if (!server->start()) {
-            LOG_ERROR("Failed to start HTTP server");
+    // Hot restart: take the listeners over from a running instance, if
+    // there is one.  Its modules were loaded above, so a module that fails
+    // to load never disturbs the running process.
+    std::unique_ptr<HotRestart> hot_restart;
+    if (!hot_restart_path.empty()) {
+        hot_restart = std::make_unique<HotRestart>(hot_restart_path,
+                                                   std::vector<std::string>(argv, argv + argc));
+        std::string error;
+        switch (hot_restart->takeOver(error)) {
+        case HotRestart::TakeOver::Done:
+            LOG_INFO("Hot restart: received listeners from the running instance");
+            break;
+        case HotRestart::TakeOver::None:
+            LOG_INFO("Hot restart: no running instance at " << hot_restart_path);
+            break;
+        case HotRestart::TakeOver::Failed:
+            LOG_ERROR("Hot restart: taking over from " << hot_restart_path << " failed: " << error);
+            std::cerr << "Error: hot restart failed: " << error << "\n";
             return 1;
         }
+    }
+
+    // Worker pools: one shared pool (--workers) for every listener without
+    // a workers= setting, plus one dedicated pool per listener that has one.
+    std::unique_ptr<ThreadPool> shared_pool;
+    std::vector<std::unique_ptr<ThreadPool>> dedicated_pools;
+    std::vector<ThreadPool *> listener_pools;
+    for (const ListenerSpec &spec : listeners) {
+        if (spec.workers > 0) {
+            dedicated_pools.push_back(std::make_unique<ThreadPool>(spec.workers, fibers, fiber_stack));
+            listener_pools.push_back(dedicated_pools.back().get());
+            continue;
+        }
+        if (!shared_pool) {
+            // Added workers create their VM clones before taking a request
+            // and drop them when they retire.
+            scaling.thread_start = []() { g_module_manager->warmThread(); };
+            scaling.thread_exit = []() { WasmModuleManager::releaseThread(); };
+            shared_pool = std::make_unique<ThreadPool>(num_workers, fibers, fiber_stack, scaling);
+            LOG_INFO("Thread pool started with " << shared_pool->size() << " workers"
+                     << (shared_pool->maxSize() > shared_pool->size()
+                             ? " (up to " + std::to_string(shared_pool->maxSize()) + ")" : "")
+                     << (fibers > 0 ? " (" + std::to_string(fibers) + " fibers each)" : ""));
+        }
+        listener_pools.push_back(shared_pool.get());
+    }
+    // Request classes: one fair queue in front of each pool.
+    std::vector<std::unique_ptr<FairQueue>> fair_queues;
+    std::unordered_map<ThreadPool *, FairQueue *> pool_queues;
+    if (!classes.empty()) {
+        request_classes().configure(std::move(classes));
+        for (ThreadPool *pool : listener_pools) {
+            if (pool_queues.count(pool)) continue;
+            fair_queues.push_back(std::make_unique<FairQueue>(*pool));
+            pool_queues[pool] = fair_queues.back().get();
+        }
+        LOG_INFO("Fair queuing across " << request_classes().size() << " request classes");
+    }
+    // Concurrency limits: one limiter per pool.  The adaptive limit never
+    // drops below what the pool runs at once, so shedding never idles a
+    // worker.
+    std::vector<std::unique_ptr<ConcurrencyLimiter>> limiters;
+    std::unordered_map<ThreadPool *, ConcurrencyLimiter *> pool_limiters;
+    for (ThreadPool *pool : listener_pools) {
+        if (!(limit_auto || limit_fixed > 0) || pool_limiters.count(pool)) continue;
+        size_t per_worker = std::max<size_t>(pool->fibersPerWorker(), 1);
+        size_t capacity = pool->size() * per_worker;
+        if (limit_auto) {
+            size_t max = limit_max ? limit_max
+                                   : pool->maxSize() * per_worker * DEFAULT_CONCURRENCY_HEADROOM;
+            limiters.push_back(std::make_unique<ConcurrencyLimiter>(capacity, capacity, max));
+        } else {
+            limiters.push_back(
+                std::make_unique<ConcurrencyLimiter>(limit_fixed, limit_fixed, limit_fixed));
+        }
+        pool_limiters[pool] = limiters.back().get();
+        LOG_INFO("Concurrency limit for a pool of " << pool->size() << " workers: "
+                 << (limit_auto ? "adaptive, starting at " : "")
+                 << limiters.back()->limit());
+    }
+    auto drain_pools = [&]() {
+        for (auto &q : fair_queues) q->drain();
+        for (auto &p : dedicated_pools) p->shutdown();
+        if (shared_pool) shared_pool->shutdown();
+    };
+
+    try {
+        std::vector<std::unique_ptr<HttpServer>> servers;
+        size_t next_cpu = 0;
+        for (size_t i = 0; i < listeners.size(); ++i) {
+            const ListenerSpec &spec = listeners[i];
+            auto server = std::make_unique<HttpServer>(
+                spec.uds ? HttpServer::uds(spec.path, spec.perm_set ? spec.perm : sock_perm)
+                         : HttpServer::tcp(spec.port, spec.address));
+
+            size_t reactors = spec.reactors_set ? spec.reactors : num_reactors;
+            server->setKeepAlive(keepalive_timeout, max_keepalive_requests);
+            server->setTimeouts(header_timeout, body_timeout, send_timeout);
+            server->setReactors(reactors);
+            server->setFirstCpu(next_cpu);
+            server->setIoBackend(io_uring ? HttpServer::IoBackend::Uring
+                                          : HttpServer::IoBackend::Epoll);
+            ConnectionLimits server_limits = limits;
+            if (spec.prebuffer_set) server_limits.body_prebuffer = spec.prebuffer;
+            server->setConnectionLimits(server_limits);
+            server->setMemoryBudget(memory_budget);
+            server->setH2c(h2c);
+            server->setDrainTimeout(drain_timeout);
+            if (!fair_queues.empty()) server->setFairQueue(pool_queues[listener_pools[i]]);
+            if (!limiters.empty()) server->setConcurrencyLimiter(pool_limiters[listener_pools[i]]);
+            if (spec.tls) server->setTls(tls_context);
+            if (hot_restart) server->adoptSockets(hot_restart->claim(server->describe()));
+            next_cpu += reactors;
+
+            if (!server->start()) {
+                LOG_ERROR("Failed to start HTTP server on " << server->describe());
+                drain_pools();
+                return 1;
+            }
+            if (spec.workers > 0) {
+                LOG_INFO(server->describe() << ": dedicated pool with "
+                         << listener_pools[i]->size() << " workers");
+            }
+            servers.push_back(std::move(server));
+        }
+        if (hot_restart) hot_restart->closeUnclaimed();
+
+        // Create every worker's VM clones before traffic arrives.
+        for (auto &p : dedicated_pools) {
+            p->runOnEachWorker([]() { g_module_manager->warmThread(); });
+        }
+        if (shared_pool) shared_pool->runOnEachWorker([]() { g_module_manager->warmThread(); });
 
         LOG_INFO("Server ready. Press Ctrl+C to stop.\n");
 
-        // Accept incoming connections (blocks until g_shutdown).
-        server->accept_connections(pool);
+        // Accept incoming connections (blocks until g_shutdown, or until
+        // the reactors have drained after a hot restart).  The first
+        // listener runs on this thread, the others on their own.  If any
+        // listener fails to set up its reactors, the whole server stops.
+        std::atomic<bool> failed{false};
+        std::mutex running_mutex;
+        std::condition_variable running_cv;
+        size_t reactors_pending = 0;
+        for (const auto &server : servers) reactors_pending += server->reactorCount();
+        auto on_running = [&]() {
+            std::lock_guard<std::mutex> lock(running_mutex);
+            if (--reactors_pending == 0) running_cv.notify_all();
+        };
+        auto serve = [&](size_t i) {
+            if (!servers[i]->accept_connections(*listener_pools[i], on_running)) {
+                LOG_ERROR("Failed to start reactors for " << servers[i]->describe());
+                failed.store(true, std::memory_order_relaxed);
+                g_shutdown.store(true, std::memory_order_relaxed);
+            }
+        };
 
-        // ── Shutdown sequence ────────────────────────────────────────────
-        // 1. Epoll loop has exited (g_shutdown is true).
-        // 2. Drain the thread pool — all in-flight requests finish.
-        LOG_INFO("Draining thread pool...");
-        pool.shutdown();
+        // Hot restart: once every reactor is warm and running, let the
+        // predecessor drain and serve the control socket ourselves.  When
+        // a successor takes over in turn, the reactors drain and the
+        // shutdown sequence below follows.
+        std::thread activator;
+        if (hot_restart) {
+            activator = std::thread([&]() {
+                {
+                    std::unique_lock<std::mutex> lock(running_mutex);
+                    while (reactors_pending > 0 && !g_shutdown.load(std::memory_order_relaxed)) {
+                        running_cv.wait_for(lock, std::chrono::milliseconds(HOT_RESTART_POLL_MS));
+                    }
+                    if (reactors_pending > 0) return;
+                }
+                HotRestart::Sockets sockets;
+                for (const auto &server : servers) {
+                    sockets[server->describe()] = server->listenSockets();
+                }
+                std::string error;
+                auto on_handoff = []() { g_draining.store(true, std::memory_order_relaxed); };
+                if (!hot_restart->activate(std::move(sockets), on_handoff, error)) {
+                    LOG_ERROR("Hot restart: control socket unavailable: " << error);
+                }
+                // The predecessor has been told to let go either way.
+                for (const auto &server : servers) server->claimSocketFile();
+            });
+        }
 
-        // 3. Destroy the HttpServer (closes the listening socket).
-        server.reset();
+        std::vector<std::thread> listener_threads;
+        for (size_t i = 1; i < servers.size(); ++i) {
+            listener_threads.emplace_back(serve, i);
+        }
+        serve(0);
+        for (auto &t : listener_threads) t.join();
+        if (activator.joinable()) activator.join();
+        if (hot_restart) hot_restart->stop();
+
+        // ── Shutdown sequence ────────────────────────────────────────────
+        // 1. Every reactor has exited (g_shutdown is true, or the reactors
+        //    drained after a successor took over).
+        // 2. Drain the thread pools — all in-flight requests finish.
+        LOG_INFO("Draining thread pools...");
+        drain_pools();
+        LOG_INFO("Server statistics:\n" << server_stats().format() << request_classes().format());
+
+        // 3. Destroy the HttpServers (closes the listening sockets, removes
+        //    the socket files unless a successor serves them, and releases
+        //    the reactors, which workers may notify until drained).
+        servers.clear();
+        if (failed.load(std::memory_order_relaxed)) return 1;
 
     } catch (const std::exception &e) {
         LOG_ERROR("Error: " << e.what());
-        pool.shutdown();
+        drain_pools();
         return 1;
     }
 
-    // Clean up UDS file if used.
-    if (!g_uds_path.empty()) {
-        ::unlink(g_uds_path.c_str());
-    }
-
     LOG_INFO("Server stopped");
 
     // 4. Release the module manager — tears down base WASM VMs.
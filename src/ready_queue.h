@@ -0,0 +1,127 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2026  LiteSpeed Technologies, Inc.                        *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unistd.h>
+
+/**
+ * ReadyQueue — lock-free multi-producer / single-consumer queue of nodes
+ * that need the reactor's attention, paired with the reactor's eventfd.
+ *
+ * Producers (worker threads) push with a CAS on the list head; the single
+ * consumer (the reactor) takes the whole list with one atomic exchange and
+ * reverses it, so entries are handled in push order.  Nodes are intrusive:
+ * pushing never allocates.
+ *
+ * Coalescing happens at two levels:
+ *   - A node already waiting in the queue is not pushed again (its queued
+ *     flag is set until the consumer takes it).
+ *   - The eventfd is written only by the push that finds the queue empty,
+ *     so a burst of notifications costs one eventfd write and one wakeup.
+ *
+ * The queue holds a reference to every queued node, so a node stays alive
+ * until the consumer has seen it even if its owner drops it meanwhile.
+ */
+class ReadyQueue {
+public:
+    /// Intrusive hook.  Derive from this to make a type queueable.
+    class Node {
+    public:
+        virtual ~Node() = default;
+
+    private:
+        friend class ReadyQueue;
+        Node *ready_next_ = nullptr;
+        std::atomic<bool> ready_queued_{false};
+        std::shared_ptr<Node> ready_ref_;  // the queue's reference while queued
+    };
+
+    explicit ReadyQueue(int event_fd = -1) : event_fd_(event_fd) {}
+
+    ~ReadyQueue() {
+        // Release the references still held by queued nodes.
+        drain([](std::shared_ptr<Node> &&) {});
+    }
+
+    // Non-copyable, non-movable.
+    ReadyQueue(const ReadyQueue &) = delete;
+    ReadyQueue &operator=(const ReadyQueue &) = delete;
+
+    /// eventfd written when the queue goes from empty to non-empty.
+    void setEventFd(int event_fd) { event_fd_ = event_fd; }
+    int eventFd() const { return event_fd_; }
+
+    /// Queue \p node for the consumer.  Safe from any thread.  No-op if
+    /// the node is already queued.
+    void push(std::shared_ptr<Node> node) {
+        if (node->ready_queued_.exchange(true, std::memory_order_acq_rel)) return;
+        Node *raw = node.get();
+        raw->ready_ref_ = std::move(node);
+
+        Node *head = head_.load(std::memory_order_relaxed);
+        do {
+            raw->ready_next_ = head;
+        } while (!head_.compare_exchange_weak(head, raw,
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed));
+        if (head == nullptr && event_fd_ >= 0) {
+            uint64_t val = 1;
+            // Best-effort write — if it fails (counter saturated), a wakeup
+            // is already pending anyway.
+            ssize_t r = ::write(event_fd_, &val, sizeof(val));
+            (void)r;
+        }
+    }
+
+    /// Consumer side: take every queued node and pass it to \p fn in push
+    /// order.  A node may be pushed again as soon as \p fn is called for it.
+    /// Returns the number of nodes handled.
+    template <typename Fn>
+    size_t drain(Fn &&fn) {
+        Node *list = head_.exchange(nullptr, std::memory_order_acquire);
+
+        // Reverse the LIFO chain into push order.
+        Node *ordered = nullptr;
+        while (list) {
+            Node *next = list->ready_next_;
+            list->ready_next_ = ordered;
+            ordered = list;
+            list = next;
+        }
+
+        size_t n = 0;
+        while (ordered) {
+            Node *next = ordered->ready_next_;
+            ordered->ready_next_ = nullptr;
+            std::shared_ptr<Node> ref = std::move(ordered->ready_ref_);
+            ordered->ready_queued_.store(false, std::memory_order_release);
+            fn(std::move(ref));
+            ordered = next;
+            ++n;
+        }
+        return n;
+    }
+
+private:
+    std::atomic<Node *> head_{nullptr};
+    int event_fd_;
+};
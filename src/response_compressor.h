@@ -0,0 +1,453 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2026  LiteSpeed Technologies, Inc.                        *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <zlib.h>
+#ifdef LSWASM_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "http_utils.h"
+#include "server_stats.h"
+
+inline constexpr int DEFAULT_COMPRESSION_LEVEL = 6;     // zlib level for gzip and deflate (1-9)
+inline constexpr size_t COMPRESSION_MIN_LENGTH = 256;   // buffered bodies below this are sent as they are
+inline constexpr size_t COMPRESSION_BLOCK = 16 * 1024;  // output growth step and file read size
+inline constexpr size_t COMPRESSOR_POOL_MAX = 4;        // idle contexts kept per thread and coding
+
+/// Content codings the host can produce (RFC 9110 §8.4.1).
+enum class ContentCoding : uint8_t { Identity, Deflate, Gzip, Zstd };
+
+/// The Content-Encoding token for \p coding.
+inline const char *content_coding_name(ContentCoding coding) {
+    switch (coding) {
+        case ContentCoding::Deflate: return "deflate";
+        case ContentCoding::Gzip:    return "gzip";
+        case ContentCoding::Zstd:    return "zstd";
+        default:                     return "identity";
+    }
+}
+
+/**
+ * CompressorContext — one deflate (zlib) or zstd compression stream.
+ *
+ * Creating a deflate stream allocates a few hundred KB of window and hash
+ * tables, so contexts are pooled per thread (see Compressor) and rewound
+ * with reset() between responses instead of being rebuilt.  zstd streams
+ * use the library's default level; the zlib level applies to the others.
+ */
+class CompressorContext {
+public:
+    enum class Mode { Continue, Flush, Finish };
+
+    CompressorContext(ContentCoding coding, int level) : coding_(coding) {
+#ifdef LSWASM_HAVE_ZSTD
+        if (coding == ContentCoding::Zstd) {
+            zstd_ = ZSTD_createCCtx();
+            ok_ = zstd_ != nullptr;
+            return;
+        }
+#endif
+        // windowBits 15 is the zlib format ("deflate"), +16 the gzip format.
+        int window_bits = coding == ContentCoding::Gzip ? 15 + 16 : 15;
+        ok_ = deflateInit2(&z_, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+
+    CompressorContext(const CompressorContext &) = delete;
+    CompressorContext &operator=(const CompressorContext &) = delete;
+
+    ~CompressorContext() {
+#ifdef LSWASM_HAVE_ZSTD
+        if (zstd_) {
+            ZSTD_freeCCtx(zstd_);
+            return;
+        }
+#endif
+        if (ok_) deflateEnd(&z_);
+    }
+
+    bool ok() const { return ok_; }
+    ContentCoding coding() const { return coding_; }
+
+    /// Start a new stream with the same settings.
+    void reset() {
+#ifdef LSWASM_HAVE_ZSTD
+        if (zstd_) {
+            ZSTD_CCtx_reset(zstd_, ZSTD_reset_session_only);
+            return;
+        }
+#endif
+        deflateReset(&z_);
+    }
+
+    /// Compress \p in and append the output to \p out.  Flush emits every
+    /// byte of input so far as a decodable block; Finish ends the stream.
+    bool run(std::string_view in, Mode mode, std::string &out) {
+#ifdef LSWASM_HAVE_ZSTD
+        if (zstd_) return run_zstd(in, mode, out);
+#endif
+        // avail_in is a uInt: feed very large inputs in slices.
+        do {
+            size_t slice = std::min<size_t>(in.size(), UINT_MAX / 2);
+            bool last = slice == in.size();
+            int flush = !last ? Z_NO_FLUSH
+                      : mode == Mode::Finish ? Z_FINISH
+                      : mode == Mode::Flush ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+            z_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+            z_.avail_in = static_cast<uInt>(slice);
+            do {
+                size_t step = std::max<size_t>(COMPRESSION_BLOCK, deflateBound(&z_, z_.avail_in) + 16);
+                size_t used = out.size();
+                out.resize(used + step);
+                z_.next_out = reinterpret_cast<Bytef *>(&out[used]);
+                z_.avail_out = static_cast<uInt>(step);
+                int rc = deflate(&z_, flush);
+                out.resize(used + step - z_.avail_out);
+                if (rc == Z_STREAM_ERROR) return false;
+            } while (z_.avail_out == 0);
+            in.remove_prefix(slice);
+        } while (!in.empty());
+        return true;
+    }
+
+private:
+#ifdef LSWASM_HAVE_ZSTD
+    bool run_zstd(std::string_view in, Mode mode, std::string &out) {
+        ZSTD_inBuffer input{in.data(), in.size(), 0};
+        ZSTD_EndDirective directive = mode == Mode::Finish ? ZSTD_e_end
+                                    : mode == Mode::Flush ? ZSTD_e_flush : ZSTD_e_continue;
+        for (;;) {
+            size_t step = std::max(COMPRESSION_BLOCK, ZSTD_compressBound(input.size - input.pos));
+            size_t used = out.size();
+            out.resize(used + step);
+            ZSTD_outBuffer output{&out[used], step, 0};
+            size_t remaining = ZSTD_compressStream2(zstd_, &output, &input, directive);
+            out.resize(used + output.pos);
+            if (ZSTD_isError(remaining)) return false;
+            bool done = directive == ZSTD_e_continue ? input.pos == input.size : remaining == 0;
+            if (done) return true;
+        }
+    }
+
+    ZSTD_CCtx *zstd_ = nullptr;
+#endif
+    ContentCoding coding_;
+    z_stream z_{};
+    bool ok_ = false;
+};
+
+/**
+ * Compressor — a response's compression stream, on a pooled context.
+ *
+ * start() takes an idle context for the coding from the calling thread's
+ * pool (creating one on a miss) and the destructor rewinds it and gives it
+ * back, so a worker or reactor thread compresses with the same few
+ * contexts for its whole life.  A context is not tied to the thread that
+ * created it; the pool only avoids locking.
+ */
+class Compressor {
+public:
+    Compressor() = default;
+    Compressor(const Compressor &) = delete;
+    Compressor &operator=(const Compressor &) = delete;
+    ~Compressor() { release(); }
+
+    /// Begin a stream in \p coding at zlib \p level.  Returns false (and
+    /// stays inactive) for Identity or if no context could be created.
+    bool start(ContentCoding coding, int level) {
+        release();
+        if (coding == ContentCoding::Identity) return false;
+        std::vector<std::unique_ptr<CompressorContext>> &idle = pool(coding);
+        if (!idle.empty()) {
+            ctx_ = std::move(idle.back());
+            idle.pop_back();
+        } else {
+            ctx_ = std::make_unique<CompressorContext>(coding, level);
+            if (!ctx_->ok()) ctx_.reset();
+        }
+        bytes_in_ = bytes_out_ = 0;
+        return ctx_ != nullptr;
+    }
+
+    bool active() const { return ctx_ != nullptr; }
+    ContentCoding coding() const { return ctx_ ? ctx_->coding() : ContentCoding::Identity; }
+
+    /// Compress \p in, appending to \p out (only while active()).  With
+    /// \p flush, everything written so far leaves in \p out; without,
+    /// the context may hold back output until later input fills a block.
+    bool write(std::string_view in, std::string &out, bool flush = true) {
+        size_t before = out.size();
+        bool ok = ctx_->run(in, flush ? CompressorContext::Mode::Flush
+                                      : CompressorContext::Mode::Continue, out);
+        bytes_in_ += in.size();
+        bytes_out_ += out.size() - before;
+        return ok;
+    }
+
+    /// End the stream, appending its last bytes to \p out.
+    bool finish(std::string &out) {
+        size_t before = out.size();
+        bool ok = ctx_->run({}, CompressorContext::Mode::Finish, out);
+        bytes_out_ += out.size() - before;
+        return ok;
+    }
+
+    /// Compress all of \p in as one stream into \p out.
+    bool compressAll(std::string_view in, std::string &out) {
+        out.clear();
+        bool ok = ctx_->run(in, CompressorContext::Mode::Finish, out);
+        bytes_in_ += in.size();
+        bytes_out_ += out.size();
+        return ok;
+    }
+
+    uint64_t bytesIn() const { return bytes_in_; }
+    uint64_t bytesOut() const { return bytes_out_; }
+
+private:
+    static std::vector<std::unique_ptr<CompressorContext>> &pool(ContentCoding coding) {
+        thread_local std::vector<std::unique_ptr<CompressorContext>> pools[4];
+        return pools[static_cast<size_t>(coding)];
+    }
+
+    void release() {
+        if (!ctx_) return;
+        std::vector<std::unique_ptr<CompressorContext>> &idle = pool(ctx_->coding());
+        if (idle.size() < COMPRESSOR_POOL_MAX) {
+            ctx_->reset();
+            idle.push_back(std::move(ctx_));
+        }
+        ctx_.reset();
+    }
+
+    std::unique_ptr<CompressorContext> ctx_;
+    uint64_t bytes_in_ = 0;
+    uint64_t bytes_out_ = 0;
+};
+
+/**
+ * ResponseCompression — process-wide response compression policy.
+ *
+ * Decides per request which coding the client accepts (negotiate()) and
+ * per response whether it is worth compressing (compressible()): only
+ * textual media types (text, JSON, JavaScript, XML, WebAssembly) without
+ * a Content-Encoding of their own, Content-Range or
+ * Cache-Control: no-transform, so already-compressed content (images,
+ * archives, pre-encoded files) passes through.  A filter keeps a response
+ * as it is by setting Content-Encoding: identity, or by removing the
+ * request's Accept-Encoding header.
+ *
+ * Configured once at startup, before any request is served.
+ */
+class ResponseCompression {
+public:
+    void setEnabled(bool enabled) { enabled_ = enabled; }
+    void setLevel(int level) { level_ = level; }
+    bool enabled() const { return enabled_; }
+    int level() const { return level_; }
+
+    /// The preferred coding the Accept-Encoding value \p accept allows:
+    /// highest q-value first, then zstd, gzip, deflate.
+    ContentCoding negotiate(std::string_view accept) const {
+        if (!enabled_ || accept.empty()) return ContentCoding::Identity;
+        static constexpr ContentCoding preference[] = {
+#ifdef LSWASM_HAVE_ZSTD
+            ContentCoding::Zstd,
+#endif
+            ContentCoding::Gzip, ContentCoding::Deflate,
+        };
+        // q-values in thousandths; -1 means not listed.
+        int q[4] = {-1, -1, -1, -1};
+        int wildcard = -1;
+        while (!accept.empty()) {
+            size_t comma = accept.find(',');
+            std::string_view item = accept.substr(0, comma);
+            accept.remove_prefix(comma == std::string_view::npos ? accept.size() : comma + 1);
+            size_t semi = item.find(';');
+            std::string_view name = trim(item.substr(0, semi));
+            int weight = semi == std::string_view::npos ? 1000 : parse_q(item.substr(semi + 1));
+            if (name == "*") {
+                wildcard = weight;
+            } else if (header_name_eq(name, "gzip") || header_name_eq(name, "x-gzip")) {
+                q[static_cast<size_t>(ContentCoding::Gzip)] = weight;
+            } else if (header_name_eq(name, "deflate")) {
+                q[static_cast<size_t>(ContentCoding::Deflate)] = weight;
+            } else if (header_name_eq(name, "zstd")) {
+                q[static_cast<size_t>(ContentCoding::Zstd)] = weight;
+            }
+        }
+        ContentCoding best = ContentCoding::Identity;
+        int best_q = 0;
+        for (ContentCoding c : preference) {
+            int w = q[static_cast<size_t>(c)] >= 0 ? q[static_cast<size_t>(c)] : wildcard;
+            if (w > best_q) {
+                best = c;
+                best_q = w;
+            }
+        }
+        return best;
+    }
+
+    /// A response with \p status and \p headers may be compressed.
+    static bool compressible(uint32_t status, const HeaderPairs &headers) {
+        if (status < 200 || status == 204 || status == 206 || status == 304) return false;
+        std::string_view type;
+        for (const auto &hdr : headers) {
+            if (header_name_eq(hdr.first, "Content-Encoding") ||
+                header_name_eq(hdr.first, "Content-Range")) {
+                return false;
+            }
+            if (header_name_eq(hdr.first, "Cache-Control") &&
+                contains_token(hdr.second, "no-transform")) {
+                return false;
+            }
+            if (header_name_eq(hdr.first, "Content-Type")) type = hdr.second;
+        }
+        type = trim(type.substr(0, type.find(';')));
+        auto starts = [&](std::string_view p) {
+            return type.size() >= p.size() && header_name_eq(type.substr(0, p.size()), p);
+        };
+        auto ends = [&](std::string_view s) {
+            return type.size() >= s.size() &&
+                   header_name_eq(type.substr(type.size() - s.size()), s);
+        };
+        return starts("text/") || ends("+json") || ends("+xml") ||
+               header_name_eq(type, "application/json") ||
+               header_name_eq(type, "application/javascript") ||
+               header_name_eq(type, "application/x-javascript") ||
+               header_name_eq(type, "application/xml") ||
+               header_name_eq(type, "application/wasm");
+    }
+
+    /// Add Accept-Encoding to the Vary header: the response depends on it
+    /// whether or not this client got it compressed.
+    static void addVary(HeaderPairs &headers) {
+        for (auto &hdr : headers) {
+            if (!header_name_eq(hdr.first, "Vary")) continue;
+            if (!contains_token(hdr.second, "accept-encoding") && trim(hdr.second) != "*") {
+                hdr.second += ", Accept-Encoding";
+            }
+            return;
+        }
+        headers.emplace_back("Vary", "Accept-Encoding");
+    }
+
+    /// Rewrite \p headers for a body encoded with \p coding: add
+    /// Content-Encoding and Vary, drop Content-Length and Accept-Ranges
+    /// (they described the identity body) and weaken a strong ETag.
+    static void markEncoded(HeaderPairs &headers, ContentCoding coding) {
+        headers.erase(std::remove_if(headers.begin(), headers.end(),
+            [](const std::pair<std::string, std::string> &p) {
+                return header_name_eq(p.first, "Content-Length") ||
+                       header_name_eq(p.first, "Accept-Ranges");
+            }), headers.end());
+        for (auto &hdr : headers) {
+            if (header_name_eq(hdr.first, "ETag") && !hdr.second.empty() && hdr.second[0] == '"') {
+                hdr.second.insert(0, "W/");
+            }
+        }
+        headers.emplace_back("Content-Encoding", content_coding_name(coding));
+        addVary(headers);
+    }
+
+    /// Compress a complete response \p body in place if the client accepts
+    /// \p coding and the response qualifies.  The caller sets
+    /// Content-Length afterwards.  Returns true if \p body was replaced.
+    bool compressBody(ContentCoding coding, uint32_t status, HeaderPairs &headers,
+                      std::string &body) const {
+        if (!enabled_ || !compressible(status, headers)) return false;
+        addVary(headers);
+        if (body.size() < COMPRESSION_MIN_LENGTH) return false;
+        Compressor compressor;
+        if (!compressor.start(coding, level_)) return false;
+        std::string encoded;
+        encoded.reserve(body.size() / 2);
+        if (!compressor.compressAll(body, encoded) || encoded.size() >= body.size()) return false;
+        body.swap(encoded);
+        markEncoded(headers, coding);
+        record(compressor);
+        return true;
+    }
+
+    /// Count a finished compressed response.
+    static void record(const Compressor &compressor) {
+        ServerStats &st = server_stats();
+        st.responses_compressed.fetch_add(1, std::memory_order_relaxed);
+        st.compress_bytes_in.fetch_add(compressor.bytesIn(), std::memory_order_relaxed);
+        st.compress_bytes_out.fetch_add(compressor.bytesOut(), std::memory_order_relaxed);
+    }
+
+private:
+    static std::string_view trim(std::string_view v) {
+        while (!v.empty() && (v.front() == ' ' || v.front() == '\t')) v.remove_prefix(1);
+        while (!v.empty() && (v.back() == ' ' || v.back() == '\t')) v.remove_suffix(1);
+        return v;
+    }
+
+    // A comma-separated list \p value holds \p token (case-insensitive).
+    static bool contains_token(std::string_view value, std::string_view token) {
+        while (!value.empty()) {
+            size_t comma = value.find(',');
+            std::string_view item = trim(value.substr(0, comma));
+            item = trim(item.substr(0, item.find('=')));
+            if (header_name_eq(item, token)) return true;
+            value.remove_prefix(comma == std::string_view::npos ? value.size() : comma + 1);
+        }
+        return false;
+    }
+
+    // "q=0.8" (RFC 9110 §12.4.2) in thousandths; other parameters are
+    // ignored and a malformed weight counts as 0.
+    static int parse_q(std::string_view params) {
+        while (!params.empty()) {
+            size_t semi = params.find(';');
+            std::string_view p = trim(params.substr(0, semi));
+            params.remove_prefix(semi == std::string_view::npos ? params.size() : semi + 1);
+            if (p.size() < 2 || (p[0] != 'q' && p[0] != 'Q') || p[1] != '=') continue;
+            std::string_view v = p.substr(2);
+            if (v.empty() || (v[0] != '0' && v[0] != '1')) return 0;
+            int q = (v[0] - '0') * 1000;
+            if (v.size() > 1 && v[1] != '.') return 0;
+            int scale = 100;
+            for (size_t i = 2; i < v.size() && i < 5; ++i) {
+                if (v[i] < '0' || v[i] > '9') return 0;
+                q += (v[i] - '0') * scale;
+                scale /= 10;
+            }
+            return std::min(q, 1000);
+        }
+        return 1000;
+    }
+
+    bool enabled_ = true;
+    int level_ = DEFAULT_COMPRESSION_LEVEL;
+};
+
+/// The process-wide instance.
+inline ResponseCompression &response_compression() {
+    static ResponseCompression compression;
+    return compression;
+}
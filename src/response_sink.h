@@ -26,6 +26,7 @@
 #include <string>
 #include <string_view>
 
+#include "file_cache.h"
 #include "http_utils.h"
 #include "log.h"
 
@@ -42,7 +43,7 @@
  *
  * Lifecycle:
  *   1. sendHeaders()  — exactly once
- *   2. writeBody()    — zero or more times
+ *   2. writeBody() / sendFile() — zero or more times, in any mix
  *   3. finishBody()   — exactly once (sends chunked terminator for HTTP
  *                       streaming, no-op otherwise)
  *
@@ -74,6 +75,21 @@ public:
      */
     virtual bool writeBody(std::string_view data) = 0;
 
+    /**
+     * Write \p len bytes of \p file, starting at \p offset, as response
+     * body.  The bytes go from the file to the transport with sendfile()
+     * (or are read back only where the transport must transform them),
+     * never through WASM memory.  Same place in the lifecycle as
+     * writeBody().
+     *
+     * @param file    Open file; the sink keeps a reference until sent.
+     * @param offset  First byte of the range.
+     * @param len     Range length.  0 is a no-op.
+     * @return true on success, false on error.
+     */
+    virtual bool sendFile(const std::shared_ptr<const OpenFile> &file, off_t offset,
+                          size_t len) = 0;
+
     /**
      * Signal end of body.  For HTTP streaming this sends the chunked
      * transfer-encoding terminator.  For other transports it may flush
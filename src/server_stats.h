@@ -0,0 +1,176 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2026  LiteSpeed Technologies, Inc.                        *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/**
+ * ServerStats — process-wide transport counters and gauges.
+ *
+ * Updated with relaxed atomics from the reactors and workers; read for
+ * diagnostics (the --body-pacifier response body and the shutdown log) and,
+ * for the buffered-bytes gauges, by the reactors' memory governor.  No
+ * cross-field consistency is promised.
+ */
+struct ServerStats {
+    // ── Connection table ──
+    std::atomic<uint64_t> connections_active{0};       // open client connections
+    std::atomic<uint64_t> connections_high_water{0};   // peak of connections_active
+    std::atomic<uint64_t> connections_accepted{0};     // total accepted
+    std::atomic<uint64_t> timeouts_header{0};          // closed before sending a complete request head
+    std::atomic<uint64_t> timeouts_body{0};            // closed on a stalled request body
+    std::atomic<uint64_t> timeouts_send{0};            // closed on a client that stopped reading
+
+    // ── ConnectionIO pool ──
+    std::atomic<uint64_t> conn_io_created{0};          // objects allocated (pool misses)
+    std::atomic<uint64_t> conn_io_reused{0};           // requests served from the pool
+    std::atomic<uint64_t> conn_io_owned{0};            // objects currently owned by the pools
+    std::atomic<uint64_t> conn_io_pool_high_water{0};  // peak objects owned by the pools
+
+    // ── Response egress ──
+    std::atomic<uint64_t> responses_spilled{0};        // responses that overflowed the output budget
+    std::atomic<uint64_t> spill_bytes{0};              // bytes written to spill files
+
+    // ── File responses ──
+    std::atomic<uint64_t> files_sent{0};               // responses sent from a file (lswasm_send_file)
+    std::atomic<uint64_t> file_cache_hits{0};          // file opens served by the fd cache
+    std::atomic<uint64_t> file_cache_misses{0};        // file opens that called open()
+
+    // ── Compression ──
+    std::atomic<uint64_t> responses_compressed{0};     // responses sent with a Content-Encoding by the host
+    std::atomic<uint64_t> compress_bytes_in{0};        // body bytes given to the compressor
+    std::atomic<uint64_t> compress_bytes_out{0};       // compressed bytes it produced
+
+    // ── Expect: 100-continue ──
+    std::atomic<uint64_t> continues_sent{0};           // request bodies solicited with 100 Continue
+    std::atomic<uint64_t> continues_declined{0};       // answered without soliciting the body
+    std::atomic<uint64_t> lingering_closes{0};         // closes that first waited out an unread body
+
+    // ── Request bodies ──
+    std::atomic<uint64_t> requests_prebuffered{0};     // bodies collected by the reactor before dispatch
+
+    // ── Worker pool ──
+    std::atomic<uint64_t> tasks_stolen{0};             // tasks a worker took from another's deque
+    std::atomic<uint64_t> worker_parks{0};             // times an idle worker slept on its futex
+    std::atomic<uint64_t> fiber_suspends{0};           // requests that gave up their thread to wait
+    std::atomic<uint64_t> workers_live{0};             // worker threads running now (all pools)
+    std::atomic<uint64_t> workers_added{0};            // workers an elastic pool started under load
+    std::atomic<uint64_t> workers_retired{0};          // added workers that exited after idling
+
+    // ── Concurrency limit ──
+    std::atomic<uint64_t> concurrency_limit{0};        // current limits, all pools
+    std::atomic<uint64_t> requests_in_flight{0};       // requests admitted and not yet finished
+    std::atomic<uint64_t> requests_shed{0};            // requests answered 503 at the limit
+
+    // ── Memory governor ──
+    std::atomic<uint64_t> body_bytes_buffered{0};      // request body bytes waiting for a worker
+    std::atomic<uint64_t> response_bytes_buffered{0};  // response bytes waiting for the client
+    std::atomic<uint64_t> buffered_high_water{0};      // peak of the two combined
+    std::atomic<uint64_t> reads_throttled{0};          // body reads paused by the memory budget
+    std::atomic<uint64_t> accepts_shed{0};             // connections refused by the memory budget
+
+    // ── HTTP/2 ──
+    std::atomic<uint64_t> h2_connections{0};           // connections that switched to HTTP/2
+    std::atomic<uint64_t> h2_streams{0};               // HTTP/2 streams opened
+
+    // ── TLS ──
+    std::atomic<uint64_t> tls_handshakes{0};           // completed TLS handshakes
+    std::atomic<uint64_t> tls_resumed{0};              // of those, resumed sessions
+    std::atomic<uint64_t> tls_failed{0};               // handshakes that failed
+    std::atomic<uint64_t> ktls_tx{0};                  // connections sending through kernel TLS
+    std::atomic<uint64_t> ktls_rx{0};                  // connections receiving through kernel TLS
+
+    /// Body and response bytes currently buffered.
+    uint64_t bufferedBytes() const {
+        return body_bytes_buffered.load(std::memory_order_relaxed) +
+               response_bytes_buffered.load(std::memory_order_relaxed);
+    }
+
+    /// Raise \p gauge to \p value if it is higher.
+    static void raise(std::atomic<uint64_t> &gauge, uint64_t value) {
+        uint64_t cur = gauge.load(std::memory_order_relaxed);
+        while (value > cur &&
+               !gauge.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    /// Render all counters as "  name: value" lines.
+    std::string format() const {
+        std::string out;
+        auto line = [&out](const char *name, const std::atomic<uint64_t> &v) {
+            out += "  ";
+            out += name;
+            out += ": ";
+            out += std::to_string(v.load(std::memory_order_relaxed));
+            out += "\n";
+        };
+        line("connections_active", connections_active);
+        line("connections_high_water", connections_high_water);
+        line("connections_accepted", connections_accepted);
+        line("timeouts_header", timeouts_header);
+        line("timeouts_body", timeouts_body);
+        line("timeouts_send", timeouts_send);
+        line("conn_io_created", conn_io_created);
+        line("conn_io_reused", conn_io_reused);
+        line("conn_io_owned", conn_io_owned);
+        line("conn_io_pool_high_water", conn_io_pool_high_water);
+        line("responses_spilled", responses_spilled);
+        line("spill_bytes", spill_bytes);
+        line("files_sent", files_sent);
+        line("file_cache_hits", file_cache_hits);
+        line("file_cache_misses", file_cache_misses);
+        line("responses_compressed", responses_compressed);
+        line("compress_bytes_in", compress_bytes_in);
+        line("compress_bytes_out", compress_bytes_out);
+        line("continues_sent", continues_sent);
+        line("continues_declined", continues_declined);
+        line("lingering_closes", lingering_closes);
+        line("requests_prebuffered", requests_prebuffered);
+        line("tasks_stolen", tasks_stolen);
+        line("worker_parks", worker_parks);
+        line("fiber_suspends", fiber_suspends);
+        line("workers_live", workers_live);
+        line("workers_added", workers_added);
+        line("workers_retired", workers_retired);
+        line("concurrency_limit", concurrency_limit);
+        line("requests_in_flight", requests_in_flight);
+        line("requests_shed", requests_shed);
+        line("body_bytes_buffered", body_bytes_buffered);
+        line("response_bytes_buffered", response_bytes_buffered);
+        line("buffered_high_water", buffered_high_water);
+        line("reads_throttled", reads_throttled);
+        line("accepts_shed", accepts_shed);
+        line("h2_connections", h2_connections);
+        line("h2_streams", h2_streams);
+        line("tls_handshakes", tls_handshakes);
+        line("tls_resumed", tls_resumed);
+        line("tls_failed", tls_failed);
+        line("ktls_tx", ktls_tx);
+        line("ktls_rx", ktls_rx);
+        return out;
+    }
+};
+
+/// The process-wide instance.
+inline ServerStats &server_stats() {
+    static ServerStats stats;
+    return stats;
+}
@@ -0,0 +1,196 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2026  LiteSpeed Technologies, Inc.                        *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+
+/// Smallest power of two >= \p n (and >= 2).
+inline size_t spsc_round_capacity(size_t n) {
+    size_t cap = 2;
+    while (cap < n) cap <<= 1;
+    return cap;
+}
+
+/**
+ * SpscRing — bounded lock-free single-producer / single-consumer queue.
+ *
+ * One thread pushes, one other thread peeks and pops; neither ever takes a
+ * lock.  Indices run freely and are masked on access, so the capacity is a
+ * power of two.  The producer caches the consumer's index and re-reads the
+ * shared atomic only when the cached value says the ring is full.
+ *
+ * Slots live in a fixed array: an element's address is stable from push
+ * until pop, so the consumer may hand pointers into queued elements (e.g.
+ * string data for writev) to the kernel while they stay queued.
+ */
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : mask_(spsc_round_capacity(capacity) - 1),
+          slots_(new T[mask_ + 1]) {}
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // ── Producer ────────────────────────────────────────────────────
+
+    /// Append \p value.  Returns false (leaving \p value untouched) if the
+    /// ring is full.
+    bool tryPush(T &&value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ > mask_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ > mask_) return false;
+        }
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Free slots as seen by the producer (a lower bound).
+    size_t writable() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        head_cache_ = head_.load(std::memory_order_acquire);
+        return capacity() - (tail - head_cache_);
+    }
+
+    /// True if a push would fail right now.
+    bool full() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        head_cache_ = head_.load(std::memory_order_acquire);
+        return tail - head_cache_ > mask_;
+    }
+
+    /// Most recently pushed element, or nullptr if the ring is empty.
+    /// Only valid while the consumer is known not to be running (e.g. both
+    /// roles are played by the same thread).
+    T *newest() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) return nullptr;
+        return &slots_[(tail - 1) & mask_];
+    }
+
+    // ── Consumer ────────────────────────────────────────────────────
+
+    /// Number of elements ready for the consumer.
+    size_t readable() {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_relaxed);
+    }
+
+    bool empty() { return readable() == 0; }
+
+    /// The \p i-th queued element (0 = oldest).  \p i must be below the
+    /// last readable() result.
+    T &peek(size_t i) {
+        return slots_[(head_.load(std::memory_order_relaxed) + i) & mask_];
+    }
+
+    /// Drop the \p n oldest elements (releasing their resources).
+    void pop(size_t n = 1) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < n; ++i) slots_[(head + i) & mask_] = T();
+        head_.store(head + n, std::memory_order_release);
+    }
+
+    /// Drop everything.  Only while no producer is running.
+    void clear() { pop(readable()); }
+
+private:
+    const size_t mask_;
+    std::unique_ptr<T[]> slots_;
+
+    alignas(64) std::atomic<size_t> head_{0};  // consumer position
+    alignas(64) std::atomic<size_t> tail_{0};  // producer position
+    size_t head_cache_ = 0;                    // producer's view of head_
+};
+
+/**
+ * SpscByteRing — bounded lock-free single-producer / single-consumer byte
+ * stream.  Same protocol as SpscRing, over a flat byte buffer; writes and
+ * reads may wrap around the end of the buffer.
+ */
+class SpscByteRing {
+public:
+    explicit SpscByteRing(size_t capacity)
+        : mask_(spsc_round_capacity(capacity) - 1),
+          buf_(new char[mask_ + 1]) {}
+
+    SpscByteRing(const SpscByteRing &) = delete;
+    SpscByteRing &operator=(const SpscByteRing &) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // ── Producer ────────────────────────────────────────────────────
+
+    /// Copy as much of \p data as fits.  Returns the number of bytes taken.
+    size_t write(const char *data, size_t len) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t space = capacity() - (tail - head_.load(std::memory_order_acquire));
+        size_t n = std::min(len, space);
+        if (n == 0) return 0;
+        size_t pos = tail & mask_;
+        size_t first = std::min(n, capacity() - pos);
+        std::memcpy(buf_.get() + pos, data, first);
+        std::memcpy(buf_.get(), data + first, n - first);
+        tail_.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    // ── Consumer ────────────────────────────────────────────────────
+
+    /// Bytes ready for the consumer.
+    size_t readable() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_relaxed);
+    }
+
+    /// Append up to \p max bytes to \p out.  Returns the number moved.
+    size_t read(std::string &out, size_t max) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t n = std::min(max, tail_.load(std::memory_order_acquire) - head);
+        if (n == 0) return 0;
+        size_t pos = head & mask_;
+        size_t first = std::min(n, capacity() - pos);
+        out.append(buf_.get() + pos, first);
+        out.append(buf_.get(), n - first);
+        head_.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    /// Drop everything.  Only while neither side is running.
+    void clear() {
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    const size_t mask_;
+    std::unique_ptr<char[]> buf_;
+
+    alignas(64) std::atomic<size_t> head_{0};  // consumer position
+    alignas(64) std::atomic<size_t> tail_{0};  // producer position
+};
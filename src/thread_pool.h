@@ -18,36 +18,134 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
 #include <condition_variable>
+#include <ctime>
 #include <functional>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <vector>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "fiber.h"
+#include "log.h"
+#include "server_stats.h"
+#include "work_deque.h"
+
+inline constexpr size_t WORKER_DEQUE_CAPACITY = 256;  // tasks a worker holds for thieves
+inline constexpr int WORKER_SPIN_ROUNDS = 64;         // empty scans before a worker parks
+inline constexpr uint32_t DEFAULT_WORKER_QUEUE_TARGET = 20;  // ms a task may wait before the pool grows
+inline constexpr uint32_t DEFAULT_WORKER_IDLE_TIMEOUT = 30;  // seconds idle before an added worker retires
 
 /**
- * ThreadPool — A simple fixed-size thread pool.
+ * ThreadPool — work-stealing thread pool, fixed-size or elastic.
+ *
+ * Tasks are intrusive nodes (ThreadPool::Task) owned by the submitter, so
+ * submitting one neither locks nor allocates.  The reactors push onto a
+ * lock-free injection stack; an idle worker takes the whole stack with one
+ * exchange, runs the oldest task and moves the rest into its own Chase-Lev
+ * deque (WorkDeque), from which the other workers steal.  A worker runs
+ * its own deque first, then the injection stack, then steals.
+ *
+ * A worker that finds nothing after WORKER_SPIN_ROUNDS scans parks on its
+ * own futex word.  submit() wakes one parked worker, and a worker that
+ * finds more work than it can run wakes another, so wakeups fan out only
+ * as far as there is work.
  *
- * Workers pull tasks from a shared queue and execute them.  submit() enqueues
- * a task and returns immediately.  shutdown() stops accepting new tasks,
- * drains all pending work, and joins every worker thread.
+ * Fibers: with fibers_per_worker > 0 each task runs on a Fiber owned by
+ * the worker that took it.  A task that waits (ConnectionIO's body read)
+ * suspends its fiber instead of blocking the thread, and the worker goes
+ * on to other tasks; up to fibers_per_worker tasks are in flight per
+ * worker.  When the wait ends the fiber is queued back to its own worker
+ * — fibers never migrate, so thread-local state such as the WASM VM clone
+ * stays with them.  A worker whose fibers are all in use takes no new
+ * tasks until one finishes.
+ *
+ * Elastic pools (Scaling::max_threads above the initial size): a scaler
+ * thread checks every queue_target_ms whether a task waited longer than
+ * that for a worker, or whether tasks sat queued across a whole period
+ * without any worker taking one (every worker blocked), and if so adds a
+ * worker, up to max_threads.  The new thread runs Scaling::thread_start
+ * (creating its WASM VM clones) before it takes a task, so no request
+ * waits for that.  A worker parked for idle_timeout_s while the pool is
+ * above its initial size retires: it runs Scaling::thread_exit (dropping
+ * its clones) and exits, and its slot can be reused.  Worker slots are
+ * allocated up front, so the other threads never see the slot table
+ * change.
+ *
+ * submit(std::function) remains for cold paths and wraps the function in a
+ * heap-allocated task.  shutdown() stops accepting new tasks, drains all
+ * pending work (including suspended fibers), and joins every worker
+ * thread.
  */
 class ThreadPool {
 public:
+    /// Intrusive task node.  Derive from this and submit() a reference;
+    /// the object must stay alive until run() or discard() is called.
+    class Task {
+    public:
+        virtual ~Task() = default;
+
+        /// Executed once on a worker thread.
+        virtual void run() = 0;
+
+        /// Called instead of run() for a task submitted after shutdown().
+        virtual void discard() {}
+
+    private:
+        friend class ThreadPool;
+        Task *task_next_ = nullptr;  // injection stack link
+        uint64_t task_enqueued_ns_ = 0;  // elastic pools: when submit() queued it
+    };
+
+    /// Elastic sizing (see above).  max_threads <= the initial size keeps
+    /// the pool fixed.
+    struct Scaling {
+        size_t max_threads = 0;
+        uint32_t queue_target_ms = DEFAULT_WORKER_QUEUE_TARGET;
+        uint32_t idle_timeout_s = DEFAULT_WORKER_IDLE_TIMEOUT;
+        std::function<void()> thread_start;  // on an added worker, before its first task
+        std::function<void()> thread_exit;   // on a retiring worker, after its last task
+    };
+
     /**
      * Create a pool with \p num_threads worker threads.
      * If \p num_threads is 0, defaults to std::thread::hardware_concurrency()
-     * (or 4 if that returns 0).
+     * (or 4 if that returns 0).  \p fibers_per_worker > 0 runs tasks on
+     * fibers with \p fiber_stack bytes of stack each (see above).
      */
-    explicit ThreadPool(size_t num_threads = 0) {
+    explicit ThreadPool(size_t num_threads = 0, size_t fibers_per_worker = 0,
+                        size_t fiber_stack = DEFAULT_FIBER_STACK)
+        : ThreadPool(num_threads, fibers_per_worker, fiber_stack, Scaling()) {}
+
+    /** As above; \p scaling lets the pool grow beyond \p num_threads and
+     *  shrink back. */
+    ThreadPool(size_t num_threads, size_t fibers_per_worker, size_t fiber_stack, Scaling scaling)
+        : fibers_per_worker_(fibers_per_worker), fiber_stack_(fiber_stack),
+          scaling_(std::move(scaling)) {
         if (num_threads == 0) {
             num_threads = std::thread::hardware_concurrency();
             if (num_threads == 0) num_threads = 4;
         }
-        workers_.reserve(num_threads);
+        min_threads_ = num_threads;
+        max_threads_ = std::max(scaling_.max_threads, num_threads);
+        workers_.reserve(max_threads_);
+        for (size_t i = 0; i < max_threads_; ++i) workers_.push_back(std::make_unique<Worker>());
+        threads_.store(num_threads, std::memory_order_relaxed);
+        slots_used_.store(num_threads, std::memory_order_relaxed);
+        server_stats().workers_live.fetch_add(num_threads, std::memory_order_relaxed);
         for (size_t i = 0; i < num_threads; ++i) {
-            workers_.emplace_back([this] { worker_loop(); });
+            workers_[i]->running.store(true, std::memory_order_relaxed);
+            workers_[i]->thread = std::thread([this, i] { worker_main(i, false); });
         }
+        if (elastic()) scaler_ = std::thread([this] { scale_loop(); });
     }
 
     // Non-copyable, non-movable.
@@ -57,16 +155,27 @@ public:
     ~ThreadPool() { shutdown(); }
 
     /**
-     * Enqueue a task for execution.  Returns immediately.
-     * If shutdown() has been called, the task is silently dropped.
+     * Queue \p task for execution.  Returns immediately; lock- and
+     * allocation-free.  Safe from any thread.  If shutdown() has been
+     * called, the task is discarded instead.
      */
-    void submit(std::function<void()> task) {
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            if (stop_) return;
-            tasks_.push(std::move(task));
+    void submit(Task &task) {
+        if (stop_.load(std::memory_order_acquire)) {
+            task.discard();
+            return;
         }
-        cv_.notify_one();
+        if (elastic()) task.task_enqueued_ns_ = steady_ns();
+        inject(&task);
+        wake_one();
+    }
+
+    /**
+     * Enqueue a function for execution.  Returns immediately.
+     * If shutdown() has been called, the function is silently dropped.
+     * Allocates; request dispatch uses submit(Task &).
+     */
+    void submit(std::function<void()> fn) {
+        submit(*new FunctionTask(std::move(fn)));
     }
 
     /**
@@ -74,38 +183,490 @@ public:
      * worker thread.  Safe to call multiple times (idempotent).
      */
     void shutdown() {
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            if (stop_) return;
-            stop_ = true;
+        if (stop_.exchange(true, std::memory_order_acq_rel)) return;
+        if (scaler_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(scale_mutex_);
+            }
+            scale_cv_.notify_all();
+            scaler_.join();
         }
-        cv_.notify_all();
-        for (std::thread &t : workers_) {
-            if (t.joinable()) t.join();
+        for (auto &w : workers_) w->unpark();
+        for (auto &w : workers_) {
+            if (w->thread.joinable()) w->thread.join();
+        }
+        // A submit() that raced with stop_ may have left a task behind.
+        for (Task *task = inject_head_.exchange(nullptr, std::memory_order_acquire); task;) {
+            Task *next = task->task_next_;
+            task->discard();
+            task = next;
         }
     }
 
-    /** Number of worker threads in the pool. */
-    size_t size() const { return workers_.size(); }
+    /**
+     * Run \p fn once on every worker thread (e.g. to set up thread-local
+     * state before traffic arrives) and return when all have finished.
+     * Each worker holds its turn until every worker has taken one, so no
+     * worker runs \p fn twice.  Must not be called from a worker.
+     */
+    void runOnEachWorker(const std::function<void()> &fn) {
+        struct Rendezvous {
+            std::mutex mutex;
+            std::condition_variable cv;
+            size_t arrived = 0;
+            size_t done = 0;
+        };
+        auto rv = std::make_shared<Rendezvous>();
+        size_t n = size();
+        for (size_t i = 0; i < n; ++i) {
+            submit([rv, n, &fn]() {
+                std::unique_lock<std::mutex> lock(rv->mutex);
+                if (++rv->arrived == n) rv->cv.notify_all();
+                rv->cv.wait(lock, [&] { return rv->arrived == n; });
+                lock.unlock();
+                fn();
+                lock.lock();
+                if (++rv->done == n) rv->cv.notify_all();
+            });
+        }
+        std::unique_lock<std::mutex> lock(rv->mutex);
+        rv->cv.wait(lock, [&] { return rv->done == n; });
+    }
+
+    /** Number of worker threads in the pool now. */
+    size_t size() const { return threads_.load(std::memory_order_relaxed); }
+
+    /** Most worker threads the pool may grow to. */
+    size_t maxSize() const { return max_threads_; }
+
+    /** Tasks each worker may have in flight on fibers (0 = no fibers). */
+    size_t fibersPerWorker() const { return fibers_per_worker_; }
 
 private:
-    void worker_loop() {
+    struct FunctionTask : Task {
+        explicit FunctionTask(std::function<void()> f) : fn(std::move(f)) {}
+        void run() override {
+            fn();
+            delete this;
+        }
+        void discard() override { delete this; }
+        std::function<void()> fn;
+    };
+
+    struct FiberTimer {
+        std::chrono::steady_clock::time_point deadline;
+        Fiber *fiber;
+        uint32_t wait_seq;  // the wait the deadline belongs to
+        bool operator>(const FiberTimer &o) const { return deadline > o.deadline; }
+    };
+
+    struct alignas(64) Worker : FiberScheduler {
+        WorkDeque<Task, WORKER_DEQUE_CAPACITY> deque;
+        std::thread thread;
+        std::atomic<bool> running{false};          // a thread owns the slot
+        std::atomic<uint64_t> taken{0};            // elastic: tasks taken from the queues
+        std::atomic<uint64_t> wait_max_ns{0};      // elastic: longest wait of those, this period
+        std::atomic<uint32_t> futex_word{0};       // bumped by every unpark()
+        std::atomic<bool> parked{false};           // asleep, or about to be
+        std::atomic<Fiber *> resume_head{nullptr};  // woken fibers (newest first)
+
+        // Owned by the worker thread.
+        std::vector<std::unique_ptr<Fiber>> fibers;
+        std::vector<Fiber *> idle_fibers;
+        std::vector<FiberTimer> timers;  // min-heap on deadline
+        std::atomic<size_t> fibers_live{0};  // fibers with a task in flight (written by the worker)
+
+        void schedule(Fiber &fiber) override {
+            Fiber *head = resume_head.load(std::memory_order_relaxed);
+            do {
+                fiber.next = head;
+            } while (!resume_head.compare_exchange_weak(head, &fiber, std::memory_order_release,
+                                                        std::memory_order_relaxed));
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (parked.load(std::memory_order_seq_cst) &&
+                parked.exchange(false, std::memory_order_acq_rel)) {
+                unpark();
+            }
+        }
+
+        void unpark() {
+            futex_word.fetch_add(1, std::memory_order_release);
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&futex_word), FUTEX_WAKE_PRIVATE, 1,
+                    nullptr, nullptr, 0);
+        }
+    };
+
+    // Push onto the injection stack (any thread).
+    void inject(Task *task) {
+        Task *head = inject_head_.load(std::memory_order_relaxed);
+        do {
+            task->task_next_ = head;
+        } while (!inject_head_.compare_exchange_weak(head, task, std::memory_order_release,
+                                                     std::memory_order_relaxed));
+    }
+
+    // Take the whole injection stack: keep the oldest task to run and move
+    // the ones after it into worker \p self's deque, oldest at the bottom.
+    // The newest that do not fit go back beneath the stack, ahead of
+    // anything submitted since.
+    Task *take_injected(size_t self) {
+        if (inject_head_.load(std::memory_order_relaxed) == nullptr) return nullptr;
+        Task *list = inject_head_.exchange(nullptr, std::memory_order_acquire);
+        if (!list) return nullptr;
+        WorkDeque<Task, WORKER_DEQUE_CAPACITY> &deque = workers_[self]->deque;
+        size_t count = 0;
+        for (Task *t = list; t->task_next_; t = t->task_next_) ++count;
+        size_t room = deque.room();
+        if (count > room) {
+            Task *last = list;  // newest count - room tasks stay injected
+            for (size_t k = 1; k < count - room; ++k) last = last->task_next_;
+            Task *rest = last->task_next_;
+            last->task_next_ = nullptr;
+            inject_oldest(list);
+            list = rest;
+        }
+        Task *oldest = list;
+        while (oldest->task_next_) {
+            Task *next = oldest->task_next_;
+            deque.push(oldest);
+            oldest = next;
+        }
+        return oldest;
+    }
+
+    // Put \p chain (linked newest first) back at the bottom of the
+    // injection stack, below anything submitted since it was taken.
+    void inject_oldest(Task *chain) {
         for (;;) {
-            std::function<void()> task;
-            {
-                std::unique_lock<std::mutex> lock(mutex_);
-                cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
-                if (stop_ && tasks_.empty()) return;
-                task = std::move(tasks_.front());
-                tasks_.pop();
+            Task *expected = nullptr;
+            if (inject_head_.compare_exchange_strong(expected, chain, std::memory_order_release,
+                                                     std::memory_order_relaxed)) {
+                return;
+            }
+            // Newer tasks arrived: take them and hang the chain below.
+            Task *newer = inject_head_.exchange(nullptr, std::memory_order_acquire);
+            if (!newer) continue;
+            Task *tail = newer;
+            while (tail->task_next_) tail = tail->task_next_;
+            tail->task_next_ = chain;
+            chain = newer;
+        }
+    }
+
+    // Next task for worker \p self, or nullptr if none was found.
+    Task *find_task(size_t self) {
+        if (Task *task = workers_[self]->deque.pop()) return task;
+        if (Task *task = take_injected(self)) return task;
+        size_t n = slots_used_.load(std::memory_order_acquire);
+        for (size_t k = 1; k < n; ++k) {
+            if (Task *task = workers_[(self + k) % n]->deque.steal()) {
+                server_stats().tasks_stolen.fetch_add(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    // True if any task queue looked non-empty.
+    bool has_work() const {
+        if (inject_head_.load(std::memory_order_acquire) != nullptr) return true;
+        size_t n = slots_used_.load(std::memory_order_acquire);
+        for (size_t i = 0; i < n; ++i) {
+            if (!workers_[i]->deque.empty()) return true;
+        }
+        return false;
+    }
+
+    // Can worker \p w start another task?
+    bool accepting(const Worker &w) const {
+        return fibers_per_worker_ == 0 ||
+               w.fibers_live.load(std::memory_order_relaxed) < fibers_per_worker_;
+    }
+
+    // Run \p task on worker \p w: directly, or on one of its fibers.
+    void run_task(Worker &w, Task *task) {
+        if (fibers_per_worker_ == 0) {
+            task->run();
+            return;
+        }
+        Fiber *fiber;
+        if (!w.idle_fibers.empty()) {
+            fiber = w.idle_fibers.back();
+            w.idle_fibers.pop_back();
+        } else {
+            w.fibers.push_back(std::make_unique<Fiber>(w, fiber_stack_));
+            fiber = w.fibers.back().get();
+        }
+        w.fibers_live.fetch_add(1, std::memory_order_relaxed);
+        fiber->start([](void *arg) { static_cast<Task *>(arg)->run(); }, task);
+        step_fiber(w, fiber);
+    }
+
+    // Switch into \p fiber until it finishes its task or waits again.
+    void step_fiber(Worker &w, Fiber *fiber) {
+        if (fiber->resume()) {
+            w.fibers_live.fetch_sub(1, std::memory_order_relaxed);
+            w.idle_fibers.push_back(fiber);
+            return;
+        }
+        server_stats().fiber_suspends.fetch_add(1, std::memory_order_relaxed);
+        if (fiber->hasDeadline()) {
+            w.timers.push_back(FiberTimer{fiber->deadline(), fiber, fiber->waitSeq()});
+            std::push_heap(w.timers.begin(), w.timers.end(), std::greater<FiberTimer>());
+        }
+    }
+
+    // Resume the fibers of \p w that were woken or whose deadline passed.
+    // Returns true if any ran.
+    bool resume_fibers(Worker &w) {
+        bool ran = false;
+        Fiber *list = w.resume_head.exchange(nullptr, std::memory_order_acquire);
+        Fiber *ordered = nullptr;
+        while (list) {
+            Fiber *next = list->next;
+            list->next = ordered;
+            ordered = list;
+            list = next;
+        }
+        while (ordered) {
+            Fiber *next = ordered->next;
+            step_fiber(w, ordered);
+            ordered = next;
+            ran = true;
+        }
+        if (!w.timers.empty()) {
+            auto now = std::chrono::steady_clock::now();
+            while (!w.timers.empty() && w.timers.front().deadline <= now) {
+                std::pop_heap(w.timers.begin(), w.timers.end(), std::greater<FiberTimer>());
+                FiberTimer timer = w.timers.back();
+                w.timers.pop_back();
+                // A timer of an earlier wait, or a fiber already woken, is stale.
+                if (timer.wait_seq == timer.fiber->waitSeq() && timer.fiber->claim()) {
+                    step_fiber(w, timer.fiber);
+                    ran = true;
+                }
+            }
+        }
+        return ran;
+    }
+
+    // Thread body of worker slot \p self; \p added if the scaler started
+    // it (rather than the constructor).
+    void worker_main(size_t self, bool added) {
+        Worker &w = *workers_[self];
+        if (added && scaling_.thread_start) scaling_.thread_start();
+        if (added) {
+            // Visible to thieves and wake_one() only once warmed up.
+            size_t used = slots_used_.load(std::memory_order_relaxed);
+            while (used < self + 1 &&
+                   !slots_used_.compare_exchange_weak(used, self + 1, std::memory_order_release,
+                                                      std::memory_order_relaxed)) {
+            }
+        }
+        if (!worker_loop(self)) return;  // stopped
+        // Retired: fibers are all idle, the deque is empty.
+        w.fibers.clear();
+        w.idle_fibers.clear();
+        w.timers.clear();
+        if (scaling_.thread_exit) scaling_.thread_exit();
+        server_stats().workers_live.fetch_sub(1, std::memory_order_relaxed);
+        server_stats().workers_retired.fetch_add(1, std::memory_order_relaxed);
+        w.running.store(false, std::memory_order_release);
+    }
+
+    // Run tasks until shutdown (returns false) or, in an elastic pool,
+    // until the worker retires (returns true).
+    bool worker_loop(size_t self) {
+        Worker &w = *workers_[self];
+        int idle_rounds = 0;
+        for (;;) {
+            bool ran = fibers_per_worker_ > 0 && resume_fibers(w);
+            if (accepting(w)) {
+                if (Task *task = find_task(self)) {
+                    idle_rounds = 0;
+                    if (elastic()) note_wait(w, *task);
+                    // More queued than this worker is about to run (perhaps
+                    // in the deque of a worker blocked in its task): let a
+                    // parked worker help.
+                    if (has_work()) wake_one();
+                    run_task(w, task);
+                    continue;
+                }
+            }
+            if (ran) {
+                idle_rounds = 0;
+                continue;
+            }
+            if (stop_.load(std::memory_order_acquire) && w.fibers_live.load() == 0) return false;
+            if (++idle_rounds < WORKER_SPIN_ROUNDS) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (park(w) && retire(w)) return true;
+            idle_rounds = 0;
+        }
+    }
+
+    // How long park() may sleep: until the earliest fiber deadline and,
+    // in an elastic pool above its initial size, the idle timeout.
+    // Leaves \p timeout null to sleep until unparked.
+    void park_timeout(Worker &w, struct timespec &ts, struct timespec *&timeout) {
+        int64_t ns = -1;
+        if (!w.timers.empty()) {
+            auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                w.timers.front().deadline - std::chrono::steady_clock::now());
+            ns = std::max<int64_t>(wait.count(), 0);
+        }
+        if (elastic() && threads_.load(std::memory_order_relaxed) > min_threads_) {
+            int64_t idle = static_cast<int64_t>(scaling_.idle_timeout_s) * 1000000000;
+            if (ns < 0 || idle < ns) ns = idle;
+        }
+        if (ns < 0) return;
+        ts.tv_sec = ns / 1000000000;
+        ts.tv_nsec = ns % 1000000000;
+        timeout = &ts;
+    }
+
+    // Sleep until unparked or the park_timeout() expires.  Announce it
+    // before the final look, so a submit() or fiber wakeup that this look
+    // misses sees the flag and unparks us.  Returns true if the idle
+    // timeout expired without anyone unparking us.
+    bool park(Worker &w) {
+        uint32_t seq = w.futex_word.load(std::memory_order_acquire);
+        w.parked.store(true, std::memory_order_seq_cst);
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool runnable = w.resume_head.load(std::memory_order_acquire) != nullptr ||
+                        (accepting(w) && has_work()) ||
+                        (stop_.load(std::memory_order_acquire) && w.fibers_live.load() == 0);
+        bool idle = false;
+        if (!runnable) {
+            struct timespec ts;
+            struct timespec *timeout = nullptr;
+            park_timeout(w, ts, timeout);
+            server_stats().worker_parks.fetch_add(1, std::memory_order_relaxed);
+            long rc = syscall(SYS_futex, reinterpret_cast<uint32_t *>(&w.futex_word),
+                              FUTEX_WAIT_PRIVATE, seq, timeout, nullptr, 0);
+            idle = rc != 0 && errno == ETIMEDOUT && w.timers.empty();
+        }
+        // Still flagged: nobody picked us in the meantime.
+        idle = w.parked.exchange(false, std::memory_order_acq_rel) && idle;
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        return idle;
+    }
+
+    // ── Elastic sizing ──
+
+    bool elastic() const { return max_threads_ > min_threads_; }
+
+    // Queue wait is read from the real clock: the cached one lags by up
+    // to a reactor tick, several times the wait target.
+    static uint64_t steady_ns() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count());
+    }
+
+    // Worker \p w took \p task: record how long it waited.
+    void note_wait(Worker &w, const Task &task) {
+        uint64_t now = steady_ns();
+        uint64_t waited = now > task.task_enqueued_ns_ ? now - task.task_enqueued_ns_ : 0;
+        w.taken.store(w.taken.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (waited > w.wait_max_ns.load(std::memory_order_relaxed)) {
+            w.wait_max_ns.store(waited, std::memory_order_relaxed);
+        }
+    }
+
+    // Leave the pool after an idle timeout, if it is above its initial
+    // size and this worker holds no suspended fibers.
+    bool retire(Worker &w) {
+        if (w.fibers_live.load(std::memory_order_relaxed) != 0) return false;
+        size_t n = threads_.load(std::memory_order_relaxed);
+        do {
+            if (n <= min_threads_) return false;
+        } while (!threads_.compare_exchange_weak(n, n - 1, std::memory_order_acq_rel));
+        if (has_work() || stop_.load(std::memory_order_acquire)) {
+            // Work arrived meanwhile (or shutdown needs us to drain).
+            threads_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        LOG_INFO("Worker pool: idle worker retired, " << n - 1 << " left");
+        return true;
+    }
+
+    // Scaler thread: add a worker whenever tasks wait too long.
+    void scale_loop() {
+        auto period = std::chrono::milliseconds(std::max<uint32_t>(scaling_.queue_target_ms, 1));
+        uint64_t target_ns = static_cast<uint64_t>(scaling_.queue_target_ms) * 1000000;
+        uint64_t taken_before = 0;
+        bool queued_before = false;
+        std::unique_lock<std::mutex> lock(scale_mutex_);
+        while (!stop_.load(std::memory_order_acquire)) {
+            scale_cv_.wait_for(lock, period);
+            if (stop_.load(std::memory_order_acquire)) break;
+            uint64_t taken = 0;
+            uint64_t wait_max = 0;
+            size_t n = slots_used_.load(std::memory_order_acquire);
+            for (size_t i = 0; i < n; ++i) {
+                taken += workers_[i]->taken.load(std::memory_order_relaxed);
+                wait_max = std::max(wait_max, workers_[i]->wait_max_ns.exchange(
+                                                  0, std::memory_order_relaxed));
+            }
+            // Queued at both looks with nothing taken in between: every
+            // worker is blocked and the queue has waited a whole period.
+            bool queued = has_work();
+            bool stalled = queued && queued_before && taken == taken_before;
+            queued_before = queued;
+            taken_before = taken;
+            if (wait_max > target_ns || stalled) grow();
+        }
+    }
+
+    // Start one more worker in a free slot, if below max_threads_.
+    void grow() {
+        if (threads_.load(std::memory_order_relaxed) >= max_threads_) return;
+        for (size_t i = 0; i < max_threads_; ++i) {
+            Worker &w = *workers_[i];
+            if (w.running.load(std::memory_order_acquire)) continue;
+            if (w.thread.joinable()) w.thread.join();  // a retired worker's thread
+            size_t n = threads_.fetch_add(1, std::memory_order_relaxed) + 1;
+            w.running.store(true, std::memory_order_relaxed);
+            server_stats().workers_live.fetch_add(1, std::memory_order_relaxed);
+            server_stats().workers_added.fetch_add(1, std::memory_order_relaxed);
+            w.thread = std::thread([this, i] { worker_main(i, true); });
+            LOG_INFO("Worker pool: queue wait above " << scaling_.queue_target_ms
+                     << " ms, added a worker (" << n << " of " << max_threads_ << ")");
+            return;
+        }
+    }
+
+    // Unpark one parked worker that can take a task, if any.
+    void wake_one() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_seq_cst) == 0) return;
+        size_t n = slots_used_.load(std::memory_order_acquire);
+        for (size_t i = 0; i < n; ++i) {
+            Worker *w = workers_[i].get();
+            if (w->parked.load(std::memory_order_relaxed) && accepting(*w) &&
+                w->parked.exchange(false, std::memory_order_acq_rel)) {
+                w->unpark();
+                return;
             }
-            task();
         }
     }
 
-    std::vector<std::thread> workers_;
-    std::queue<std::function<void()>> tasks_;
-    std::mutex mutex_;
-    std::condition_variable cv_;
-    bool stop_ = false;
+    const size_t fibers_per_worker_;
+    const size_t fiber_stack_;
+    const Scaling scaling_;
+    size_t min_threads_ = 0;
+    size_t max_threads_ = 0;
+    std::vector<std::unique_ptr<Worker>> workers_;  // max_threads_ slots, allocated up front
+    std::atomic<size_t> threads_{0};                // worker threads in the pool
+    std::atomic<size_t> slots_used_{0};             // slots [0, n) may hold a worker
+    std::thread scaler_;
+    std::mutex scale_mutex_;
+    std::condition_variable scale_cv_;
+    alignas(64) std::atomic<Task *> inject_head_{nullptr};  // injection stack (newest first)
+    std::atomic<uint32_t> sleepers_{0};                     // workers parked or about to park
+    std::atomic<bool> stop_{false};
 };
@@ -0,0 +1,163 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2026  LiteSpeed Technologies, Inc.                        *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+inline constexpr unsigned TIMER_WHEEL_BITS = 6;     // 64 slots per level
+inline constexpr unsigned TIMER_WHEEL_LEVELS = 4;   // spans 2^24 ticks (19 days at 100 ms)
+
+/**
+ * TimerWheel — hierarchical timing wheel for one reactor thread.
+ *
+ * Timers are identified by a small integer id (the reactors use the
+ * connection's fd) and live in a table indexed by it, so each id has at
+ * most one pending expiry and the caller keeps no pointers that a growing
+ * connection slab could invalidate.  Time is counted in ticks supplied by
+ * the caller.
+ *
+ * Level 0 has one slot per tick for the next 64 ticks; each further level
+ * has 64 slots, each covering a whole turn of the level below.  A timer
+ * goes into the lowest level that reaches its expiry, and whenever a lower
+ * level wraps around, the next slot of the level above is cascaded down.
+ * schedule() and cancel() are O(1); advance() is O(1) per tick plus the
+ * work of the timers that expire or cascade.  A delay beyond the top
+ * level is clamped to its span.
+ *
+ * Not thread-safe: owned and driven by one thread.
+ */
+class TimerWheel {
+public:
+    /// Start the wheel at tick \p now.
+    explicit TimerWheel(uint64_t now = 0) : current_(now) {
+        for (uint32_t &head : slots_) head = NIL;
+    }
+
+    /// The next tick advance() will process: every tick before it has run.
+    uint64_t now() const { return current_; }
+
+    /// (Re)arm timer \p id to expire \p delay ticks from now().  A pending
+    /// expiry of the same id is replaced.
+    void schedule(uint32_t id, uint64_t delay) {
+        if (id >= nodes_.size()) nodes_.resize(std::max<size_t>(id + 1, nodes_.size() * 2));
+        if (nodes_[id].slot != NIL) unlink(id);
+        nodes_[id].expires = current_ + delay;
+        insert(id);
+    }
+
+    /// Disarm timer \p id.  No-op if it is not pending.
+    void cancel(uint32_t id) {
+        if (id < nodes_.size() && nodes_[id].slot != NIL) unlink(id);
+    }
+
+    /// True if timer \p id is pending.
+    bool pending(uint32_t id) const { return id < nodes_.size() && nodes_[id].slot != NIL; }
+
+    /// Run every tick up to and including \p to, calling \p on_expire(id)
+    /// for each timer that expires.  The callback may schedule or cancel
+    /// any timer, including the one that fired.
+    template <typename F>
+    void advance(uint64_t to, F &&on_expire) {
+        while (current_ <= to) {
+            uint32_t index = static_cast<uint32_t>(current_ & SLOT_MASK);
+            // Level 0 wrapped: pull the next slot of each level above down
+            // until one that did not wrap.
+            for (unsigned level = 1; index == 0 && level < TIMER_WHEEL_LEVELS; ++level) {
+                index = static_cast<uint32_t>((current_ >> (level * TIMER_WHEEL_BITS)) & SLOT_MASK);
+                cascade(level * SLOTS + index);
+            }
+            // Move the due timers to the expiring list first: a timer the
+            // callback schedules 63 ticks ahead lands in the same slot.
+            uint32_t slot = static_cast<uint32_t>(current_ & SLOT_MASK);
+            ++current_;
+            uint32_t id = slots_[slot];
+            slots_[slot] = NIL;
+            slots_[EXPIRING] = id;
+            for (; id != NIL; id = nodes_[id].next) nodes_[id].slot = EXPIRING;
+            while (slots_[EXPIRING] != NIL) {
+                id = slots_[EXPIRING];
+                unlink(id);
+                on_expire(id);
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+    static constexpr uint32_t SLOTS = 1u << TIMER_WHEEL_BITS;
+    static constexpr uint64_t SLOT_MASK = SLOTS - 1;
+    static constexpr uint32_t EXPIRING = TIMER_WHEEL_LEVELS * SLOTS;  // list being run by advance()
+
+    struct Node {
+        uint64_t expires = 0;
+        uint32_t prev = NIL;
+        uint32_t next = NIL;
+        uint32_t slot = NIL;  // index into slots_ (or EXPIRING), NIL while not pending
+    };
+
+    // Link \p id into the slot its expiry falls in.
+    void insert(uint32_t id) {
+        Node &n = nodes_[id];
+        if (n.expires < current_) n.expires = current_;
+        uint64_t delta = n.expires - current_;
+        unsigned level = 0;
+        while (level + 1 < TIMER_WHEEL_LEVELS && delta >= (1ull << ((level + 1) * TIMER_WHEEL_BITS))) {
+            ++level;
+        }
+        uint64_t span = 1ull << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS);
+        if (delta >= span) n.expires = current_ + span - 1;
+        uint32_t slot = level * SLOTS +
+                        static_cast<uint32_t>((n.expires >> (level * TIMER_WHEEL_BITS)) & SLOT_MASK);
+        n.slot = slot;
+        n.prev = NIL;
+        n.next = slots_[slot];
+        if (n.next != NIL) nodes_[n.next].prev = id;
+        slots_[slot] = id;
+    }
+
+    void unlink(uint32_t id) {
+        Node &n = nodes_[id];
+        if (n.prev != NIL) {
+            nodes_[n.prev].next = n.next;
+        } else {
+            slots_[n.slot] = n.next;
+        }
+        if (n.next != NIL) nodes_[n.next].prev = n.prev;
+        n.prev = n.next = n.slot = NIL;
+    }
+
+    // Re-insert every timer of \p slot relative to the current tick.
+    void cascade(uint32_t slot) {
+        uint32_t id = slots_[slot];
+        slots_[slot] = NIL;
+        while (id != NIL) {
+            uint32_t next = nodes_[id].next;
+            nodes_[id].slot = NIL;
+            insert(id);
+            id = next;
+        }
+    }
+
+    uint64_t current_;
+    uint32_t slots_[TIMER_WHEEL_LEVELS * SLOTS + 1];  // list heads, the last one EXPIRING
+    std::vector<Node> nodes_;
+};
@@ -0,0 +1,289 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2026  LiteSpeed Technologies, Inc.                        *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <memory>
+#include <string>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+#include "server_stats.h"
+
+inline constexpr long TLS_SESSION_CACHE_SIZE = 20480;  // server-side session cache entries
+inline constexpr long TLS_SESSION_TIMEOUT = 300;       // seconds a session (or ticket) stays resumable
+
+/**
+ * TlsContext — server certificate, settings and session state for TLS
+ * listeners.
+ *
+ * One instance (one SSL_CTX) is shared by every reactor of every TLS
+ * listener.  OpenSSL locks the session cache internally and the
+ * session-ticket keys belong to the SSL_CTX, so a client that resumes a
+ * session may land on any reactor thread.
+ *
+ * With kTLS enabled, OpenSSL installs the negotiated keys into the kernel
+ * (TLS_TX / TLS_RX) once the handshake is done, if the kernel's "tls"
+ * module and the cipher allow it; each TlsConnection reports whether that
+ * happened.
+ *
+ * ALPN selects "h2" when HTTP/2 is enabled and the client offers it,
+ * otherwise "http/1.1".
+ */
+class TlsContext {
+public:
+    /// Load \p cert_file (PEM chain) and \p key_file.  Returns null and
+    /// sets \p error on failure.
+    static std::shared_ptr<TlsContext> create(const std::string &cert_file,
+                                              const std::string &key_file,
+                                              bool ktls, bool h2, std::string &error) {
+        std::shared_ptr<TlsContext> tls(new TlsContext(h2, ktls));
+        SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+        if (!ctx) {
+            error = "SSL_CTX_new failed";
+            return nullptr;
+        }
+        tls->ctx_ = ctx;
+
+        uint64_t options = SSL_OP_NO_RENEGOTIATION | SSL_OP_CIPHER_SERVER_PREFERENCE;
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+        options |= SSL_OP_IGNORE_UNEXPECTED_EOF;  // a peer without close_notify reads as EOF
+#endif
+#ifdef SSL_OP_ENABLE_KTLS
+        if (ktls) options |= SSL_OP_ENABLE_KTLS;
+#endif
+        SSL_CTX_set_options(ctx, options);
+        SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+        // Writes are retried from the egress ring, whose bytes may move
+        // between attempts; idle connections give their record buffers back.
+        SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE |
+                                  SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER |
+                                  SSL_MODE_RELEASE_BUFFERS);
+
+        if (SSL_CTX_use_certificate_chain_file(ctx, cert_file.c_str()) != 1) {
+            error = "cannot load certificate " + cert_file + ": " + last_error();
+            return nullptr;
+        }
+        if (SSL_CTX_use_PrivateKey_file(ctx, key_file.c_str(), SSL_FILETYPE_PEM) != 1) {
+            error = "cannot load private key " + key_file + ": " + last_error();
+            return nullptr;
+        }
+        if (SSL_CTX_check_private_key(ctx) != 1) {
+            error = "private key does not match the certificate";
+            return nullptr;
+        }
+
+        static const unsigned char SESSION_ID_CONTEXT[] = "lswasm";
+        SSL_CTX_set_session_id_context(ctx, SESSION_ID_CONTEXT, sizeof(SESSION_ID_CONTEXT) - 1);
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size(ctx, TLS_SESSION_CACHE_SIZE);
+        SSL_CTX_set_timeout(ctx, TLS_SESSION_TIMEOUT);
+        SSL_CTX_set_alpn_select_cb(ctx, &TlsContext::select_alpn, tls.get());
+        return tls;
+    }
+
+    ~TlsContext() {
+        if (ctx_) SSL_CTX_free(ctx_);
+    }
+
+    TlsContext(const TlsContext &) = delete;
+    TlsContext &operator=(const TlsContext &) = delete;
+
+    SSL_CTX *get() const { return ctx_; }
+    bool ktls() const { return ktls_; }
+
+    /// Most recent OpenSSL error as text (clears the error queue).
+    static std::string last_error() {
+        unsigned long code = ERR_get_error();
+        ERR_clear_error();
+        if (code == 0) return "unknown error";
+        char buf[256];
+        ERR_error_string_n(code, buf, sizeof(buf));
+        return buf;
+    }
+
+private:
+    TlsContext(bool h2, bool ktls) : h2_(h2), ktls_(ktls) {}
+
+    static int select_alpn(SSL * /*ssl*/, const unsigned char **out, unsigned char *outlen,
+                           const unsigned char *in, unsigned int inlen, void *arg) {
+        static const unsigned char WITH_H2[] = "\x02h2\x08http/1.1";
+        static const unsigned char HTTP11[] = "\x08http/1.1";
+        const TlsContext *self = static_cast<const TlsContext *>(arg);
+        const unsigned char *prefs = self->h2_ ? WITH_H2 : HTTP11;
+        unsigned int prefs_len = self->h2_ ? sizeof(WITH_H2) - 1 : sizeof(HTTP11) - 1;
+        unsigned char *selected = nullptr;
+        if (SSL_select_next_proto(&selected, outlen, prefs, prefs_len, in, inlen) !=
+            OPENSSL_NPN_NEGOTIATED) {
+            return SSL_TLSEXT_ERR_NOACK;  // no common protocol: carry on without ALPN
+        }
+        *out = selected;
+        return SSL_TLSEXT_ERR_OK;
+    }
+
+    SSL_CTX *ctx_ = nullptr;
+    bool h2_;
+    bool ktls_;
+};
+
+/**
+ * TlsConnection — the TLS state of one accepted connection.
+ *
+ * The SSL object reads and writes the non-blocking socket directly, so the
+ * handshake is driven by the reactor's readiness events: handshake()
+ * reports which direction it is waiting for.  Afterwards recv() and send()
+ * behave like their socket counterparts (EAGAIN included).  When kTLS is
+ * active in a direction, that direction bypasses OpenSSL entirely: the
+ * reactor may then use plain recv(), sendmsg() and sendfile() on the fd,
+ * and the kernel does the record processing.
+ *
+ * OpenSSL reads one record at a time (no read-ahead), so no decrypted
+ * bytes are left inside the SSL object once recv() has returned a record;
+ * edge-triggered readiness therefore stays accurate.
+ */
+class TlsConnection {
+public:
+    enum class Status { Done, WantRead, WantWrite, Error };
+
+    /// Start the server side of a handshake on \p fd.  Returns null if the
+    /// SSL object cannot be created.
+    static std::unique_ptr<TlsConnection> accept(const TlsContext &ctx, int fd) {
+        SSL *ssl = SSL_new(ctx.get());
+        if (!ssl) return nullptr;
+        if (SSL_set_fd(ssl, fd) != 1) {
+            SSL_free(ssl);
+            return nullptr;
+        }
+        SSL_set_accept_state(ssl);
+        return std::unique_ptr<TlsConnection>(new TlsConnection(ssl));
+    }
+
+    ~TlsConnection() { SSL_free(ssl_); }
+
+    TlsConnection(const TlsConnection &) = delete;
+    TlsConnection &operator=(const TlsConnection &) = delete;
+
+    /// Advance the handshake.  On Done the connection is established and
+    /// the kTLS state is known.
+    Status handshake() {
+        ERR_clear_error();
+        int rc = SSL_do_handshake(ssl_);
+        if (rc == 1) {
+            established_ = true;
+            ktls_tx_ = BIO_get_ktls_send(SSL_get_wbio(ssl_));
+            ktls_rx_ = BIO_get_ktls_recv(SSL_get_rbio(ssl_));
+            const unsigned char *proto = nullptr;
+            unsigned int proto_len = 0;
+            SSL_get0_alpn_selected(ssl_, &proto, &proto_len);
+            alpn_h2_ = (proto_len == 2 && proto[0] == 'h' && proto[1] == '2');
+
+            ServerStats &st = server_stats();
+            st.tls_handshakes.fetch_add(1, std::memory_order_relaxed);
+            if (SSL_session_reused(ssl_)) st.tls_resumed.fetch_add(1, std::memory_order_relaxed);
+            if (ktls_tx_) st.ktls_tx.fetch_add(1, std::memory_order_relaxed);
+            if (ktls_rx_) st.ktls_rx.fetch_add(1, std::memory_order_relaxed);
+            return Status::Done;
+        }
+        switch (SSL_get_error(ssl_, rc)) {
+        case SSL_ERROR_WANT_READ:
+            return Status::WantRead;
+        case SSL_ERROR_WANT_WRITE:
+            return Status::WantWrite;
+        default:
+            ERR_clear_error();
+            server_stats().tls_failed.fetch_add(1, std::memory_order_relaxed);
+            return Status::Error;
+        }
+    }
+
+    bool established() const { return established_; }
+    bool ktlsSend() const { return ktls_tx_; }
+    bool ktlsRecv() const { return ktls_rx_; }
+    /// ALPN settled on HTTP/2.
+    bool alpnH2() const { return alpn_h2_; }
+    const char *version() const { return SSL_get_version(ssl_); }
+    const char *cipher() const { return SSL_get_cipher_name(ssl_); }
+
+    /// Read decrypted bytes, like recv(): > 0 bytes, 0 at the end of the
+    /// stream, -1 with errno set (EAGAIN when no complete record is in).
+    ssize_t recv(int fd, char *buf, size_t len) {
+        if (ktls_rx_) {
+            ssize_t n = ::recv(fd, buf, len, 0);
+            // A control record (close_notify, KeyUpdate) cannot be read
+            // as data; treat it as the end of the stream.
+            if (n < 0 && errno == EIO) return 0;
+            return n;
+        }
+        ERR_clear_error();
+        int n = SSL_read(ssl_, buf, static_cast<int>(std::min<size_t>(len, INT_MAX)));
+        if (n > 0) return n;
+        return fail(n);
+    }
+
+    /// Encrypt and send, like send(): bytes accepted, or -1 with errno set
+    /// (EAGAIN when the socket is full).  After EAGAIN the next call must
+    /// start with the same bytes, at least as many of them.
+    ssize_t send(int fd, const void *data, size_t len) {
+        if (ktls_tx_) return ::send(fd, data, len, MSG_NOSIGNAL);
+        ERR_clear_error();
+        int n = SSL_write(ssl_, data, static_cast<int>(std::min<size_t>(len, INT_MAX)));
+        if (n > 0) return n;
+        return fail(n);
+    }
+
+    /// Send close_notify (best effort, never blocks).
+    void shutdown() {
+        if (!established_) return;
+        ERR_clear_error();
+        SSL_shutdown(ssl_);
+        ERR_clear_error();
+    }
+
+private:
+    explicit TlsConnection(SSL *ssl) : ssl_(ssl) {}
+
+    // Map an SSL_read()/SSL_write() failure onto socket semantics.
+    ssize_t fail(int rc) {
+        int err = SSL_get_error(ssl_, rc);
+        ERR_clear_error();
+        switch (err) {
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            errno = EAGAIN;
+            return -1;
+        case SSL_ERROR_ZERO_RETURN:
+            return 0;
+        default:
+            errno = ECONNRESET;
+            return -1;
+        }
+    }
+
+    SSL *ssl_;
+    bool established_ = false;
+    bool ktls_tx_ = false;
+    bool ktls_rx_ = false;
+    bool alpn_h2_ = false;
+};
@@ -0,0 +1,932 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2026  LiteSpeed Technologies, Inc.                        *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+#pragma once
+
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <vector>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "http_reactor.h"
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+
+// The backend needs multishot accept/recv and extended wait arguments
+// (Linux 6.0+ headers).  Older headers build a stub whose init() fails,
+// and the server falls back to epoll.
+// IORING_RECV_MULTISHOT stands in for the set (the register opcodes are
+// enumerators and cannot be tested with #ifdef).
+#if defined(IORING_ACCEPT_MULTISHOT) && defined(IORING_RECV_MULTISHOT) && \
+    defined(IORING_ENTER_EXT_ARG) && defined(__NR_io_uring_setup)
+#define LSWASM_HAVE_IO_URING 1
+#endif
+
+#ifdef LSWASM_HAVE_IO_URING
+
+// io_uring backend configuration
+inline constexpr unsigned URING_SQ_ENTRIES = 1024;
+inline constexpr unsigned URING_RECV_BUFFERS = 256;      // provided receive buffers per reactor
+inline constexpr unsigned URING_RECV_BUFFER_SIZE = 16384; // bytes per provided buffer
+inline constexpr unsigned URING_MAX_FIXED_FILES = 65536;  // registered file table size cap
+
+/**
+ * IoUring — a minimal raw-syscall io_uring ring (no liburing dependency).
+ *
+ * Owned and driven by a single thread.  SQEs are filled with getSqe() and
+ * published by submitAndWait(); completions are consumed with
+ * forEachCompletion().
+ */
+class IoUring {
+public:
+    IoUring() = default;
+    ~IoUring() { destroy(); }
+
+    IoUring(const IoUring &) = delete;
+    IoUring &operator=(const IoUring &) = delete;
+
+    /// Create the ring and map its queues.  Returns false on failure
+    /// (errno is preserved).
+    bool init(unsigned entries) {
+        struct io_uring_params p{};
+        p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+        p.cq_entries = entries * 4;
+        ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+        if (ring_fd_ < 0 && errno == EINVAL) {
+            // Older kernel: retry without the optional setup flags.
+            p = io_uring_params{};
+            p.flags = IORING_SETUP_CQSIZE;
+            p.cq_entries = entries * 4;
+            ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+        }
+        if (ring_fd_ < 0) return false;
+        features_ = p.features;
+
+        sq_ring_size_ = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+        cq_ring_size_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+        if (features_ & IORING_FEAT_SINGLE_MMAP) {
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        }
+        sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+        if (sq_ring_ == MAP_FAILED) { sq_ring_ = nullptr; return false; }
+        if (features_ & IORING_FEAT_SINGLE_MMAP) {
+            cq_ring_ = sq_ring_;
+        } else {
+            cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+            if (cq_ring_ == MAP_FAILED) { cq_ring_ = nullptr; return false; }
+        }
+        sqes_size_ = p.sq_entries * sizeof(struct io_uring_sqe);
+        sqes_ = static_cast<struct io_uring_sqe *>(
+            mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+        if (sqes_ == MAP_FAILED) { sqes_ = nullptr; return false; }
+
+        char *sq = static_cast<char *>(sq_ring_);
+        sq_head_ = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+        sq_entries_ = p.sq_entries;
+        unsigned *sq_array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+        for (unsigned i = 0; i < sq_entries_; ++i) sq_array[i] = i;  // identity mapping
+
+        char *cq = static_cast<char *>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<struct io_uring_cqe *>(cq + p.cq_off.cqes);
+
+        sqe_tail_ = *sq_tail_;
+
+        return true;
+    }
+
+    /// Register the ring fd with the calling thread so io_uring_enter()
+    /// skips the fd table lookup (best effort, Linux 5.18+).  Registered
+    /// ring fds are per thread: call this from the thread that drives the
+    /// ring, and submit only from that thread afterwards.
+    void registerRingFd() {
+        struct io_uring_rsrc_update up{};
+        up.offset = ~0U;  // let the kernel pick the slot
+        up.data = static_cast<uint64_t>(ring_fd_);
+        if (registerOp(IORING_REGISTER_RING_FDS, &up, 1) == 1) {
+            enter_fd_ = static_cast<int>(up.offset);
+            enter_flags_ = IORING_ENTER_REGISTERED_RING;
+        }
+    }
+
+    /// Drop the registration made by registerRingFd() (same thread).
+    void unregisterRingFd() {
+        if (enter_fd_ < 0) return;
+        struct io_uring_rsrc_update up{};
+        up.offset = static_cast<uint32_t>(enter_fd_);
+        registerOp(IORING_UNREGISTER_RING_FDS, &up, 1);
+        enter_fd_ = -1;
+        enter_flags_ = 0;
+    }
+
+    bool hasFeature(uint32_t feature) const { return (features_ & feature) != 0; }
+    int fd() const { return ring_fd_; }
+
+    /// io_uring_register() wrapper.  Returns the syscall result.
+    int registerOp(unsigned opcode, void *arg, unsigned nr_args) {
+        return static_cast<int>(syscall(__NR_io_uring_register, ring_fd_, opcode, arg, nr_args));
+    }
+
+    /// Next free SQE, zeroed.  Submits queued entries if the SQ is full.
+    struct io_uring_sqe *getSqe() {
+        unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (sqe_tail_ - head >= sq_entries_) {
+            submitAndWait(0, nullptr);
+            head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+            if (sqe_tail_ - head >= sq_entries_) return nullptr;
+        }
+        struct io_uring_sqe *sqe = &sqes_[sqe_tail_ & sq_mask_];
+        std::memset(sqe, 0, sizeof(*sqe));
+        ++sqe_tail_;
+        return sqe;
+    }
+
+    /// Publish queued SQEs and wait for at least \p wait_nr completions or
+    /// until \p timeout expires (nullptr = no timeout).  Returns the
+    /// io_uring_enter() result.
+    int submitAndWait(unsigned wait_nr, const struct __kernel_timespec *timeout) {
+        __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+        unsigned to_submit = sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        unsigned flags = enter_flags_;
+        struct io_uring_getevents_arg arg{};
+        void *argp = nullptr;
+        size_t argsz = 0;
+        if (wait_nr > 0) {
+            flags |= IORING_ENTER_GETEVENTS;
+            if (timeout) {
+                flags |= IORING_ENTER_EXT_ARG;
+                arg.sigmask_sz = _NSIG / 8;
+                arg.ts = reinterpret_cast<uint64_t>(timeout);
+                argp = &arg;
+                argsz = sizeof(arg);
+            }
+        }
+        if (to_submit == 0 && wait_nr == 0) return 0;
+        return static_cast<int>(syscall(__NR_io_uring_enter, enter_fd_ >= 0 ? enter_fd_ : ring_fd_,
+                                        to_submit, wait_nr, flags, argp, argsz));
+    }
+
+    /// Hand every available completion to \p fn(user_data, res, flags).
+    /// The CQ slot is released before \p fn runs, so \p fn may queue new
+    /// SQEs.  Returns the number of completions handled.
+    template <typename Fn>
+    unsigned forEachCompletion(Fn &&fn) {
+        unsigned n = 0;
+        for (;;) {
+            unsigned head = *cq_head_;
+            unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            if (head == tail) break;
+            struct io_uring_cqe cqe = cqes_[head & cq_mask_];
+            __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+            fn(cqe.user_data, cqe.res, cqe.flags);
+            ++n;
+        }
+        return n;
+    }
+
+private:
+    void destroy() {
+        if (sqes_) munmap(sqes_, sqes_size_);
+        if (cq_ring_ && cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_size_);
+        if (sq_ring_) munmap(sq_ring_, sq_ring_size_);
+        if (ring_fd_ >= 0) close(ring_fd_);
+        sqes_ = nullptr;
+        sq_ring_ = cq_ring_ = nullptr;
+        ring_fd_ = -1;
+    }
+
+    int ring_fd_ = -1;
+    int enter_fd_ = -1;
+    unsigned enter_flags_ = 0;
+    uint32_t features_ = 0;
+
+    void *sq_ring_ = nullptr;
+    void *cq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    struct io_uring_sqe *sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    unsigned *sq_head_ = nullptr;
+    unsigned *sq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned sqe_tail_ = 0;  // local tail (SQEs filled, not yet published)
+
+    unsigned *cq_head_ = nullptr;
+    unsigned *cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    struct io_uring_cqe *cqes_ = nullptr;
+};
+
+/**
+ * UringReactor — io_uring backend (--io-backend=uring).
+ *
+ * Keeps the HttpReactor connection logic and ConnectionIO worker contract,
+ * and replaces readiness notification plus one syscall per recv/send with
+ * completions batched through a single io_uring_enter() per loop turn:
+ *
+ *   - One multishot accept on the listener yields every new connection.
+ *   - Each connection has one multishot recv that draws from a shared
+ *     group of provided buffers; bytes are copied into the connection's
+ *     buffers and the buffer is handed straight back to the group (the
+ *     re-provide rides along with the next submit).
+ *   - Client sockets are installed in a sparse registered file table with
+ *     a FILES_UPDATE linked ahead of the first recv, so recv/send skip the
+ *     per-op fd lookup.  Teardown is a hard-linked cancel → unregister →
+ *     close chain, so the fd number cannot be reused before its registered
+ *     slot is cleared.
+ *   - All queued response segments go out as one gathered SENDMSG; the
+ *     ConnectionIO (which owns the segments) is kept alive until the send
+ *     completes.
+ *   - Worker notifications arrive as a read on the eventfd, timer ticks as
+ *     a read on the timerfd.
+ *
+ * A multishot recv keeps delivering while a request is being processed;
+ * bytes that arrive then are the next pipelined request and are buffered
+ * like in the epoll backend.  If that buffer passes MAX_HEADER_SIZE the
+ * recv is cancelled and re-armed when the connection wants input again,
+ * which restores kernel backpressure.  An EOF seen while the connection
+ * does not want input is held back until it does, so pipelined requests
+ * that precede a half-close are still answered.
+ *
+ * init() fails — and the caller falls back to epoll — if the kernel lacks
+ * io_uring or any of the features above.
+ */
+class UringReactor final : public HttpReactor {
+public:
+    using HttpReactor::HttpReactor;
+
+    ~UringReactor() override { std::free(buf_base_); }
+
+    bool init() override {
+        if (!ring_.init(URING_SQ_ENTRIES)) {
+            LOG_ERROR("io_uring_setup failed: " << strerror(errno));
+            return false;
+        }
+        if (!ring_.hasFeature(IORING_FEAT_EXT_ARG) || !ring_.hasFeature(IORING_FEAT_NODROP)) {
+            LOG_ERROR("io_uring: kernel lacks EXT_ARG/NODROP support");
+            return false;
+        }
+        if (!probe_ops()) return false;
+        if (!init_common()) return false;
+        if (!provide_buffers()) return false;
+        setup_fixed_files();
+        uconns_.resize(slots_.size());
+
+        arm_accept();
+        arm_eventfd();
+        arm_tick();
+        if (ring_.submitAndWait(0, nullptr) < 0) {
+            LOG_ERROR("io_uring submit failed: " << strerror(errno));
+            return false;
+        }
+        return true;
+    }
+
+    void run() override {
+        pin_thread();
+        ring_.registerRingFd();
+        CoarseClock::attach();
+
+        // No wait timeout: the timer tick completes a read every tick.
+        while (!shutdown_.load(std::memory_order_relaxed)) {
+            int ret = ring_.submitAndWait(1, nullptr);
+            if (ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+                if (shutdown_.load(std::memory_order_relaxed)) break;
+                LOG_ERROR("io_uring_enter error: " << strerror(errno));
+                break;
+            }
+            refresh_clock();
+
+            ring_.forEachCompletion([this](uint64_t user_data, int32_t res, uint32_t flags) {
+                on_completion(user_data, res, flags);
+            });
+
+            drain_completed_inline();
+            deliver_deferred_eof();
+            resume_throttled();
+            run_timers();
+            if (draining_.load(std::memory_order_relaxed) && drain_step()) break;
+        }
+
+        // Clean up remaining client connections and let the close chains
+        // run before the ring goes away.
+        close_all();
+        struct __kernel_timespec ts{};
+        ts.tv_nsec = 100 * 1000 * 1000;
+        ring_.submitAndWait(1, &ts);
+        ring_.forEachCompletion([](uint64_t, int32_t, uint32_t) {});
+        ring_.unregisterRingFd();
+        CoarseClock::detach();
+    }
+
+    const char *backendName() const override { return "io_uring"; }
+
+protected:
+    void set_interest(int fd, ConnCtx &ctx, uint32_t interest) override {
+        uint32_t added = interest & ~ctx.interest;
+        ctx.interest = interest;
+        if (!(added & WANT_READ)) return;
+        UringConn &u = uconns_[fd];
+        if (u.eof_pending) {
+            deferred_eof_.emplace_back(fd, ctx.generation);
+        } else if (!u.recv_armed) {
+            arm_recv(fd, ctx);
+        }
+    }
+
+    // Submit every queued response segment as one gathered SENDMSG unless
+    // a send is already in flight; the completion continues the flush.
+    // File segments and a spilled tail are sent with sendfile() (io_uring
+    // has no file-to-socket op short of a splice pipe pair), waiting on a
+    // POLLOUT poll whenever the socket is full.
+    bool flush(int fd, ConnCtx &ctx) override {
+        UringConn &u = uconns_[fd];
+        if (u.send_inflight) return true;
+        if (!u.send_buf) u.send_buf = std::make_unique<SendBuf>();
+        SendBuf &sb = *u.send_buf;
+        size_t cnt = ctx.conn_io->pendingWriteSegments(sb.iov, EGRESS_IOV_MAX);
+        if (cnt == 0) {
+            if (!send_file(fd, ctx)) return false;
+            if (u.send_inflight) return true;
+            return after_flush(fd, ctx);
+        }
+
+        struct io_uring_sqe *sqe = ring_.getSqe();
+        if (!sqe) {
+            close_conn(fd, ctx);
+            return false;
+        }
+        sb.msg = msghdr{};
+        sb.msg.msg_iov = sb.iov;
+        sb.msg.msg_iovlen = cnt;
+        sqe->opcode = IORING_OP_SENDMSG;
+        set_target(sqe, fd, u);
+        sqe->addr = reinterpret_cast<uint64_t>(&sb.msg);
+        sqe->len = 1;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = tag(OP_SEND, fd, ctx.generation);
+        u.send_inflight = true;
+        u.send_io = ctx.conn_io;  // keeps the segments alive until completion
+        ctx.interest |= WANT_WRITE;
+        return true;
+    }
+
+    // Cancel the connection's operations, drop it from the registered file
+    // table and close it — hard-linked so each step runs after the last.
+    void close_socket(int fd, ConnCtx &ctx) override {
+        UringConn &u = uconns_[fd];
+        ctx.interest = 0;
+
+        struct io_uring_sqe *sqe = ring_.getSqe();
+        if (!sqe) {
+            close(fd);
+            return;
+        }
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = fd;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL |
+                            (u.fixed ? IORING_ASYNC_CANCEL_FD_FIXED : 0);
+        sqe->flags = IOSQE_IO_HARDLINK;
+        sqe->user_data = tag(OP_IGNORE, fd, ctx.generation);
+
+        if (u.fixed) {
+            file_vals_[fd] = -1;
+            sqe = ring_.getSqe();
+            if (sqe) {
+                sqe->opcode = IORING_OP_FILES_UPDATE;
+                sqe->fd = -1;
+                sqe->off = static_cast<uint64_t>(fd);
+                sqe->addr = reinterpret_cast<uint64_t>(&file_vals_[fd]);
+                sqe->len = 1;
+                sqe->flags = IOSQE_IO_HARDLINK;
+                sqe->user_data = tag(OP_IGNORE, fd, ctx.generation);
+            }
+        }
+
+        sqe = ring_.getSqe();
+        if (!sqe) {
+            close(fd);
+            return;
+        }
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = fd;
+        sqe->user_data = tag(OP_IGNORE, fd, ctx.generation);
+        u.eof_pending = false;
+    }
+
+    // Cancel the multishot accept; on_accept() no longer re-arms it.  A
+    // connection it took before the cancel landed is still served.
+    void stop_accepting() override {
+        struct io_uring_sqe *sqe = ring_.getSqe();
+        if (!sqe) return;
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = tag(OP_ACCEPT, 0, 0);
+        sqe->user_data = tag(OP_IGNORE, 0, 0);
+    }
+
+    bool accept_pending() const override { return accept_armed_; }
+
+private:
+    // ── user_data encoding: op (8 bits) | generation (24 bits) | fd (32 bits)
+
+    enum Op : uint64_t {
+        OP_IGNORE = 0,
+        OP_ACCEPT,
+        OP_EVENTFD,
+        OP_RECV,
+        OP_SEND,
+        OP_FILES_UPDATE,
+        OP_BUFFERS,
+        OP_WRITABLE,
+        OP_TICK,
+    };
+
+    static uint64_t tag(Op op, int fd, uint32_t generation) {
+        return (static_cast<uint64_t>(op) << 56) |
+               (static_cast<uint64_t>(generation & 0xFFFFFF) << 32) |
+               static_cast<uint32_t>(fd);
+    }
+    static Op tag_op(uint64_t ud) { return static_cast<Op>(ud >> 56); }
+    static uint32_t tag_gen(uint64_t ud) { return static_cast<uint32_t>(ud >> 32) & 0xFFFFFF; }
+    static int tag_fd(uint64_t ud) { return static_cast<int>(static_cast<uint32_t>(ud)); }
+
+    // Gather list of an in-flight SENDMSG (must stay put until completion).
+    struct SendBuf {
+        struct msghdr msg;
+        struct iovec iov[EGRESS_IOV_MAX];
+    };
+
+    // Backend state per connection slot (parallel to slots_).
+    struct UringConn {
+        bool fixed = false;         // socket is in the registered file table
+        bool recv_armed = false;    // a (multishot) recv is outstanding
+        bool recv_cancelling = false;
+        bool eof_pending = false;   // EOF seen while the connection did not want input
+        bool send_inflight = false;
+        std::shared_ptr<ConnectionIO> send_io;  // owner of the in-flight segments
+        std::unique_ptr<SendBuf> send_buf;      // kept across connections on this slot
+
+        // Back to the initial state for a new connection on the slot.
+        void reset() {
+            fixed = recv_armed = recv_cancelling = eof_pending = send_inflight = false;
+            send_io.reset();
+        }
+    };
+
+    // Connection slot still matching the generation encoded in user_data.
+    ConnCtx *live_slot(uint64_t ud) {
+        ConnCtx *ctx = slot(tag_fd(ud));
+        return (ctx && (ctx->generation & 0xFFFFFF) == tag_gen(ud)) ? ctx : nullptr;
+    }
+
+    void set_target(struct io_uring_sqe *sqe, int fd, const UringConn &u) {
+        sqe->fd = fd;  // registered slot index == fd number
+        if (u.fixed) sqe->flags |= IOSQE_FIXED_FILE;
+    }
+
+    // ── Setup ───────────────────────────────────────────────────────
+
+    bool probe_ops() {
+        size_t len = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+        std::unique_ptr<char[]> mem(new char[len]());
+        struct io_uring_probe *probe = reinterpret_cast<struct io_uring_probe *>(mem.get());
+        if (ring_.registerOp(IORING_REGISTER_PROBE, probe, 256) < 0) {
+            LOG_ERROR("io_uring: probe failed: " << strerror(errno));
+            return false;
+        }
+        const uint8_t needed[] = {IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SENDMSG,
+                                  IORING_OP_READ, IORING_OP_FILES_UPDATE,
+                                  IORING_OP_ASYNC_CANCEL, IORING_OP_CLOSE,
+                                  IORING_OP_PROVIDE_BUFFERS, IORING_OP_POLL_ADD};
+        for (uint8_t op : needed) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+                LOG_ERROR("io_uring: opcode " << static_cast<int>(op) << " not supported");
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Hand the receive buffers to the kernel as one provided-buffer
+    // group.  The classic PROVIDE_BUFFERS interface is used rather than a
+    // registered buffer ring: it works on every kernel with multishot recv.
+    bool provide_buffers() {
+        if (posix_memalign(reinterpret_cast<void **>(&buf_base_), 4096,
+                           static_cast<size_t>(URING_RECV_BUFFERS) * URING_RECV_BUFFER_SIZE) != 0) {
+            buf_base_ = nullptr;
+            LOG_ERROR("io_uring: receive buffer allocation failed");
+            return false;
+        }
+        struct io_uring_sqe *sqe = ring_.getSqe();
+        if (!sqe) return false;
+        sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+        sqe->fd = static_cast<int>(URING_RECV_BUFFERS);  // number of buffers
+        sqe->addr = reinterpret_cast<uint64_t>(buf_base_);
+        sqe->len = URING_RECV_BUFFER_SIZE;
+        sqe->off = 0;  // first buffer id
+        sqe->buf_group = BUFFER_GROUP;
+        sqe->user_data = tag(OP_BUFFERS, 0, 0);
+        return true;
+    }
+
+    // Register a sparse file table; clients are installed at index == fd.
+    // Best effort: without it, operations use plain fds.
+    void setup_fixed_files() {
+        unsigned nr = URING_MAX_FIXED_FILES;
+        struct rlimit rl{};
+        if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY) {
+            nr = std::min<unsigned>(nr, static_cast<unsigned>(rl.rlim_cur));
+        }
+        struct io_uring_rsrc_register reg{};
+        reg.nr = nr;
+        reg.flags = IORING_RSRC_REGISTER_SPARSE;
+        if (ring_.registerOp(IORING_REGISTER_FILES2, &reg, sizeof(reg)) < 0) {
+            LOG_INFO("io_uring: registered files unavailable: " << strerror(errno));
+            return;
+        }
+        file_vals_.assign(nr, -1);
+    }
+
+    // Hand provided buffer \p bid back to the kernel.
+    void add_buffer(unsigned bid) {
+        struct io_uring_sqe *sqe = ring_.getSqe();
+        if (!sqe) return;
+        sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+        sqe->fd = 1;
+        sqe->addr = reinterpret_cast<uint64_t>(buf_base_ + static_cast<size_t>(bid) * URING_RECV_BUFFER_SIZE);
+        sqe->len = URING_RECV_BUFFER_SIZE;
+        sqe->off = bid;
+        sqe->buf_group = BUFFER_GROUP;
+        sqe->user_data = tag(OP_BUFFERS, 0, 0);
+    }
+
+    // ── Arming operations ───────────────────────────────────────────
+
+    void arm_accept() {
+        struct io_uring_sqe *sqe = ring_.getSqe();
+        if (!sqe) return;
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = listen_fd_;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        sqe->user_data = tag(OP_ACCEPT, 0, 0);
+        accept_armed_ = true;
+    }
+
+    void arm_eventfd() {
+        struct io_uring_sqe *sqe = ring_.getSqe();
+        if (!sqe) return;
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = event_fd_;
+        sqe->addr = reinterpret_cast<uint64_t>(&event_val_);
+        sqe->len = sizeof(event_val_);
+        sqe->off = static_cast<uint64_t>(-1);
+        sqe->user_data = tag(OP_EVENTFD, 0, 0);
+    }
+
+    void arm_tick() {
+        struct io_uring_sqe *sqe = ring_.getSqe();
+        if (!sqe) return;
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = timer_fd_;
+        sqe->addr = reinterpret_cast<uint64_t>(&tick_val_);
+        sqe->len = sizeof(tick_val_);
+        sqe->off = static_cast<uint64_t>(-1);
+        sqe->user_data = tag(OP_TICK, 0, 0);
+    }
+
+    void arm_recv(int fd, ConnCtx &ctx) {
+        UringConn &u = uconns_[fd];
+        struct io_uring_sqe *sqe = ring_.getSqe();
+        if (!sqe) return;
+        sqe->opcode = IORING_OP_RECV;
+        set_target(sqe, fd, u);
+        sqe->flags |= IOSQE_BUFFER_SELECT;
+        sqe->buf_group = BUFFER_GROUP;
+        if (recv_multishot_) sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->user_data = tag(OP_RECV, fd, ctx.generation);
+        u.recv_armed = true;
+    }
+
+    // ── Completions ─────────────────────────────────────────────────
+
+    void on_completion(uint64_t ud, int32_t res, uint32_t flags) {
+        switch (tag_op(ud)) {
+        case OP_ACCEPT:
+            on_accept(res, flags);
+            break;
+        case OP_EVENTFD:
+            drain_ready();
+            arm_eventfd();
+            break;
+        case OP_TICK:
+            arm_tick();  // the timers run at the end of the loop turn
+            break;
+        case OP_RECV:
+            on_recv(ud, res, flags);
+            break;
+        case OP_SEND:
+            on_send(ud, res);
+            break;
+        case OP_WRITABLE:
+            on_writable(ud, res);
+            break;
+        case OP_FILES_UPDATE:
+            on_files_update(ud, res);
+            break;
+        case OP_BUFFERS:
+            if (res < 0) LOG_ERROR("io_uring: providing receive buffers failed: " << strerror(-res));
+            break;
+        case OP_IGNORE:
+            break;
+        }
+    }
+
+    void on_accept(int32_t res, uint32_t flags) {
+        if (!(flags & IORING_CQE_F_MORE)) {
+            accept_armed_ = false;
+            if (!drain_started_ && !shutdown_.load(std::memory_order_relaxed)) {
+                arm_accept();  // multishot ended (error or overflow): re-arm
+            }
+        }
+        if (res < 0) {
+            if (res != -ECANCELED && res != -ECONNABORTED && res != -EAGAIN &&
+                !shutdown_.load(std::memory_order_relaxed)) {
+                LOG_ERROR("Accept error: " << strerror(-res));
+            }
+            return;
+        }
+        int client_fd = res;
+        LOG_INFO("Accepted new connection: fd " << client_fd);
+        if (shed_accept(client_fd)) return;
+
+        ConnCtx &ctx = claim_slot(client_fd);
+        if (uconns_.size() < slots_.size()) uconns_.resize(slots_.size());
+        UringConn &u = uconns_[client_fd];
+        u.reset();
+
+        if (static_cast<size_t>(client_fd) < file_vals_.size()) {
+            // Install the socket in the registered table, then start
+            // receiving through it.
+            struct io_uring_sqe *sqe = ring_.getSqe();
+            if (sqe) {
+                file_vals_[client_fd] = client_fd;
+                sqe->opcode = IORING_OP_FILES_UPDATE;
+                sqe->fd = -1;
+                sqe->off = static_cast<uint64_t>(client_fd);
+                sqe->addr = reinterpret_cast<uint64_t>(&file_vals_[client_fd]);
+                sqe->len = 1;
+                sqe->flags = IOSQE_IO_LINK;
+                sqe->user_data = tag(OP_FILES_UPDATE, client_fd, ctx.generation);
+                u.fixed = true;
+            }
+        }
+        arm_recv(client_fd, ctx);
+    }
+
+    void on_files_update(uint64_t ud, int32_t res) {
+        if (res >= 0) return;
+        // Registration failed, so the linked recv was cancelled: fall back
+        // to the plain fd for this connection.
+        ConnCtx *ctx = live_slot(ud);
+        if (!ctx) return;
+        UringConn &u = uconns_[tag_fd(ud)];
+        u.fixed = false;
+    }
+
+    void on_recv(uint64_t ud, int32_t res, uint32_t flags) {
+        if (flags & IORING_CQE_F_BUFFER) {
+            // Copy out first; the buffer goes back to the ring right away.
+            unsigned bid = flags >> IORING_CQE_BUFFER_SHIFT;
+            ConnCtx *ctx = live_slot(ud);
+            bool open = true;
+            if (ctx && res > 0) {
+                const char *data = buf_base_ + static_cast<size_t>(bid) * URING_RECV_BUFFER_SIZE;
+                open = on_data(tag_fd(ud), *ctx, data, static_cast<size_t>(res));
+            }
+            add_buffer(bid);
+            if (!ctx || !open) return;
+        }
+
+        ConnCtx *ctx = live_slot(ud);
+        if (!ctx) return;
+        int fd = tag_fd(ud);
+        UringConn &u = uconns_[fd];
+        bool more = (flags & IORING_CQE_F_MORE) != 0;
+        if (!more) {
+            u.recv_armed = false;
+            u.recv_cancelling = false;
+        }
+
+        if (res == 0) {
+            // Peer closed its write direction.
+            if (ctx->interest & WANT_READ) {
+                on_peer_eof(fd, *ctx);
+            } else {
+                u.eof_pending = true;
+            }
+            return;
+        }
+        if (res < 0) {
+            if (res == -EINVAL && recv_multishot_) {
+                // Kernel without multishot recv: use one-shot receives.
+                LOG_INFO("io_uring: multishot recv unsupported, using one-shot recv");
+                recv_multishot_ = false;
+            } else if (res != -ENOBUFS && res != -ECANCELED) {
+                // Anything else is fatal.  -ENOBUFS (the buffer group ran
+                // dry) and -ECANCELED (our own cancel, or a failed linked
+                // FILES_UPDATE, which cleared `fixed`) just re-arm below.
+                close_conn(fd, *ctx);
+                return;
+            }
+        }
+
+        // Keep one recv outstanding while input is wanted or the bytes held
+        // back (pipelined requests, body the ring had no room for) are
+        // below MAX_HEADER_SIZE; past that, or once the memory budget has
+        // throttled the connection, cancel it so TCP pushes back.
+        bool wanted = (ctx->interest & WANT_READ) ||
+                      (!ctx->throttled &&
+                       ctx->header_buf.size() + ctx->body_backlog.size() < MAX_HEADER_SIZE);
+        if (!u.recv_armed && wanted) {
+            arm_recv(fd, *ctx);
+        } else if (u.recv_armed && !wanted && !u.recv_cancelling) {
+            struct io_uring_sqe *sqe = ring_.getSqe();
+            if (sqe) {
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->addr = ud;  // match the recv by its user_data
+                sqe->user_data = tag(OP_IGNORE, fd, ctx->generation);
+                u.recv_cancelling = true;
+            }
+        }
+    }
+
+    void on_send(uint64_t ud, int32_t res) {
+        int fd = tag_fd(ud);
+        if (static_cast<size_t>(fd) < uconns_.size()) {
+            UringConn &u = uconns_[fd];
+            if (u.send_inflight && (!slot(fd) || live_slot(ud))) {
+                u.send_inflight = false;
+                u.send_io.reset();
+            }
+        }
+        ConnCtx *ctx = live_slot(ud);
+        if (!ctx || !ctx->conn_io) return;
+        ctx->interest &= ~WANT_WRITE;
+        if (res < 0) {
+            if (res == -EAGAIN || res == -EINTR) {
+                flush(fd, *ctx);
+                return;
+            }
+            ctx->conn_io->writeError();
+            close_conn(fd, *ctx);
+            return;
+        }
+        ctx->last_io = tick_;
+        ctx->conn_io->advanceWrite(static_cast<size_t>(res));
+        flush(fd, *ctx);
+    }
+
+    // Send file segments and the spilled tail of the response until they
+    // are done, in-memory segments are next, or the socket is full; in the
+    // last case arm a POLLOUT poll, which holds send_inflight like a
+    // SENDMSG would.  Returns false if the connection was closed.
+    bool send_file(int fd, ConnCtx &ctx) {
+        int file_fd;
+        off_t off;
+        size_t len;
+        while (ctx.conn_io->pendingFile(file_fd, off, len)) {
+            ssize_t sent = ::sendfile(fd, file_fd, &off, len);
+            if (sent > 0) {
+                ctx.last_io = tick_;
+                ctx.conn_io->advanceFile(static_cast<size_t>(sent));
+                struct iovec next;
+                if (ctx.conn_io->pendingWriteSegments(&next, 1) > 0) return flush(fd, ctx);
+                continue;
+            }
+            if (sent < 0 && errno == EINTR) continue;
+            if (sent == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                // sendfile() returns 0 if the file shrank below the range.
+                if (sent == 0) LOG_ERROR("Response file truncated while sending (fd " << fd << ")");
+                ctx.conn_io->writeError();
+                close_conn(fd, ctx);
+                return false;
+            }
+            UringConn &u = uconns_[fd];
+            struct io_uring_sqe *sqe = ring_.getSqe();
+            if (!sqe) {
+                close_conn(fd, ctx);
+                return false;
+            }
+            sqe->opcode = IORING_OP_POLL_ADD;
+            set_target(sqe, fd, u);
+            sqe->poll32_events = POLLOUT;
+            sqe->user_data = tag(OP_WRITABLE, fd, ctx.generation);
+            u.send_inflight = true;
+            ctx.interest |= WANT_WRITE;
+            break;
+        }
+        return true;
+    }
+
+    void on_writable(uint64_t ud, int32_t res) {
+        int fd = tag_fd(ud);
+        if (static_cast<size_t>(fd) < uconns_.size()) {
+            UringConn &u = uconns_[fd];
+            if (u.send_inflight && (!slot(fd) || live_slot(ud))) u.send_inflight = false;
+        }
+        ConnCtx *ctx = live_slot(ud);
+        if (!ctx || !ctx->conn_io) return;
+        ctx->interest &= ~WANT_WRITE;
+        if (res < 0 && res != -EINTR) {
+            ctx->conn_io->writeError();
+            close_conn(fd, *ctx);
+            return;
+        }
+        flush(fd, *ctx);
+    }
+
+    // EOFs held back until the connection wanted input again.
+    void deliver_deferred_eof() {
+        while (!deferred_eof_.empty()) {
+            std::pair<int, uint32_t> e = deferred_eof_.back();
+            deferred_eof_.pop_back();
+            ConnCtx *ctx = slot(e.first, e.second);
+            if (!ctx || !(ctx->interest & WANT_READ)) continue;
+            UringConn &u = uconns_[e.first];
+            if (!u.eof_pending) continue;
+            u.eof_pending = false;
+            on_peer_eof(e.first, *ctx);
+        }
+    }
+
+    static constexpr uint16_t BUFFER_GROUP = 0;
+
+    IoUring ring_;
+    bool recv_multishot_ = true;
+    std::vector<UringConn> uconns_;           // indexed by fd, parallel to slots_
+    std::vector<int> file_vals_;              // registered-file update values (stable storage)
+    std::vector<std::pair<int, uint32_t>> deferred_eof_;
+    uint64_t event_val_ = 0;                  // eventfd read target
+    uint64_t tick_val_ = 0;                   // timerfd read target
+    bool accept_armed_ = false;               // the multishot accept has not ended
+
+    char *buf_base_ = nullptr;                // URING_RECV_BUFFERS provided buffers
+};
+
+#else  // !LSWASM_HAVE_IO_URING
+
+/// Placeholder when the system headers lack the required io_uring
+/// features: init() always fails, so the caller falls back to epoll.
+class UringReactor final : public HttpReactor {
+public:
+    using HttpReactor::HttpReactor;
+
+    bool init() override {
+        LOG_ERROR("io_uring backend not available in this build");
+        return false;
+    }
+    void run() override {}
+    const char *backendName() const override { return "io_uring"; }
+
+protected:
+    void set_interest(int, ConnCtx &, uint32_t) override {}
+    bool flush(int, ConnCtx &) override { return false; }
+    void close_socket(int fd, ConnCtx &) override { close(fd); }
+    void stop_accepting() override {}
+};
+
+#endif  // LSWASM_HAVE_IO_URING
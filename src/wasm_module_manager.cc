@@ -24,6 +24,12 @@
 
 #include "include/proxy-wasm/bytecode_util.h"
 
+namespace {
+// Plugin handles (and through them the VM clones) that warmThread() keeps
+// alive on this thread.
+thread_local std::vector<std::shared_ptr<proxy_wasm::PluginHandleBase>> t_warm_plugins;
+} // namespace
+
 bool WasmModuleManager::loadModule(const std::string &module_path,
                                     const std::string &module_name) {
   // Read WASM file
@@ -275,6 +281,27 @@ bool WasmModuleManager::createRequestScope(const std::string &module_name,
   return scope.init(it->second, context_id);
 }
 
+bool WasmModuleManager::warmThread() const {
+  std::shared_lock<std::shared_mutex> rlock(modules_mutex_);
+  bool ok = true;
+  for (const auto &[name, state] : modules_) {
+    std::shared_ptr<proxy_wasm::PluginHandleBase> handle =
+        proxy_wasm::getOrCreateThreadLocalPlugin(state.base_handle, state.plugin,
+                                                 state.clone_factory, state.plugin_factory);
+    if (!handle || !handle->wasm() || handle->wasm()->isFailed()) {
+      LOG_ERROR("Failed to create thread-local VM clone of module " << name);
+      ok = false;
+      continue;
+    }
+    t_warm_plugins.push_back(std::move(handle));
+  }
+  return ok;
+}
+
+void WasmModuleManager::releaseThread() {
+  t_warm_plugins.clear();
+}
+
 bool WasmModuleManager::unloadModule(const std::string &module_name) {
   std::unique_lock<std::shared_mutex> wlock(modules_mutex_);
   auto it = modules_.find(module_name);
@@ -24,6 +24,7 @@
 #include <atomic>
 #include <cctype>
 #include <cstdio>
+#include <cstring>
 #include <map>
 #include <mutex>
 #include <shared_mutex>
@@ -33,6 +34,7 @@
 #include <chrono>
 
 #include "log.h"
+#include "coarse_clock.h"
 #include "http_utils.h"
 
 #include "proxy-wasm/wasm_vm.h"
@@ -61,6 +63,15 @@ enum class StreamingResponseState {
 
 // header_name_eq() is now defined in http_utils.h (included above).
 
+// Request body batching a module asked for via lswasm_set_body_delivery.
+// A zero chunk size leaves the host default in place.
+struct BodyDeliveryHint {
+  bool set = false;
+  uint32_t min_chunk = 0;       // wake the filter once this many bytes are buffered
+  uint32_t max_chunk = 0;       // largest chunk per onRequestBody()
+  uint32_t max_latency_ms = 0;  // longest a smaller chunk is held back
+};
+
 namespace lswasm {
 
 /**
@@ -288,17 +299,10 @@ public:
 
   uint32_t getLogLevel() override { return static_cast<uint32_t>(proxy_wasm::LogLevel::trace); }
 
-  uint64_t getCurrentTimeNanoseconds() override {
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(
-               std::chrono::system_clock::now().time_since_epoch())
-        .count();
-  }
+  // Served from the reactors' cached clock: at most one timer tick old.
+  uint64_t getCurrentTimeNanoseconds() override { return CoarseClock::realtimeNs(); }
 
-  uint64_t getMonotonicTimeNanoseconds() override {
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(
-               std::chrono::steady_clock::now().time_since_epoch())
-        .count();
-  }
+  uint64_t getMonotonicTimeNanoseconds() override { return CoarseClock::monotonicNs(); }
 
   // Capture sendLocalResponse from the WASM module (called by proxy_send_local_response).
   proxy_wasm::WasmResult sendLocalResponse(uint32_t response_code, std::string_view body,
@@ -529,12 +533,132 @@ public:
     return proxy_wasm::WasmResult::Ok;
   }
 
+  /// Send a complete response whose body is the file at \p path: \p len
+  /// bytes from \p offset (UINT64_MAX for the rest of the file).  That
+  /// slice is the representation a Range request header selects from:
+  /// a single byte range of a GET or HEAD yields 206 with Content-Range,
+  /// an unsatisfiable one 416, anything else 200.  An If-Range that does
+  /// not match the Last-Modified or ETag header disables the range.  The
+  /// host sets Content-Length and, unless \p headers carry them,
+  /// Accept-Ranges and Last-Modified (from the file's mtime).  The file is
+  /// opened through the fd cache and its bytes are sent by the sink
+  /// without entering WASM memory; a HEAD response carries no body.
+  /// Returns NotFound (nothing sent) if the file cannot be opened, so
+  /// the filter may still answer otherwise.
+  proxy_wasm::WasmResult streamingSendFile(const std::string &path, uint64_t offset,
+                                           uint64_t len, const HeaderPairs &headers) {
+    if (!sink_) {
+      LOG_ERROR("[Streaming] no ResponseSink — cannot send file");
+      return proxy_wasm::WasmResult::InternalFailure;
+    }
+    if (streaming_state_ != StreamingResponseState::Idle) {
+      LOG_ERROR("[Streaming] sendFile called after the response started");
+      return proxy_wasm::WasmResult::BadArgument;
+    }
+    std::shared_ptr<const OpenFile> file = file_cache().open(path);
+    if (!file) {
+      LOG_ERROR("[Streaming] cannot open '" << path << "': " << std::strerror(errno));
+      return proxy_wasm::WasmResult::NotFound;
+    }
+    if (offset > file->size) {
+      LOG_ERROR("[Streaming] sendFile offset " << offset << " beyond the end of '"
+                << path << "' (" << file->size << " bytes)");
+      return proxy_wasm::WasmResult::BadArgument;
+    }
+    uint64_t size = std::min(len, file->size - offset);
+
+    HeaderPairs out;
+    out.reserve(headers.size() + 4);
+    std::string_view last_modified, etag;
+    bool accept_ranges = false;
+    for (const auto &hdr : headers) {
+      // Framing is the host's: the sink and the range decide it.
+      if (header_name_eq(hdr.first, "Content-Length") ||
+          header_name_eq(hdr.first, "Content-Range") ||
+          header_name_eq(hdr.first, "Transfer-Encoding")) {
+        continue;
+      }
+      if (header_name_eq(hdr.first, "Last-Modified")) last_modified = hdr.second;
+      if (header_name_eq(hdr.first, "ETag")) etag = hdr.second;
+      if (header_name_eq(hdr.first, "Accept-Ranges")) accept_ranges = true;
+      out.emplace_back(hdr.first, hdr.second);
+    }
+    std::string mtime_date;
+    if (last_modified.empty()) {
+      mtime_date = http_utils::http_date(file->mtime.tv_sec);
+      last_modified = mtime_date;
+    }
+
+    std::string_view method, range, if_range;
+    getHeaderMapValue(proxy_wasm::WasmHeaderMapType::RequestHeaders, ":method", &method);
+    getHeaderMapValue(proxy_wasm::WasmHeaderMapType::RequestHeaders, "range", &range);
+    getHeaderMapValue(proxy_wasm::WasmHeaderMapType::RequestHeaders, "if-range", &if_range);
+    bool head = (method == "HEAD");
+
+    uint32_t status = 200;
+    uint64_t first = 0, last = 0;
+    http_utils::ByteRange kind = http_utils::ByteRange::Full;
+    if (!range.empty() && (head || method == "GET") &&
+        (if_range.empty() || if_range == last_modified || (!etag.empty() && if_range == etag &&
+                                                           etag.substr(0, 2) != "W/"))) {
+      kind = http_utils::parse_byte_range(range, size, first, last);
+    }
+    uint64_t body_offset = offset;
+    uint64_t body_len = size;
+    if (kind == http_utils::ByteRange::Partial) {
+      status = 206;
+      body_offset = offset + first;
+      body_len = last - first + 1;
+      out.emplace_back("Content-Range", "bytes " + std::to_string(first) + "-" +
+                                            std::to_string(last) + "/" + std::to_string(size));
+    } else if (kind == http_utils::ByteRange::Unsatisfiable) {
+      status = 416;
+      body_len = 0;
+      out.emplace_back("Content-Range", "bytes */" + std::to_string(size));
+    }
+    if (!accept_ranges) out.emplace_back("Accept-Ranges", "bytes");
+    if (!mtime_date.empty()) out.emplace_back("Last-Modified", mtime_date);
+    out.emplace_back("Content-Length", std::to_string(body_len));
+
+    if (!sink_->sendHeaders(status, out, /*streaming=*/false)) {
+      LOG_ERROR("[Streaming] sendHeaders failed");
+      return proxy_wasm::WasmResult::InternalFailure;
+    }
+    streaming_state_ = StreamingResponseState::HeadersSent;
+    if (!head && body_len > 0 &&
+        !sink_->sendFile(file, static_cast<off_t>(body_offset), static_cast<size_t>(body_len))) {
+      LOG_ERROR("[Streaming] sendFile failed");
+      return proxy_wasm::WasmResult::InternalFailure;
+    }
+    if (!sink_->finishBody()) {
+      LOG_ERROR("[Streaming] finishBody failed");
+      return proxy_wasm::WasmResult::InternalFailure;
+    }
+    streaming_state_ = StreamingResponseState::Finished;
+    server_stats().files_sent.fetch_add(1, std::memory_order_relaxed);
+    LOG_INFO("[Streaming] sent file '" << path << "': status=" << status
+             << " bytes=" << (head ? 0 : body_len));
+    return proxy_wasm::WasmResult::Ok;
+  }
+
   /// Reset streaming state between requests (if context is reused).
   void resetStreamingState() {
     sink_ = nullptr;
     streaming_state_ = StreamingResponseState::Idle;
+    body_delivery_ = BodyDeliveryHint();
+  }
+
+  /// Record how the filter wants the request body batched (see
+  /// lswasm_set_body_delivery).  Takes effect for the body chunks that
+  /// follow onRequestHeaders().
+  void setBodyDelivery(uint32_t min_chunk, uint32_t max_chunk, uint32_t max_latency_ms) {
+    body_delivery_ = BodyDeliveryHint{true, min_chunk, max_chunk, max_latency_ms};
+    LOG_INFO("[Streaming] body delivery: min=" << min_chunk << " max=" << max_chunk
+             << " latency=" << max_latency_ms << "ms");
   }
 
+  const BodyDeliveryHint &bodyDelivery() const { return body_delivery_; }
+
 private:
   // Helper: downcast wasm() to LsWasm* (defined out-of-line after LsWasm).
   inline LsWasm *lswasm();
@@ -561,6 +685,7 @@ private:
   // ---- Streaming response state ----
   ResponseSink *sink_ = nullptr;
   StreamingResponseState streaming_state_ = StreamingResponseState::Idle;
+  BodyDeliveryHint body_delivery_;
 };
 
 /**
@@ -1003,6 +1128,23 @@ public:
   bool createRequestScope(const std::string &module_name, uint32_t context_id,
                           RequestScope &scope) const;
 
+  /**
+   * Create the calling thread's VM clone of every loaded module now,
+   * rather than on its first request, and keep it for as long as the
+   * thread runs (proxy-wasm holds thread-local clones only while
+   * something references them).  Called by each worker and reactor
+   * thread before it takes traffic.
+   * Thread-safe: takes a read lock on modules_mutex_.
+   * @return false if a clone could not be created.
+   */
+  bool warmThread() const;
+
+  /**
+   * Drop the clones warmThread() keeps on the calling thread.  Threads
+   * that outlive the module manager must call this before it is destroyed.
+   */
+  static void releaseThread();
+
   /**
    * Unload a module.
    * Thread-safe: takes a write lock on modules_mutex_.
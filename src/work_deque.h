@@ -0,0 +1,116 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2026  LiteSpeed Technologies, Inc.                        *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * WorkDeque — fixed-capacity Chase-Lev work-stealing deque of pointers.
+ *
+ * One owner thread pushes and pops at the bottom (LIFO); any number of
+ * thieves steal from the top (FIFO) with a CAS.  The slot array is part of
+ * the object, so neither side ever allocates: push() fails when the deque
+ * is full and the caller finds the item another home.
+ *
+ * Memory ordering follows Lê, Pop, Cohen and Zappa Nardelli, "Correct and
+ * Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013).
+ */
+template <typename T, size_t Capacity = 256>
+class WorkDeque {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    WorkDeque() {
+        for (std::atomic<T *> &slot : slots_) slot.store(nullptr, std::memory_order_relaxed);
+    }
+
+    // Non-copyable, non-movable.
+    WorkDeque(const WorkDeque &) = delete;
+    WorkDeque &operator=(const WorkDeque &) = delete;
+
+    /// Owner: add \p item at the bottom.  Returns false if the deque is full.
+    bool push(T *item) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        if (b - t >= static_cast<int64_t>(Capacity)) return false;
+        slots_[b & MASK].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /// Owner: take the item at the bottom, or nullptr if empty.
+    T *pop() {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T *item = slots_[b & MASK].load(std::memory_order_relaxed);
+        if (t == b) {
+            // Last item: race the thieves for it.
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    /// Any thread: take the item at the top, or nullptr if the deque is
+    /// empty or another thread won the race for it.
+    T *steal() {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+        T *item = slots_[t & MASK].load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    /// Owner: free slots.  Thieves only ever add to it, so push() succeeds
+    /// that many times.
+    size_t room() const {
+        int64_t used = bottom_.load(std::memory_order_relaxed) - top_.load(std::memory_order_acquire);
+        return Capacity - static_cast<size_t>(std::max<int64_t>(used, 0));
+    }
+
+    /// Any thread: true if the deque looked empty.  Only a hint.
+    bool empty() const {
+        return top_.load(std::memory_order_acquire) >= bottom_.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr int64_t MASK = static_cast<int64_t>(Capacity) - 1;
+
+    alignas(64) std::atomic<int64_t> top_{0};     // next item to steal
+    alignas(64) std::atomic<int64_t> bottom_{0};  // next free slot (owner)
+    std::atomic<T *> slots_[Capacity];
+};
@@ -9,6 +9,11 @@
 #   5. Copy the new binary to the installed location.
 #   6. Restart the service.
 #
+# When the service was installed with --hot-restart, step 4 is skipped and
+# step 6 is a "systemctl --user reload": the running server starts the new
+# binary, hands over its listening sockets and drains, so no connection is
+# refused during the upgrade.  --cold forces the stop/start sequence.
+#
 # Usage:
 #   ./upgrade.sh [options]
 #
@@ -18,6 +23,7 @@
 #   --no-clean            Incremental build instead of clean rebuild
 #   --no-pull             Skip git pull (use local source as-is)
 #   --service-name <name> systemd unit name (default: from install state)
+#   --cold                Stop and start the service even with hot restart
 #   --help                Show this help message
 #
 # The script reads the install state from ~/.local/state/lswasm/install-state.env
@@ -36,6 +42,7 @@ CMAKE_ARGS=""
 CLEAN=true
 PULL=true
 SERVICE_NAME_OVERRIDE=""
+COLD=false
 
 # ── Parse arguments ─────────────────────────────────────────────────────
 while [[ $# -gt 0 ]]; do
@@ -50,12 +57,14 @@ while [[ $# -gt 0 ]]; do
       PULL=false; shift ;;
     --service-name)
       SERVICE_NAME_OVERRIDE="$2"; shift 2 ;;
+    --cold)
+      COLD=true; shift ;;
     --help)
       sed -n '2,/^$/{ s/^# //; s/^#$//; p }' "$0"
       exit 0 ;;
     *)
       echo "Unknown option: $1" >&2
-      echo "Usage: $0 [--build-dir <path>] [--cmake-args <args>] [--no-clean] [--no-pull] [--service-name <name>]" >&2
+      echo "Usage: $0 [--build-dir <path>] [--cmake-args <args>] [--no-clean] [--no-pull] [--service-name <name>] [--cold]" >&2
       exit 1 ;;
   esac
 done
@@ -76,10 +85,17 @@ if [[ -n "$SERVICE_NAME_OVERRIDE" ]]; then
   SERVICE_NAME="$SERVICE_NAME_OVERRIDE"
 fi
 
+# Installs predating hot restart have no HOT_RESTART entry.
+HOT_RELOAD=false
+if [[ "${HOT_RESTART:-false}" == true ]] && ! $COLD; then
+  HOT_RELOAD=true
+fi
+
 echo "=== lswasm upgrade ==="
 echo "Installed binary: $INSTALLED_BIN"
 echo "Service name:     $SERVICE_NAME"
 echo "Build directory:  $BUILD_DIR"
+echo "Restart mode:     $($HOT_RELOAD && echo "hot (reload)" || echo "cold (stop/start)")"
 echo ""
 
 # ── Step 1: Pull latest source ──────────────────────────────────────────
@@ -118,27 +134,41 @@ if [[ ! -f "$NEW_BIN" ]]; then
 fi
 
 # ── Step 4: Stop the service ────────────────────────────────────────────
-echo "→ Stopping service $SERVICE_NAME..."
-if systemctl --user is-active --quiet "$SERVICE_NAME" 2>/dev/null; then
-  systemctl --user stop "$SERVICE_NAME"
-  echo "  Service stopped."
+if $HOT_RELOAD; then
+  echo "→ Hot restart: leaving $SERVICE_NAME running."
 else
-  echo "  Service was not running."
+  echo "→ Stopping service $SERVICE_NAME..."
+  if systemctl --user is-active --quiet "$SERVICE_NAME" 2>/dev/null; then
+    systemctl --user stop "$SERVICE_NAME"
+    echo "  Service stopped."
+  else
+    echo "  Service was not running."
+  fi
 fi
 echo ""
 
 # ── Step 5: Copy the new binary ─────────────────────────────────────────
+# Copy next to the target and rename over it: the running binary is never
+# written to, and a successor started mid-copy still execs a whole file.
 echo "→ Installing new binary to $INSTALLED_BIN..."
-cp "$NEW_BIN" "$INSTALLED_BIN"
-chmod 755 "$INSTALLED_BIN"
+cp "$NEW_BIN" "${INSTALLED_BIN}.new"
+chmod 755 "${INSTALLED_BIN}.new"
+mv -f "${INSTALLED_BIN}.new" "$INSTALLED_BIN"
 echo "  Binary updated."
 echo ""
 
 # ── Step 6: Restart the service ─────────────────────────────────────────
-echo "→ Reloading systemd and restarting $SERVICE_NAME..."
 systemctl --user daemon-reload
-systemctl --user start "$SERVICE_NAME"
-echo "  Service restarted."
+if $HOT_RELOAD && systemctl --user is-active --quiet "$SERVICE_NAME" 2>/dev/null; then
+  echo "→ Reloading $SERVICE_NAME (hot restart)..."
+  systemctl --user reload "$SERVICE_NAME"
+  echo "  Reload requested: the new binary takes over the listeners and the"
+  echo "  old process exits once its connections have drained."
+else
+  echo "→ Starting $SERVICE_NAME..."
+  systemctl --user start "$SERVICE_NAME"
+  echo "  Service restarted."
+fi
 echo ""
 
 # ── Done ─────────────────────────────────────────────────────────────────